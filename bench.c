@@ -0,0 +1,985 @@
+// engine benchmark: parse and prepare time, tree walker vs compiled program vs batch vs jit,
+// value and derivative spans, full viewport sampling at several widths, how a rebuild scales
+// with threads, what clipping and simplification leave to draw, parametric and polar
+// tracing, and indexing and querying a point cloud and fitting it. tables by default,
+// --json prints one record per line for tracking regressions
+// build: make bench
+#include "parser.h"
+#include "optimizer.h"
+#include "compiler.h"
+#include "vecmath.h"
+#include "jit.h"
+#include "expr.h"
+#include "samples.h"
+#include "implicit.h"
+#include "pool.h"
+#include "path.h"
+#include "stroke.h"
+#include "param.h"
+#include "points.h"
+#include "fit.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <stdbool.h>
+
+#define BENCH_WIDTH 4096
+#define BENCH_MIN_SECONDS 0.2
+#define BENCH_VIEW_HEIGHT 2048
+#define BENCH_VIEW_SCALE 100.0
+#define BENCH_POINTS 1000000
+
+static const char* corpus[] = {
+    "x^2",
+    "3x^2-2x+1/(x-1)",
+    "sin(x)*cos(x)",
+    "exp(-x*x)*sin(5x)",
+    "sqrt(abs(x))+log(x)",
+    "tan(x)",
+    "sin(x)*sin(x)+sin(x)",
+    "(x+1)(x-1)(x+2)(x-2)/(x^2+1)",
+    "x^5-4x^4+3x^3-2x^2+x-7",
+    "sin(x^2)/x+cos(3x)*exp(-abs(x)/4)",
+    NULL
+};
+
+// identities the optimizer is tempted to fold, where -0, inf and nan say it mustn't
+static const char* edgeCorpus[] = {
+    "x/0",
+    "0/x",
+    "x*0",
+    "0*x",
+    "x-x",
+    "x+0",
+    "0+x",
+    "x-0",
+    "x+(-0)",
+    "-0+x",
+    "x^0",
+    "x^1",
+    "1*x",
+    "x/1",
+    "0^x",
+    "--x",
+    NULL
+};
+
+static const char* implicitCorpus[] = {
+    "x^2+y^2-16",
+    "sin(x*y)-0.5",
+    "sin(x)+cos(y)",
+    NULL
+};
+
+static const int viewWidths[] = { 800, 1920, 3840, 7680, 0 };
+
+#ifdef BENCH_WRAP_ALLOC
+#include <stdatomic.h>
+// linked with --wrap, so every allocation in the core library comes through here
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* p, size_t size);
+
+static atomic_long allocations;
+
+void* __wrap_malloc(size_t size) {
+    atomic_fetch_add(&allocations, 1);
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+    atomic_fetch_add(&allocations, 1);
+    return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* p, size_t size) {
+    atomic_fetch_add(&allocations, 1);
+    return __real_realloc(p, size);
+}
+
+static long Allocations(void) {
+    return atomic_load(&allocations);
+}
+#else
+// -1 everywhere when the build can't count
+static long Allocations(void) {
+    return -1;
+}
+#endif
+
+static bool json;
+
+// one measurement as a json line, the expression is the only string that needs escaping
+static void Record(const char* suite, const char* expr, int width, const char* metric, double value) {
+    printf("{\"suite\":\"%s\",\"expr\":\"", suite);
+    for (const char* c = expr; *c; c++) {
+        if (*c == '"' || *c == '\\') putchar('\\');
+        putchar(*c);
+    }
+    if (isfinite(value)) printf("\",\"width\":%d,\"metric\":\"%s\",\"value\":%.6g}\n", width, metric, value);
+    else printf("\",\"width\":%d,\"metric\":\"%s\",\"value\":null}\n", width, metric);
+}
+
+static double Now(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static double sink;
+
+// repeats a full-width pass until enough time has passed, returns ns per sample
+typedef void (*BenchFn)(void* user, const double* xs, double* out, int n);
+
+static double Measure(BenchFn fn, void* user, const double* xs, double* out, int n) {
+    int reps = 0;
+    double start = Now();
+    double elapsed;
+    do {
+        fn(user, xs, out, n);
+        sink += out[reps % n];
+        reps++;
+        elapsed = Now() - start;
+    } while (elapsed < BENCH_MIN_SECONDS);
+    return elapsed * 1e9 / ((double)reps * n);
+}
+
+typedef struct {
+    AST* ast;
+    Program* program;
+    JitProgram* jit;
+    EvalContext ctx;
+} BenchExpr;
+
+static void RunTree(void* user, const double* xs, double* out, int n) {
+    BenchExpr* e = (BenchExpr*)user;
+    EvalContext c = e->ctx;
+    for (int i = 0; i < n; i++) {
+        c.x = xs[i];
+        out[i] = AST_Evaluate(e->ast, &c);
+    }
+}
+
+static void RunProgram(void* user, const double* xs, double* out, int n) {
+    BenchExpr* e = (BenchExpr*)user;
+    EvalContext c = e->ctx;
+    for (int i = 0; i < n; i++) {
+        c.x = xs[i];
+        out[i] = Program_Evaluate(e->program, &c);
+    }
+}
+
+static void RunBatch(void* user, const double* xs, double* out, int n) {
+    BenchExpr* e = (BenchExpr*)user;
+    AST_EvaluateBatch(e->program, xs, out, n, &e->ctx);
+}
+
+static void RunJit(void* user, const double* xs, double* out, int n) {
+    BenchExpr* e = (BenchExpr*)user;
+    Jit_EvaluateSpan(e->jit, xs, out, n, &e->ctx);
+}
+
+// every equation of both corpora on one big view, rebuilt from scratch
+typedef struct {
+    Expr exprs[16];
+    SampleCache samples[16];
+    ImplicitPlot plots[16];
+    int explicitCount;
+    int implicitCount;
+    PoolTask* tasks;
+    int taskCapacity;
+} BenchView;
+
+static void SampleTask(void* user, int index, int worker) {
+    (void)worker;
+    SampleCache_RunChunk((SampleCache*)user, index);
+}
+
+static void ImplicitTask(void* user, int index, int worker) {
+    (void)worker;
+    ImplicitPlot_RunStrip((ImplicitPlot*)user, index);
+}
+
+static void Queue(BenchView* v, int* count, PoolTaskFn fn, void* user, int n) {
+    if (*count + n > v->taskCapacity) {
+        v->taskCapacity = (*count + n) * 2;
+        v->tasks = (PoolTask*)realloc(v->tasks, v->taskCapacity * sizeof(PoolTask));
+    }
+    for (int i = 0; i < n; i++) {
+        v->tasks[(*count)++] = (PoolTask){ fn, user, i };
+    }
+}
+
+// returns ms per rebuild
+static double MeasureView(BenchView* v, ThreadPool* pool) {
+    EvalContext ctx = { 0.0, 0.0, 0.0 };
+    int reps = 0;
+    double start = Now();
+    double elapsed;
+    do {
+        int count = 0;
+        for (int i = 0; i < v->explicitCount; i++) {
+            SampleCache_Invalidate(&v->samples[i]);
+            int n = SampleCache_Begin(&v->samples[i], &v->exprs[i], &ctx, BENCH_VIEW_SCALE, 0.0, BENCH_WIDTH);
+            Queue(v, &count, SampleTask, &v->samples[i], n);
+        }
+        for (int i = 0; i < v->implicitCount; i++) {
+            Expr* e = &v->exprs[v->explicitCount + i];
+            v->plots[i].valid = false;
+            int n = ImplicitPlot_Begin(&v->plots[i], e, &ctx, 0, BENCH_VIEW_SCALE, 0.0, 0.0, BENCH_WIDTH, BENCH_VIEW_HEIGHT);
+            Queue(v, &count, ImplicitTask, &v->plots[i], n);
+        }
+        Pool_Run(pool, v->tasks, count);
+        for (int i = 0; i < v->explicitCount; i++) {
+            SampleCache_End(&v->samples[i]);
+            sink += v->samples[i].curve.count;
+        }
+        for (int i = 0; i < v->implicitCount; i++) {
+            ImplicitPlot_End(&v->plots[i]);
+            sink += v->plots[i].segmentCount;
+        }
+        reps++;
+        elapsed = Now() - start;
+    } while (elapsed < BENCH_MIN_SECONDS);
+    return elapsed * 1e3 / reps;
+}
+
+static void RunScaling(void) {
+    BenchView v;
+    memset(&v, 0, sizeof(v));
+    for (int i = 0; corpus[i]; i++) {
+        Expr_Init(&v.exprs[v.explicitCount]);
+        Expr_Set(&v.exprs[v.explicitCount], corpus[i]);
+        SampleCache_Init(&v.samples[v.explicitCount]);
+        v.explicitCount++;
+    }
+    for (int i = 0; implicitCorpus[i]; i++) {
+        Expr_Init(&v.exprs[v.explicitCount + i]);
+        Expr_Set(&v.exprs[v.explicitCount + i], implicitCorpus[i]);
+        ImplicitPlot_Init(&v.plots[i]);
+        v.implicitCount++;
+    }
+
+    int cores = Pool_CoreCount();
+    if (!json) {
+        printf("\nviewport rebuild, %d curves + %d implicit on %dx%d, %d cores\n",
+               v.explicitCount, v.implicitCount, BENCH_WIDTH, BENCH_VIEW_HEIGHT, cores);
+        printf("%8s %10s %8s\n", "threads", "ms", "speedup");
+    }
+    double base = 0.0;
+    for (int threads = 1;; threads *= 2) {
+        if (threads > cores) threads = cores;
+        ThreadPool* pool = Pool_Create(threads);
+        double ms = MeasureView(&v, pool);
+        Pool_Destroy(pool);
+        if (threads == 1) base = ms;
+        if (json) {
+            char name[32];
+            snprintf(name, sizeof(name), "threads=%d", threads);
+            Record("scaling", name, BENCH_WIDTH, "rebuild_ms", ms);
+            Record("scaling", name, BENCH_WIDTH, "speedup", base / ms);
+        } else {
+            printf("%8d %10.2f %8.2f\n", threads, ms, base / ms);
+        }
+        if (threads >= cores) break;
+    }
+
+    for (int i = 0; i < v.explicitCount; i++) SampleCache_Free(&v.samples[i]);
+    for (int i = 0; i < v.implicitCount; i++) ImplicitPlot_Free(&v.plots[i]);
+    for (int i = 0; i < v.explicitCount + v.implicitCount; i++) Expr_Free(&v.exprs[i]);
+    free(v.tasks);
+}
+
+// samples through clipping and simplification to triangles, at the tolerance the app uses
+static void RunPipeline(void) {
+    if (!json) {
+        printf("\nrender pipeline on %dx%d, 0.25 px tolerance\n", BENCH_WIDTH, BENCH_VIEW_HEIGHT);
+        printf("%-36s %8s %8s %8s %8s %10s %8s\n", "expression", "samples", "clipped", "simpl", "kept", "triangles", "us");
+    }
+    EvalContext ctx = { 0.0, 0.0, 0.0 };
+    for (int i = 0; corpus[i]; i++) {
+        Expr e;
+        SampleCache cache;
+        CurvePath path;
+        StrokeMesh mesh;
+        Expr_Init(&e);
+        Expr_Set(&e, corpus[i]);
+        SampleCache_Init(&cache);
+        CurvePath_Init(&path);
+        StrokeMesh_Init(&mesh);
+        SampleCache_Update(&cache, &e, &ctx, BENCH_VIEW_SCALE, 0.0, BENCH_WIDTH);
+
+        int reps = 0;
+        double start = Now();
+        double elapsed;
+        do {
+            // a vertical pan moves the view without touching the samples
+            double centerY = (reps & 1) ? 0.5 / BENCH_VIEW_SCALE : 0.0;
+            CurvePath_FromCurve(&path, &cache, 0.25, 3.0, BENCH_VIEW_SCALE, 0.0, centerY, BENCH_WIDTH, BENCH_VIEW_HEIGHT);
+            StrokeMesh_FromPath(&mesh, &path, 2.0f);
+            reps++;
+            elapsed = Now() - start;
+        } while (elapsed < BENCH_MIN_SECONDS);
+        double us = elapsed * 1e6 / reps;
+        if (json) {
+            Record("pipeline", corpus[i], BENCH_WIDTH, "samples", path.input);
+            Record("pipeline", corpus[i], BENCH_WIDTH, "clipped", path.clipped);
+            Record("pipeline", corpus[i], BENCH_WIDTH, "simplified", path.simplified);
+            Record("pipeline", corpus[i], BENCH_WIDTH, "triangles", mesh.count / 3);
+            Record("pipeline", corpus[i], BENCH_WIDTH, "build_us", us);
+        } else {
+            printf("%-36s %8d %8d %8d %8d %10d %8.1f\n", corpus[i], path.input, path.clipped, path.simplified,
+                   path.count, mesh.count / 3, us);
+        }
+
+        StrokeMesh_Free(&mesh);
+        CurvePath_Free(&path);
+        SampleCache_Free(&cache);
+        Expr_Free(&e);
+    }
+}
+
+static const char* animatedCorpus[] = {
+    "sin(x)*cos(t)",
+    "sin(x+t)",
+    "exp(-x^2/10)*sin(3*x)*cos(t)+x*t",
+    "tan(x)/(t+1)+sin(2*x)*cos(t*x)",
+    NULL
+};
+
+// one frame of an animation: t moves, the view doesn't. full is what the seeds cost
+// without the x-only columns kept between frames
+static void RunAnimation(void) {
+    if (!json) {
+        printf("\nanimated t at %d px, one update per frame\n", BENCH_WIDTH);
+        printf("%-36s %8s %8s %10s %10s\n", "expression", "columns", "evals", "frame us", "full us");
+    }
+    for (int i = 0; animatedCorpus[i]; i++) {
+        Expr e;
+        SampleCache cache;
+        Expr_Init(&e);
+        Expr_Set(&e, animatedCorpus[i]);
+        SampleCache_Init(&cache);
+        EvalContext ctx = { 0.0, 0.0, 0.0 };
+        SampleCache_Update(&cache, &e, &ctx, BENCH_VIEW_SCALE, 0.0, BENCH_WIDTH);
+
+        int reps = 0;
+        double start = Now();
+        double elapsed;
+        do {
+            ctx.t += 1.0 / 60;
+            SampleCache_Update(&cache, &e, &ctx, BENCH_VIEW_SCALE, 0.0, BENCH_WIDTH);
+            reps++;
+            elapsed = Now() - start;
+        } while (elapsed < BENCH_MIN_SECONDS);
+        double us = elapsed * 1e6 / reps;
+        int evaluated = cache.evaluated;
+
+        // the same frames with a cache that starts over every time
+        reps = 0;
+        start = Now();
+        do {
+            ctx.t += 1.0 / 60;
+            SampleCache_Invalidate(&cache);
+            for (int k = 0; k < cache.chunkCapacity; k++) cache.chunks[k].columnsValid = false;
+            SampleCache_Update(&cache, &e, &ctx, BENCH_VIEW_SCALE, 0.0, BENCH_WIDTH);
+            reps++;
+            elapsed = Now() - start;
+        } while (elapsed < BENCH_MIN_SECONDS);
+        double fullUs = elapsed * 1e6 / reps;
+
+        if (json) {
+            Record("animation", animatedCorpus[i], BENCH_WIDTH, "columns", Expr_ColumnCount(&e));
+            Record("animation", animatedCorpus[i], BENCH_WIDTH, "evaluated", evaluated);
+            Record("animation", animatedCorpus[i], BENCH_WIDTH, "frame_us", us);
+            Record("animation", animatedCorpus[i], BENCH_WIDTH, "full_us", fullUs);
+        } else {
+            printf("%-36s %8d %8d %10.1f %10.1f\n", animatedCorpus[i], Expr_ColumnCount(&e), evaluated, us, fullUs);
+        }
+        SampleCache_Free(&cache);
+        Expr_Free(&e);
+    }
+}
+
+// x and y, or r alone for a polar curve
+static const struct {
+    const char* x;
+    const char* y;
+} parametricCorpus[] = {
+    { "cos(3*t)", "sin(2*t)" },
+    { "t/10", NULL },
+    { "t", "2*t+1" },
+    { "1+cos(t)", NULL },
+    { "t", "tan(t)" },
+    { NULL, NULL }
+};
+
+// a full trace per update, the view pans a pixel back and forth so nothing is kept
+static void RunParametric(void) {
+    if (!json) {
+        printf("\nparametric and polar over [0, 20 pi] at %dx%d\n", BENCH_WIDTH, BENCH_VIEW_HEIGHT);
+        printf("%-36s %8s %8s %8s %10s\n", "expression", "evals", "points", "kept", "us");
+    }
+    const double from = 0.0, to = 20 * 3.14159265358979323846;
+    for (int i = 0; parametricCorpus[i].x; i++) {
+        ParamForm form = parametricCorpus[i].y ? PARAM_CARTESIAN : PARAM_POLAR;
+        char name[80];
+        if (form == PARAM_POLAR) snprintf(name, sizeof(name), "r = %s", parametricCorpus[i].x);
+        else snprintf(name, sizeof(name), "(%s, %s)", parametricCorpus[i].x, parametricCorpus[i].y);
+        Expr x, y;
+        ParamCurve curve;
+        CurvePath path;
+        Expr_Init(&x);
+        Expr_Init(&y);
+        Expr_Set(&x, parametricCorpus[i].x);
+        if (form == PARAM_CARTESIAN) Expr_Set(&y, parametricCorpus[i].y);
+        ParamCurve_Init(&curve);
+        CurvePath_Init(&path);
+
+        int reps = 0;
+        double start = Now();
+        double elapsed;
+        do {
+            double centerX = (reps & 1) ? 1.0 / BENCH_VIEW_SCALE : 0.0;
+            int n = ParamCurve_Begin(&curve, form, &x, &y, from, to, BENCH_VIEW_SCALE, centerX, 0.0, BENCH_WIDTH, BENCH_VIEW_HEIGHT);
+            for (int k = 0; k < n; k++) ParamCurve_RunChunk(&curve, k);
+            ParamCurve_End(&curve);
+            CurvePath_FromSamples(&path, &curve, curve.generation, &curve.curve, 0.25, 3.0, BENCH_VIEW_SCALE, centerX, 0.0,
+                                  BENCH_WIDTH, BENCH_VIEW_HEIGHT);
+            reps++;
+            elapsed = Now() - start;
+        } while (elapsed < BENCH_MIN_SECONDS);
+        double us = elapsed * 1e6 / reps;
+        if (json) {
+            Record("parametric", name, BENCH_WIDTH, "evaluated", curve.evaluated);
+            Record("parametric", name, BENCH_WIDTH, "points", curve.curve.count);
+            Record("parametric", name, BENCH_WIDTH, "kept", path.count);
+            Record("parametric", name, BENCH_WIDTH, "trace_us", us);
+        } else {
+            printf("%-36s %8d %8d %8d %10.1f\n", name, curve.evaluated, curve.curve.count, path.count, us);
+        }
+        CurvePath_Free(&path);
+        ParamCurve_Free(&curve);
+        Expr_Free(&x);
+        Expr_Free(&y);
+    }
+}
+
+// parsing alone, then everything Expr_Set does: optimize, compile and jit
+static void RunParse(void) {
+    if (!json) printf("%-36s %10s %10s %10s\n", "expression", "parse us", "prepare", "allocs");
+    for (int i = 0; corpus[i]; i++) {
+        int reps = 0;
+        double start = Now();
+        double elapsed;
+        do {
+            AST* ast = Parser_Parse(corpus[i]);
+            sink += ast ? ast->nodeCount : 0;
+            AST_Free(ast);
+            reps++;
+            elapsed = Now() - start;
+        } while (elapsed < BENCH_MIN_SECONDS);
+        double parse = elapsed * 1e6 / reps;
+
+        long before = Allocations();
+        Expr e;
+        Expr_Init(&e);
+        Expr_Set(&e, corpus[i]);
+        long allocs = before < 0 ? -1 : Allocations() - before;
+        Expr_Free(&e);
+
+        reps = 0;
+        start = Now();
+        do {
+            Expr_Init(&e);
+            Expr_Set(&e, corpus[i]);
+            Expr_Free(&e);
+            reps++;
+            elapsed = Now() - start;
+        } while (elapsed < BENCH_MIN_SECONDS);
+        double prepare = elapsed * 1e6 / reps;
+
+        if (json) {
+            Record("parse", corpus[i], 0, "parse_us", parse);
+            Record("parse", corpus[i], 0, "prepare_us", prepare);
+            Record("parse", corpus[i], 0, "prepare_allocs", allocs);
+        } else {
+            printf("%-36s %10.2f %10.2f %10ld\n", corpus[i], parse, prepare, allocs);
+        }
+    }
+}
+
+// the tree walk over an unoptimized parse is the reference every backend is held to: the
+// optimized tree and the program have to match it bit for bit, any nan for any nan, and the
+// batch kernels, which may round differently, to within BENCH_BATCH_TOLERANCE
+#define BENCH_BATCH_TOLERANCE 1e-12
+
+static bool SameBits(double a, double b) {
+    return memcmp(&a, &b, sizeof(double)) == 0 || (isnan(a) && isnan(b));
+}
+
+static bool Close(double a, double b) {
+    if (isnan(a) || isnan(b) || isinf(a) || isinf(b)) return SameBits(a, b) || a == b;
+    return fabs(a - b) <= BENCH_BATCH_TOLERANCE * fmax(1.0, fmax(fabs(a), fabs(b)));
+}
+
+static bool CheckExpression(const char* text, const double* xs, int n) {
+    static double ref[BENCH_WIDTH];
+    static double out[BENCH_WIDTH];
+    AST* plain = Parser_Parse(text);
+    AST* ast = Parser_Parse(text);
+    AST_Optimize(ast);
+    Program* program = AST_Compile(ast);
+    bool ok = plain && ast && program;
+    EvalContext ctx = { 0.0, 0.0, 0.0 };
+    for (int k = 0; ok && k < n; k++) {
+        ctx.x = xs[k];
+        ref[k] = AST_Evaluate(plain, &ctx);
+        double folded = AST_Evaluate(ast, &ctx);
+        double v = Program_Evaluate(program, &ctx);
+        if (!SameBits(ref[k], folded)) {
+            fprintf(stderr, "check %s: optimized tree gives %.17g at x = %g, the tree %.17g\n", text, folded, xs[k], ref[k]);
+            ok = false;
+        } else if (!SameBits(ref[k], v)) {
+            fprintf(stderr, "check %s: program gives %.17g at x = %g, the tree %.17g\n", text, v, xs[k], ref[k]);
+            ok = false;
+        }
+    }
+    if (ok) {
+        ctx.x = 0.0;
+        AST_EvaluateBatch(program, xs, out, n, &ctx);
+        for (int k = 0; k < n; k++) {
+            if (Close(ref[k], out[k])) continue;
+            fprintf(stderr, "check %s: batch gives %.17g at x = %g, the tree %.17g\n", text, out[k], xs[k], ref[k]);
+            ok = false;
+            break;
+        }
+    }
+    if (!program) fprintf(stderr, "check %s: doesn't compile\n", text);
+    Program_Free(program);
+    AST_Free(ast);
+    AST_Free(plain);
+    return ok;
+}
+
+static bool RunCheck(void) {
+    static double xs[BENCH_WIDTH];
+    // the bench's usual span, then the values that tell the edge cases apart
+    static const double special[] = { 0.0, -0.0, 1.0, -1.0, INFINITY, -INFINITY, NAN, 1e-310, 1e308 };
+    int specials = (int)(sizeof(special) / sizeof(special[0]));
+    int n = BENCH_WIDTH - specials;
+    for (int i = 0; i < n; i++) xs[i] = -10.0 + 20.0 * i / n;
+    for (int i = 0; i < specials; i++) xs[n + i] = special[i];
+
+    bool ok = true;
+    int count = 0;
+    for (int i = 0; corpus[i]; i++, count++) ok = CheckExpression(corpus[i], xs, BENCH_WIDTH) && ok;
+    for (int i = 0; edgeCorpus[i]; i++, count++) ok = CheckExpression(edgeCorpus[i], xs, BENCH_WIDTH) && ok;
+    if (!json) printf("%d expressions against the unoptimized tree: %s\n\n", count, ok ? "ok" : "MISMATCH");
+    return ok;
+}
+
+static void RunEval(void) {
+    static double xs[BENCH_WIDTH];
+    static double out[BENCH_WIDTH];
+    static double ref[BENCH_WIDTH];
+    for (int i = 0; i < BENCH_WIDTH; i++) {
+        xs[i] = -10.0 + 20.0 * i / BENCH_WIDTH;
+    }
+
+    if (!json) printf("\n%-36s %10s %10s %10s %10s %8s\n", "expression", "tree ns", "program", "batch", "jit", "jit ok");
+    for (int i = 0; corpus[i]; i++) {
+        BenchExpr e;
+        e.ast = Parser_Parse(corpus[i]);
+        AST_Optimize(e.ast);
+        e.program = AST_Compile(e.ast);
+        e.jit = Jit_Compile(e.program);
+        e.ctx = (EvalContext){ 0.0, 0.0, 0.0 };
+
+        double tree = Measure(RunTree, &e, xs, ref, BENCH_WIDTH);
+        double program = Measure(RunProgram, &e, xs, out, BENCH_WIDTH);
+        double batch = Measure(RunBatch, &e, xs, out, BENCH_WIDTH);
+        double jit = NAN;
+        const char* ok = "-";
+        if (e.jit) {
+            jit = Measure(RunJit, &e, xs, out, BENCH_WIDTH);
+            // the jit calls the same libm as the interpreter, so it has to match exactly
+            RunProgram(&e, xs, ref, BENCH_WIDTH);
+            ok = "yes";
+            for (int k = 0; k < BENCH_WIDTH; k++) {
+                if (memcmp(&ref[k], &out[k], sizeof(double)) != 0 && !(isnan(ref[k]) && isnan(out[k]))) {
+                    ok = "NO";
+                    break;
+                }
+            }
+        }
+        if (json) {
+            Record("eval", corpus[i], BENCH_WIDTH, "tree_ns", tree);
+            Record("eval", corpus[i], BENCH_WIDTH, "program_ns", program);
+            Record("eval", corpus[i], BENCH_WIDTH, "batch_ns", batch);
+            Record("eval", corpus[i], BENCH_WIDTH, "jit_ns", jit);
+            Record("eval", corpus[i], BENCH_WIDTH, "jit_exact", ok[0] == 'y' ? 1 : (ok[0] == 'N' ? 0 : NAN));
+        } else {
+            printf("%-36s %10.2f %10.2f %10.2f %10.2f %8s\n", corpus[i], tree, program, batch, jit, ok);
+        }
+
+        Jit_Free(e.jit);
+        Program_Free(e.program);
+        AST_Free(e.ast);
+    }
+}
+
+// a plain span against value and derivative in one pass, and against plotting d/dx(f).
+// the ratios are what a derivative curve costs on top of the curve
+typedef struct {
+    Expr expr;
+    Expr derivative;
+    EvalContext ctx;
+    double* derivatives;
+} BenchDual;
+
+static void RunSpan(void* user, const double* xs, double* out, int n) {
+    BenchDual* d = (BenchDual*)user;
+    Expr_EvaluateSpan(&d->expr, xs, out, n, &d->ctx);
+}
+
+static void RunSpanDual(void* user, const double* xs, double* out, int n) {
+    BenchDual* d = (BenchDual*)user;
+    Expr_EvaluateSpanDual(&d->expr, xs, out, d->derivatives, n, &d->ctx);
+}
+
+static void RunDerivativeSpan(void* user, const double* xs, double* out, int n) {
+    BenchDual* d = (BenchDual*)user;
+    Expr_EvaluateSpan(&d->derivative, xs, out, n, &d->ctx);
+}
+
+static void RunDual(void) {
+    static double xs[BENCH_WIDTH];
+    static double out[BENCH_WIDTH];
+    static double derivatives[BENCH_WIDTH];
+    for (int i = 0; i < BENCH_WIDTH; i++) {
+        xs[i] = -10.0 + 20.0 * i / BENCH_WIDTH;
+    }
+
+    if (!json) printf("\n%-36s %10s %10s %10s %8s %8s\n", "expression", "span ns", "dual", "d/dx", "dual x", "d/dx x");
+    for (int i = 0; corpus[i]; i++) {
+        char text[256];
+        snprintf(text, sizeof(text), "d/dx(%s)", corpus[i]);
+        BenchDual d;
+        Expr_Init(&d.expr);
+        Expr_Init(&d.derivative);
+        Expr_Set(&d.expr, corpus[i]);
+        Expr_Set(&d.derivative, text);
+        d.ctx = (EvalContext){ 0.0, 0.0, 0.0 };
+        d.derivatives = derivatives;
+
+        double span = Measure(RunSpan, &d, xs, out, BENCH_WIDTH);
+        double dual = Measure(RunSpanDual, &d, xs, out, BENCH_WIDTH);
+        double curve = Measure(RunDerivativeSpan, &d, xs, out, BENCH_WIDTH);
+        if (json) {
+            Record("dual", corpus[i], BENCH_WIDTH, "span_ns", span);
+            Record("dual", corpus[i], BENCH_WIDTH, "dual_ns", dual);
+            Record("dual", corpus[i], BENCH_WIDTH, "derivative_ns", curve);
+        } else {
+            printf("%-36s %10.2f %10.2f %10.2f %8.2f %8.2f\n", corpus[i], span, dual, curve, dual / span, curve / span);
+        }
+        Expr_Free(&d.expr);
+        Expr_Free(&d.derivative);
+    }
+}
+
+// a full adaptive sampling of the view from nothing, and the allocations of the first build
+// against a rebuild that reuses the buffers
+static void RunViewport(void) {
+    EvalContext ctx = { 0.0, 0.0, 0.0 };
+    if (!json) printf("\n%-36s %6s %10s %8s %8s %8s\n", "full viewport sampling", "width", "us", "evals", "allocs", "reused");
+    for (int i = 0; corpus[i]; i++) {
+        Expr e;
+        Expr_Init(&e);
+        Expr_Set(&e, corpus[i]);
+        for (int w = 0; viewWidths[w]; w++) {
+            int width = viewWidths[w];
+            // the same world window at every width, so more pixels means a finer curve
+            double scale = width / 20.0;
+            SampleCache cache;
+            SampleCache_Init(&cache);
+            long before = Allocations();
+            SampleCache_Update(&cache, &e, &ctx, scale, 0.0, width);
+            long cold = before < 0 ? -1 : Allocations() - before;
+
+            int reps = 0;
+            double start = Now();
+            double elapsed;
+            do {
+                SampleCache_Invalidate(&cache);
+                SampleCache_Update(&cache, &e, &ctx, scale, 0.0, width);
+                sink += cache.curve.count;
+                reps++;
+                elapsed = Now() - start;
+            } while (elapsed < BENCH_MIN_SECONDS);
+            double us = elapsed * 1e6 / reps;
+            // once the buffers have settled
+            before = Allocations();
+            SampleCache_Invalidate(&cache);
+            SampleCache_Update(&cache, &e, &ctx, scale, 0.0, width);
+            long warm = before < 0 ? -1 : Allocations() - before;
+
+            if (json) {
+                Record("viewport", corpus[i], width, "sample_us", us);
+                Record("viewport", corpus[i], width, "evaluations", cache.evaluated);
+                Record("viewport", corpus[i], width, "allocs_cold", cold);
+                Record("viewport", corpus[i], width, "allocs_warm", warm);
+            } else {
+                printf("%-36s %6d %10.1f %8d %8ld %8ld\n", w == 0 ? corpus[i] : "", width, us, cache.evaluated, cold, warm);
+            }
+            SampleCache_Free(&cache);
+        }
+        Expr_Free(&e);
+    }
+}
+
+// what the deep zoom tier costs: the same span and the same viewport sampling with the
+// expression measured from an origin in double-double, 1e-20 off from 1 so doubles can't
+// hold it, and the view zoomed in far enough to need it
+static void RunPrecision(void) {
+    static double xs[BENCH_WIDTH];
+    static double out[BENCH_WIDTH];
+    EvalContext ctx = { 0.0, 0.0, 0.0 };
+    DDouble zero = { 0.0, 0.0 };
+    DDouble origin = { 1.0, 1e-20 };
+    double deepScale = BENCH_WIDTH * 1e20;
+    for (int i = 0; i < BENCH_WIDTH; i++) {
+        xs[i] = (-0.5 + (double)i / BENCH_WIDTH) * BENCH_WIDTH / deepScale;
+    }
+
+    if (!json) printf("\n%-36s %10s %10s %8s %10s %10s %8s\n", "double vs double-double", "span ns", "dd ns", "x", "view us", "dd us", "x");
+    for (int i = 0; corpus[i]; i++) {
+        BenchDual d;
+        Expr_Init(&d.expr);
+        Expr_Set(&d.expr, corpus[i]);
+        d.ctx = ctx;
+        double span = Measure(RunSpan, &d, xs, out, BENCH_WIDTH);
+        Expr_SetOrigin(&d.expr, origin, zero, zero);
+        double deepSpan = Measure(RunSpan, &d, xs, out, BENCH_WIDTH);
+
+        double view[2];
+        for (int tier = 0; tier < 2; tier++) {
+            Expr_SetOrigin(&d.expr, tier ? origin : zero, zero, zero);
+            double scale = tier ? deepScale : BENCH_WIDTH / 20.0;
+            SampleCache cache;
+            SampleCache_Init(&cache);
+            int reps = 0;
+            double start = Now();
+            double elapsed;
+            do {
+                SampleCache_Invalidate(&cache);
+                SampleCache_Update(&cache, &d.expr, &ctx, scale, 0.0, BENCH_WIDTH);
+                sink += cache.curve.count;
+                reps++;
+                elapsed = Now() - start;
+            } while (elapsed < BENCH_MIN_SECONDS);
+            view[tier] = elapsed * 1e6 / reps;
+            SampleCache_Free(&cache);
+        }
+
+        if (json) {
+            Record("precision", corpus[i], BENCH_WIDTH, "double_span_ns", span);
+            Record("precision", corpus[i], BENCH_WIDTH, "dd_span_ns", deepSpan);
+            Record("precision", corpus[i], BENCH_WIDTH, "double_view_us", view[0]);
+            Record("precision", corpus[i], BENCH_WIDTH, "dd_view_us", view[1]);
+        } else {
+            printf("%-36s %10.2f %10.2f %8.1f %10.1f %10.1f %8.1f\n", corpus[i], span, deepSpan, deepSpan / span,
+                   view[0], view[1], view[1] / view[0]);
+        }
+        Expr_Free(&d.expr);
+    }
+}
+
+// a million points in a blob, indexed, then queried for views from all of it to a few of
+// them, a 1920 wide screen with 3 pixel bins
+static void RunPoints(void) {
+    PointCloud pc;
+    PointCloud_Init(&pc);
+    uint32_t state = 12345;
+    for (int i = 0; i < BENCH_POINTS; i++) {
+        // sums of uniforms are close enough to normal for a blob
+        double x = 0.0, y = 0.0;
+        for (int k = 0; k < 4; k++) {
+            state = state * 1664525u + 1013904223u;
+            x += state / 4294967296.0 - 0.5;
+            state = state * 1664525u + 1013904223u;
+            y += state / 4294967296.0 - 0.5;
+        }
+        PointCloud_Add(&pc, x * 10.0, y * 5.0);
+    }
+    double start = Now();
+    PointCloud_Build(&pc);
+    double build = Now() - start;
+    if (json) Record("points", "build", BENCH_POINTS, "ms", build * 1e3);
+    else printf("\n%-36s %10.2f ms\n%-36s %10s %10s %10s\n", "index of 1M points", build * 1e3, "view", "us", "marks", "points");
+
+    static const double halfWidths[] = { 20.0, 2.0, 0.2, 0.002, 0 };
+    PointMarks marks = { 0 };
+    for (int v = 0; halfWidths[v]; v++) {
+        double w = halfWidths[v];
+        int reps = 0;
+        double elapsed;
+        start = Now();
+        do {
+            PointCloud_Query(&pc, -w, w, -w * 0.5625, w * 0.5625, 2 * w / 1920 * 3, &marks);
+            reps++;
+            elapsed = Now() - start;
+        } while (elapsed < BENCH_MIN_SECONDS);
+        char name[64];
+        snprintf(name, sizeof(name), "%g wide", 2 * w);
+        if (json) {
+            Record("points", name, 1920, "query_us", elapsed * 1e6 / reps);
+            Record("points", name, 1920, "marks", marks.count);
+        } else {
+            printf("%-36s %10.1f %10d %10lld\n", name, elapsed * 1e6 / reps, marks.count, (long long)marks.points);
+        }
+    }
+    PointMarks_Free(&marks);
+
+    PointCloud_Free(&pc);
+}
+
+// the clouds a fit has to find its way back from: BENCH_POINTS points of a known curve over
+// [-5, 5], with normal noise added to y, or to ln y for the exponential
+static const struct {
+    const char* name;
+    FitKind kind;
+    int degree;
+    double truth[4]; // lowest power first, a and b of a*exp(b*x) for the exponential
+} fitCases[] = {
+    { "degree 1", FIT_POLYNOMIAL, 1, { 1.5, 0.75, 0.0, 0.0 } },
+    { "degree 3", FIT_POLYNOMIAL, 3, { 2.0, -0.5, 0.25, 0.1 } },
+    { "degree 8 of a cubic", FIT_POLYNOMIAL, FIT_MAX_DEGREE, { 2.0, -0.5, 0.25, 0.1 } },
+    { "exponential", FIT_EXPONENTIAL, 1, { 3.0, 0.4, 0.0, 0.0 } },
+};
+
+#define BENCH_FIT_NOISE 0.1
+#define BENCH_FIT_TOLERANCE 0.01 // of the fitted curve from the true one, far below the noise
+
+static double TrueCurve(int c, double x) {
+    const double* k = fitCases[c].truth;
+    if (fitCases[c].kind == FIT_EXPONENTIAL) return k[0] * exp(k[1] * x);
+    return k[0] + x * (k[1] + x * (k[2] + x * k[3]));
+}
+
+static double FitCurve(const Fit* fit, double x) {
+    double u = x - fit->center, v = 0.0;
+    for (int k = fit->degree; k >= 0; k--) v = v * u + fit->coefficients[k];
+    return fit->kind == FIT_EXPONENTIAL ? exp(v) : v;
+}
+
+// the fit's coefficients about 0 instead of its center, comparable with the truth
+static void FitAboutZero(const Fit* fit, double* out) {
+    if (fit->kind == FIT_EXPONENTIAL) {
+        out[0] = exp(fit->coefficients[0] - fit->coefficients[1] * fit->center);
+        out[1] = fit->coefficients[1];
+        return;
+    }
+    // expand every (x - center)^k by the binomial theorem
+    for (int j = 0; j <= fit->degree; j++) out[j] = 0.0;
+    for (int k = 0; k <= fit->degree; k++) {
+        double binomial = 1.0;
+        for (int j = 0; j <= k; j++) {
+            out[j] += fit->coefficients[k] * binomial * pow(-fit->center, k - j);
+            binomial = binomial * (k - j) / (j + 1);
+        }
+    }
+}
+
+// least squares over all the points of each case on every core. the fitted curve has to
+// come within BENCH_FIT_TOLERANCE of the true one, a broken sum or solve fails the bench
+static bool RunFit(void) {
+    ThreadPool* pool = Pool_Create(0);
+    bool ok = true;
+    if (!json) printf("\n%-36s %10s %10s %10s  %s\n", "fit of 1M noisy points", "ms", "r2", "off by", "coefficients about 0");
+    for (int c = 0; c < (int)(sizeof(fitCases) / sizeof(fitCases[0])); c++) {
+        PointCloud pc;
+        PointCloud_Init(&pc);
+        uint32_t state = 777u + (uint32_t)c;
+        for (int i = 0; i < BENCH_POINTS; i++) {
+            double x = -5.0 + 10.0 * i / (BENCH_POINTS - 1);
+            // a sum of twelve uniforms less six has a variance of one
+            double noise = -6.0;
+            for (int k = 0; k < 12; k++) {
+                state = state * 1664525u + 1013904223u;
+                noise += state / 4294967296.0;
+            }
+            noise *= BENCH_FIT_NOISE;
+            double y = TrueCurve(c, x);
+            PointCloud_Add(&pc, x, fitCases[c].kind == FIT_EXPONENTIAL ? y * exp(noise) : y + noise);
+        }
+        PointCloud_Build(&pc);
+
+        Fit fit;
+        bool solved = true;
+        int reps = 0;
+        double elapsed;
+        double start = Now();
+        do {
+            solved = Fit_Points(&fit, fitCases[c].kind, fitCases[c].degree, &pc, pool);
+            reps++;
+            elapsed = Now() - start;
+        } while (elapsed < BENCH_MIN_SECONDS);
+
+        // how far off over the range, relative for the exponential that spans a factor of 54
+        double off = solved ? 0.0 : INFINITY;
+        for (int k = 0; solved && k <= 100; k++) {
+            double x = -5.0 + 0.1 * k;
+            double d = fabs(FitCurve(&fit, x) - TrueCurve(c, x));
+            if (fitCases[c].kind == FIT_EXPONENTIAL) d /= TrueCurve(c, x);
+            if (!(d <= off)) off = d;
+        }
+        if (!(off <= BENCH_FIT_TOLERANCE)) {
+            fprintf(stderr, "fit %s: off by %g from the curve the points came from\n", fitCases[c].name, off);
+            ok = false;
+        }
+
+        double about[FIT_MAX_DEGREE + 1] = { 0 };
+        if (solved) FitAboutZero(&fit, about);
+        if (json) {
+            Record("fit", fitCases[c].name, BENCH_POINTS, "ms", elapsed * 1e3 / reps);
+            Record("fit", fitCases[c].name, BENCH_POINTS, "off_by", off);
+        } else {
+            printf("%-36s %10.2f %10.4f %10.2e ", fitCases[c].name, elapsed * 1e3 / reps, fit.r2, off);
+            int shown = fitCases[c].kind == FIT_EXPONENTIAL ? 1 : fitCases[c].degree;
+            for (int k = 0; k <= shown; k++) printf(" %.4f", about[k]);
+            printf("\n");
+        }
+        PointCloud_Free(&pc);
+    }
+    Pool_Destroy(pool);
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else {
+            fprintf(stderr, "usage: %s [--json]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    if (!json) printf("kernels: %s, jit: %s, width: %d, cores: %d\n\n", VecMath_Get()->name, Jit_IsAvailable() ? "yes" : "no", BENCH_WIDTH, Pool_CoreCount());
+    bool checked = RunCheck();
+    RunParse();
+    RunEval();
+    RunDual();
+    RunViewport();
+    RunPrecision();
+    RunScaling();
+    RunPipeline();
+    RunAnimation();
+    RunParametric();
+    RunPoints();
+    bool fitted = RunFit();
+    return !checked || !fitted || sink == 12345.0; // keep the results alive
+}
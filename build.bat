@@ -8,4 +8,7 @@ set RAYLIB_PATH=C:\raylib\raylib
 set INCLUDE_PATH=-I"%RAYLIB_PATH%\src" -I.
 set LIB_PATH=-L"%RAYLIB_PATH%\src"
 
-gcc -o graph_calc.exe main.c parser.c graph.c ui.c %INCLUDE_PATH% %LIB_PATH% -lraylib -lopengl32 -lgdi32 -lwinmm
+gcc -o graph_calc.exe main.c parser.c optimizer.c compiler.c vecmath.c jit.c expr.c samples.c interval.c implicit.c pool.c region.c path.c stroke.c figure.c profile.c solver.c points.c fit.c param.c ddouble.c graphstate.c graph.c ui.c %INCLUDE_PATH% %LIB_PATH% -lraylib -lopengl32 -lgdi32 -lwinmm
+gcc -O2 -o bench.exe bench.c parser.c optimizer.c compiler.c vecmath.c jit.c expr.c samples.c interval.c implicit.c pool.c path.c stroke.c points.c fit.c param.c ddouble.c -I. -lm
+gcc -O2 -o plot.exe plot.c headless.c figure.c raster.c png.c parser.c optimizer.c compiler.c vecmath.c jit.c expr.c samples.c interval.c implicit.c pool.c path.c stroke.c region.c param.c ddouble.c graphstate.c -I. -lm
+gcc -O2 -o calc.exe calc.c stream.c parser.c optimizer.c compiler.c vecmath.c jit.c expr.c interval.c ddouble.c pool.c -I. -lm
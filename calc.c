@@ -0,0 +1,112 @@
+// evaluates expressions over many xs, streaming from input to output
+//   calc -e "sin(x)" -r 0:10:1000001         a range
+//   calc -e "x^2" < xs.txt                   a column of xs
+//   calc jobs.txt                            directives and xs, see stream.h
+// build: make calc
+#include "stream.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+static void Usage(const char* name) {
+    fprintf(stderr,
+            "usage: %s [options] [file]\n"
+            "  file        xs and directives (expr, y, t, range), - or none for stdin\n"
+            "  -e EXPR     expression to start with\n"
+            "  -r A:B:N    N evenly spaced xs from A to B, instead of reading input\n"
+            "  -y Y, -t T  values of y and t (0)\n"
+            "  -x          write x before every f(x)\n"
+            "  -b          binary output, little-endian doubles\n"
+            "  -B          binary input, little-endian doubles of x\n"
+            "  -p DIGITS   significant digits of text output (17)\n"
+            "  -j N        threads, 0 for one per core (0)\n"
+            "  -q          no timing line\n",
+            name);
+}
+
+int main(int argc, char** argv) {
+    StreamOptions options = { STREAM_TEXT, STREAM_TEXT, false, STREAM_MAX_DIGITS };
+    const char* expr = NULL;
+    const char* path = NULL;
+    const char* range = NULL;
+    double y = 0.0, t = 0.0;
+    int threads = 0;
+    bool quiet = false;
+
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        if (a[0] != '-' || a[1] == '\0') {
+            path = a;
+            continue;
+        }
+        if (strcmp(a, "-x") == 0) options.withX = true;
+        else if (strcmp(a, "-b") == 0) options.output = STREAM_BINARY;
+        else if (strcmp(a, "-B") == 0) options.input = STREAM_BINARY;
+        else if (strcmp(a, "-q") == 0) quiet = true;
+        else if (i + 1 < argc && strcmp(a, "-e") == 0) expr = argv[++i];
+        else if (i + 1 < argc && strcmp(a, "-r") == 0) range = argv[++i];
+        else if (i + 1 < argc && strcmp(a, "-y") == 0) y = atof(argv[++i]);
+        else if (i + 1 < argc && strcmp(a, "-t") == 0) t = atof(argv[++i]);
+        else if (i + 1 < argc && strcmp(a, "-p") == 0) options.digits = atoi(argv[++i]);
+        else if (i + 1 < argc && strcmp(a, "-j") == 0) threads = atoi(argv[++i]);
+        else {
+            Usage(argv[0]);
+            return 2;
+        }
+    }
+
+    Stream stream;
+    Stream_Init(&stream, &options);
+    if (expr) Stream_SetExpression(&stream, expr);
+    Stream_SetVariables(&stream, y, t);
+    if (range) {
+        double from, to;
+        long long count;
+        if (sscanf(range, "%lf:%lf:%lld", &from, &to, &count) != 3 || count < 0) {
+            Usage(argv[0]);
+            return 2;
+        }
+        Stream_SetRange(&stream, from, to, count);
+    }
+
+    // a range alone reads nothing
+    FILE* in = NULL;
+    if (path && strcmp(path, "-") != 0) {
+        in = fopen(path, options.input == STREAM_BINARY ? "rb" : "r");
+        if (!in) {
+            fprintf(stderr, "%s: can't open\n", path);
+            return 1;
+        }
+    } else if (path || !range) {
+        in = stdin;
+    }
+#ifdef _WIN32
+    if (in == stdin && options.input == STREAM_BINARY) _setmode(_fileno(stdin), _O_BINARY);
+    if (options.output == STREAM_BINARY) _setmode(_fileno(stdout), _O_BINARY);
+#endif
+    // the pipeline writes whole chunks, a big buffer saves the small writes stdio would do
+    static char outBuffer[1 << 16];
+    setvbuf(stdout, outBuffer, _IOFBF, sizeof(outBuffer));
+
+    ThreadPool* pool = Pool_Create(threads);
+    struct timespec start, end;
+    timespec_get(&start, TIME_UTC);
+    bool ok = Stream_Run(&stream, pool, in, stdout);
+    timespec_get(&end, TIME_UTC);
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+    if (stream.writeFailed) fprintf(stderr, "can't write the output\n");
+    if (!quiet) {
+        fprintf(stderr, "%lld samples in %.3f s, %.1f M/s on %d threads\n", (long long)stream.samples, seconds,
+                seconds > 0 ? stream.samples / seconds * 1e-6 : 0.0, Pool_WorkerCount(pool));
+    }
+
+    if (in && in != stdin) fclose(in);
+    Stream_Free(&stream);
+    Pool_Destroy(pool);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,563 @@
+#include "compiler.h"
+#include "vecmath.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+
+typedef struct {
+    Program* prog;
+    bool live[PROGRAM_MAX_REGS];
+    bool overflow;
+} CompilerState;
+
+static int AllocReg(CompilerState* c) {
+    for (int r = 0; r < PROGRAM_MAX_REGS; r++) {
+        if (!c->live[r]) {
+            c->live[r] = true;
+            if (r + 1 > c->prog->regCount) c->prog->regCount = r + 1;
+            return r;
+        }
+    }
+    c->overflow = true;
+    return 0;
+}
+
+static void FreeReg(CompilerState* c, int r) {
+    c->live[r] = false;
+}
+
+static int EmitInstr(CompilerState* c, OpCode op, int a, int b) {
+    Program* prog = c->prog;
+    int dst = AllocReg(c);
+    prog->code[prog->codeCount++] = (Instr){ (uint16_t)op, (uint16_t)dst, (uint16_t)a, (uint16_t)b };
+    return dst;
+}
+
+static int EmitConst(CompilerState* c, double value) {
+    Program* prog = c->prog;
+    int k = prog->constCount++;
+    prog->constants[k] = value;
+    return EmitInstr(c, OP_CONST, k, 0);
+}
+
+// register holding an operand; missing operands get a fresh constant 0
+static int OperandReg(CompilerState* c, const int* regOf, NodeIndex n) {
+    return (n == NODE_NONE) ? EmitConst(c, 0.0) : regOf[n];
+}
+
+// drops one use of an operand and frees its register after the last one
+static void ReleaseOperand(CompilerState* c, int* uses, NodeIndex n, int reg) {
+    if (n == NODE_NONE || --uses[n] == 0) FreeReg(c, reg);
+}
+
+static OpCode BinaryOp(uint8_t op) {
+    switch (op) {
+        case TOKEN_PLUS: return OP_ADD;
+        case TOKEN_MINUS: return OP_SUB;
+        case TOKEN_MULTIPLY: return OP_MUL;
+        case TOKEN_DIVIDE: return OP_DIV;
+        default: return OP_POW;
+    }
+}
+
+static OpCode FunctionOp(uint8_t func) {
+    switch (func) {
+        case FUNC_SIN: return OP_SIN;
+        case FUNC_COS: return OP_COS;
+        case FUNC_TAN: return OP_TAN;
+        case FUNC_SQRT: return OP_SQRT;
+        case FUNC_LOG: return OP_LOG;
+        case FUNC_EXP: return OP_EXP;
+        default: return OP_ABS;
+    }
+}
+
+// nodes are stored children first, so one forward pass over the arena emits valid code
+static void EmitNodes(CompilerState* c, const AST* ast, int* regOf, int* uses) {
+    for (NodeIndex i = 0; i < ast->nodeCount; i++) {
+        if (uses[i] == 0) continue; // not reachable from the root
+        const ASTNode* node = &ast->nodes[i];
+        switch (node->type) {
+            case NODE_NUMBER:
+                regOf[i] = EmitConst(c, node->data.number);
+                break;
+            case NODE_VARIABLE:
+                // names were interned by the parser, x/y/t ids are the slots
+                regOf[i] = (node->data.var < VAR_COUNT) ? EmitInstr(c, OP_VAR, node->data.var, 0) : EmitConst(c, 0.0);
+                break;
+            case NODE_BINARY_OP: {
+                NodeIndex l = node->data.binary.left;
+                NodeIndex r = node->data.binary.right;
+                int a = OperandReg(c, regOf, l);
+                int b = OperandReg(c, regOf, r);
+                ReleaseOperand(c, uses, l, a);
+                ReleaseOperand(c, uses, r, b);
+                if (node->op == TOKEN_PLUS || node->op == TOKEN_MINUS || node->op == TOKEN_MULTIPLY ||
+                    node->op == TOKEN_DIVIDE || node->op == TOKEN_POWER) {
+                    regOf[i] = EmitInstr(c, BinaryOp(node->op), a, b);
+                } else {
+                    regOf[i] = EmitConst(c, 0.0);
+                }
+                break;
+            }
+            case NODE_UNARY_OP: {
+                NodeIndex o = node->data.unary.operand;
+                int a = OperandReg(c, regOf, o);
+                ReleaseOperand(c, uses, o, a);
+                regOf[i] = EmitInstr(c, OP_NEG, a, 0);
+                break;
+            }
+            case NODE_FUNCTION: {
+                NodeIndex o = node->data.function.arg;
+                int a = OperandReg(c, regOf, o);
+                ReleaseOperand(c, uses, o, a);
+                regOf[i] = (node->func < FUNC_NONE) ? EmitInstr(c, FunctionOp(node->func), a, 0) : EmitConst(c, 0.0);
+                break;
+            }
+        }
+    }
+}
+
+static void CountUses(const AST* ast, NodeIndex n, int* uses) {
+    if (n == NODE_NONE) return;
+    if (uses[n]++ > 0) return; // shared node, children already counted
+    const ASTNode* node = &ast->nodes[n];
+    if (node->type == NODE_BINARY_OP) {
+        CountUses(ast, node->data.binary.left, uses);
+        CountUses(ast, node->data.binary.right, uses);
+    } else if (node->type == NODE_UNARY_OP) {
+        CountUses(ast, node->data.unary.operand, uses);
+    } else if (node->type == NODE_FUNCTION) {
+        CountUses(ast, node->data.function.arg, uses);
+    }
+}
+
+static int OperandCount(uint16_t op) {
+    switch (op) {
+        case OP_CONST:
+        case OP_VAR: return 0;
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+        case OP_DIV:
+        case OP_POW: return 2;
+        default: return 1;
+    }
+}
+
+static bool IsExpensive(uint16_t op) {
+    return op == OP_POW || op == OP_SQRT || op == OP_SIN || op == OP_COS || op == OP_TAN || op == OP_LOG || op == OP_EXP;
+}
+
+static bool IsColumn(const Program* prog, int i) {
+    return (prog->depends[i] & DEPENDS_ON(VAR_X)) && !(prog->depends[i] & DEPENDS_ON(VAR_T));
+}
+
+// what every instruction depends on, and which columns the t-dependent part reads.
+// registers get reused, so an operand is traced to the instruction that last wrote it
+static void Analyze(Program* prog) {
+    int writer[PROGRAM_MAX_REGS] = { 0 };
+    uint8_t all = 0;
+    for (int i = 0; i < prog->codeCount; i++) {
+        const Instr* in = &prog->code[i];
+        int operands = OperandCount(in->op);
+        uint8_t d = (in->op == OP_VAR) ? (uint8_t)DEPENDS_ON(in->a) : 0;
+        if (operands >= 1) d |= prog->depends[writer[in->a]];
+        if (operands == 2) d |= prog->depends[writer[in->b]];
+        prog->depends[i] = d;
+        prog->column[i] = -1;
+        writer[in->dst] = i;
+        all |= d;
+    }
+
+    prog->columnCount = 0;
+    prog->columnCost = 0;
+    if (!(all & DEPENDS_ON(VAR_T))) return;
+    for (int i = 0; i < prog->codeCount; i++) {
+        const Instr* in = &prog->code[i];
+        if (IsColumn(prog, i)) {
+            if (IsExpensive(in->op)) prog->columnCost++;
+        } else {
+            int operands = OperandCount(in->op);
+            // only read operands are registers, a constant's a indexes the pool
+            for (int k = 0; k < operands; k++) {
+                int w = writer[k == 0 ? in->a : in->b];
+                if (IsColumn(prog, w) && prog->column[w] < 0) prog->column[w] = (int16_t)prog->columnCount++;
+            }
+        }
+        writer[in->dst] = i;
+    }
+}
+
+Program* AST_Compile(const AST* ast) {
+    if (!ast || ast->root == NODE_NONE) return NULL;
+
+    // one instruction per node plus a constant for each missing operand
+    int count = 3 * ast->nodeCount;
+    size_t size = sizeof(Program) + count * (sizeof(Instr) + sizeof(double) + sizeof(int16_t) + sizeof(uint8_t));
+    Program* prog = (Program*)malloc(size);
+    int* scratch = (int*)calloc(2 * ast->nodeCount, sizeof(int));
+    if (!prog || !scratch) {
+        free(prog);
+        free(scratch);
+        return NULL;
+    }
+    int* uses = scratch;
+    int* regOf = scratch + ast->nodeCount;
+
+    prog->constants = (double*)(prog + 1);
+    prog->code = (Instr*)(prog->constants + count);
+    prog->column = (int16_t*)(prog->code + count);
+    prog->depends = (uint8_t*)(prog->column + count);
+    prog->codeCount = 0;
+    prog->constCount = 0;
+    prog->regCount = 0;
+
+    CompilerState c;
+    memset(&c, 0, sizeof(c));
+    c.prog = prog;
+    CountUses(ast, ast->root, uses);
+    uses[ast->root]++; // the result register is never released
+    EmitNodes(&c, ast, regOf, uses);
+    prog->result = regOf[ast->root];
+    free(scratch);
+
+    if (c.overflow) {
+        free(prog);
+        return NULL;
+    }
+    Analyze(prog);
+    return prog;
+}
+
+static double Apply(uint16_t op, double a, double b) {
+    switch (op) {
+        case OP_ADD: return a + b;
+        case OP_SUB: return a - b;
+        case OP_MUL: return a * b;
+        case OP_DIV: return (b != 0) ? a / b : NAN;
+        case OP_POW: return pow(a, b);
+        case OP_NEG: return -a;
+        case OP_SIN: return sin(a);
+        case OP_COS: return cos(a);
+        case OP_TAN: return tan(a);
+        case OP_SQRT: return sqrt(a);
+        case OP_LOG: return log(a);
+        case OP_EXP: return exp(a);
+        case OP_ABS: return fabs(a);
+        default: return 0.0;
+    }
+}
+
+double Program_Evaluate(const Program* program, EvalContext* ctx) {
+    double regs[PROGRAM_MAX_REGS];
+    const double* k = program->constants;
+    const Instr* ip = program->code;
+    const Instr* end = ip + program->codeCount;
+
+    for (; ip < end; ip++) {
+        switch (ip->op) {
+            case OP_CONST: regs[ip->dst] = k[ip->a]; break;
+            case OP_VAR: regs[ip->dst] = (ip->a == VAR_X) ? ctx->x : (ip->a == VAR_Y) ? ctx->y : ctx->t; break;
+            default: regs[ip->dst] = Apply(ip->op, regs[ip->a], regs[ip->b]); break;
+        }
+    }
+    return regs[program->result];
+}
+
+// derivative of one instruction given its operands a, b, their derivatives ta, tb and its
+// value v. the same rules as AST_EvaluateNodeDual
+static double Tangent(uint16_t op, double a, double b, double ta, double tb, double v) {
+    switch (op) {
+        case OP_ADD: return ta + tb;
+        case OP_SUB: return ta - tb;
+        case OP_MUL: return ta * b + a * tb;
+        case OP_DIV: return (ta - v * tb) / b;
+        case OP_POW:
+            if (tb == 0.0) return (ta == 0.0) ? 0.0 : b * pow(a, b - 1.0) * ta;
+            return v * (tb * log(a) + b * ta / a);
+        case OP_NEG: return -ta;
+        case OP_SIN: return (ta == 0.0) ? 0.0 : cos(a) * ta;
+        case OP_COS: return (ta == 0.0) ? 0.0 : -sin(a) * ta;
+        case OP_TAN: return (ta == 0.0) ? 0.0 : (1.0 + v * v) * ta;
+        case OP_SQRT: return (ta == 0.0) ? 0.0 : ta / (2.0 * v);
+        case OP_LOG: return (ta == 0.0) ? 0.0 : ta / a;
+        case OP_EXP: return (ta == 0.0) ? 0.0 : v * ta;
+        case OP_ABS: return (ta == 0.0) ? 0.0 : ta * (a / v);
+        default: return 0.0;
+    }
+}
+
+double Program_EvaluateDual(const Program* program, EvalContext* ctx, double* derivative) {
+    double regs[PROGRAM_MAX_REGS];
+    double tangents[PROGRAM_MAX_REGS];
+    const double* k = program->constants;
+
+    for (int i = 0; i < program->codeCount; i++) {
+        const Instr* ip = &program->code[i];
+        switch (ip->op) {
+            case OP_CONST:
+                regs[ip->dst] = k[ip->a];
+                tangents[ip->dst] = 0.0;
+                break;
+            case OP_VAR:
+                regs[ip->dst] = (ip->a == VAR_X) ? ctx->x : (ip->a == VAR_Y) ? ctx->y : ctx->t;
+                tangents[ip->dst] = (ip->a == VAR_X) ? 1.0 : 0.0;
+                break;
+            default: {
+                // dst can be an operand's register, read everything first
+                double a = regs[ip->a], b = regs[ip->b];
+                double v = Apply(ip->op, a, b);
+                tangents[ip->dst] = Tangent(ip->op, a, b, tangents[ip->a], tangents[ip->b], v);
+                regs[ip->dst] = v;
+                break;
+            }
+        }
+    }
+    *derivative = tangents[program->result];
+    return regs[program->result];
+}
+
+// the batch register file lives on the stack, lanes per chunk shrink for big programs
+#define BATCH_MAX_LANES 64
+#define BATCH_STACK_DOUBLES 4096
+
+typedef enum {
+    RUN_ALL,
+    RUN_COLUMNS,     // only what doesn't read t, storing the columns
+    RUN_WITH_COLUMNS // only what isn't a column, loading the ones that are read
+} RunMode;
+
+static void EvaluateChunk(const Program* program, const VecKernels* vk, double* regs, int lanes,
+                          const double* xs, int n, const EvalContext* ctx, RunMode mode, double* columns) {
+    const double* k = program->constants;
+    int columnCount = program->columnCount;
+
+    for (int i = 0; i < program->codeCount; i++) {
+        const Instr* ip = &program->code[i];
+        double* d = regs + ip->dst * lanes;
+        const double* a = regs + ip->a * lanes;
+        const double* b = regs + ip->b * lanes;
+        uint8_t depends = program->depends[i];
+        if (mode == RUN_COLUMNS && (depends & DEPENDS_ON(VAR_T))) continue;
+        if (mode == RUN_WITH_COLUMNS && IsColumn(program, i)) {
+            int c = program->column[i];
+            if (c < 0) continue;
+            for (int l = 0; l < n; l++) d[l] = columns[l * columnCount + c];
+            for (int l = n; l < lanes; l++) d[l] = d[n - 1];
+            continue;
+        }
+        if (!(depends & DEPENDS_ON(VAR_X)) && ip->op != OP_CONST && ip->op != OP_VAR) {
+            // the same in every lane, worked out once
+            double v = Apply(ip->op, a[0], b[0]);
+            for (int l = 0; l < lanes; l++) d[l] = v;
+            continue;
+        }
+        switch (ip->op) {
+            case OP_CONST:
+                for (int l = 0; l < lanes; l++) d[l] = k[ip->a];
+                break;
+            case OP_VAR:
+                if (ip->a == VAR_X) {
+                    memcpy(d, xs, n * sizeof(double));
+                    for (int l = n; l < lanes; l++) d[l] = xs[n - 1]; // pad the tail with a real sample
+                } else {
+                    double v = (ip->a == VAR_Y) ? ctx->y : ctx->t;
+                    for (int l = 0; l < lanes; l++) d[l] = v;
+                }
+                break;
+            case OP_ADD: vk->add(d, a, b, lanes); break;
+            case OP_SUB: vk->sub(d, a, b, lanes); break;
+            case OP_MUL: vk->mul(d, a, b, lanes); break;
+            case OP_DIV: vk->div(d, a, b, lanes); break;
+            case OP_POW:
+                for (int l = 0; l < lanes; l++) d[l] = pow(a[l], b[l]);
+                break;
+            case OP_NEG: vk->neg(d, a, lanes); break;
+            case OP_SIN: vk->sin(d, a, lanes); break;
+            case OP_COS: vk->cos(d, a, lanes); break;
+            case OP_TAN:
+                for (int l = 0; l < lanes; l++) d[l] = tan(a[l]);
+                break;
+            case OP_SQRT: vk->sqrt(d, a, lanes); break;
+            case OP_LOG: vk->log(d, a, lanes); break;
+            case OP_EXP: vk->exp(d, a, lanes); break;
+            case OP_ABS: vk->abs(d, a, lanes); break;
+        }
+        if (mode == RUN_COLUMNS && program->column[i] >= 0) {
+            int c = program->column[i];
+            for (int l = 0; l < n; l++) columns[l * columnCount + c] = d[l];
+        }
+    }
+}
+
+static void RunBatch(const Program* program, const double* xs, double* columns, double* out, size_t n,
+                     const EvalContext* ctx, RunMode mode) {
+    double regs[BATCH_STACK_DOUBLES];
+    const VecKernels* vk = VecMath_Get();
+
+    int lanes = BATCH_STACK_DOUBLES / (program->regCount > 0 ? program->regCount : 1);
+    if (lanes > BATCH_MAX_LANES) lanes = BATCH_MAX_LANES;
+    lanes &= ~3; // whole vectors only
+    if (lanes < 4) {
+        // only reachable with an absurd register count, stay correct anyway. columns are
+        // left alone and the full program runs instead
+        EvalContext c = *ctx;
+        for (size_t i = 0; i < n && out; i++) {
+            c.x = xs[i];
+            out[i] = Program_Evaluate(program, &c);
+        }
+        return;
+    }
+
+    for (size_t base = 0; base < n; base += lanes) {
+        int count = (n - base < (size_t)lanes) ? (int)(n - base) : lanes;
+        // run the short tail at vector width and copy out only the real lanes
+        int width = (count + 3) & ~3;
+        double* chunkColumns = columns ? columns + base * program->columnCount : NULL;
+        EvaluateChunk(program, vk, regs, width, xs + base, count, ctx, mode, chunkColumns);
+        if (out) memcpy(out + base, regs + program->result * width, count * sizeof(double));
+    }
+}
+
+void AST_EvaluateBatch(const Program* program, const double* xs, double* out, size_t n, const EvalContext* ctx) {
+    RunBatch(program, xs, NULL, out, n, ctx, RUN_ALL);
+}
+
+void Program_EvaluateColumns(const Program* program, const double* xs, double* columns, size_t n, const EvalContext* ctx) {
+    RunBatch(program, xs, columns, NULL, n, ctx, RUN_COLUMNS);
+}
+
+void Program_EvaluateWithColumns(const Program* program, const double* xs, const double* columns, double* out, size_t n,
+                                 const EvalContext* ctx) {
+    RunBatch(program, xs, (double*)columns, out, n, ctx, RUN_WITH_COLUMNS);
+}
+
+// value and tangent registers side by side plus three lanes of scratch. the tangent of
+// anything that doesn't read x is 0, the rest costs about one more op per op, except
+// sin and cos which also need the other one
+static void EvaluateChunkDual(const Program* program, const VecKernels* vk, double* regs, double* tangents,
+                              double* scratch, int lanes, const double* xs, int n, const EvalContext* ctx) {
+    const double* k = program->constants;
+    double* s = scratch + 2 * lanes;
+
+    for (int i = 0; i < program->codeCount; i++) {
+        const Instr* ip = &program->code[i];
+        double* d = regs + ip->dst * lanes;
+        double* td = tangents + ip->dst * lanes;
+        const double* a = regs + ip->a * lanes;
+        const double* b = regs + ip->b * lanes;
+        const double* ta = tangents + ip->a * lanes;
+        const double* tb = tangents + ip->b * lanes;
+
+        if (ip->op == OP_VAR && ip->a == VAR_X) {
+            memcpy(d, xs, n * sizeof(double));
+            for (int l = n; l < lanes; l++) d[l] = xs[n - 1];
+            for (int l = 0; l < lanes; l++) td[l] = 1.0;
+            continue;
+        }
+        if (!(program->depends[i] & DEPENDS_ON(VAR_X))) {
+            double value = (ip->op == OP_CONST) ? k[ip->a]
+                         : (ip->op == OP_VAR) ? ((ip->a == VAR_Y) ? ctx->y : ctx->t)
+                         : Apply(ip->op, a[0], b[0]);
+            for (int l = 0; l < lanes; l++) d[l] = value;
+            memset(td, 0, lanes * sizeof(double));
+            continue;
+        }
+        // straight into dst unless it's an operand's register too
+        bool aliased = ip->dst == ip->a || (OperandCount(ip->op) == 2 && ip->dst == ip->b);
+        double* v = aliased ? scratch : d;
+        double* t = aliased ? scratch + lanes : td;
+        switch (ip->op) {
+            case OP_ADD:
+                vk->add(v, a, b, lanes);
+                vk->add(t, ta, tb, lanes);
+                break;
+            case OP_SUB:
+                vk->sub(v, a, b, lanes);
+                vk->sub(t, ta, tb, lanes);
+                break;
+            case OP_MUL:
+                vk->mul(v, a, b, lanes);
+                for (int l = 0; l < lanes; l++) t[l] = ta[l] * b[l] + a[l] * tb[l];
+                break;
+            case OP_DIV:
+                vk->div(v, a, b, lanes);
+                for (int l = 0; l < lanes; l++) t[l] = (ta[l] - v[l] * tb[l]) / b[l];
+                break;
+            case OP_NEG:
+                vk->neg(v, a, lanes);
+                vk->neg(t, ta, lanes);
+                break;
+            case OP_SIN:
+                vk->sin(v, a, lanes);
+                vk->cos(s, a, lanes);
+                vk->mul(t, s, ta, lanes);
+                break;
+            case OP_COS:
+                vk->cos(v, a, lanes);
+                vk->sin(s, a, lanes);
+                for (int l = 0; l < lanes; l++) t[l] = -s[l] * ta[l];
+                break;
+            case OP_SQRT:
+                vk->sqrt(v, a, lanes);
+                for (int l = 0; l < lanes; l++) t[l] = ta[l] / (2.0 * v[l]);
+                break;
+            case OP_LOG:
+                vk->log(v, a, lanes);
+                vk->div(t, ta, a, lanes);
+                break;
+            case OP_EXP:
+                vk->exp(v, a, lanes);
+                vk->mul(t, v, ta, lanes);
+                break;
+            case OP_ABS:
+                vk->abs(v, a, lanes);
+                for (int l = 0; l < lanes; l++) t[l] = ta[l] * (a[l] / v[l]);
+                break;
+            default: // pow and tan have no kernels
+                for (int l = 0; l < lanes; l++) {
+                    v[l] = Apply(ip->op, a[l], b[l]);
+                    t[l] = Tangent(ip->op, a[l], b[l], ta[l], tb[l], v[l]);
+                }
+                break;
+        }
+        if (aliased) {
+            memcpy(d, v, lanes * sizeof(double));
+            memcpy(td, t, lanes * sizeof(double));
+        }
+    }
+}
+
+void Program_EvaluateBatchDual(const Program* program, const double* xs, double* out, double* derivatives, size_t n,
+                               const EvalContext* ctx) {
+    double regs[BATCH_STACK_DOUBLES];
+    const VecKernels* vk = VecMath_Get();
+
+    int lanes = BATCH_STACK_DOUBLES / (2 * program->regCount + 3);
+    if (lanes > BATCH_MAX_LANES) lanes = BATCH_MAX_LANES;
+    lanes &= ~3;
+    if (lanes < 4) {
+        EvalContext c = *ctx;
+        for (size_t i = 0; i < n; i++) {
+            c.x = xs[i];
+            out[i] = Program_EvaluateDual(program, &c, &derivatives[i]);
+        }
+        return;
+    }
+
+    double* tangents = regs + program->regCount * lanes;
+    double* scratch = tangents + program->regCount * lanes;
+    for (size_t base = 0; base < n; base += lanes) {
+        int count = (n - base < (size_t)lanes) ? (int)(n - base) : lanes;
+        int width = (count + 3) & ~3;
+        EvaluateChunkDual(program, vk, regs, tangents, scratch, width, xs + base, count, ctx);
+        memcpy(out + base, regs + program->result * width, count * sizeof(double));
+        memcpy(derivatives + base, tangents + program->result * width, count * sizeof(double));
+    }
+}
+
+void Program_Free(Program* program) {
+    free(program);
+}
@@ -0,0 +1,72 @@
+#ifndef COMPILER_H
+#define COMPILER_H
+
+#include "parser.h"
+#include <stdint.h>
+#include <stddef.h>
+
+// upper bound on simultaneously live values; a 255 char input never gets close
+#define PROGRAM_MAX_REGS 256
+
+typedef enum {
+    OP_CONST,   // dst = constants[a]
+    OP_VAR,     // dst = variable slot a (VarSlot)
+    OP_ADD,     // dst = a + b
+    OP_SUB,
+    OP_MUL,
+    OP_DIV,
+    OP_POW,
+    OP_NEG,     // dst = -a
+    OP_SIN,     // dst = sin(a)
+    OP_COS,
+    OP_TAN,
+    OP_SQRT,
+    OP_LOG,
+    OP_EXP,
+    OP_ABS
+} OpCode;
+
+typedef struct {
+    uint16_t op;
+    uint16_t dst;
+    uint16_t a;
+    uint16_t b;
+} Instr;
+
+// dependency bits, one per VarSlot
+#define DEPENDS_ON(var) (1u << (var))
+
+// flat register program lowered from an AST, lives in a single allocation
+typedef struct {
+    Instr* code;
+    int codeCount;
+    double* constants;
+    int constCount;
+    int regCount;
+    int result;       // register holding the final value
+    uint8_t* depends; // per instruction, the variables its value is computed from
+    // an instruction that reads x but not t is a column: its value at an x holds for every
+    // t. the columns the rest of the program reads are numbered here, -1 for the others
+    int16_t* column;
+    int columnCount;  // 0 when the program doesn't read t
+    int columnCost;   // expensive instructions (pow, sqrt, transcendentals) the columns save
+} Program;
+
+Program* AST_Compile(const AST* ast);
+double Program_Evaluate(const Program* program, EvalContext* ctx);
+// evaluates out[i] = f(xs[i]) for a whole span, y and t are taken from ctx
+void AST_EvaluateBatch(const Program* program, const double* xs, double* out, size_t n, const EvalContext* ctx);
+// the columns a program reads at each x, columnCount per x, computed for ctx->y
+void Program_EvaluateColumns(const Program* program, const double* xs, double* columns, size_t n, const EvalContext* ctx);
+// AST_EvaluateBatch with the columns read from Program_EvaluateColumns instead of computed,
+// only what depends on t is left to do
+void Program_EvaluateWithColumns(const Program* program, const double* xs, const double* columns, double* out, size_t n,
+                                 const EvalContext* ctx);
+// value and derivative with respect to x in one pass, see AST_EvaluateDual
+double Program_EvaluateDual(const Program* program, EvalContext* ctx, double* derivative);
+// AST_EvaluateBatch that also writes derivatives[i] = f'(xs[i])
+void Program_EvaluateBatchDual(const Program* program, const double* xs, double* out, double* derivatives, size_t n,
+                               const EvalContext* ctx);
+void Program_Free(Program* program);
+
+#endif
@@ -0,0 +1,382 @@
+#include "ddouble.h"
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// pi / 2 in three parts, so reducing an angle many turns out still keeps its digits
+static const double HALF_PI[3] = { 1.5707963267948966, 6.123233995736766e-17, -1.4973849048591698e-33 };
+static const DDouble LN2 = { 0.6931471805599453, 2.3190468138462996e-17 };
+// 1 / n!, from n = 2
+static const DDouble INVERSE_FACTORIAL[] = {
+    { 0.5, 0.0 },
+    { 0.16666666666666666, 9.25185853854297e-18 },
+    { 0.041666666666666664, 2.3129646346357427e-18 },
+    { 0.008333333333333333, 1.1564823173178714e-19 },
+    { 0.001388888888888889, -5.300543954373577e-20 },
+    { 0.0001984126984126984, 1.7209558293420705e-22 },
+    { 2.48015873015873e-05, 2.1511947866775882e-23 },
+    { 2.7557319223985893e-06, -1.858393274046472e-22 },
+    { 2.755731922398589e-07, 2.3767714622250297e-23 },
+    { 2.505210838544172e-08, -1.448814070935912e-24 },
+    { 2.08767569878681e-09, -1.20734505911326e-25 },
+    { 1.6059043836821613e-10, 1.2585294588752098e-26 },
+    { 1.1470745597729725e-11, 2.0655512752830745e-28 },
+    { 7.647163731819816e-13, 7.03872877733453e-30 },
+    { 4.779477332387385e-14, 4.399205485834081e-31 },
+    { 2.8114572543455206e-15, 1.6508842730861433e-31 },
+    { 1.5619206968586225e-16, 1.1910679660273754e-32 },
+    { 8.22063524662433e-18, 2.2141894119604265e-34 }
+};
+
+#define EXP_HALVINGS 8 // exp works on a / 2^8, then squares back up
+#define SIN_HALVINGS 3 // sin and cos on a / 2^3, then doubles the angle back up
+
+static DDouble Value(double a) {
+    return (DDouble){ a, 0.0 };
+}
+
+// a + b with the rounding error of the sum in lo, when |a| >= |b|
+static DDouble QuickTwoSum(double a, double b) {
+    double s = a + b;
+    return (DDouble){ s, b - (s - a) };
+}
+
+static DDouble TwoSum(double a, double b) {
+    double s = a + b;
+    double bb = s - a;
+    return (DDouble){ s, (a - (s - bb)) + (b - bb) };
+}
+
+// dekker's product, exact without fma: a and b split into halves whose products fit
+static DDouble TwoProduct(double a, double b) {
+    const double split = 134217729.0; // 2^27 + 1
+    double p = a * b;
+    double ca = split * a, cb = split * b;
+    double ahi = ca - (ca - a), alo = a - ahi;
+    double bhi = cb - (cb - b), blo = b - bhi;
+    return (DDouble){ p, ((ahi * bhi - p) + ahi * blo + alo * bhi) + alo * blo };
+}
+
+DDouble DDouble_Add(DDouble a, DDouble b) {
+    DDouble s = TwoSum(a.hi, b.hi);
+    if (!isfinite(s.hi)) return Value(s.hi);
+    DDouble t = TwoSum(a.lo, b.lo);
+    s = QuickTwoSum(s.hi, s.lo + t.hi);
+    return QuickTwoSum(s.hi, s.lo + t.lo);
+}
+
+DDouble DDouble_Sub(DDouble a, DDouble b) {
+    return DDouble_Add(a, (DDouble){ -b.hi, -b.lo });
+}
+
+DDouble DDouble_Mul(DDouble a, DDouble b) {
+    double hi = a.hi * b.hi;
+    if (!isfinite(hi)) return Value(hi);
+    DDouble p = TwoProduct(a.hi, b.hi);
+    return QuickTwoSum(p.hi, p.lo + (a.hi * b.lo + a.lo * b.hi));
+}
+
+static DDouble Scale(DDouble a, double b) {
+    double hi = a.hi * b;
+    if (!isfinite(hi)) return Value(hi);
+    DDouble p = TwoProduct(a.hi, b);
+    return QuickTwoSum(p.hi, p.lo + a.lo * b);
+}
+
+DDouble DDouble_Div(DDouble a, DDouble b) {
+    if (b.hi == 0) return Value(NAN);
+    double q1 = a.hi / b.hi;
+    if (!isfinite(q1) || !isfinite(b.hi)) return Value(q1);
+    // two corrections from the remainder, each worth another double of quotient
+    DDouble r = DDouble_Sub(a, Scale(b, q1));
+    double q2 = r.hi / b.hi;
+    r = DDouble_Sub(r, Scale(b, q2));
+    double q3 = r.hi / b.hi;
+    DDouble q = QuickTwoSum(q1, q2);
+    return DDouble_Add(q, Value(q3));
+}
+
+DDouble DDouble_Sqrt(DDouble a) {
+    if (!(a.hi > 0) || !isfinite(a.hi)) return Value(sqrt(a.hi));
+    double q = sqrt(a.hi);
+    // one newton step from the double root
+    DDouble r = DDouble_Sub(a, TwoProduct(q, q));
+    return QuickTwoSum(q, r.hi / (2 * q));
+}
+
+// sum of x^n / n! for n = 1 up to where the terms stop counting, x small
+static DDouble Series(DDouble x, int step) {
+    DDouble sum = x, power = x;
+    DDouble x2 = (step == 2) ? DDouble_Mul(x, x) : x;
+    int count = (int)(sizeof(INVERSE_FACTORIAL) / sizeof(INVERSE_FACTORIAL[0]));
+    for (int n = 1 + step; n - 2 < count; n += step) {
+        power = DDouble_Mul(power, x2);
+        DDouble term = DDouble_Mul(power, INVERSE_FACTORIAL[n - 2]);
+        if (step == 2 && ((n - 1) / 2) % 2 == 1) term = (DDouble){ -term.hi, -term.lo };
+        sum = DDouble_Add(sum, term);
+        if (fabs(term.hi) < 1e-33 * fabs(sum.hi)) break;
+    }
+    return sum;
+}
+
+DDouble DDouble_Exp(DDouble a) {
+    if (isnan(a.hi)) return a;
+    if (a.hi > 709.8) return Value(INFINITY);
+    if (a.hi < -745.2) return Value(0.0);
+    // a = k ln 2 + r, |r| <= ln 2 / 2, and e^r from the series of r / 256
+    double k = nearbyint(a.hi / LN2.hi);
+    DDouble r = DDouble_Sub(a, Scale(LN2, k));
+    r.hi = ldexp(r.hi, -EXP_HALVINGS);
+    r.lo = ldexp(r.lo, -EXP_HALVINGS);
+    // e^r - 1, then (e^2r - 1) = (e^r - 1)(e^r - 1 + 2) back up
+    DDouble m = Series(r, 1);
+    for (int i = 0; i < EXP_HALVINGS; i++) m = DDouble_Add(DDouble_Mul(m, m), Scale(m, 2.0));
+    m = DDouble_Add(m, Value(1.0));
+    return (DDouble){ ldexp(m.hi, (int)k), ldexp(m.lo, (int)k) };
+}
+
+DDouble DDouble_Log(DDouble a) {
+    if (!(a.hi > 0) || !isfinite(a.hi)) return Value(log(a.hi));
+    // one newton step on e^y = a from the double log
+    DDouble y = Value(log(a.hi));
+    DDouble e = DDouble_Exp((DDouble){ -y.hi, -y.lo });
+    return DDouble_Sub(DDouble_Add(y, DDouble_Mul(a, e)), Value(1.0));
+}
+
+// sin and cos of a together. quadrant from a = k pi/2 + r, then r / 8 by series
+static void SinCos(DDouble a, DDouble* s, DDouble* c) {
+    if (!isfinite(a.hi)) {
+        *s = *c = Value(NAN);
+        return;
+    }
+    double k = nearbyint(a.hi / HALF_PI[0]);
+    DDouble r = DDouble_Sub(a, TwoProduct(k, HALF_PI[0]));
+    r = DDouble_Sub(r, TwoProduct(k, HALF_PI[1]));
+    r = DDouble_Sub(r, Value(k * HALF_PI[2]));
+    r.hi = ldexp(r.hi, -SIN_HALVINGS);
+    r.lo = ldexp(r.lo, -SIN_HALVINGS);
+
+    DDouble sr = Series(r, 2);
+    DDouble cr = DDouble_Sqrt(DDouble_Sub(Value(1.0), DDouble_Mul(sr, sr)));
+    for (int i = 0; i < SIN_HALVINGS; i++) {
+        // sin 2r = 2 sin r cos r, cos 2r = 1 - 2 sin^2 r
+        DDouble s2 = Scale(DDouble_Mul(sr, cr), 2.0);
+        cr = DDouble_Sub(Value(1.0), Scale(DDouble_Mul(sr, sr), 2.0));
+        sr = s2;
+    }
+    switch ((long long)fmod(k, 4.0) & 3) {
+        case 0: *s = sr; *c = cr; break;
+        case 1: *s = cr; *c = (DDouble){ -sr.hi, -sr.lo }; break;
+        case 2: *s = (DDouble){ -sr.hi, -sr.lo }; *c = (DDouble){ -cr.hi, -cr.lo }; break;
+        default: *s = (DDouble){ -cr.hi, -cr.lo }; *c = sr; break;
+    }
+}
+
+DDouble DDouble_Sin(DDouble a) {
+    DDouble s, c;
+    SinCos(a, &s, &c);
+    return s;
+}
+
+DDouble DDouble_Cos(DDouble a) {
+    DDouble s, c;
+    SinCos(a, &s, &c);
+    return c;
+}
+
+DDouble DDouble_Tan(DDouble a) {
+    DDouble s, c;
+    SinCos(a, &s, &c);
+    if (c.hi == 0) return Value(s.hi / c.hi);
+    return DDouble_Div(s, c);
+}
+
+DDouble DDouble_Pow(DDouble a, DDouble b) {
+    // whole powers by squaring, no log and exp to lose digits in
+    if (b.lo == 0 && b.hi == floor(b.hi) && fabs(b.hi) <= 1024) {
+        long n = (long)fabs(b.hi);
+        DDouble result = Value(1.0), base = a;
+        while (n > 0) {
+            if (n & 1) result = DDouble_Mul(result, base);
+            base = DDouble_Mul(base, base);
+            n >>= 1;
+        }
+        if (b.hi < 0) return (result.hi == 0) ? Value(pow(a.hi, b.hi)) : DDouble_Div(Value(1.0), result);
+        return result;
+    }
+    // everything else the way pow does it: nan below 0, 0 and inf at 0
+    if (!(a.hi > 0)) return Value(pow(a.hi, b.hi));
+    return DDouble_Exp(DDouble_Mul(b, DDouble_Log(a)));
+}
+
+DDouble DDouble_Floor(DDouble a) {
+    double hi = floor(a.hi);
+    if (hi != a.hi) return Value(hi);
+    // hi is whole already, what's left is in lo
+    return QuickTwoSum(hi, floor(a.lo));
+}
+
+// 10^n, divided rather than multiplied for negative n so 0.1 and friends stay exact to the last digit
+static DDouble ApplyExponent(DDouble m, int n) {
+    DDouble power = DDouble_Pow(Value(10.0), Value(fabs((double)n)));
+    return (n < 0) ? DDouble_Div(m, power) : DDouble_Mul(m, power);
+}
+
+DDouble DDouble_Parse(const char* text, char** end) {
+    const char* p = text;
+    while (isspace((unsigned char)*p)) p++;
+    double sign = 1.0;
+    if (*p == '-' || *p == '+') sign = (*p++ == '-') ? -1.0 : 1.0;
+    DDouble m = Value(0.0);
+    int digits = 0, exponent = 0; // significant digits, and where the point goes
+    bool point = false, any = false;
+    for (;; p++) {
+        if (*p == '.' && !point) {
+            point = true;
+            continue;
+        }
+        if (!isdigit((unsigned char)*p)) break;
+        any = true;
+        int d = *p - '0';
+        if (digits == 0 && d == 0) {
+            // leading zeros only move the point
+            if (point) exponent--;
+            continue;
+        }
+        // past 34 digits they can't change the sum, only its size
+        if (digits < 34) {
+            m = DDouble_Add(Scale(m, 10.0), Value(d));
+            if (point) exponent--;
+        } else if (!point) {
+            exponent++;
+        }
+        digits++;
+    }
+    if (!any) {
+        if (end) *end = (char*)text;
+        return Value(0.0);
+    }
+    if (*p == 'e' || *p == 'E') {
+        char* after;
+        long e = strtol(p + 1, &after, 10);
+        if (after != p + 1) {
+            exponent += (int)(e > 1000 ? 1000 : e < -1000 ? -1000 : e);
+            p = after;
+        }
+    }
+    if (end) *end = (char*)p;
+    m = ApplyExponent(m, exponent);
+    return (DDouble){ sign * m.hi, sign * m.lo };
+}
+
+int DDouble_Format(DDouble a, int digits, char* out, int size) {
+    if (size <= 0) return 0;
+    if (digits < 1) digits = 1;
+    if (digits > 32) digits = 32;
+    if (!isfinite(a.hi) || a.hi == 0) return snprintf(out, (size_t)size, "%.*g", digits, a.hi);
+
+    char mantissa[40];
+    bool negative = a.hi < 0;
+    if (negative) a = (DDouble){ -a.hi, -a.lo };
+    // a = m 10^e with m in [1, 10), one digit past what's asked for to round on
+    int e = (int)floor(log10(a.hi));
+    DDouble m = ApplyExponent(a, -e);
+    if (m.hi >= 10.0) {
+        m = DDouble_Div(m, Value(10.0));
+        e++;
+    } else if (m.hi < 1.0) {
+        m = Scale(m, 10.0);
+        e--;
+    }
+    for (int i = 0; i <= digits; i++) {
+        int d = (int)floor(m.hi);
+        if (d < 0) d = 0;
+        if (d > 9) d = 9;
+        mantissa[i] = (char)('0' + d);
+        m = Scale(DDouble_Sub(m, Value(d)), 10.0);
+    }
+    if (mantissa[digits] >= '5') {
+        int i = digits - 1;
+        while (i >= 0 && mantissa[i] == '9') mantissa[i--] = '0';
+        if (i >= 0) {
+            mantissa[i]++;
+        } else {
+            // 9.99 rounded up to 10.0
+            memmove(mantissa + 1, mantissa, (size_t)digits);
+            mantissa[0] = '1';
+            e++;
+        }
+    }
+    int last = digits - 1;
+    while (last > 0 && mantissa[last] == '0') last--;
+
+    // the layout %g picks
+    char text[80];
+    int n = 0;
+    if (negative) text[n++] = '-';
+    if (e < -4 || e >= digits) {
+        text[n++] = mantissa[0];
+        if (last > 0) {
+            text[n++] = '.';
+            for (int i = 1; i <= last; i++) text[n++] = mantissa[i];
+        }
+        n += snprintf(text + n, sizeof(text) - (size_t)n, "e%+03d", e);
+    } else if (e < 0) {
+        text[n++] = '0';
+        text[n++] = '.';
+        for (int i = e + 1; i < 0; i++) text[n++] = '0';
+        for (int i = 0; i <= last; i++) text[n++] = mantissa[i];
+    } else {
+        for (int i = 0; i <= e; i++) text[n++] = (i <= last) ? mantissa[i] : '0';
+        if (last > e) {
+            text[n++] = '.';
+            for (int i = e + 1; i <= last; i++) text[n++] = mantissa[i];
+        }
+    }
+    text[n] = '\0';
+    return snprintf(out, (size_t)size, "%s", text);
+}
+
+bool DDouble_IsZero(DDouble a) {
+    return a.hi == 0 && a.lo == 0;
+}
+
+DDouble Program_EvaluateDDouble(const Program* program, const DDoubleContext* ctx) {
+    DDouble regs[PROGRAM_MAX_REGS];
+    const double* k = program->constants;
+    const Instr* ip = program->code;
+    const Instr* end = ip + program->codeCount;
+
+    for (; ip < end; ip++) {
+        DDouble* out = &regs[ip->dst];
+        if (ip->op == OP_CONST) {
+            *out = Value(k[ip->a]);
+            continue;
+        }
+        if (ip->op == OP_VAR) {
+            *out = (ip->a == VAR_X) ? ctx->x : (ip->a == VAR_Y) ? ctx->y : ctx->t;
+            continue;
+        }
+        DDouble a = regs[ip->a];
+        DDouble b = (ip->op <= OP_POW) ? regs[ip->b] : a;
+        switch (ip->op) {
+            case OP_ADD: *out = DDouble_Add(a, b); break;
+            case OP_SUB: *out = DDouble_Sub(a, b); break;
+            case OP_MUL: *out = DDouble_Mul(a, b); break;
+            case OP_DIV: *out = DDouble_Div(a, b); break;
+            case OP_POW: *out = DDouble_Pow(a, b); break;
+            case OP_NEG: *out = (DDouble){ -a.hi, -a.lo }; break;
+            case OP_SIN: *out = DDouble_Sin(a); break;
+            case OP_COS: *out = DDouble_Cos(a); break;
+            case OP_TAN: *out = DDouble_Tan(a); break;
+            case OP_SQRT: *out = DDouble_Sqrt(a); break;
+            case OP_LOG: *out = DDouble_Log(a); break;
+            case OP_EXP: *out = DDouble_Exp(a); break;
+            case OP_ABS: *out = (a.hi < 0) ? (DDouble){ -a.hi, -a.lo } : a; break;
+            default: *out = Value(0.0); break;
+        }
+    }
+    return regs[program->result];
+}
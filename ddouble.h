@@ -0,0 +1,42 @@
+#ifndef DDOUBLE_H
+#define DDOUBLE_H
+
+#include "compiler.h"
+#include <stdbool.h>
+
+// a number kept as the unevaluated sum hi + lo, |lo| at most half an ulp of hi. about 32
+// significant digits for roughly ten to a hundred times the cost of a double, which is what
+// a view zoomed in past what doubles can tell apart needs. inf and nan live in hi, lo is 0
+typedef struct {
+    double hi;
+    double lo;
+} DDouble;
+
+typedef struct {
+    DDouble x;
+    DDouble y;
+    DDouble t;
+} DDoubleContext;
+
+DDouble DDouble_Add(DDouble a, DDouble b);
+DDouble DDouble_Sub(DDouble a, DDouble b);
+DDouble DDouble_Mul(DDouble a, DDouble b);
+// nan for b = 0, like the program's own division
+DDouble DDouble_Div(DDouble a, DDouble b);
+DDouble DDouble_Sqrt(DDouble a);
+DDouble DDouble_Exp(DDouble a);
+DDouble DDouble_Log(DDouble a);
+DDouble DDouble_Sin(DDouble a);
+DDouble DDouble_Cos(DDouble a);
+DDouble DDouble_Tan(DDouble a);
+DDouble DDouble_Pow(DDouble a, DDouble b);
+DDouble DDouble_Floor(DDouble a);
+bool DDouble_IsZero(DDouble a);
+// like strtod, with all the digits a double would drop
+DDouble DDouble_Parse(const char* text, char** end);
+// like %.*g with up to 32 digits, the length written
+int DDouble_Format(DDouble a, int digits, char* out, int size);
+// the same instructions as Program_Evaluate, every register a DDouble
+DDouble Program_EvaluateDDouble(const Program* program, const DDoubleContext* ctx);
+
+#endif
@@ -0,0 +1,203 @@
+#include "expr.h"
+#include "optimizer.h"
+#include <math.h>
+#include <stdlib.h>
+
+void Expr_Init(Expr* e) {
+    e->ast = NULL;
+    e->program = NULL;
+    e->jit = NULL;
+    e->version = 0;
+    e->depends = 0;
+    e->shifted = false;
+    e->originX = e->originY = e->originValue = (DDouble){ 0.0, 0.0 };
+}
+
+void Expr_Set(Expr* e, const char* text) {
+    if (e->program) { Program_Free(e->program); e->program = NULL; }
+    if (e->jit) { Jit_Free(e->jit); e->jit = NULL; }
+
+    // reuses the previous arena, so typing doesn't churn the allocator
+    e->ast = Parser_Reparse(e->ast, text);
+    AST_Optimize(e->ast);
+    e->program = AST_Compile(e->ast);
+    // native code only where it beats the batch interpreter, NULL falls back to it
+    if (Jit_IsWorthwhile(e->program)) e->jit = Jit_Compile(e->program);
+    e->version++;
+
+    // the optimizer leaves only reachable nodes, so a scan is enough
+    e->depends = 0;
+    for (uint32_t i = 0; !Expr_IsEmpty(e) && i < e->ast->nodeCount; i++) {
+        const ASTNode* node = &e->ast->nodes[i];
+        if (node->type == NODE_VARIABLE && node->data.var < VAR_COUNT) e->depends |= (uint8_t)DEPENDS_ON(node->data.var);
+    }
+}
+
+void Expr_SetOrigin(Expr* e, DDouble x, DDouble y, DDouble value) {
+    bool shifted = !DDouble_IsZero(x) || !DDouble_IsZero(y) || !DDouble_IsZero(value);
+    if (shifted == e->shifted && x.hi == e->originX.hi && x.lo == e->originX.lo && y.hi == e->originY.hi &&
+        y.lo == e->originY.lo && value.hi == e->originValue.hi && value.lo == e->originValue.lo) {
+        return;
+    }
+    e->shifted = shifted;
+    e->originX = x;
+    e->originY = y;
+    e->originValue = value;
+    e->version++;
+}
+
+// the fallback for expressions too big to compile. a derivative shares nodes between many
+// parents, a walk down the tree would redo them every time they're reached. the buffer is
+// per call, the same expression is evaluated from several threads at once
+static double* TreeValues(const Expr* e, int perNode) {
+    return (double*)malloc((size_t)e->ast->nodeCount * perNode * sizeof(double));
+}
+
+static double EvaluateTree(const Expr* e, EvalContext* ctx) {
+    if (Expr_IsEmpty(e)) return 0.0;
+    double* values = TreeValues(e, 1);
+    if (!values) return NAN;
+    double v = AST_EvaluateNodes(e->ast, ctx, values);
+    free(values);
+    return v;
+}
+
+static double EvaluateTreeDual(const Expr* e, EvalContext* ctx, double* derivative) {
+    *derivative = 0.0;
+    if (Expr_IsEmpty(e)) return 0.0;
+    double* values = TreeValues(e, 2);
+    if (!values) return *derivative = NAN;
+    double v = AST_EvaluateNodesDual(e->ast, ctx, values, values + e->ast->nodeCount, derivative);
+    free(values);
+    return v;
+}
+
+// f at the origin plus (x, y), less the value origin
+static double EvaluateShifted(const Expr* e, double x, double y, double t) {
+    DDoubleContext c;
+    c.x = DDouble_Add(e->originX, (DDouble){ x, 0.0 });
+    c.y = DDouble_Add(e->originY, (DDouble){ y, 0.0 });
+    c.t = (DDouble){ t, 0.0 };
+    DDouble v;
+    if (e->program) {
+        v = Program_EvaluateDDouble(e->program, &c);
+    } else {
+        // no program to run wide, the tree walk gets the nearest doubles
+        EvalContext plain = { c.x.hi, c.y.hi, t };
+        v = (DDouble){ EvaluateTree(e, &plain), 0.0 };
+    }
+    return DDouble_Sub(v, e->originValue).hi;
+}
+
+bool Expr_IsEmpty(const Expr* e) {
+    return !e->ast || e->ast->root == NODE_NONE;
+}
+
+const char* Expr_Error(const Expr* e) {
+    return e->ast ? e->ast->error : NULL;
+}
+
+bool Expr_DependsOn(const Expr* e, VarSlot var) {
+    return (e->depends & DEPENDS_ON(var)) != 0;
+}
+
+void Expr_EvaluateSpan(const Expr* e, const double* xs, double* out, size_t n, const EvalContext* ctx) {
+    if (e->shifted) {
+        for (size_t i = 0; i < n; i++) out[i] = EvaluateShifted(e, xs[i], ctx->y, ctx->t);
+    } else if (e->jit) {
+        Jit_EvaluateSpan(e->jit, xs, out, n, ctx);
+    } else if (e->program) {
+        AST_EvaluateBatch(e->program, xs, out, n, ctx);
+    } else {
+        // the tree is only a fallback
+        EvalContext c = *ctx;
+        double* values = Expr_IsEmpty(e) ? NULL : TreeValues(e, 1);
+        for (size_t i = 0; i < n; i++) {
+            c.x = xs[i];
+            out[i] = values ? AST_EvaluateNodes(e->ast, &c, values) : Expr_IsEmpty(e) ? 0.0 : NAN;
+        }
+        free(values);
+    }
+}
+
+void Expr_EvaluateSpanDual(const Expr* e, const double* xs, double* out, double* derivatives, size_t n, const EvalContext* ctx) {
+    if (e->shifted) {
+        EvalContext c = *ctx;
+        for (size_t i = 0; i < n; i++) {
+            c.x = xs[i];
+            out[i] = Expr_EvaluateDual(e, &c, &derivatives[i]);
+        }
+        return;
+    }
+    if (e->program) {
+        Program_EvaluateBatchDual(e->program, xs, out, derivatives, n, ctx);
+        return;
+    }
+    EvalContext c = *ctx;
+    double* values = Expr_IsEmpty(e) ? NULL : TreeValues(e, 2);
+    for (size_t i = 0; i < n; i++) {
+        c.x = xs[i];
+        if (values) out[i] = AST_EvaluateNodesDual(e->ast, &c, values, values + e->ast->nodeCount, &derivatives[i]);
+        else out[i] = derivatives[i] = Expr_IsEmpty(e) ? 0.0 : NAN;
+    }
+    free(values);
+}
+
+double Expr_Evaluate(const Expr* e, EvalContext* ctx) {
+    if (e->shifted) return EvaluateShifted(e, ctx->x, ctx->y, ctx->t);
+    if (e->program) return Program_Evaluate(e->program, ctx);
+    return EvaluateTree(e, ctx);
+}
+
+double Expr_EvaluateDual(const Expr* e, EvalContext* ctx, double* derivative) {
+    if (e->shifted) {
+        // a slope only needs a double's digits, at the nearest double to the point
+        EvalContext c = *ctx;
+        c.x = DDouble_Add(e->originX, (DDouble){ ctx->x, 0.0 }).hi;
+        c.y = DDouble_Add(e->originY, (DDouble){ ctx->y, 0.0 }).hi;
+        if (e->program) Program_EvaluateDual(e->program, &c, derivative);
+        else EvaluateTreeDual(e, &c, derivative);
+        return EvaluateShifted(e, ctx->x, ctx->y, ctx->t);
+    }
+    if (e->program) return Program_EvaluateDual(e->program, ctx, derivative);
+    return EvaluateTreeDual(e, ctx, derivative);
+}
+
+// a + origin, or a - origin, rounded outwards
+static Interval Shift(Interval a, DDouble origin, double sign) {
+    if (Interval_IsEmpty(a)) return a;
+    DDouble o = { sign * origin.hi, sign * origin.lo };
+    double lo = DDouble_Add(o, (DDouble){ a.lo, 0.0 }).hi;
+    double hi = DDouble_Add(o, (DDouble){ a.hi, 0.0 }).hi;
+    return (Interval){ nextafter(lo, -INFINITY), nextafter(hi, INFINITY) };
+}
+
+Interval Expr_EvaluateInterval(const Expr* e, const IntervalContext* ctx, Interval* scratch) {
+    if (!e->shifted) return AST_EvaluateInterval(e->ast, ctx, scratch);
+    // bounds in doubles around the origin are as wide as an ulp there, loose but still bounds
+    IntervalContext c = *ctx;
+    c.x = Shift(ctx->x, e->originX, 1.0);
+    c.y = Shift(ctx->y, e->originY, 1.0);
+    return Shift(AST_EvaluateInterval(e->ast, &c, scratch), e->originValue, -1.0);
+}
+
+int Expr_ColumnCount(const Expr* e) {
+    // the jit does cheap programs faster than the interpreter can skip parts of them
+    if (e->shifted || !e->program || e->program->columnCost == 0) return 0;
+    return e->program->columnCount;
+}
+
+void Expr_EvaluateColumns(const Expr* e, const double* xs, double* columns, size_t n, const EvalContext* ctx) {
+    Program_EvaluateColumns(e->program, xs, columns, n, ctx);
+}
+
+void Expr_EvaluateSpanColumns(const Expr* e, const double* xs, const double* columns, double* out, size_t n, const EvalContext* ctx) {
+    Program_EvaluateWithColumns(e->program, xs, columns, out, n, ctx);
+}
+
+void Expr_Free(Expr* e) {
+    AST_Free(e->ast);
+    Program_Free(e->program);
+    Jit_Free(e->jit);
+    Expr_Init(e);
+}
@@ -0,0 +1,57 @@
+#ifndef EXPR_H
+#define EXPR_H
+
+#include "parser.h"
+#include "compiler.h"
+#include "jit.h"
+#include "ddouble.h"
+#include "interval.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// everything derived from one expression string: tree, compiled program and jit code.
+// after Expr_Set it is only read, so it can be shared by anything that evaluates it.
+typedef struct {
+    AST* ast;
+    Program* program;
+    JitProgram* jit;
+    unsigned version; // bumped whenever the text changes, used as a cache key
+    uint8_t depends;  // DEPENDS_ON bits of the variables it reads
+    // deep zoom: x and y come in relative to originX and originY and values go out relative
+    // to originValue, everything in between in double-double. see Expr_SetOrigin
+    bool shifted;
+    DDouble originX, originY, originValue;
+} Expr;
+
+void Expr_Init(Expr* e);
+// parses, optimizes and compiles text, reusing the previous arena
+void Expr_Set(Expr* e, const char* text);
+// from now on every evaluation below takes x and y as offsets from (x, y) and returns
+// f - value, and works out f itself in double-double, so a view zoomed in around a point
+// doubles can't resolve still gets its digits. all zero is plain doubles again, with the
+// jit. bumps the version when it changes, caches keyed on it start over
+void Expr_SetOrigin(Expr* e, DDouble x, DDouble y, DDouble value);
+bool Expr_IsEmpty(const Expr* e);
+// why the text couldn't be made into an expression, NULL when it could or it's just blank
+const char* Expr_Error(const Expr* e);
+bool Expr_DependsOn(const Expr* e, VarSlot var);
+// one value at the point in ctx, for callers that vary something other than x
+double Expr_Evaluate(const Expr* e, EvalContext* ctx);
+// evaluates out[i] = f(xs[i]) with the fastest backend available for this expression
+void Expr_EvaluateSpan(const Expr* e, const double* xs, double* out, size_t n, const EvalContext* ctx);
+// out[i] = f(xs[i]) and derivatives[i] = f'(xs[i]) together, for about twice the cost of
+// Expr_EvaluateSpan. exact derivatives by dual numbers, not differences of samples
+void Expr_EvaluateSpanDual(const Expr* e, const double* xs, double* out, double* derivatives, size_t n, const EvalContext* ctx);
+double Expr_EvaluateDual(const Expr* e, EvalContext* ctx, double* derivative);
+// AST_EvaluateInterval over a box relative to the origin, when there is one
+Interval Expr_EvaluateInterval(const Expr* e, const IntervalContext* ctx, Interval* scratch);
+// values per x that stay put while t changes, 0 when the expression doesn't read t,
+// keeping them wouldn't save anything expensive or it is shifted. see Program_EvaluateColumns
+int Expr_ColumnCount(const Expr* e);
+void Expr_EvaluateColumns(const Expr* e, const double* xs, double* columns, size_t n, const EvalContext* ctx);
+// Expr_EvaluateSpan for the xs the columns were computed for, redoing only what reads t
+void Expr_EvaluateSpanColumns(const Expr* e, const double* xs, const double* columns, double* out, size_t n, const EvalContext* ctx);
+void Expr_Free(Expr* e);
+
+#endif
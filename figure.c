@@ -0,0 +1,377 @@
+#include "figure.h"
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void Figure_Init(Figure* fig) {
+    memset(fig, 0, sizeof(*fig));
+    Expr_Init(&fig->expr);
+    Expr_Init(&fig->exprY);
+    SampleCache_Init(&fig->samples);
+    ImplicitPlot_Init(&fig->implicitPlot);
+    ParamCurve_Init(&fig->paramCurve);
+    RegionLayer_Init(&fig->shading);
+    CurvePath_Init(&fig->path);
+    StrokeMesh_Init(&fig->stroke);
+    fig->lineWidth = FIGURE_THICKNESS;
+}
+
+// the bracket closing the one at open, 0 when it isn't closed
+static size_t Closing(const char* s, size_t open) {
+    int depth = 0;
+    for (size_t i = open; s[i]; i++) {
+        if (s[i] == '(' || s[i] == '{') depth++;
+        else if ((s[i] == ')' || s[i] == '}') && --depth == 0) return i;
+    }
+    return 0;
+}
+
+// the first comma in from..to outside any brackets, 0 when there is none
+static size_t Comma(const char* s, size_t from, size_t to) {
+    int depth = 0;
+    for (size_t i = from; i < to; i++) {
+        if (s[i] == '(' || s[i] == '{') depth++;
+        else if (s[i] == ')' || s[i] == '}') depth--;
+        else if (s[i] == ',' && depth == 0) return i;
+    }
+    return 0;
+}
+
+static size_t TrimEnd(const char* s, size_t end) {
+    while (end > 0 && s[end - 1] == ' ') end--;
+    return end;
+}
+
+// a number written as an expression, like 2pi
+static bool Constant(const char* text, double* value) {
+    Expr e;
+    Expr_Init(&e);
+    Expr_Set(&e, text);
+    bool ok = !Expr_IsEmpty(&e);
+    if (ok) {
+        EvalContext ctx = { 0 };
+        *value = Expr_Evaluate(&e, &ctx);
+        ok = isfinite(*value);
+    }
+    Expr_Free(&e);
+    return ok;
+}
+
+// theta and θ as whole words become t, the parameter. never longer than the text
+static void RenameTheta(char* out, const char* text) {
+    for (size_t i = 0; text[i];) {
+        bool start = i == 0 || !isalnum((unsigned char)text[i - 1]);
+        if (start && strncmp(text + i, "theta", 5) == 0 && !isalnum((unsigned char)text[i + 5])) {
+            *out++ = 't';
+            i += 5;
+        } else if (strncmp(text + i, "\xce\xb8", 2) == 0) {
+            *out++ = 't';
+            i += 2;
+        } else {
+            *out++ = text[i++];
+        }
+    }
+    *out = '\0';
+}
+
+// "(x(t), y(t))" or "r = f(t)" with an optional "{from, to}" after it. false for anything
+// else, which is left to the other forms
+static bool SetParametric(Figure* fig, const char* text) {
+    size_t length = strlen(text);
+    char* body = (char*)malloc(length + 1);
+    if (!body) return false;
+    memcpy(body, text, length + 1);
+    double from = 0.0, to = 2 * 3.14159265358979323846;
+    size_t end = TrimEnd(body, length);
+
+    // the range, found from its closing brace back to the brace that opens it
+    if (end > 0 && body[end - 1] == '}') {
+        size_t open = end - 1;
+        int depth = 0;
+        while (true) {
+            if (body[open] == '}') depth++;
+            else if (body[open] == '{' && --depth == 0) break;
+            if (open == 0) break;
+            open--;
+        }
+        size_t comma = Comma(body, open + 1, end - 1);
+        if (body[open] == '{' && comma) {
+            body[comma] = '\0';
+            body[end - 1] = '\0';
+            if (!Constant(body + open + 1, &from) || !Constant(body + comma + 1, &to)) {
+                free(body);
+                return false;
+            }
+            body[open] = '\0';
+            end = TrimEnd(body, open);
+        }
+    }
+    body[end] = '\0';
+    size_t start = 0;
+    while (body[start] == ' ') start++;
+
+    bool ok = false;
+    size_t close = (body[start] == '(') ? Closing(body, start) : 0;
+    size_t comma = close ? Comma(body, start + 1, close) : 0;
+    if (close && close + 1 == end && comma) {
+        body[comma] = '\0';
+        body[close] = '\0';
+        fig->param = PARAM_CARTESIAN;
+        Expr_Set(&fig->expr, body + start + 1);
+        Expr_Set(&fig->exprY, body + comma + 1);
+        ok = true;
+    } else if (body[start] == 'r') {
+        size_t i = start + 1;
+        while (body[i] == ' ') i++;
+        if (body[i] == '=' && body[i + 1] != '=') {
+            RenameTheta(body, body + i + 1);
+            fig->param = PARAM_POLAR;
+            Expr_Set(&fig->expr, body);
+            ok = true;
+        }
+    }
+    if (ok) {
+        fig->paramFrom = from;
+        fig->paramTo = to;
+    }
+    free(body);
+    return ok;
+}
+
+void Figure_SetText(Figure* fig, const char* text) {
+    if (fig->text && strcmp(text, fig->text) == 0 && fig->expr.ast != NULL) return;
+
+    size_t length = strlen(text);
+    char* copy = (char*)realloc(fig->text, length + 1);
+    if (!copy) return;
+    memcpy(copy, text, length + 1);
+    fig->text = copy;
+    fig->rel = REL_EQ;
+    fig->implicit = false;
+    fig->param = PARAM_NONE;
+    if (SetParametric(fig, text)) return;
+
+    // split at the relation, "lhs op rhs"
+    size_t opAt = strcspn(text, "<>=");
+    size_t opLen = (text[opAt] != '\0') ? 1 : 0;
+    if (text[opAt] == '<') fig->rel = REL_LT;
+    else if (text[opAt] == '>') fig->rel = REL_GT;
+    if (fig->rel != REL_EQ && text[opAt + 1] == '=') {
+        fig->rel = (fig->rel == REL_LT) ? REL_LE : REL_GE;
+        opLen = 2;
+    }
+
+    // room for the lhs alone and for "(lhs)-(rhs)"
+    char* lhs = (char*)malloc(length + 8);
+    char* implicitText = (char*)malloc(length + 8);
+    if (!lhs || !implicitText) {
+        free(lhs);
+        free(implicitText);
+        return;
+    }
+    const char* exprStart = text;
+    lhs[0] = '\0';
+    if (opLen) {
+        size_t start = 0, end = opAt;
+        while (start < end && text[start] == ' ') start++;
+        while (end > start && text[end - 1] == ' ') end--;
+        memcpy(lhs, text + start, end - start);
+        lhs[end - start] = '\0';
+        exprStart = text + opAt + opLen;
+    }
+    while (*exprStart == ' ') exprStart++;
+
+    // nothing or a lone y on the left is the explicit form
+    bool explicitY = lhs[0] == '\0' || strcmp(lhs, "y") == 0;
+    bool solved = false;
+    if (explicitY || *exprStart == '\0') {
+        // bumps the expression version, which is what invalidates the caches
+        Expr_Set(&fig->expr, exprStart);
+        // y on the right as well means it has to be solved as a whole. with no relation
+        // at all an expression in y is plotted where it is 0
+        fig->implicit = Expr_DependsOn(&fig->expr, VAR_Y);
+        solved = !fig->implicit || !opLen || *exprStart == '\0';
+        strcpy(lhs, "y");
+    }
+    if (!solved) {
+        fig->implicit = true;
+        snprintf(implicitText, length + 8, "(%s)-(%s)", lhs, exprStart);
+        Expr_Set(&fig->expr, implicitText);
+    }
+    free(lhs);
+    free(implicitText);
+}
+
+void Figure_SetOrigin(Figure* fig, DDouble x, DDouble y) {
+    fig->originX = x;
+    fig->originY = y;
+}
+
+// hands the origin on to whatever evaluates the figure in its current form. a curve
+// y = f(x) comes back relative to the origin's y, f(x, y) rel 0 is compared to 0 as it is
+static void ApplyOrigin(Figure* fig) {
+    DDouble zero = { 0.0, 0.0 };
+    if (fig->param != PARAM_NONE) {
+        Expr_SetOrigin(&fig->expr, zero, zero, zero);
+        Expr_SetOrigin(&fig->exprY, zero, zero, zero);
+        ParamCurve_SetOrigin(&fig->paramCurve, fig->originX, fig->originY);
+    } else {
+        Expr_SetOrigin(&fig->expr, fig->originX, fig->originY, fig->implicit ? zero : fig->originY);
+    }
+}
+
+// a box relative to the origin in world coordinates, rounded outwards
+static Interval Absolute(Interval a, DDouble origin) {
+    double lo = DDouble_Add(origin, (DDouble){ a.lo, 0.0 }).hi;
+    double hi = DDouble_Add(origin, (DDouble){ a.hi, 0.0 }).hi;
+    return (Interval){ nextafter(lo, -INFINITY), nextafter(hi, INFINITY) };
+}
+
+bool Figure_IsEmpty(const Figure* fig) {
+    return Expr_IsEmpty(&fig->expr) || (fig->param == PARAM_CARTESIAN && Expr_IsEmpty(&fig->exprY));
+}
+
+const char* Figure_Error(const Figure* fig) {
+    const char* error = Expr_Error(&fig->expr);
+    if (!error && fig->param == PARAM_CARTESIAN) error = Expr_Error(&fig->exprY);
+    return error;
+}
+
+bool Figure_IsFunction(const Figure* fig) {
+    return !fig->implicit && fig->param == PARAM_NONE;
+}
+
+int Figure_Side(const Figure* fig) {
+    if (fig->rel == REL_LT || fig->rel == REL_LE) return -1;
+    if (fig->rel == REL_GT || fig->rel == REL_GE) return 1;
+    return 0;
+}
+
+// interval bounds of an expression over a box, all of the line when there's no room to work them out
+static Interval Bound(Figure* fig, const Expr* e, const IntervalContext* box) {
+    const AST* ast = e->ast;
+    if ((int)ast->nodeCount > fig->boundsCapacity) {
+        Interval* grown = (Interval*)realloc(fig->bounds, ast->nodeCount * sizeof(Interval));
+        if (!grown) return (Interval){ -INFINITY, INFINITY };
+        fig->bounds = grown;
+        fig->boundsCapacity = (int)ast->nodeCount;
+    }
+    return Expr_EvaluateInterval(e, box, fig->bounds);
+}
+
+bool Figure_MayShow(Figure* fig, const EvalContext* ctx, double scale, double centerX, double centerY, int width, int height) {
+    if (Figure_IsEmpty(fig)) return false;
+    ApplyOrigin(fig);
+
+    // the view grown by the line width, a curve just outside still reaches in
+    double margin = fig->lineWidth / scale;
+    double halfWidth = width / (2.0 * scale) + margin;
+    double halfHeight = height / (2.0 * scale) + margin;
+    IntervalContext box;
+    box.x = (Interval){ centerX - halfWidth, centerX + halfWidth };
+    box.y = (Interval){ centerY - halfHeight, centerY + halfHeight };
+    box.t = (Interval){ ctx->t, ctx->t };
+    if (fig->param != PARAM_NONE) {
+        // the box the curve stays in over all of its range against the view
+        IntervalContext range;
+        range.x = (Interval){ ctx->x, ctx->x };
+        range.y = (Interval){ ctx->y, ctx->y };
+        range.t = (Interval){ fmin(fig->paramFrom, fig->paramTo), fmax(fig->paramFrom, fig->paramTo) };
+        Interval a = Bound(fig, &fig->expr, &range);
+        if (Interval_IsEmpty(a)) return false;
+        if (fig->param == PARAM_POLAR) {
+            // within |r| of the origin
+            double r = fmax(fabs(a.lo), fabs(a.hi));
+            double x = DDouble_Add(fig->originX, (DDouble){ centerX, 0.0 }).hi;
+            double y = DDouble_Add(fig->originY, (DDouble){ centerY, 0.0 }).hi;
+            double dx = fmax(fabs(x) - halfWidth, 0.0), dy = fmax(fabs(y) - halfHeight, 0.0);
+            return !(hypot(dx, dy) > r);
+        }
+        Interval b = Bound(fig, &fig->exprY, &range);
+        if (Interval_IsEmpty(b)) return false;
+        Interval x = Absolute(box.x, fig->originX), y = Absolute(box.y, fig->originY);
+        return a.hi >= x.lo && a.lo <= x.hi && b.hi >= y.lo && b.lo <= y.hi;
+    }
+    Interval v = Bound(fig, &fig->expr, &box);
+    if (Interval_IsEmpty(v)) return false; // undefined everywhere in view
+
+    int side = Figure_Side(fig);
+    if (fig->implicit) {
+        // f(x, y) rel 0 over the box
+        if (side == 0) return v.lo <= 0 && v.hi >= 0;
+        return side < 0 ? v.lo <= 0 : v.hi >= 0;
+    }
+    // the curve's values against the view's ys, shading below or above reaches further
+    if (side == 0) return v.hi >= box.y.lo && v.lo <= box.y.hi;
+    return side < 0 ? v.hi >= box.y.lo : v.lo <= box.y.hi;
+}
+
+int Figure_Begin(Figure* fig, const EvalContext* ctx, double scale, double centerX, double centerY, int width, int height) {
+    fig->scale = scale;
+    fig->centerX = centerX;
+    fig->centerY = centerY;
+    fig->width = width;
+    fig->height = height;
+    if (Figure_IsEmpty(fig)) return 0;
+    ApplyOrigin(fig);
+    if (fig->param != PARAM_NONE) {
+        return ParamCurve_Begin(&fig->paramCurve, fig->param, &fig->expr, &fig->exprY, fig->paramFrom, fig->paramTo,
+                                scale, centerX, centerY, width, height);
+    }
+    if (fig->implicit) {
+        return ImplicitPlot_Begin(&fig->implicitPlot, &fig->expr, ctx, Figure_Side(fig), scale, centerX, centerY, width, height);
+    }
+    // only samples what the view change exposed, centerY isn't part of the key
+    return SampleCache_Begin(&fig->samples, &fig->expr, ctx, scale, centerX, width);
+}
+
+void Figure_RunTask(void* user, int index, int worker) {
+    Figure* fig = (Figure*)user;
+    (void)worker;
+    if (fig->param != PARAM_NONE) ParamCurve_RunChunk(&fig->paramCurve, index);
+    else if (fig->implicit) ImplicitPlot_RunStrip(&fig->implicitPlot, index);
+    else SampleCache_RunChunk(&fig->samples, index);
+}
+
+void Figure_End(Figure* fig) {
+    if (Figure_IsEmpty(fig)) return;
+    int side = Figure_Side(fig);
+    if (fig->param != PARAM_NONE) {
+        ParamCurve_End(&fig->paramCurve);
+        const ParamCurve* c = &fig->paramCurve;
+        CurvePath_FromSamples(&fig->path, c, c->generation, c->valid ? &c->curve : NULL, FIGURE_TOLERANCE_PX,
+                              fig->lineWidth + 1.0, fig->scale, fig->centerX, fig->centerY, fig->width, fig->height);
+        StrokeMesh_FromPath(&fig->stroke, &fig->path, fig->lineWidth);
+    } else if (fig->implicit) {
+        ImplicitPlot_End(&fig->implicitPlot);
+        if (side != 0) RegionLayer_FromPlot(&fig->shading, &fig->implicitPlot);
+        StrokeMesh_FromPlot(&fig->stroke, &fig->implicitPlot, fig->lineWidth);
+    } else {
+        SampleCache_End(&fig->samples);
+        if (side != 0) {
+            RegionLayer_FromCurve(&fig->shading, &fig->samples, side, fig->scale, fig->centerX, fig->centerY, fig->width, fig->height);
+        }
+        // clipped to the view grown by the line width, so the line ends stay off screen
+        CurvePath_FromCurve(&fig->path, &fig->samples, FIGURE_TOLERANCE_PX, fig->lineWidth + 1.0,
+                            fig->scale, fig->centerX, fig->centerY, fig->width, fig->height);
+        StrokeMesh_FromPath(&fig->stroke, &fig->path, fig->lineWidth);
+    }
+    // an equality has nothing to shade, drop what an earlier inequality left
+    if (side == 0) RegionLayer_Free(&fig->shading);
+}
+
+void Figure_Free(Figure* fig) {
+    free(fig->text);
+    free(fig->bounds);
+    Expr_Free(&fig->expr);
+    Expr_Free(&fig->exprY);
+    SampleCache_Free(&fig->samples);
+    ImplicitPlot_Free(&fig->implicitPlot);
+    ParamCurve_Free(&fig->paramCurve);
+    RegionLayer_Free(&fig->shading);
+    CurvePath_Free(&fig->path);
+    StrokeMesh_Free(&fig->stroke);
+    Figure_Init(fig);
+}
@@ -0,0 +1,79 @@
+#ifndef FIGURE_H
+#define FIGURE_H
+
+#include "expr.h"
+#include "samples.h"
+#include "implicit.h"
+#include "region.h"
+#include "path.h"
+#include "stroke.h"
+#include "interval.h"
+#include "param.h"
+#include <stdbool.h>
+
+#define FIGURE_THICKNESS 2.0f
+// how far simplification may move a curve, well under the line width
+#define FIGURE_TOLERANCE_PX 0.25
+
+typedef enum {
+    REL_EQ,
+    REL_LT,
+    REL_GT,
+    REL_LE,
+    REL_GE
+} Relation;
+
+// everything one equation needs to get from its text to triangles on the screen, kept
+// between frames so every stage only redoes what the last change touched. no raylib in
+// here, the app and the headless renderer both draw from shading and stroke
+typedef struct {
+    char* text;         // what was parsed last
+    Relation rel;
+    bool implicit;      // f(x, y) rel 0 instead of y rel f(x)
+    ParamForm param;    // a curve traced by t instead, expr is x(t) or r(t)
+    Expr expr;
+    Expr exprY;         // y(t) of PARAM_CARTESIAN
+    double paramFrom, paramTo;
+    SampleCache samples;
+    ImplicitPlot implicitPlot;
+    ParamCurve paramCurve;
+    RegionLayer shading; // for inequalities, empty otherwise
+    CurvePath path;      // the curve clipped and simplified, in screen space
+    StrokeMesh stroke;
+    float lineWidth;     // FIGURE_THICKNESS unless set
+    Interval* bounds;    // scratch of Figure_MayShow, a node each
+    int boundsCapacity;
+    DDouble originX, originY; // what the view is relative to, see Figure_SetOrigin
+    // the view of the update between Begin and End
+    double scale, centerX, centerY;
+    int width, height;
+} Figure;
+
+void Figure_Init(Figure* fig);
+// parses "y = f(x)", "f(x)", "lhs rel rhs" and so on, only when the text changed. "(x(t), y(t))"
+// and "r = f(t)" (or of theta) are traced by t over [0, 2 pi] unless a range "{from, to}" follows
+void Figure_SetText(Figure* fig, const char* text);
+// the views passed in from now on are relative to (x, y), 0 unless the view is zoomed in
+// too far for doubles, see GraphState. the expressions switch to double-double around it
+void Figure_SetOrigin(Figure* fig, DDouble x, DDouble y);
+bool Figure_IsEmpty(const Figure* fig);
+// the first of its expressions' errors, NULL when there's none
+const char* Figure_Error(const Figure* fig);
+// y = f(x) or y rel f(x), one y per x
+bool Figure_IsFunction(const Figure* fig);
+// -1 when the relation shades below or inside, 1 above or outside, 0 for an equality
+int Figure_Side(const Figure* fig);
+// false when nothing of the figure can be in the view, from interval bounds of the
+// expression over all of it. costs a pass over the nodes, so a view with thousands of
+// equations only samples the ones that can show
+bool Figure_MayShow(Figure* fig, const EvalContext* ctx, double scale, double centerX, double centerY, int width, int height);
+// plans the update for a view and returns how many tasks it takes, 0 when nothing changed.
+// run them with Figure_RunTask, on any thread, then call End
+int Figure_Begin(Figure* fig, const EvalContext* ctx, double scale, double centerX, double centerY, int width, int height);
+// a PoolTaskFn, user is the figure
+void Figure_RunTask(void* user, int index, int worker);
+// finishes the update and brings shading and stroke up to date with the view
+void Figure_End(Figure* fig);
+void Figure_Free(Figure* fig);
+
+#endif
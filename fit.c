@@ -0,0 +1,257 @@
+#include "fit.h"
+#include "vecmath.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FIT_BLOCK 256 // points scaled and raised to powers at a time, stays in L1
+#define FIT_LANES 4   // independent sums, so the adds don't wait on each other and vectorize
+
+// the normal equations of one task: sums of u^k for k up to 2 * degree, of u^k * w for k up
+// to degree, and of w and w^2 for r2. w is y, or ln y for the exponential
+typedef struct {
+    double powers[2 * FIT_MAX_DEGREE + 1];
+    double moments[FIT_MAX_DEGREE + 1];
+    double ww;
+    int64_t used;
+} FitSums;
+
+typedef struct {
+    const PointCloud* pc;
+    FitKind kind;
+    int degree;
+    double center, invHalfWidth;
+    FitSums* sums; // one per task
+} FitJob;
+
+static void AddBlock(FitSums* sums, const double* u, const double* w, int m, int degree) {
+    double p[FIT_BLOCK];
+    for (int j = 0; j < m; j++) p[j] = 1.0;
+    for (int k = 0; k <= 2 * degree; k++) {
+        double s[FIT_LANES] = { 0 }, t[FIT_LANES] = { 0 };
+        int j = 0;
+        if (k <= degree) {
+            for (; j + FIT_LANES <= m; j += FIT_LANES) {
+                for (int l = 0; l < FIT_LANES; l++) {
+                    s[l] += p[j + l];
+                    t[l] += p[j + l] * w[j + l];
+                    p[j + l] *= u[j + l];
+                }
+            }
+            for (; j < m; j++) {
+                s[0] += p[j];
+                t[0] += p[j] * w[j];
+                p[j] *= u[j];
+            }
+            sums->moments[k] += (t[0] + t[1]) + (t[2] + t[3]);
+        } else {
+            for (; j + FIT_LANES <= m; j += FIT_LANES) {
+                for (int l = 0; l < FIT_LANES; l++) {
+                    s[l] += p[j + l];
+                    p[j + l] *= u[j + l];
+                }
+            }
+            for (; j < m; j++) {
+                s[0] += p[j];
+                p[j] *= u[j];
+            }
+        }
+        sums->powers[k] += (s[0] + s[1]) + (s[2] + s[3]);
+    }
+    double ww[FIT_LANES] = { 0 };
+    int j = 0;
+    for (; j + FIT_LANES <= m; j += FIT_LANES) {
+        for (int l = 0; l < FIT_LANES; l++) ww[l] += w[j + l] * w[j + l];
+    }
+    for (; j < m; j++) ww[0] += w[j] * w[j];
+    sums->ww += (ww[0] + ww[1]) + (ww[2] + ww[3]);
+    sums->used += m;
+}
+
+static void FitTask(void* user, int index, int worker) {
+    const FitJob* job = (const FitJob*)user;
+    (void)worker;
+    const PointCloud* pc = job->pc;
+    FitSums* sums = &job->sums[index];
+    memset(sums, 0, sizeof(*sums));
+    int from = index * FIT_CHUNK;
+    int to = (pc->count - from < FIT_CHUNK) ? pc->count : from + FIT_CHUNK;
+    const VecKernels* vk = VecMath_Get();
+
+    double u[FIT_BLOCK], w[FIT_BLOCK];
+    for (int start = from; start < to; start += FIT_BLOCK) {
+        int n = (to - start < FIT_BLOCK) ? to - start : FIT_BLOCK;
+        int m = 0;
+        if (job->kind == FIT_EXPONENTIAL) {
+            // only y > 0 has a log, the rest close up behind the ones kept
+            for (int i = 0; i < n; i++) {
+                double y = pc->ys[start + i];
+                if (!(y > 0)) continue;
+                u[m] = (pc->xs[start + i] - job->center) * job->invHalfWidth;
+                w[m] = y;
+                m++;
+            }
+            vk->log(w, w, m);
+        } else {
+            for (int i = 0; i < n; i++) {
+                u[i] = (pc->xs[start + i] - job->center) * job->invHalfWidth;
+                w[i] = pc->ys[start + i];
+            }
+            m = n;
+        }
+        AddBlock(sums, u, w, m, job->degree);
+    }
+}
+
+// a round number near the middle of [lo, hi], to a tenth of its width
+static double RoundCenter(double lo, double hi) {
+    // data on both sides of 0 keeps plain x
+    if (lo <= 0 && hi >= 0) return 0.0;
+    double middle = (lo + hi) / 2;
+    double width = hi - lo;
+    if (!(width > 0)) return middle;
+    double step = pow(10.0, floor(log10(width)) - 1);
+    return round(middle / step) * step;
+}
+
+// a x = b for symmetric positive definite a, n by n, by Cholesky. false when a pivot is lost
+// to rounding, the columns of a are too close to dependent to tell the coefficients apart
+static bool SolveCholesky(double* a, double* b, int n) {
+    for (int j = 0; j < n; j++) {
+        double diagonal = a[j * n + j];
+        double d = diagonal;
+        for (int k = 0; k < j; k++) d -= a[j * n + k] * a[j * n + k];
+        if (!(d > diagonal * 1e-13)) return false;
+        d = sqrt(d);
+        a[j * n + j] = d;
+        for (int i = j + 1; i < n; i++) {
+            double s = a[i * n + j];
+            for (int k = 0; k < j; k++) s -= a[i * n + k] * a[j * n + k];
+            a[i * n + j] = s / d;
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        double s = b[i];
+        for (int k = 0; k < i; k++) s -= a[i * n + k] * b[k];
+        b[i] = s / a[i * n + i];
+    }
+    for (int i = n - 1; i >= 0; i--) {
+        double s = b[i];
+        for (int k = i + 1; k < n; k++) s -= a[k * n + i] * b[k];
+        b[i] = s / a[i * n + i];
+    }
+    return true;
+}
+
+bool Fit_Points(Fit* fit, FitKind kind, int degree, const PointCloud* pc, ThreadPool* pool) {
+    memset(fit, 0, sizeof(*fit));
+    if (kind == FIT_EXPONENTIAL) degree = 1;
+    if (degree < 0 || degree > FIT_MAX_DEGREE || !pc->indexed || pc->count == 0) return false;
+    fit->kind = kind;
+    fit->degree = degree;
+    fit->center = RoundCenter(pc->minX, pc->maxX);
+    double halfWidth = fmax(pc->maxX - fit->center, fit->center - pc->minX);
+    if (!(halfWidth > 0)) halfWidth = 1.0;
+
+    int tasks = (pc->count + FIT_CHUNK - 1) / FIT_CHUNK;
+    FitSums* sums = (FitSums*)malloc((size_t)tasks * sizeof(FitSums));
+    PoolTask* list = (PoolTask*)calloc((size_t)tasks, sizeof(PoolTask));
+    if (!sums || !list) {
+        free(sums);
+        free(list);
+        return false;
+    }
+    FitJob job = { pc, kind, degree, fit->center, 1.0 / halfWidth, sums };
+    for (int i = 0; i < tasks; i++) list[i] = (PoolTask){ FitTask, &job, i };
+    Pool_Run(pool, list, tasks);
+
+    FitSums total = { 0 };
+    for (int i = 0; i < tasks; i++) {
+        for (int k = 0; k <= 2 * degree; k++) total.powers[k] += sums[i].powers[k];
+        for (int k = 0; k <= degree; k++) total.moments[k] += sums[i].moments[k];
+        total.ww += sums[i].ww;
+        total.used += sums[i].used;
+    }
+    free(sums);
+    free(list);
+    fit->used = total.used;
+    if (total.used <= degree) return false;
+
+    int n = degree + 1;
+    double a[(FIT_MAX_DEGREE + 1) * (FIT_MAX_DEGREE + 1)];
+    double beta[FIT_MAX_DEGREE + 1];
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) a[i * n + j] = total.powers[i + j];
+        beta[i] = total.moments[i];
+    }
+    if (!SolveCholesky(a, beta, n)) return false;
+
+    // residuals from the sums: w.w - 2 beta.moments + beta' powers beta
+    double explained = 0.0;
+    for (int i = 0; i < n; i++) {
+        explained += 2 * beta[i] * total.moments[i];
+        for (int j = 0; j < n; j++) explained -= beta[i] * beta[j] * total.powers[i + j];
+    }
+    double residual = fmax(total.ww - explained, 0.0);
+    double spread = total.ww - total.moments[0] * total.moments[0] / (double)total.used;
+    fit->r2 = (spread > 0) ? 1.0 - residual / spread : 1.0;
+
+    // back from u = (x - center) / halfWidth to x - center
+    double scale = 1.0;
+    for (int k = 0; k < n; k++) {
+        fit->coefficients[k] = beta[k] * scale;
+        scale /= halfWidth;
+    }
+    return true;
+}
+
+// a number formatted into text at length, the new length or -1 once it doesn't fit
+static int Append(char* text, int size, int length, const char* format, double value) {
+    if (length < 0 || length >= size) return -1;
+    int n = snprintf(text + length, (size_t)(size - length), format, value);
+    return (n < 0 || length + n >= size) ? -1 : length + n;
+}
+
+static int AppendText(char* text, int size, int length, const char* s) {
+    int n = (int)strlen(s);
+    if (length < 0 || length + n >= size) return -1;
+    memcpy(text + length, s, (size_t)n + 1);
+    return length + n;
+}
+
+static int Format(const Fit* fit, char* text, int size, int digits) {
+    char x[64];
+    if (fit->center == 0) snprintf(x, sizeof(x), "x");
+    else snprintf(x, sizeof(x), "(x%+.*g)", 15, -fit->center);
+    char number[16], term[96];
+    snprintf(number, sizeof(number), "%%.%dg", digits);
+
+    int length = AppendText(text, size, 0, "y = ");
+    if (fit->kind == FIT_EXPONENTIAL) {
+        length = Append(text, size, length, number, exp(fit->coefficients[0]));
+        snprintf(term, sizeof(term), "*exp(%s*%s)", number, x);
+        return Append(text, size, length, term, fit->coefficients[1]);
+    }
+    for (int k = 0; k <= fit->degree; k++) {
+        double c = fit->coefficients[k];
+        if (k > 0) {
+            length = AppendText(text, size, length, (c < 0) ? " - " : " + ");
+            c = fabs(c);
+        }
+        if (k == 0) snprintf(term, sizeof(term), "%s", number);
+        else if (k == 1) snprintf(term, sizeof(term), "%s*%s", number, x);
+        else snprintf(term, sizeof(term), "%s*%s^%d", number, x, k);
+        length = Append(text, size, length, term, c);
+    }
+    return length;
+}
+
+int Fit_Format(const Fit* fit, char* text, int size) {
+    for (int digits = 10; digits >= 3; digits--) {
+        int length = Format(fit, text, size, digits);
+        if (length > 0) return length;
+    }
+    if (size > 0) text[0] = '\0';
+    return 0;
+}
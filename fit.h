@@ -0,0 +1,36 @@
+#ifndef FIT_H
+#define FIT_H
+
+#include "points.h"
+#include "pool.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define FIT_MAX_DEGREE 8
+#define FIT_CHUNK 65536 // points per task
+
+typedef enum {
+    FIT_POLYNOMIAL,
+    FIT_EXPONENTIAL // a line through (x, ln y), y <= 0 left out
+} FitKind;
+
+// a least squares fit. the polynomial is in x - center, a round number in the middle of the
+// data, so years or timestamps don't lose their digits to x^n
+typedef struct {
+    FitKind kind;
+    int degree;      // 1 for the exponential
+    double center;
+    double coefficients[FIT_MAX_DEGREE + 1]; // lowest power first, ln a and b of a*exp(b*(x - center))
+    double r2;       // of y, or of ln y for the exponential
+    int64_t used;    // points that went in
+} Fit;
+
+// one pass over the points of an indexed cloud on the pool, which may be NULL. every task
+// sums the powers of x, scaled to about [-1, 1] by the cloud's bounds, into its own normal
+// equations and the sums are added up in order, so any number of threads gives the same
+// fit. solved by Cholesky, false when the points can't pin down that many coefficients
+bool Fit_Points(Fit* fit, FitKind kind, int degree, const PointCloud* pc, ThreadPool* pool);
+// "y = ..." for an equation, with as many digits as fit in size. the length, 0 when nothing fits
+int Fit_Format(const Fit* fit, char* text, int size);
+
+#endif
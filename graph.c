@@ -2,82 +2,77 @@
 #include <math.h>
 #include <stdio.h>
 
+#define GRAPH_MAX_LINES 1000 // per direction, in case a step doesn't move a line along
+
 void Graph_Init(GraphState* state) {
     state->centerX = 0.0;
     state->centerY = 0.0;
     state->scale = 40.0; // 40 pixels per unit default
+    state->originX = state->originY = (DDouble){ 0.0, 0.0 };
 }
 
-Vector2 Graph_ToScreen(GraphState* state, Vector2 pos, int width, int height) {
-    double px = (pos.x - state->centerX) * state->scale + width / 2.0;
-    double py = height / 2.0 - (pos.y - state->centerY) * state->scale;
+Vector2 Graph_ToScreen(const GraphState* state, double x, double y, int width, int height) {
+    double px = (x - state->centerX) * state->scale + width / 2.0;
+    double py = height / 2.0 - (y - state->centerY) * state->scale;
     return (Vector2){ (float)px, (float)py };
 }
 
-Vector2 Graph_ToCartesian(GraphState* state, Vector2 pos, int width, int height) {
-    double cx = (pos.x - width / 2.0) / state->scale + state->centerX;
-    double cy = (height / 2.0 - pos.y) / state->scale + state->centerY;
-    return (Vector2){ (float)cx, (float)cy };
+void Graph_ToView(const GraphState* state, Vector2 pos, int width, int height, double* x, double* y) {
+    *x = (pos.x - width / 2.0) / state->scale + state->centerX;
+    *y = (height / 2.0 - pos.y) / state->scale + state->centerY;
+}
+
+// a screen coordinate that still fits an int, far off screen is as good as just off it
+static int Pixel(float v) {
+    return (int)fminf(fmaxf(v, -1e6f), 1e6f);
 }
 
 void Graph_DrawGrid(GraphState* state, int width, int height) {
     // Calculate visible range
-    Vector2 topLeft = Graph_ToCartesian(state, (Vector2){0, 0}, width, height);
-    Vector2 bottomRight = Graph_ToCartesian(state, (Vector2){(float)width, (float)height}, width, height);
+    double minX, maxX, minY, maxY;
+    Graph_ToView(state, (Vector2){ 0, 0 }, width, height, &minX, &maxY);
+    Graph_ToView(state, (Vector2){ (float)width, (float)height }, width, height, &maxX, &minY);
+
+    // we want a line roughly every 100 pixels, at 1, 2 or 5 times a power of 10
+    double step = GraphState_GridStep(state, 100.0);
+    DDouble stepDD = { step, 0.0 };
 
-    double minX = topLeft.x;
-    double maxX = bottomRight.x;
-    double minY = bottomRight.y;
-    double maxY = topLeft.y;
+    // the axes are where the world's 0 is, which a deep view has far off screen
+    Vector2 screenOrigin = Graph_ToScreen(state, GraphState_ViewX(state, 0.0), GraphState_ViewY(state, 0.0), width, height);
+    int originX = Pixel(screenOrigin.x), originY = Pixel(screenOrigin.y);
 
-    // determine grid step
-    // wwe want a line roughly every 100 pixels
-    // 100 pixels = 100 / scale units
-    double targetStep = 100.0 / state->scale;
-    double step = pow(10.0, floor(log10(targetStep)));
-    
-    // refine step to be 1, 2, or 5 times the power of 10
-    if (targetStep / step > 5.0) step *= 5.0;
-    else if (targetStep / step > 2.0) step *= 2.0;
-    
-    Vector2 screenOrigin = Graph_ToScreen(state, (Vector2){0, 0}, width, height);
+    DrawLine(0, originY, width, originY, BLACK);
+    DrawLine(originX, 0, originX, height, BLACK);
+
+    // lines counted in double-double, a deep view has more of them to 0 than a double counts
+    DDouble x = GraphState_FirstLine(state->originX, minX, step);
+    for (int i = 0; i < GRAPH_MAX_LINES; i++, x = DDouble_Add(x, stepDD)) {
+        double viewX = DDouble_Sub(x, state->originX).hi;
+        if (viewX > maxX) break;
+        int screenX = Pixel(Graph_ToScreen(state, viewX, 0.0, width, height).x);
+        DrawLine(screenX, 0, screenX, height, Fade(LIGHTGRAY, 0.5f));
 
-    
-    DrawLine(0, (int)screenOrigin.y, width, (int)screenOrigin.y, BLACK);
-    DrawLine((int)screenOrigin.x, 0, (int)screenOrigin.x, height, BLACK);
-    
-    double startX = floor(minX / step) * step;
-    for (double x = startX; x <= maxX; x += step) {
-        float screenX = (float)((x - state->centerX) * state->scale + width / 2.0);
-        DrawLine((int)screenX, 0, (int)screenX, height, Fade(LIGHTGRAY, 0.5f));
-        
         // draw Number
-        if (fabs(x) > 1e-10) { 
-             char b[32];
-             if (fabs(x) >= 1000000 || (fabs(x) < 0.001 && fabs(x) > 1e-10)) {
-                 sprintf(b, "%.2e", x);
-             } else {
-                 sprintf(b, "%.6g", x);
-             }
-             DrawText(b, (int)screenX + 2, (int)screenOrigin.y + 2, 10, DARKGRAY);
+        if (fabs(x.hi) > step * 1e-6) {
+            char b[48];
+            GraphState_Label(x, step, b, sizeof(b));
+            DrawText(b, screenX + 2, originY + 2, 10, DARKGRAY);
         }
     }
 
     // draw Horizontal Lines
-    double startY = floor(minY / step) * step;
-    for (double y = startY; y <= maxY; y += step) {
-        float screenY = (float)(height / 2.0 - (y - state->centerY) * state->scale);
-        DrawLine(0, (int)screenY, width, (int)screenY, Fade(LIGHTGRAY, 0.5f));
-        
-         // draw Number
-        if (fabs(y) > 1e-10) {
-             char b[32];
-             if (fabs(y) >= 1000000 || (fabs(y) < 0.001 && fabs(y) > 1e-10)) {
-                 sprintf(b, "%.2e", y);
-             } else {
-                 sprintf(b, "%.6g", y);
-             }
-             DrawText(b, (int)screenOrigin.x + 2, (int)screenY + 2, 10, DARKGRAY);
+    DDouble y = GraphState_FirstLine(state->originY, minY, step);
+    for (int i = 0; i < GRAPH_MAX_LINES; i++, y = DDouble_Add(y, stepDD)) {
+        double viewY = DDouble_Sub(y, state->originY).hi;
+        if (viewY > maxY) break;
+        int screenY = Pixel(Graph_ToScreen(state, 0.0, viewY, width, height).y);
+        DrawLine(0, screenY, width, screenY, Fade(LIGHTGRAY, 0.5f));
+
+        // draw Number
+        if (fabs(y.hi) > step * 1e-6) {
+            char b[48];
+            GraphState_Label(y, step, b, sizeof(b));
+            DrawText(b, originX + 2, screenY + 2, 10, DARKGRAY);
         }
     }
 }
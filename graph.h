@@ -2,16 +2,13 @@
 #define GRAPH_H
 
 #include "raylib.h"
-
-typedef struct {
-    double centerX;
-    double centerY;
-    double scale; 
-} GraphState;
+#include "graphstate.h"
 
 void Graph_Init(GraphState* state);
-Vector2 Graph_ToScreen(GraphState* state, Vector2 pos, int width, int height);
-Vector2 Graph_ToCartesian(GraphState* state, Vector2 pos, int width, int height);
+// a point of the view, relative to its origin, to the screen and back. the view side is
+// doubles, a float can't hold a coordinate once the view is zoomed in a million times
+Vector2 Graph_ToScreen(const GraphState* state, double x, double y, int width, int height);
+void Graph_ToView(const GraphState* state, Vector2 pos, int width, int height, double* x, double* y);
 void Graph_DrawGrid(GraphState* state, int width, int height);
 
 #endif
@@ -0,0 +1,72 @@
+#include "graphstate.h"
+#include <math.h>
+#include <stdio.h>
+
+bool GraphState_IsDeep(const GraphState* g) {
+    return !DDouble_IsZero(g->originX) || !DDouble_IsZero(g->originY);
+}
+
+bool GraphState_Recenter(GraphState* g) {
+    DDouble x = GraphState_WorldX(g, g->centerX);
+    DDouble y = GraphState_WorldY(g, g->centerY);
+    double reach = fmax(fabs(x.hi), fabs(y.hi)) * g->scale;
+    bool deep = GraphState_IsDeep(g);
+    if (!deep && !(reach > GRAPH_DEEP_PX)) return false;
+    if (deep && reach < GRAPH_DEEP_PX / 16) {
+        // well clear of the limit, so a zoom hovering at it doesn't flip back and forth
+        g->centerX = x.hi;
+        g->centerY = y.hi;
+        g->originX = g->originY = (DDouble){ 0.0, 0.0 };
+        return true;
+    }
+    if (deep && fabs(g->centerX) * g->scale < GRAPH_RECENTER_PX && fabs(g->centerY) * g->scale < GRAPH_RECENTER_PX) {
+        return false;
+    }
+    g->originX = x;
+    g->originY = y;
+    g->centerX = 0.0;
+    g->centerY = 0.0;
+    return true;
+}
+
+DDouble GraphState_WorldX(const GraphState* g, double x) {
+    return DDouble_Add(g->originX, (DDouble){ x, 0.0 });
+}
+
+DDouble GraphState_WorldY(const GraphState* g, double y) {
+    return DDouble_Add(g->originY, (DDouble){ y, 0.0 });
+}
+
+double GraphState_ViewX(const GraphState* g, double worldX) {
+    return DDouble_Sub((DDouble){ worldX, 0.0 }, g->originX).hi;
+}
+
+double GraphState_ViewY(const GraphState* g, double worldY) {
+    return DDouble_Sub((DDouble){ worldY, 0.0 }, g->originY).hi;
+}
+
+double GraphState_GridStep(const GraphState* g, double targetPx) {
+    double target = targetPx / g->scale;
+    double step = pow(10.0, floor(log10(target)));
+    if (target / step > 5.0) step *= 5.0;
+    else if (target / step > 2.0) step *= 2.0;
+    return step;
+}
+
+DDouble GraphState_FirstLine(DDouble origin, double view, double step) {
+    DDouble at = DDouble_Add(origin, (DDouble){ view, 0.0 });
+    // the line count from 0 can be past what a double counts exactly
+    DDouble k = DDouble_Floor(DDouble_Div(at, (DDouble){ step, 0.0 }));
+    return DDouble_Mul(k, (DDouble){ step, 0.0 });
+}
+
+void GraphState_Label(DDouble value, double step, char* out, int size) {
+    double digits = ceil(log10(fabs(value.hi) / step)) + 1;
+    if (!(digits > 6)) {
+        double v = value.hi;
+        if (fabs(v) >= 1000000 || fabs(v) < 0.001) snprintf(out, (size_t)size, "%.2e", v);
+        else snprintf(out, (size_t)size, "%.6g", v);
+        return;
+    }
+    DDouble_Format(value, (int)digits, out, size);
+}
@@ -0,0 +1,42 @@
+#ifndef GRAPHSTATE_H
+#define GRAPHSTATE_H
+
+#include "ddouble.h"
+#include <stdbool.h>
+
+// past this many pixels between the world's 0 and the center, doubles would round a
+// position to a visible fraction of a pixel, so the view moves to double-double
+#define GRAPH_DEEP_PX 1e12
+// the deep view moves its origin along once the center is this far from it
+#define GRAPH_RECENTER_PX 1e9
+
+// the view, shared with code that doesn't link raylib. the center and everything drawn
+// are relative to the origin, which stays 0 and costs nothing until the view is zoomed in
+// past GRAPH_DEEP_PX. from there the origin holds the digits doubles can't, and only the
+// figures evaluate in double-double
+typedef struct {
+    double centerX;
+    double centerY;
+    double scale; 
+    DDouble originX;
+    DDouble originY;
+} GraphState;
+
+bool GraphState_IsDeep(const GraphState* g);
+// picks the precision for the view: puts the origin on the center once doubles can't
+// place a pixel there, moves it along with a deep view that wandered far from it and back
+// to 0 once doubles are enough again. true when it moved, everything relative to it is stale
+bool GraphState_Recenter(GraphState* g);
+// a coordinate of the view in the world and back
+DDouble GraphState_WorldX(const GraphState* g, double x);
+DDouble GraphState_WorldY(const GraphState* g, double y);
+double GraphState_ViewX(const GraphState* g, double worldX);
+double GraphState_ViewY(const GraphState* g, double worldY);
+// a line roughly every targetPx pixels, at 1, 2 or 5 times a power of 10
+double GraphState_GridStep(const GraphState* g, double targetPx);
+// the world value of the first grid line at or past a coordinate of the view
+DDouble GraphState_FirstLine(DDouble origin, double view, double step);
+// a grid line's number, with the digits it takes to tell it from the next one
+void GraphState_Label(DDouble value, double step, char* out, int size);
+
+#endif
@@ -0,0 +1,153 @@
+#include "headless.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define HEADLESS_BAND_ROWS 64
+#define HEADLESS_MAX_LINES 1000 // per direction, in case a step doesn't move a line along
+
+// the app's colors, see main.c
+static const RasterColor background = { 245, 245, 245, 255 };
+static const RasterColor axisColor = { 0, 0, 0, 255 };
+static const RasterColor gridColor = { 200, 200, 200, 127 };
+static const RasterColor labelColor = { 80, 80, 80, 255 };
+static const RasterColor palette[] = {
+    { 230, 41, 55, 255 },
+    { 0, 121, 241, 255 },
+    { 0, 228, 48, 255 },
+    { 200, 122, 255, 255 },
+    { 255, 161, 0, 255 },
+};
+
+void Headless_Init(HeadlessRenderer* r, ThreadPool* pool) {
+    memset(r, 0, sizeof(*r));
+    r->pool = pool;
+}
+
+static bool ReserveTasks(HeadlessRenderer* r, int count) {
+    if (count <= r->taskCapacity) return true;
+    int capacity = r->taskCapacity ? r->taskCapacity : 256;
+    while (capacity < count) capacity *= 2;
+    PoolTask* tasks = (PoolTask*)realloc(r->tasks, capacity * sizeof(PoolTask));
+    if (!tasks) return false;
+    r->tasks = tasks;
+    r->taskCapacity = capacity;
+    return true;
+}
+
+static void Label(Canvas* canvas, RasterClip clip, DDouble v, double step, int x, int y, int size) {
+    char b[48];
+    GraphState_Label(v, step, b, sizeof(b));
+    Canvas_DrawText(canvas, clip, b, x, y, size, labelColor);
+}
+
+// a screen coordinate that still fits an int, far off screen is as good as just off it
+static int Pixel(double v) {
+    return (int)floor(fmin(fmax(v, -1e6), 1e6));
+}
+
+// same layout as Graph_DrawGrid, with lines and labels grown by the ui scale
+static void DrawGrid(Canvas* canvas, RasterClip clip, const GraphState* graph, int ui) {
+    int width = canvas->width, height = canvas->height;
+    double minX = (0 - width / 2.0) / graph->scale + graph->centerX;
+    double maxX = (width / 2.0) / graph->scale + graph->centerX;
+    double minY = (height / 2.0 - height) / graph->scale + graph->centerY;
+    double maxY = (height / 2.0) / graph->scale + graph->centerY;
+
+    double step = GraphState_GridStep(graph, 100.0 * ui);
+    DDouble stepDD = { step, 0.0 };
+
+    int originX = Pixel((GraphState_ViewX(graph, 0.0) - graph->centerX) * graph->scale + width / 2.0);
+    int originY = Pixel(height / 2.0 - (GraphState_ViewY(graph, 0.0) - graph->centerY) * graph->scale);
+    Canvas_FillRect(canvas, clip, 0, originY, width, ui, axisColor);
+    Canvas_FillRect(canvas, clip, originX, 0, ui, height, axisColor);
+
+    DDouble x = GraphState_FirstLine(graph->originX, minX, step);
+    for (int i = 0; i < HEADLESS_MAX_LINES; i++, x = DDouble_Add(x, stepDD)) {
+        double viewX = DDouble_Sub(x, graph->originX).hi;
+        if (viewX > maxX) break;
+        int screenX = Pixel((viewX - graph->centerX) * graph->scale + width / 2.0);
+        Canvas_FillRect(canvas, clip, screenX, 0, ui, height, gridColor);
+        if (fabs(x.hi) > step * 1e-6) Label(canvas, clip, x, step, screenX + 2 * ui, originY + 2 * ui, ui);
+    }
+    DDouble y = GraphState_FirstLine(graph->originY, minY, step);
+    for (int i = 0; i < HEADLESS_MAX_LINES; i++, y = DDouble_Add(y, stepDD)) {
+        double viewY = DDouble_Sub(y, graph->originY).hi;
+        if (viewY > maxY) break;
+        int screenY = Pixel(height / 2.0 - (viewY - graph->centerY) * graph->scale);
+        Canvas_FillRect(canvas, clip, 0, screenY, width, ui, gridColor);
+        if (fabs(y.hi) > step * 1e-6) Label(canvas, clip, y, step, originX + 2 * ui, screenY + 2 * ui, ui);
+    }
+}
+
+// one band of rows, everything drawn in the app's order so the bands agree on overlaps
+static void DrawBand(void* user, int index, int worker) {
+    HeadlessRenderer* r = (HeadlessRenderer*)user;
+    const HeadlessJob* job = r->job;
+    (void)worker;
+    RasterClip clip = { 0, index * HEADLESS_BAND_ROWS, r->canvas.width, (index + 1) * HEADLESS_BAND_ROWS };
+    Canvas_Clear(&r->canvas, clip, background);
+    DrawGrid(&r->canvas, clip, &job->graph, r->uiScale);
+
+    for (int i = 0; i < job->equationCount; i++) {
+        const Figure* fig = &r->figures[i];
+        if (Figure_IsEmpty(fig)) continue;
+        RasterColor color = job->colors ? job->colors[i] : palette[i % 5];
+        color.a = (uint8_t)(color.a * 0.3f);
+        Canvas_FillTriangles(&r->canvas, clip, fig->shading.xy, fig->shading.count, color);
+    }
+    for (int i = 0; i < job->equationCount; i++) {
+        const Figure* fig = &r->figures[i];
+        if (Figure_IsEmpty(fig)) continue;
+        RasterColor color = job->colors ? job->colors[i] : palette[i % 5];
+        Canvas_FillTriangles(&r->canvas, clip, fig->stroke.xy, fig->stroke.count, color);
+    }
+}
+
+bool Headless_Render(HeadlessRenderer* r, const HeadlessJob* job) {
+    if (!Canvas_Resize(&r->canvas, job->width, job->height)) return false;
+    if (job->equationCount > r->figureCapacity) {
+        Figure* figures = (Figure*)realloc(r->figures, job->equationCount * sizeof(Figure));
+        if (!figures) return false;
+        for (int i = r->figureCapacity; i < job->equationCount; i++) Figure_Init(&figures[i]);
+        r->figures = figures;
+        r->figureCapacity = job->equationCount;
+    }
+    r->uiScale = job->uiScale > 0 ? job->uiScale : (job->height + 540) / 1080;
+    if (r->uiScale < 1) r->uiScale = 1;
+
+    // sampling, every figure's tasks in one batch like the app does per frame
+    EvalContext ctx = { 0.0, 0.0, job->t };
+    const GraphState* g = &job->graph;
+    int taskCount = 0;
+    for (int i = 0; i < job->equationCount; i++) {
+        Figure* fig = &r->figures[i];
+        Figure_SetText(fig, job->equations[i]);
+        const char* error = Figure_Error(fig);
+        if (error) fprintf(stderr, "%.40s: %s\n", job->equations[i], error);
+        fig->lineWidth = FIGURE_THICKNESS * r->uiScale;
+        Figure_SetOrigin(fig, g->originX, g->originY);
+        int n = Figure_Begin(fig, &ctx, g->scale, g->centerX, g->centerY, job->width, job->height);
+        if (!ReserveTasks(r, taskCount + n)) return false;
+        for (int k = 0; k < n; k++) r->tasks[taskCount++] = (PoolTask){ Figure_RunTask, fig, k };
+    }
+    Pool_Run(r->pool, r->tasks, taskCount);
+    for (int i = 0; i < job->equationCount; i++) Figure_End(&r->figures[i]);
+
+    int bands = (job->height + HEADLESS_BAND_ROWS - 1) / HEADLESS_BAND_ROWS;
+    if (!ReserveTasks(r, bands)) return false;
+    for (int i = 0; i < bands; i++) r->tasks[i] = (PoolTask){ DrawBand, r, i };
+    r->job = job;
+    Pool_Run(r->pool, r->tasks, bands);
+    r->job = NULL;
+    return true;
+}
+
+void Headless_Free(HeadlessRenderer* r) {
+    for (int i = 0; i < r->figureCapacity; i++) Figure_Free(&r->figures[i]);
+    free(r->figures);
+    free(r->tasks);
+    Canvas_Free(&r->canvas);
+    memset(r, 0, sizeof(*r));
+}
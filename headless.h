@@ -0,0 +1,41 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include "figure.h"
+#include "graphstate.h"
+#include "raster.h"
+#include "pool.h"
+
+// one picture: equations as typed in the app, over a view, at any size
+typedef struct {
+    const char* const* equations;
+    int equationCount;
+    const RasterColor* colors; // one per equation, NULL for the app's palette
+    GraphState graph;
+    int width;
+    int height;
+    double t;
+    int uiScale; // line widths and text, 0 picks one per 1080 rows
+} HeadlessJob;
+
+// renders jobs without a window. sampling and rasterizing both run on the pool, the raster
+// in bands of rows. everything is kept between jobs, so a batch of plots only allocates
+// while it meets bigger ones than before
+typedef struct {
+    ThreadPool* pool;
+    Canvas canvas;
+    Figure* figures;
+    int figureCapacity;
+    PoolTask* tasks;
+    int taskCapacity;
+    const HeadlessJob* job; // during Render
+    int uiScale;
+} HeadlessRenderer;
+
+// pool may be NULL to do everything on the calling thread
+void Headless_Init(HeadlessRenderer* r, ThreadPool* pool);
+// the picture ends up in r->canvas
+bool Headless_Render(HeadlessRenderer* r, const HeadlessJob* job);
+void Headless_Free(HeadlessRenderer* r);
+
+#endif
@@ -0,0 +1,342 @@
+#include "implicit.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define IMPLICIT_ROOT_PX 64
+#define IMPLICIT_LEAF_PX 2
+#define IMPLICIT_STRIP_COLUMNS 2 // root columns per strip, 128 pixels
+// stops splitting once a level would have more cells than this per root column, and contours what it has
+#define IMPLICIT_MAX_CELLS_PER_COLUMN 4096
+// a sign change whose center is this much bigger than the corners is a pole, not a crossing
+#define IMPLICIT_POLE_RATIO 2.0
+
+void ImplicitPlot_Init(ImplicitPlot* plot) {
+    memset(plot, 0, sizeof(*plot));
+}
+
+static bool Grow(void** data, int* capacity, int count, size_t itemSize) {
+    if (count <= *capacity) return true;
+    int newCapacity = *capacity ? *capacity : 256;
+    while (newCapacity < count) newCapacity *= 2;
+    void* p = realloc(*data, newCapacity * itemSize);
+    if (!p) return false;
+    *data = p;
+    *capacity = newCapacity;
+    return true;
+}
+
+static bool AddFill(ImplicitStrip* strip, ImplicitCell cell) {
+    if (!Grow((void**)&strip->fills, &strip->fillCapacity, strip->fillCount + 1, sizeof(ImplicitCell))) return false;
+    strip->fills[strip->fillCount++] = cell;
+    return true;
+}
+
+static bool AddSegment(ImplicitStrip* strip, float x0, float y0, float x1, float y1) {
+    if (!Grow((void**)&strip->segments, &strip->segmentCapacity, strip->segmentCount + 1, sizeof(ImplicitSegment))) return false;
+    strip->segments[strip->segmentCount++] = (ImplicitSegment){ x0, y0, x1, y1 };
+    return true;
+}
+
+static bool ReserveScratch(ImplicitStrip* strip, int count) {
+    if (count <= strip->scratchCapacity) return true;
+    int capacity = strip->scratchCapacity;
+    if (!Grow((void**)&strip->xs, &capacity, count, sizeof(double))) return false;
+    capacity = strip->scratchCapacity;
+    if (!Grow((void**)&strip->ys, &capacity, count, sizeof(double))) return false;
+    strip->scratchCapacity = capacity;
+    return true;
+}
+
+// cells and next are swapped every level, so they always grow together
+static bool ReserveCells(ImplicitStrip* strip, int count) {
+    if (count <= strip->cellCapacity) return true;
+    int capacity = strip->cellCapacity;
+    if (!Grow((void**)&strip->cells, &capacity, count, sizeof(ImplicitCell))) return false;
+    capacity = strip->cellCapacity;
+    if (!Grow((void**)&strip->next, &capacity, count, sizeof(ImplicitCell))) return false;
+    strip->cellCapacity = capacity;
+    return true;
+}
+
+static int CompareCells(const void* a, const void* b) {
+    const ImplicitCell* p = (const ImplicitCell*)a;
+    const ImplicitCell* q = (const ImplicitCell*)b;
+    if (p->y != q->y) return (p->y < q->y) ? -1 : 1;
+    return (p->x > q->x) - (p->x < q->x);
+}
+
+typedef struct {
+    double scale, centerX, centerY;
+    double halfWidth, halfHeight;
+} View;
+
+static double WorldX(const View* v, double px) {
+    return (px - v->halfWidth) / v->scale + v->centerX;
+}
+
+static double WorldY(const View* v, double py) {
+    return (v->halfHeight - py) / v->scale + v->centerY;
+}
+
+// crossing point on one edge of a leaf, edges are top, right, bottom, left
+static void EdgePoint(const ImplicitCell* c, const double f[4], int edge, float* x, float* y) {
+    // corners clockwise from the top left
+    static const int ends[4][2] = { { 0, 1 }, { 1, 2 }, { 3, 2 }, { 0, 3 } };
+    static const int cx[4] = { 0, 1, 1, 0 };
+    static const int cy[4] = { 0, 0, 1, 1 };
+    int a = ends[edge][0], b = ends[edge][1];
+    double t = f[a] / (f[a] - f[b]);
+    *x = (float)(c->x + c->size * (cx[a] + t * (cx[b] - cx[a])));
+    *y = (float)(c->y + c->size * (cy[a] + t * (cy[b] - cy[a])));
+}
+
+// marching squares on one leaf. corners are f at top left, top right, bottom right, bottom
+// left, the center breaks ties on saddles and catches poles, where the sign flips through infinity
+static bool Contour(ImplicitStrip* strip, const ImplicitCell* c, const double f[4], double center) {
+    // edge pairs per corner sign pattern, bit i set when corner i is positive
+    static const signed char edges[16][4] = {
+        { -1 }, { 3, 0, -1 }, { 0, 1, -1 }, { 3, 1, -1 },
+        { 1, 2, -1 }, { -1 }, { 0, 2, -1 }, { 3, 2, -1 },
+        { 3, 2, -1 }, { 0, 2, -1 }, { -1 }, { 1, 2, -1 },
+        { 3, 1, -1 }, { 0, 1, -1 }, { 3, 0, -1 }, { -1 }
+    };
+    // saddles cut off either the top right and bottom left corners or the other two
+    static const signed char cutTrBl[4] = { 0, 1, 3, 2 };
+    static const signed char cutTlBr[4] = { 3, 0, 1, 2 };
+
+    int mask = 0;
+    double largest = 0;
+    for (int i = 0; i < 4; i++) {
+        if (isnan(f[i])) return true;
+        if (f[i] > 0) mask |= 1 << i;
+        largest = fmax(largest, fabs(f[i]));
+    }
+    if (mask == 0 || mask == 15) return true;
+    if (isnan(center) || fabs(center) > IMPLICIT_POLE_RATIO * largest) return true;
+
+    const signed char* pairs = edges[mask];
+    if (mask == 5) pairs = (center > 0) ? cutTrBl : cutTlBr;
+    if (mask == 10) pairs = (center > 0) ? cutTlBr : cutTrBl;
+    int count = (mask == 5 || mask == 10) ? 4 : 2;
+    for (int i = 0; i < count; i += 2) {
+        float x0, y0, x1, y1;
+        EdgePoint(c, f, pairs[i], &x0, &y0);
+        EdgePoint(c, f, pairs[i + 1], &x1, &y1);
+        if (!AddSegment(strip, x0, y0, x1, y1)) return false;
+    }
+    return true;
+}
+
+// evaluates the leaves one row at a time, so every call is a span at a fixed y
+static bool ContourLeaves(ImplicitStrip* strip, const Expr* expr, const EvalContext* ctx, const View* view, int side, ImplicitCell* leaves, int count) {
+    qsort(leaves, count, sizeof(ImplicitCell), CompareCells);
+    if (!ReserveScratch(strip, 6 * count)) return false;
+    EvalContext c = *ctx;
+
+    for (int start = 0; start < count;) {
+        int end = start;
+        while (end < count && leaves[end].y == leaves[start].y) end++;
+        int n = end - start;
+        int size = leaves[start].size;
+        double* xs = strip->xs;
+        double* top = strip->ys;
+        double* bottom = top + 2 * n;
+        double* middle = bottom + 2 * n;
+
+        // left and right corners of each leaf, then the centers
+        for (int i = 0; i < n; i++) {
+            xs[2 * i] = WorldX(view, leaves[start + i].x);
+            xs[2 * i + 1] = WorldX(view, leaves[start + i].x + size);
+        }
+        c.y = WorldY(view, leaves[start].y);
+        Expr_EvaluateSpan(expr, xs, top, 2 * n, &c);
+        c.y = WorldY(view, leaves[start].y + size);
+        Expr_EvaluateSpan(expr, xs, bottom, 2 * n, &c);
+        for (int i = 0; i < n; i++) {
+            xs[i] = WorldX(view, leaves[start + i].x + size / 2.0);
+        }
+        c.y = WorldY(view, leaves[start].y + size / 2.0);
+        Expr_EvaluateSpan(expr, xs, middle, n, &c);
+        strip->evaluated += 5 * n;
+
+        for (int i = 0; i < n; i++) {
+            const ImplicitCell* leaf = &leaves[start + i];
+            double f[4] = { top[2 * i], top[2 * i + 1], bottom[2 * i + 1], bottom[2 * i] };
+            if (!Contour(strip, leaf, f, middle[i])) return false;
+            if (side != 0 && middle[i] * side > 0 && !AddFill(strip, *leaf)) return false;
+        }
+        start = end;
+    }
+    return true;
+}
+
+static bool Build(ImplicitStrip* strip, const Expr* expr, const EvalContext* ctx, int side, const View* view, int height) {
+    const AST* ast = expr->ast;
+    if (ast->nodeCount > strip->intervalCapacity) {
+        Interval* intervals = (Interval*)realloc(strip->intervals, ast->nodeCount * sizeof(Interval));
+        if (!intervals) return false;
+        strip->intervals = intervals;
+        strip->intervalCapacity = ast->nodeCount;
+    }
+
+    int count = 0;
+    int rows = (height + IMPLICIT_ROOT_PX - 1) / IMPLICIT_ROOT_PX;
+    int maxCells = IMPLICIT_MAX_CELLS_PER_COLUMN * strip->columns;
+    if (!ReserveCells(strip, strip->columns * rows)) return false;
+    for (int r = 0; r < rows; r++) {
+        for (int col = strip->column; col < strip->column + strip->columns; col++) {
+            strip->cells[count++] = (ImplicitCell){ col * IMPLICIT_ROOT_PX, r * IMPLICIT_ROOT_PX, IMPLICIT_ROOT_PX };
+        }
+    }
+
+    IntervalContext ic;
+    ic.t = (Interval){ ctx->t, ctx->t };
+    for (int size = IMPLICIT_ROOT_PX;; size /= 2) {
+        // keep the cells that might contain part of the curve, in place
+        int kept = 0;
+        for (int i = 0; i < count; i++) {
+            ImplicitCell cell = strip->cells[i];
+            ic.x = (Interval){ WorldX(view, cell.x), WorldX(view, cell.x + size) };
+            ic.y = (Interval){ WorldY(view, cell.y + size), WorldY(view, cell.y) };
+            Interval v = Expr_EvaluateInterval(expr, &ic, strip->intervals);
+            strip->cellsVisited++;
+            if (Interval_IsEmpty(v)) continue;
+            if (v.lo > 0 || v.hi < 0) {
+                if (side != 0 && (v.lo > 0) == (side > 0) && !AddFill(strip, cell)) return false;
+                continue;
+            }
+            strip->cells[kept++] = cell;
+        }
+        count = kept;
+
+        if (size / 2 < IMPLICIT_LEAF_PX || 4 * count > maxCells) break;
+        if (!ReserveCells(strip, 4 * count)) return false;
+        int half = size / 2;
+        for (int i = 0; i < count; i++) {
+            ImplicitCell cell = strip->cells[i];
+            for (int k = 0; k < 4; k++) {
+                strip->next[4 * i + k] = (ImplicitCell){ cell.x + (k & 1) * half, cell.y + (k >> 1) * half, half };
+            }
+        }
+        ImplicitCell* t = strip->cells;
+        strip->cells = strip->next;
+        strip->next = t;
+        count *= 4;
+    }
+    return ContourLeaves(strip, expr, ctx, view, side, strip->cells, count);
+}
+
+int ImplicitPlot_Begin(ImplicitPlot* plot, const Expr* expr, const EvalContext* ctx, int side,
+                       double scale, double centerX, double centerY, int width, int height) {
+    plot->cellsVisited = 0;
+    plot->evaluated = 0;
+    plot->pending = false;
+    plot->stripCount = 0;
+    bool sameTime = !Expr_DependsOn(expr, VAR_T) || plot->t == ctx->t;
+    if (plot->valid && plot->version == expr->version && plot->side == side && plot->scale == scale &&
+        plot->centerX == centerX && plot->centerY == centerY && plot->width == width && plot->height == height && sameTime) {
+        return 0;
+    }
+
+    plot->segmentCount = 0;
+    plot->fillCount = 0;
+    plot->valid = false;
+    if (width <= 0 || height <= 0 || Expr_IsEmpty(expr)) return 0;
+
+    int columns = (width + IMPLICIT_ROOT_PX - 1) / IMPLICIT_ROOT_PX;
+    int strips = (columns + IMPLICIT_STRIP_COLUMNS - 1) / IMPLICIT_STRIP_COLUMNS;
+    if (strips > plot->stripCapacity) {
+        ImplicitStrip* s = (ImplicitStrip*)realloc(plot->strips, strips * sizeof(ImplicitStrip));
+        if (!s) return 0;
+        memset(s + plot->stripCapacity, 0, (strips - plot->stripCapacity) * sizeof(ImplicitStrip));
+        plot->strips = s;
+        plot->stripCapacity = strips;
+    }
+    for (int i = 0; i < strips; i++) {
+        plot->strips[i].column = i * IMPLICIT_STRIP_COLUMNS;
+        plot->strips[i].columns = (columns - plot->strips[i].column < IMPLICIT_STRIP_COLUMNS) ? columns - plot->strips[i].column : IMPLICIT_STRIP_COLUMNS;
+    }
+
+    // the key doubles as the view the strips work on, valid says whether they're done
+    plot->version = expr->version;
+    plot->side = side;
+    plot->scale = scale;
+    plot->centerX = centerX;
+    plot->centerY = centerY;
+    plot->width = width;
+    plot->height = height;
+    plot->t = ctx->t;
+    plot->pending = true;
+    plot->expr = expr;
+    plot->ctx = *ctx;
+    plot->stripCount = strips;
+    return strips;
+}
+
+void ImplicitPlot_RunStrip(ImplicitPlot* plot, int index) {
+    ImplicitStrip* strip = &plot->strips[index];
+    View view = { plot->scale, plot->centerX, plot->centerY, plot->width / 2.0, plot->height / 2.0 };
+    strip->segmentCount = 0;
+    strip->fillCount = 0;
+    strip->cellsVisited = 0;
+    strip->evaluated = 0;
+    strip->ok = Build(strip, plot->expr, &plot->ctx, plot->side, &view, plot->height);
+}
+
+void ImplicitPlot_End(ImplicitPlot* plot) {
+    if (!plot->pending) return;
+    plot->pending = false;
+
+    int segments = 0, fills = 0;
+    for (int i = 0; i < plot->stripCount; i++) {
+        const ImplicitStrip* strip = &plot->strips[i];
+        if (!strip->ok) return;
+        segments += strip->segmentCount;
+        fills += strip->fillCount;
+        plot->cellsVisited += strip->cellsVisited;
+        plot->evaluated += strip->evaluated;
+    }
+    if (!Grow((void**)&plot->segments, &plot->segmentCapacity, segments, sizeof(ImplicitSegment))) return;
+    if (!Grow((void**)&plot->fills, &plot->fillCapacity, fills, sizeof(ImplicitCell))) return;
+    for (int i = 0; i < plot->stripCount; i++) {
+        const ImplicitStrip* strip = &plot->strips[i];
+        // a strip that found nothing may never have allocated
+        if (strip->segmentCount > 0) {
+            memcpy(plot->segments + plot->segmentCount, strip->segments, strip->segmentCount * sizeof(ImplicitSegment));
+            plot->segmentCount += strip->segmentCount;
+        }
+        if (strip->fillCount > 0) {
+            memcpy(plot->fills + plot->fillCount, strip->fills, strip->fillCount * sizeof(ImplicitCell));
+            plot->fillCount += strip->fillCount;
+        }
+    }
+    plot->valid = true;
+    plot->generation++;
+}
+
+void ImplicitPlot_Update(ImplicitPlot* plot, const Expr* expr, const EvalContext* ctx, int side,
+                         double scale, double centerX, double centerY, int width, int height) {
+    int strips = ImplicitPlot_Begin(plot, expr, ctx, side, scale, centerX, centerY, width, height);
+    for (int i = 0; i < strips; i++) {
+        ImplicitPlot_RunStrip(plot, i);
+    }
+    ImplicitPlot_End(plot);
+}
+
+void ImplicitPlot_Free(ImplicitPlot* plot) {
+    for (int i = 0; i < plot->stripCapacity; i++) {
+        ImplicitStrip* strip = &plot->strips[i];
+        free(strip->segments);
+        free(strip->fills);
+        free(strip->cells);
+        free(strip->next);
+        free(strip->intervals);
+        free(strip->xs);
+        free(strip->ys);
+    }
+    free(plot->strips);
+    free(plot->segments);
+    free(plot->fills);
+    ImplicitPlot_Init(plot);
+}
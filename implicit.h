@@ -0,0 +1,87 @@
+#ifndef IMPLICIT_H
+#define IMPLICIT_H
+
+#include "expr.h"
+#include "interval.h"
+#include <stdbool.h>
+
+// square of screen pixels, a quadtree cell
+typedef struct {
+    int x;
+    int y;
+    int size;
+} ImplicitCell;
+
+typedef struct {
+    float x0, y0;
+    float x1, y1;
+} ImplicitSegment;
+
+// a band of root columns contoured on its own, so an update can be spread over threads
+typedef struct {
+    int column;
+    int columns;
+    ImplicitSegment* segments;
+    int segmentCount;
+    int segmentCapacity;
+    ImplicitCell* fills;
+    int fillCount;
+    int fillCapacity;
+    int cellsVisited;
+    int evaluated;
+    bool ok;
+    // scratch reused between updates
+    ImplicitCell* cells;
+    ImplicitCell* next;
+    int cellCapacity;
+    Interval* intervals;
+    unsigned intervalCapacity;
+    double* xs;
+    double* ys;
+    int scratchCapacity;
+} ImplicitStrip;
+
+// the curve f(x, y) = 0 over the viewport, in screen pixels. cells whose interval can't
+// contain zero are dropped whole, so only cells along the curve get split down to leaves,
+// and only leaves are contoured. the cost follows the length of the curve, not the window.
+typedef struct {
+    ImplicitSegment* segments;
+    int segmentCount;
+    int segmentCapacity;
+    ImplicitCell* fills; // where f has the sign asked for, for inequalities
+    int fillCount;
+    int fillCapacity;
+    // what it was computed for
+    unsigned version;
+    int side;
+    double scale, centerX, centerY;
+    int width, height;
+    double t;            // only part of the key when the expression reads t
+    bool valid;
+    unsigned generation; // bumped whenever segments or fills change
+    int cellsVisited; // interval evaluations done by the last update
+    int evaluated;    // point evaluations done by the last update
+    // the update between Begin and End
+    bool pending;
+    const Expr* expr;
+    EvalContext ctx;
+    ImplicitStrip* strips;
+    int stripCount;
+    int stripCapacity;
+} ImplicitPlot;
+
+void ImplicitPlot_Init(ImplicitPlot* plot);
+// plans the update for a view and returns how many strips it takes, 0 when nothing changed.
+// side is 0 for f = 0, -1 to also fill where f < 0 and 1 where f > 0. the strips read
+// expr, so it has to stay put until End
+int ImplicitPlot_Begin(ImplicitPlot* plot, const Expr* expr, const EvalContext* ctx, int side,
+                       double scale, double centerX, double centerY, int width, int height);
+// contours one strip, different strips can run on different threads at the same time
+void ImplicitPlot_RunStrip(ImplicitPlot* plot, int strip);
+void ImplicitPlot_End(ImplicitPlot* plot);
+// all of the above on the calling thread
+void ImplicitPlot_Update(ImplicitPlot* plot, const Expr* expr, const EvalContext* ctx, int side,
+                         double scale, double centerX, double centerY, int width, int height);
+void ImplicitPlot_Free(ImplicitPlot* plot);
+
+#endif
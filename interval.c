@@ -0,0 +1,178 @@
+#include "interval.h"
+#include <math.h>
+
+#define INTERVAL_PI 3.14159265358979323846
+#define INTERVAL_TWO_PI 6.28318530717958647692
+
+static const Interval Empty = { NAN, NAN };
+static const Interval Whole = { -INFINITY, INFINITY };
+
+bool Interval_IsEmpty(Interval a) {
+    return isnan(a.lo);
+}
+
+static Interval Point(double v) {
+    Interval r = { v, v };
+    return isnan(v) ? Empty : r;
+}
+
+// rounds outwards, the libm functions are only good to about an ulp
+static Interval Widen(double lo, double hi) {
+    if (isnan(lo) || isnan(hi)) return Whole;
+    Interval r = { nextafter(lo, -INFINITY), nextafter(hi, INFINITY) };
+    return r;
+}
+
+// products where 0 * inf counts as 0, the limit an interval bound stands for
+static double Mul(double a, double b) {
+    if (a == 0 || b == 0) return 0;
+    return a * b;
+}
+
+static Interval Multiply(Interval a, Interval b) {
+    if ((a.lo == 0 && a.hi == 0) || (b.lo == 0 && b.hi == 0)) return Point(0.0);
+    double p1 = Mul(a.lo, b.lo), p2 = Mul(a.lo, b.hi), p3 = Mul(a.hi, b.lo), p4 = Mul(a.hi, b.hi);
+    return Widen(fmin(fmin(p1, p2), fmin(p3, p4)), fmax(fmax(p1, p2), fmax(p3, p4)));
+}
+
+static Interval Divide(Interval a, Interval b) {
+    if (b.lo == 0 && b.hi == 0) return Empty; // division by zero is NaN
+    if (b.lo <= 0 && b.hi >= 0) return Whole;
+    Interval inv = { 1.0 / b.hi, 1.0 / b.lo };
+    return Multiply(a, Widen(inv.lo, inv.hi));
+}
+
+static bool IsInteger(double v) {
+    return isfinite(v) && v == floor(v);
+}
+
+static Interval Power(Interval a, Interval b) {
+    if (b.lo == b.hi && IsInteger(b.lo)) {
+        double n = b.lo;
+        if (n == 0) return Point(1.0);
+        // even powers fold around zero, odd ones are monotonic
+        bool even = fmod(n, 2.0) == 0;
+        if (n < 0 && a.lo <= 0 && a.hi >= 0) {
+            if (a.lo == 0 && a.hi == 0) return even ? Point(INFINITY) : Whole; // the sign of zero picks the infinity
+            if (even) return Widen(fmin(pow(a.lo, n), pow(a.hi, n)), INFINITY);
+            return Whole;
+        }
+        double lo = pow(a.lo, n), hi = pow(a.hi, n);
+        if (even && a.lo < 0 && a.hi > 0) return Widen(0, fmax(lo, hi));
+        return Widen(fmin(lo, hi), fmax(lo, hi));
+    }
+    // non integer exponents are only defined for a >= 0, where pow is monotonic in each argument.
+    // the exceptions are pow(-inf, b), which isn't NaN, and pow(-0, b) with a negative odd integer in b
+    if (a.lo == -INFINITY) return Whole;
+    if (a.lo <= 0 && b.lo < 0 && b.lo != b.hi) return Whole;
+    if (a.hi < 0) return (b.lo == b.hi) ? Empty : Whole;
+    if (a.lo < 0) {
+        if (b.lo != b.hi) return Whole; // integers inside b keep negative bases defined
+        a.lo = 0;
+    }
+    double p1 = pow(a.lo, b.lo), p2 = pow(a.lo, b.hi), p3 = pow(a.hi, b.lo), p4 = pow(a.hi, b.hi);
+    return Widen(fmin(fmin(p1, p2), fmin(p3, p4)), fmax(fmax(p1, p2), fmax(p3, p4)));
+}
+
+// how far a bound may be off after shifting it by a multiple of pi
+static double Slack(double v) {
+    return 1e-12 + 1e-15 * fabs(v);
+}
+
+// sin over [lo, hi] with the peaks at pi/2 + 2k pi and troughs at -pi/2 + 2k pi
+static Interval Sine(Interval a, double phase) {
+    if (!isfinite(a.lo) || !isfinite(a.hi) || a.hi - a.lo >= INTERVAL_TWO_PI) return Widen(-1, 1);
+    double s1 = sin(a.lo + phase), s2 = sin(a.hi + phase);
+    double lo = fmin(s1, s2), hi = fmax(s1, s2);
+    // the shifted bounds are rounded, so a peak right at the edge is counted as inside
+    double peak = ceil((a.lo + phase - INTERVAL_PI / 2) / INTERVAL_TWO_PI) * INTERVAL_TWO_PI + INTERVAL_PI / 2;
+    if (peak - phase <= a.hi + Slack(a.hi)) hi = 1;
+    double trough = ceil((a.lo + phase + INTERVAL_PI / 2) / INTERVAL_TWO_PI) * INTERVAL_TWO_PI - INTERVAL_PI / 2;
+    if (trough - phase <= a.hi + Slack(a.hi)) lo = -1;
+    return Widen(lo, hi);
+}
+
+static Interval Tangent(Interval a) {
+    if (!isfinite(a.lo) || !isfinite(a.hi) || a.hi - a.lo >= INTERVAL_PI) return Whole;
+    double pole = ceil((a.lo - INTERVAL_PI / 2) / INTERVAL_PI) * INTERVAL_PI + INTERVAL_PI / 2;
+    if (pole <= a.hi + Slack(a.hi)) return Whole;
+    return Widen(tan(a.lo), tan(a.hi));
+}
+
+static Interval Function(uint8_t func, Interval a) {
+    switch (func) {
+        case FUNC_SIN: return Sine(a, 0);
+        case FUNC_COS: return Sine(a, INTERVAL_PI / 2);
+        case FUNC_TAN: return Tangent(a);
+        case FUNC_SQRT:
+            if (a.hi < 0) return Empty;
+            return Widen(sqrt(fmax(a.lo, 0)), sqrt(a.hi));
+        case FUNC_LOG:
+            if (a.hi < 0) return Empty;
+            return Widen((a.lo <= 0) ? -INFINITY : log(a.lo), log(a.hi));
+        case FUNC_EXP: return Widen(exp(a.lo), exp(a.hi));
+        case FUNC_ABS:
+            if (a.lo >= 0) return a;
+            if (a.hi <= 0) return (Interval){ -a.hi, -a.lo };
+            return (Interval){ 0, fmax(-a.lo, a.hi) };
+        default: return Point(0.0);
+    }
+}
+
+static Interval Operand(const Interval* values, NodeIndex n) {
+    return (n == NODE_NONE) ? Point(0.0) : values[n];
+}
+
+Interval AST_EvaluateInterval(const AST* ast, const IntervalContext* ctx, Interval* scratch) {
+    if (!ast || ast->root == NODE_NONE) return Point(0.0);
+
+    // children come first, one forward pass covers the whole tree
+    for (NodeIndex i = 0; i <= ast->root; i++) {
+        const ASTNode* node = &ast->nodes[i];
+        Interval r = Point(0.0);
+        switch (node->type) {
+            case NODE_NUMBER:
+                r = Point(node->data.number);
+                break;
+            case NODE_VARIABLE:
+                if (node->data.var == VAR_X) r = ctx->x;
+                else if (node->data.var == VAR_Y) r = ctx->y;
+                else if (node->data.var == VAR_T) r = ctx->t;
+                break;
+            case NODE_BINARY_OP: {
+                Interval a = Operand(scratch, node->data.binary.left);
+                Interval b = Operand(scratch, node->data.binary.right);
+                // pow(NaN, 0) and pow(1, NaN) are both 1, that's all the defined part can be
+                if (node->op == TOKEN_POWER && ((Interval_IsEmpty(a) && b.lo <= 0 && b.hi >= 0) || (Interval_IsEmpty(b) && a.lo <= 1 && a.hi >= 1))) {
+                    r = Point(1.0);
+                    break;
+                }
+                if (Interval_IsEmpty(a) || Interval_IsEmpty(b)) {
+                    r = Empty;
+                    break;
+                }
+                switch (node->op) {
+                    case TOKEN_PLUS: r = Widen(a.lo + b.lo, a.hi + b.hi); break;
+                    case TOKEN_MINUS: r = Widen(a.lo - b.hi, a.hi - b.lo); break;
+                    case TOKEN_MULTIPLY: r = Multiply(a, b); break;
+                    case TOKEN_DIVIDE: r = Divide(a, b); break;
+                    case TOKEN_POWER: r = Power(a, b); break;
+                    default: break;
+                }
+                break;
+            }
+            case NODE_UNARY_OP: {
+                Interval a = Operand(scratch, node->data.unary.operand);
+                r = (Interval){ -a.hi, -a.lo };
+                break;
+            }
+            case NODE_FUNCTION: {
+                Interval a = Operand(scratch, node->data.function.arg);
+                r = Interval_IsEmpty(a) ? Empty : Function(node->func, a);
+                break;
+            }
+        }
+        scratch[i] = r;
+    }
+    return scratch[ast->root];
+}
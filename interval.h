@@ -0,0 +1,25 @@
+#ifndef INTERVAL_H
+#define INTERVAL_H
+
+#include "parser.h"
+#include <stdbool.h>
+
+// closed range of values. lo and hi are NaN when nothing in the input is in the
+// function's domain, partially undefined inputs are clipped to the part that is.
+typedef struct {
+    double lo;
+    double hi;
+} Interval;
+
+typedef struct {
+    Interval x;
+    Interval y;
+    Interval t;
+} IntervalContext;
+
+bool Interval_IsEmpty(Interval a);
+// every value AST_Evaluate can return for inputs inside ctx, widened by an ulp per
+// operation so libm rounding can't make it miss. scratch holds ast->nodeCount entries.
+Interval AST_EvaluateInterval(const AST* ast, const IntervalContext* ctx, Interval* scratch);
+
+#endif
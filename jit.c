@@ -0,0 +1,361 @@
+#define _DEFAULT_SOURCE // MAP_ANONYMOUS under strict -std modes
+#include "jit.h"
+#include "vecmath.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#if defined(_WIN32)
+#define JIT_SUPPORTED 1
+#define JIT_WIN64 1
+#include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#define JIT_SUPPORTED 1
+#include <sys/mman.h>
+#endif
+#endif
+
+#ifdef JIT_SUPPORTED
+
+// generated code: void fn(const double* xs, double* out, size_t pairs, const EvalContext* ctx)
+typedef void (*JitFn)(const double* xs, double* out, size_t pairs, const EvalContext* ctx);
+
+struct JitProgram {
+    uint8_t* memory;
+    size_t size;     // bytes mapped
+    size_t codeSize; // bytes emitted, constant pool included
+    JitFn entry;
+};
+
+typedef struct {
+    uint8_t* base;
+    size_t len;
+    size_t cap;
+} JitBuffer;
+
+// 16 byte constant pool entries at the start of the buffer, addressed rip relative
+enum {
+    POOL_SIGN,
+    POOL_ABS,
+    POOL_NAN,
+    POOL_CONSTANTS
+};
+
+// frame: 32 bytes of call shadow space (win64 needs it, harmless elsewhere), then one xmm slot per register
+#define JIT_SHADOW 32
+#define JIT_MAX_REGS 200 // keeps the frame under a page, so no stack probing is needed on windows
+#define JIT_MAX_INSTR_BYTES 96
+
+static void Emit8(JitBuffer* b, uint8_t v) {
+    if (b->len < b->cap) b->base[b->len] = v;
+    b->len++;
+}
+
+static void Emit32(JitBuffer* b, uint32_t v) {
+    for (int i = 0; i < 4; i++) Emit8(b, (uint8_t)(v >> (8 * i)));
+}
+
+static void Emit64(JitBuffer* b, uint64_t v) {
+    for (int i = 0; i < 8; i++) Emit8(b, (uint8_t)(v >> (8 * i)));
+}
+
+static void EmitBytes(JitBuffer* b, const uint8_t* bytes, size_t n) {
+    for (size_t i = 0; i < n; i++) Emit8(b, bytes[i]);
+}
+
+static void Patch32(JitBuffer* b, size_t at, uint32_t v) {
+    for (int i = 0; i < 4; i++) {
+        if (at + i < b->cap) b->base[at + i] = (uint8_t)(v >> (8 * i));
+    }
+}
+
+static int32_t RegDisp(int reg) {
+    return JIT_SHADOW + 16 * reg;
+}
+
+// <prefix> 0F <op> xmm, [rsp + disp32]
+static void EmitSseStack(JitBuffer* b, uint8_t prefix, uint8_t op, int xmm, int32_t disp) {
+    Emit8(b, prefix);
+    Emit8(b, 0x0F);
+    Emit8(b, op);
+    Emit8(b, (uint8_t)(0x84 | (xmm << 3))); // mod=10, rm=100 -> sib
+    Emit8(b, 0x24);                         // base rsp, no index
+    Emit32(b, (uint32_t)disp);
+}
+
+// <prefix> 0F <op> xmm, [rip + rel32]
+static void EmitSseRip(JitBuffer* b, uint8_t prefix, uint8_t op, int xmm, size_t target) {
+    Emit8(b, prefix);
+    Emit8(b, 0x0F);
+    Emit8(b, op);
+    Emit8(b, (uint8_t)(0x05 | (xmm << 3)));
+    Emit32(b, (uint32_t)(int32_t)(target - (b->len + 4)));
+}
+
+// 66 0F <op> dst, src
+static void EmitSseReg(JitBuffer* b, uint8_t op, int dst, int src) {
+    Emit8(b, 0x66);
+    Emit8(b, 0x0F);
+    Emit8(b, op);
+    Emit8(b, (uint8_t)(0xC0 | (dst << 3) | src));
+}
+
+static size_t PoolOffset(int entry) {
+    return (size_t)entry * 16;
+}
+
+// calls a libm function once per lane, operands and result go through the frame
+static void EmitCallPerLane(JitBuffer* b, uint64_t fn, const Instr* in, bool binary) {
+    for (int lane = 0; lane < 2; lane++) {
+        EmitSseStack(b, 0xF2, 0x10, 0, RegDisp(in->a) + 8 * lane);     // movsd xmm0, [a]
+        if (binary) EmitSseStack(b, 0xF2, 0x10, 1, RegDisp(in->b) + 8 * lane); // movsd xmm1, [b]
+        Emit8(b, 0x48); Emit8(b, 0xB8); Emit64(b, fn);                  // mov rax, fn
+        Emit8(b, 0xFF); Emit8(b, 0xD0);                                 // call rax
+        EmitSseStack(b, 0xF2, 0x11, 0, RegDisp(in->dst) + 8 * lane);   // movsd [dst], xmm0
+    }
+}
+
+static uint64_t FnAddress(double (*fn)(double)) {
+    return (uint64_t)(uintptr_t)fn;
+}
+
+static void EmitInstr(JitBuffer* b, const Instr* in) {
+    switch (in->op) {
+        case OP_CONST:
+            EmitSseRip(b, 0x66, 0x28, 0, PoolOffset(POOL_CONSTANTS + in->a)); // movapd xmm0, [k]
+            break;
+        case OP_VAR:
+            if (in->a == VAR_X) {
+                static const uint8_t loadX[] = { 0x66, 0x41, 0x0F, 0x10, 0x04, 0x24 }; // movupd xmm0, [r12]
+                EmitBytes(b, loadX, sizeof(loadX));
+            } else {
+                // movsd xmm0, [r15 + offset]; unpcklpd xmm0, xmm0
+                uint8_t offset = (in->a == VAR_Y) ? (uint8_t)offsetof(EvalContext, y) : (uint8_t)offsetof(EvalContext, t);
+                uint8_t loadVar[] = { 0xF2, 0x41, 0x0F, 0x10, 0x47, offset };
+                EmitBytes(b, loadVar, sizeof(loadVar));
+                EmitSseReg(b, 0x14, 0, 0);
+            }
+            break;
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL: {
+            uint8_t op = (in->op == OP_ADD) ? 0x58 : (in->op == OP_SUB) ? 0x5C : 0x59;
+            EmitSseStack(b, 0x66, 0x28, 0, RegDisp(in->a)); // movapd xmm0, [a]
+            EmitSseStack(b, 0x66, op, 0, RegDisp(in->b));   // op xmm0, [b]
+            break;
+        }
+        case OP_DIV:
+            // quotient where b != 0, NaN where it is, same as the interpreter
+            EmitSseStack(b, 0x66, 0x28, 0, RegDisp(in->a));      // movapd xmm0, [a]
+            EmitSseStack(b, 0x66, 0x28, 1, RegDisp(in->b));      // movapd xmm1, [b]
+            EmitSseReg(b, 0x5E, 0, 1);                           // divpd xmm0, xmm1
+            EmitSseReg(b, 0x57, 2, 2);                           // xorpd xmm2, xmm2
+            EmitSseReg(b, 0xC2, 1, 2); Emit8(b, 0x00);           // cmpeqpd xmm1, xmm2
+            EmitSseRip(b, 0x66, 0x28, 3, PoolOffset(POOL_NAN));  // movapd xmm3, [nan]
+            EmitSseReg(b, 0x54, 3, 1);                           // andpd xmm3, xmm1
+            EmitSseReg(b, 0x55, 1, 0);                           // andnpd xmm1, xmm0
+            EmitSseReg(b, 0x56, 1, 3);                           // orpd xmm1, xmm3
+            EmitSseReg(b, 0x28, 0, 1);                           // movapd xmm0, xmm1
+            break;
+        case OP_NEG:
+            EmitSseStack(b, 0x66, 0x28, 0, RegDisp(in->a));
+            EmitSseRip(b, 0x66, 0x57, 0, PoolOffset(POOL_SIGN)); // xorpd xmm0, [sign]
+            break;
+        case OP_ABS:
+            EmitSseStack(b, 0x66, 0x28, 0, RegDisp(in->a));
+            EmitSseRip(b, 0x66, 0x54, 0, PoolOffset(POOL_ABS));  // andpd xmm0, [abs]
+            break;
+        case OP_SQRT:
+            EmitSseStack(b, 0x66, 0x51, 0, RegDisp(in->a));      // sqrtpd xmm0, [a]
+            break;
+        case OP_POW:
+            EmitCallPerLane(b, (uint64_t)(uintptr_t)pow, in, true);
+            return;
+        case OP_SIN: EmitCallPerLane(b, FnAddress(sin), in, false); return;
+        case OP_COS: EmitCallPerLane(b, FnAddress(cos), in, false); return;
+        case OP_TAN: EmitCallPerLane(b, FnAddress(tan), in, false); return;
+        case OP_LOG: EmitCallPerLane(b, FnAddress(log), in, false); return;
+        case OP_EXP: EmitCallPerLane(b, FnAddress(exp), in, false); return;
+    }
+    EmitSseStack(b, 0x66, 0x29, 0, RegDisp(in->dst)); // movapd [dst], xmm0
+}
+
+static void EmitFunction(JitBuffer* b, const Program* program, size_t codeStart) {
+    int32_t frame = JIT_SHADOW + 16 * program->regCount;
+    b->len = codeStart;
+
+    // push rbx, r12-r15: five pushes realign rsp to 16
+    static const uint8_t prologue[] = { 0x53, 0x41, 0x54, 0x41, 0x55, 0x41, 0x56, 0x41, 0x57 };
+    EmitBytes(b, prologue, sizeof(prologue));
+    Emit8(b, 0x48); Emit8(b, 0x81); Emit8(b, 0xEC); Emit32(b, (uint32_t)frame); // sub rsp, frame
+
+#ifdef JIT_WIN64
+    static const uint8_t args[] = { 0x49, 0x89, 0xCC, 0x49, 0x89, 0xD5, 0x4D, 0x89, 0xC6, 0x4D, 0x89, 0xCF }; // r12..r15 = rcx, rdx, r8, r9
+#else
+    static const uint8_t args[] = { 0x49, 0x89, 0xFC, 0x49, 0x89, 0xF5, 0x49, 0x89, 0xD6, 0x49, 0x89, 0xCF }; // r12..r15 = rdi, rsi, rdx, rcx
+#endif
+    EmitBytes(b, args, sizeof(args));
+
+    static const uint8_t testPairs[] = { 0x4D, 0x85, 0xF6, 0x0F, 0x84 }; // test r14, r14; jz done
+    EmitBytes(b, testPairs, sizeof(testPairs));
+    size_t jzPatch = b->len;
+    Emit32(b, 0);
+
+    size_t loopStart = b->len;
+    for (int i = 0; i < program->codeCount; i++) {
+        EmitInstr(b, &program->code[i]);
+    }
+    EmitSseStack(b, 0x66, 0x28, 0, RegDisp(program->result));      // movapd xmm0, [result]
+    static const uint8_t storeOut[] = { 0x66, 0x41, 0x0F, 0x11, 0x45, 0x00 }; // movupd [r13], xmm0
+    EmitBytes(b, storeOut, sizeof(storeOut));
+
+    // add r12, 16; add r13, 16; dec r14; jnz loop
+    static const uint8_t advance[] = { 0x49, 0x83, 0xC4, 0x10, 0x49, 0x83, 0xC5, 0x10, 0x49, 0xFF, 0xCE, 0x0F, 0x85 };
+    EmitBytes(b, advance, sizeof(advance));
+    Emit32(b, (uint32_t)(int32_t)(loopStart - (b->len + 4)));
+
+    Patch32(b, jzPatch, (uint32_t)(int32_t)(b->len - (jzPatch + 4)));
+    Emit8(b, 0x48); Emit8(b, 0x81); Emit8(b, 0xC4); Emit32(b, (uint32_t)frame); // add rsp, frame
+    static const uint8_t epilogue[] = { 0x41, 0x5F, 0x41, 0x5E, 0x41, 0x5D, 0x41, 0x5C, 0x5B, 0xC3 };
+    EmitBytes(b, epilogue, sizeof(epilogue));
+}
+
+static void* AllocWritable(size_t size) {
+#ifdef JIT_WIN64
+    return VirtualAlloc(NULL, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+#else
+    void* p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return (p == MAP_FAILED) ? NULL : p;
+#endif
+}
+
+// the buffer is never writable and executable at the same time
+static bool MakeExecutable(void* p, size_t size) {
+#ifdef JIT_WIN64
+    DWORD old;
+    if (!VirtualProtect(p, size, PAGE_EXECUTE_READ, &old)) return false;
+    FlushInstructionCache(GetCurrentProcess(), p, size);
+    return true;
+#else
+    return mprotect(p, size, PROT_READ | PROT_EXEC) == 0;
+#endif
+}
+
+static void FreeExecutable(void* p, size_t size) {
+#ifdef JIT_WIN64
+    (void)size;
+    VirtualFree(p, 0, MEM_RELEASE);
+#else
+    munmap(p, size);
+#endif
+}
+
+bool Jit_IsAvailable(void) {
+    return true;
+}
+
+bool Jit_IsWorthwhile(const Program* program) {
+    if (!program) return false;
+    if (VecMath_Get()->sin == VecMath_GetScalar()->sin) return true; // no vector transcendentals to lose
+    for (int i = 0; i < program->codeCount; i++) {
+        uint16_t op = program->code[i].op;
+        if (op == OP_SIN || op == OP_COS || op == OP_EXP || op == OP_LOG) return false;
+    }
+    return true;
+}
+
+JitProgram* Jit_Compile(const Program* program) {
+    if (!program || program->regCount > JIT_MAX_REGS) return NULL;
+
+    size_t codeStart = PoolOffset(POOL_CONSTANTS + program->constCount);
+    size_t need = codeStart + 128 + (size_t)program->codeCount * JIT_MAX_INSTR_BYTES;
+    size_t size = (need + 4095) & ~(size_t)4095;
+
+    JitProgram* jit = (JitProgram*)malloc(sizeof(JitProgram));
+    if (!jit) return NULL;
+    jit->memory = (uint8_t*)AllocWritable(size);
+    if (!jit->memory) {
+        free(jit);
+        return NULL;
+    }
+    jit->size = size;
+
+    // constant pool, every value duplicated for both lanes
+    double* pool = (double*)jit->memory;
+    uint64_t sign = 0x8000000000000000ULL;
+    uint64_t abs = 0x7FFFFFFFFFFFFFFFULL;
+    memcpy(&pool[2 * POOL_SIGN], &sign, 8);
+    memcpy(&pool[2 * POOL_SIGN + 1], &sign, 8);
+    memcpy(&pool[2 * POOL_ABS], &abs, 8);
+    memcpy(&pool[2 * POOL_ABS + 1], &abs, 8);
+    pool[2 * POOL_NAN] = pool[2 * POOL_NAN + 1] = NAN;
+    for (int k = 0; k < program->constCount; k++) {
+        pool[2 * (POOL_CONSTANTS + k)] = pool[2 * (POOL_CONSTANTS + k) + 1] = program->constants[k];
+    }
+
+    JitBuffer b = { jit->memory, 0, size };
+    EmitFunction(&b, program, codeStart);
+    jit->codeSize = b.len;
+
+    if (b.len > size || !MakeExecutable(jit->memory, size)) {
+        FreeExecutable(jit->memory, size);
+        free(jit);
+        return NULL;
+    }
+    jit->entry = (JitFn)(void*)(jit->memory + codeStart);
+    return jit;
+}
+
+void Jit_EvaluateSpan(const JitProgram* jit, const double* xs, double* out, size_t n, const EvalContext* ctx) {
+    if (n >= 2) jit->entry(xs, out, n / 2, ctx);
+    if (n & 1) {
+        // odd tail goes through a padded pair
+        double x2[2] = { xs[n - 1], xs[n - 1] };
+        double out2[2];
+        jit->entry(x2, out2, 1, ctx);
+        out[n - 1] = out2[0];
+    }
+}
+
+size_t Jit_CodeSize(const JitProgram* jit) {
+    return jit->codeSize;
+}
+
+void Jit_Free(JitProgram* jit) {
+    if (!jit) return;
+    FreeExecutable(jit->memory, jit->size);
+    free(jit);
+}
+
+#else
+
+bool Jit_IsAvailable(void) {
+    return false;
+}
+
+bool Jit_IsWorthwhile(const Program* program) {
+    (void)program;
+    return false;
+}
+
+JitProgram* Jit_Compile(const Program* program) {
+    (void)program;
+    return NULL;
+}
+
+void Jit_EvaluateSpan(const JitProgram* jit, const double* xs, double* out, size_t n, const EvalContext* ctx) {
+    (void)jit; (void)xs; (void)out; (void)n; (void)ctx;
+}
+
+size_t Jit_CodeSize(const JitProgram* jit) {
+    (void)jit;
+    return 0;
+}
+
+void Jit_Free(JitProgram* jit) {
+    (void)jit;
+}
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include "compiler.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+// native x86-64 code for a compiled program. arithmetic is emitted as packed
+// SSE2 over two samples at a time, functions call into libm per lane, so the
+// results match Program_Evaluate exactly.
+typedef struct JitProgram JitProgram;
+
+bool Jit_IsAvailable(void);
+// returns NULL when there is no JIT for this platform, callers fall back to the interpreter
+JitProgram* Jit_Compile(const Program* program);
+// true when the jit is expected to beat AST_EvaluateBatch for this program: the batch
+// path has vector sin/cos/exp/log on avx2 while the jit calls libm per lane for them
+bool Jit_IsWorthwhile(const Program* program);
+void Jit_EvaluateSpan(const JitProgram* jit, const double* xs, double* out, size_t n, const EvalContext* ctx);
+size_t Jit_CodeSize(const JitProgram* jit);
+void Jit_Free(JitProgram* jit);
+
+#endif
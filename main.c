@@ -1,88 +1,360 @@
 #include "raylib.h"
-#include "parser.h"
+#include "figure.h"
+#include "pool.h"
+#include "profile.h"
+#include "solver.h"
+#include "points.h"
+#include "fit.h"
+#include "rlgl.h"
 #include "graph.h"
 #include "ui.h"
 #include <string.h>
-#include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
 
 #define MAX_INPUT_CHARS 256
-#define MAX_EQUATIONS 5
-
-typedef enum {
-    REL_EQ,
-    REL_LT,
-    REL_GT,
-    REL_LE,
-    REL_GE
-} Relation;
+// sidebar rows, the list scrolls under the timeline
+#define ROW_HEIGHT 50
+#define LIST_TOP 50
+#define SIDEBAR_WIDTH 320
+// t runs from 0 to here in as many seconds and starts over
+#define TIMELINE_END 10.0f
+// point clouds are drawn as squares this many pixels a side counting the points in them,
+// unless there are few enough in view to draw and label one by one
+#define POINT_BIN 3
+#define POINT_LABELS 50
 
 typedef struct {
     InputField input;
     Color color;
     bool visible;
-    Relation rel;
-    char parsedExpr[256];
-    char lastInput[256];
-    ASTNode* ast;
+    bool dirty;    // text changed since the figure last saw it
+    bool onScreen; // visible and not ruled out by Figure_MayShow at the last update
+    int id;        // its row in the profiler
+    Figure figure;
 } Equation;
 
-void ParseEquation(Equation* eq) {
-    if (strcmp(eq->input.text, eq->lastInput) == 0 && eq->ast != NULL) return;
-    
-    strcpy(eq->lastInput, eq->input.text);
-    if (eq->ast) { AST_Free(eq->ast); eq->ast = NULL; }
-
-    const char* text = eq->input.text;
-    eq->rel = REL_EQ;
-    const char* exprStart = text;
-
-    if (strncmp(text, "y<=", 3) == 0) { eq->rel = REL_LE; exprStart = text + 3; }
-    else if (strncmp(text, "y>=", 3) == 0) { eq->rel = REL_GE; exprStart = text + 3; }
-    else if (strncmp(text, "y<", 2) == 0) { eq->rel = REL_LT; exprStart = text + 2; }
-    else if (strncmp(text, "y>", 2) == 0) { eq->rel = REL_GT; exprStart = text + 2; }
-    else if (strncmp(text, "y=", 2) == 0) { eq->rel = REL_EQ; exprStart = text + 2; }
-    else if (strncmp(text, "<=", 2) == 0) { eq->rel = REL_LE; exprStart = text + 2; }
-    else if (strncmp(text, ">=", 2) == 0) { eq->rel = REL_GE; exprStart = text + 2; }
-    else if (text[0] == '<') { eq->rel = REL_LT; exprStart = text + 1; }
-    else if (text[0] == '>') { eq->rel = REL_GT; exprStart = text + 1; }
-    
-    while (*exprStart == ' ') exprStart++;
-    strcpy(eq->parsedExpr, exprStart);
-    
-    eq->ast = Parser_Parse(exprStart);
+// every equation, growable. the last one is always empty, typing into it adds the next
+typedef struct {
+    Equation* items;
+    int count;
+    int capacity;
+    float scroll; // of the sidebar list, pixels
+    int laidFirst, laidLast; // the rows LayoutRows gave a place last time
+} EquationList;
+
+// F2 shows it, F3 writes trace.json
+static Profiler profiler;
+
+// what changed since the scene layer was drawn. the overlay (hover, sidebar, keyboard) is
+// drawn on top of the layer every frame, so it needs no flag of its own
+typedef enum {
+    DIRTY_INPUT = 1 << 0,
+    DIRTY_VIEW = 1 << 1,    // pan, zoom or resize
+    DIRTY_VISIBLE = 1 << 2,
+    DIRTY_TIME = 1 << 3,
+    DIRTY_POINTS = 1 << 4,
+    DIRTY_FOCUS = 1 << 5    // another active equation, the solver crosses that one with the rest
+} Dirty;
+
+// the swatch next to an equation, clicking it shows or hides the equation
+static Rectangle SwatchRect(const Equation* eq) {
+    return (Rectangle){ eq->input.rect.x + eq->input.rect.width + 5, eq->input.rect.y, 10, 40 };
+}
+
+// the first five as always, then hues spread by the golden angle so neighbours differ
+static Color EquationColor(int i) {
+    static const Color palette[] = { RED, BLUE, GREEN, PURPLE, ORANGE };
+    if (i < 5) return palette[i];
+    return ColorFromHSV(fmodf(i * 137.508f, 360.0f), 0.75f, 0.8f);
+}
+
+static Equation* AddEquation(EquationList* list, const char* text) {
+    if (list->count == list->capacity) {
+        int capacity = list->capacity ? list->capacity * 2 : 16;
+        Equation* grown = (Equation*)realloc(list->items, capacity * sizeof(Equation));
+        if (!grown) return NULL;
+        list->items = grown;
+        list->capacity = capacity;
+    }
+    Equation* eq = &list->items[list->count];
+    memset(eq, 0, sizeof(*eq));
+    strncpy(eq->input.text, text, MAX_INPUT_CHARS - 1);
+    eq->input.letterCount = (int)strlen(eq->input.text);
+    eq->color = EquationColor(list->count);
+    eq->visible = true;
+    eq->dirty = true;
+    eq->id = list->count;
+    Figure_Init(&eq->figure);
+    list->count++;
+    return eq;
 }
 
-void SaveEquations(Equation* equations, int count, const char* filename) {
+// rows of the list that are at least partly in view
+static void VisibleRows(const EquationList* list, float listHeight, int* first, int* last) {
+    *first = (int)(list->scroll / ROW_HEIGHT);
+    *last = (int)((list->scroll + listHeight) / ROW_HEIGHT) + 1;
+    if (*last > list->count) *last = list->count;
+}
+
+// only the rows in view get a place, the others keep an empty rect nothing can hit. the
+// ones that were in view before are cleared, so a frame costs the rows on screen however
+// long the list is
+static void LayoutRows(EquationList* list, float listHeight) {
+    int first, last;
+    VisibleRows(list, listHeight, &first, &last);
+    for (int i = list->laidFirst; i < list->laidLast && i < list->count; i++) {
+        if (i < first || i >= last) list->items[i].input.rect = (Rectangle){ 0 };
+    }
+    for (int i = first; i < last; i++) {
+        list->items[i].input.rect = (Rectangle){ 10, LIST_TOP + i * ROW_HEIGHT - list->scroll, 300, 40 };
+    }
+    list->laidFirst = first;
+    list->laidLast = last;
+}
+
+static void ClampScroll(EquationList* list, float listHeight) {
+    float most = list->count * ROW_HEIGHT - listHeight;
+    if (list->scroll > most) list->scroll = most;
+    if (list->scroll < 0) list->scroll = 0;
+}
+
+static bool ReadsT(const Equation* equations, int count) {
+    for (int i = 0; i < count; i++) {
+        const Equation* eq = &equations[i];
+        if (eq->visible && eq->input.letterCount > 0 && Expr_DependsOn(&eq->figure.expr, VAR_T)) return true;
+    }
+    return false;
+}
+
+void SaveEquations(const EquationList* list, const char* filename) {
     FILE* file = fopen(filename, "w");
     if (file == NULL) return;
 
-    for (int i = 0; i < count; i++) {
-        fprintf(file, "%s\n", equations[i].input.text);
+    // not the empty one at the end
+    for (int i = 0; i + 1 < list->count; i++) {
+        fprintf(file, "%s\n", list->items[i].input.text);
     }
     fclose(file);
 }
 
-void LoadEquations(Equation* equations, int count, const char* filename) {
+// one equation per line, as many as there are
+void LoadEquations(EquationList* list, const char* filename) {
     FILE* file = fopen(filename, "r");
     if (file == NULL) return;
 
-    char buffer[256];
-    int i = 0;
-    while (fgets(buffer, sizeof(buffer), file) && i < count) {
+    char buffer[MAX_INPUT_CHARS];
+    while (fgets(buffer, sizeof(buffer), file)) {
         // Remove newline
         buffer[strcspn(buffer, "\r\n")] = 0;
-        if (strlen(buffer) > 0) {
-           strcpy(equations[i].input.text, buffer);
-           equations[i].input.letterCount = strlen(buffer);
-        }
-        i++;
+        if (strlen(buffer) > 0 && !AddEquation(list, buffer)) break;
     }
     fclose(file);
 }
 
+// one solver input per equation, kept between frames
+static bool ReserveSolverInputs(SolverInput** inputs, int* capacity, int count) {
+    if (count <= *capacity) return true;
+    SolverInput* grown = (SolverInput*)realloc(*inputs, count * sizeof(SolverInput));
+    if (!grown) return false;
+    *inputs = grown;
+    *capacity = count;
+    return true;
+}
+
+// queues the chunks of one update, tasks grows as needed
+static bool QueueTasks(PoolTask** tasks, int* count, int* capacity, PoolTaskFn fn, void* user, int n) {
+    if (*count + n > *capacity) {
+        int newCapacity = *capacity ? *capacity * 2 : 64;
+        while (newCapacity < *count + n) newCapacity *= 2;
+        PoolTask* t = (PoolTask*)realloc(*tasks, newCapacity * sizeof(PoolTask));
+        if (!t) return false;
+        *tasks = t;
+        *capacity = newCapacity;
+    }
+    for (int i = 0; i < n; i++) {
+        (*tasks)[(*count)++] = (PoolTask){ fn, user, i };
+    }
+    return true;
+}
+
+// Figure_RunTask with its time going to the equation's row
+static void SampleTask(void* user, int index, int worker) {
+    Equation* eq = (Equation*)user;
+    double start = Profiler_Now(&profiler);
+    Figure_RunTask(&eq->figure, index, worker);
+    Profiler_Record(&profiler, PROFILE_SAMPLE, eq->id, worker, start);
+}
+
+// a prebuilt triangle list in as few batches as rlgl allows, returns how many it took
+static int DrawTriangles(const float* xy, int count, Color color) {
+    const int perBatch = 3 * 1024;
+    int batches = 0;
+    for (int start = 0; start < count; start += perBatch, batches++) {
+        int n = count - start < perBatch ? count - start : perBatch;
+        rlCheckRenderBatchLimit(n);
+        rlBegin(RL_TRIANGLES);
+        rlColor4ub(color.r, color.g, color.b, color.a);
+        for (int i = start; i < start + n; i++) {
+            rlVertex2f(xy[2 * i], xy[2 * i + 1]);
+        }
+        rlEnd();
+    }
+    return batches;
+}
+
+// what drawing a point cloud keeps between frames
+typedef struct {
+    PointMarks marks;
+    float* bins; // the screen in POINT_BIN squares, how many points each
+    int binCapacity;
+} PointScratch;
+
+static bool IsPointFile(const char* filename) {
+    const char* dot = strrchr(filename, '.');
+    return dot && (strcmp(dot, ".csv") == 0 || strcmp(dot, ".bin") == 0 || strcmp(dot, ".CSV") == 0 || strcmp(dot, ".BIN") == 0);
+}
+
+// the whole square the cloud's index covers, in view
+static void FramePoints(GraphState* graph, const PointCloud* pc, int width, int height) {
+    if (pc->count == 0) return;
+    graph->originX = graph->originY = (DDouble){ 0.0, 0.0 };
+    graph->centerX = pc->minX + pc->size / 2;
+    graph->centerY = pc->minY + pc->size / 2;
+    graph->scale = 0.9 * (width < height ? width : height) / pc->size;
+}
+
+// only the points in view, a few of them as labelled dots and any more as a density map
+static void DrawPoints(const PointCloud* pc, PointScratch* scratch, GraphState* graph, int width, int height, Color color, Color ink) {
+    if (pc->count == 0) return;
+    // a dot's width past the edges, so the ones just outside still show their half
+    double left, top, right, bottom;
+    Graph_ToView(graph, (Vector2){ -5, -5 }, width, height, &left, &top);
+    Graph_ToView(graph, (Vector2){ width + 5.0f, height + 5.0f }, width, height, &right, &bottom);
+    PointCloud_Query(pc, GraphState_WorldX(graph, left).hi, GraphState_WorldX(graph, right).hi,
+                     GraphState_WorldY(graph, bottom).hi, GraphState_WorldY(graph, top).hi, POINT_BIN / graph->scale, &scratch->marks);
+    const PointMarks* marks = &scratch->marks;
+
+    if (marks->points <= POINT_LABELS) {
+        for (int i = 0; i < marks->count; i++) {
+            const PointMark* m = &marks->items[i];
+            Vector2 at = Graph_ToScreen(graph, GraphState_ViewX(graph, m->x), GraphState_ViewY(graph, m->y), width, height);
+            DrawCircleV(at, 5, color);
+            DrawCircleLines(at.x, at.y, 5, ink);
+            if (m->count == 1) DrawText(TextFormat("(%.2f, %.2f)", m->x, m->y), at.x + 8, at.y - 10, 10, ink);
+            else DrawText(TextFormat("%d points", m->count), at.x + 8, at.y - 10, 10, ink);
+        }
+        return;
+    }
+
+    int columns = width / POINT_BIN + 1, rows = height / POINT_BIN + 1;
+    if (scratch->binCapacity < columns * rows) {
+        float* grown = (float*)realloc(scratch->bins, (size_t)columns * rows * sizeof(float));
+        if (!grown) return;
+        scratch->bins = grown;
+        scratch->binCapacity = columns * rows;
+    }
+    memset(scratch->bins, 0, (size_t)columns * rows * sizeof(float));
+    float most = 0;
+    for (int i = 0; i < marks->count; i++) {
+        const PointMark* m = &marks->items[i];
+        Vector2 at = Graph_ToScreen(graph, GraphState_ViewX(graph, m->x), GraphState_ViewY(graph, m->y), width, height);
+        if (at.x < 0 || at.y < 0 || at.x >= width || at.y >= height) continue;
+        float* bin = &scratch->bins[(int)at.y / POINT_BIN * columns + (int)at.x / POINT_BIN];
+        *bin += (float)m->count;
+        if (*bin > most) most = *bin;
+    }
+    // a lone point still shows, the densest bin is solid
+    float norm = 1.0f / logf(1.0f + most);
+    const int perBatch = 1024;
+    int inBatch = 0;
+    for (int y = 0; y < rows; y++) {
+        for (int x = 0; x < columns; x++) {
+            float n = scratch->bins[y * columns + x];
+            if (n == 0) continue;
+            if (inBatch == 0) {
+                rlCheckRenderBatchLimit(4 * perBatch);
+                rlBegin(RL_QUADS);
+            }
+            float alpha = 0.25f + 0.75f * logf(1.0f + n) * norm;
+            rlColor4ub(color.r, color.g, color.b, (unsigned char)(255 * alpha));
+            float x0 = (float)(x * POINT_BIN), y0 = (float)(y * POINT_BIN);
+            rlVertex2f(x0, y0);
+            rlVertex2f(x0, y0 + POINT_BIN);
+            rlVertex2f(x0 + POINT_BIN, y0 + POINT_BIN);
+            rlVertex2f(x0 + POINT_BIN, y0);
+            if (++inBatch == perBatch) {
+                rlEnd();
+                inBatch = 0;
+            }
+        }
+    }
+    if (inBatch > 0) rlEnd();
+}
 
-int main(void) {
+// a least squares fit of the points into the selected equation when it's empty, the empty
+// last one otherwise, so the fit is parsed and plotted like anything typed. status says how it went
+static void FitEquation(EquationList* list, int active, const PointCloud* pc, FitKind kind, int degree, ThreadPool* pool, char* status, int statusSize) {
+    Fit fit;
+    if (pc->count == 0) {
+        snprintf(status, statusSize, "no points to fit, load some or ctrl + click");
+        return;
+    }
+    if (!Fit_Points(&fit, kind, degree, pc, pool)) {
+        if (kind == FIT_EXPONENTIAL) snprintf(status, statusSize, "an exponential needs two xs with y > 0");
+        else snprintf(status, statusSize, "degree %d needs %d distinct xs", degree, degree + 1);
+        return;
+    }
+    Equation* eq = &list->items[active];
+    if (eq->input.letterCount > 0) eq = &list->items[list->count - 1];
+    Fit_Format(&fit, eq->input.text, MAX_INPUT_CHARS);
+    eq->input.letterCount = (int)strlen(eq->input.text);
+    eq->dirty = true;
+    eq->visible = true;
+    snprintf(status, statusSize, "fit of %lld points, r2 = %.6f", (long long)fit.used, fit.r2);
+    // the last row has to stay empty
+    if (list->items[list->count - 1].input.letterCount > 0) AddEquation(list, "");
+}
+
+// rolling percentiles of every stage and every equation's share, top right
+static void DrawProfiler(const Equation* equations, int count, int screenWidth) {
+    const int lineHeight = 14;
+    int x = screenWidth - 330, y = 10;
+    // equations past the last row share it, like they share its slot in the profiler
+    int rows = count < PROFILE_MAX_ITEMS ? count : PROFILE_MAX_ITEMS;
+    int lines = 2 + PROFILE_STAGE_COUNT + 1 + rows;
+    DrawRectangle(x - 8, y - 6, 328, lines * lineHeight + 12, Fade(BLACK, 0.75f));
+    DrawText(TextFormat("%-8s %7s %7s %7s", "ms", "p50", "p95", "max"), x, y, 10, YELLOW);
+    y += lineHeight;
+    for (int stage = 0; stage < PROFILE_STAGE_COUNT; stage++) {
+        ProfileStats st;
+        if (!Profiler_Stats(&profiler, (ProfileStage)stage, -1, &st)) continue;
+        DrawText(TextFormat("%-8s %7.2f %7.2f %7.2f", Profiler_StageName((ProfileStage)stage), st.p50, st.p95, st.max), x, y, 10, WHITE);
+        y += lineHeight;
+    }
+    y += lineHeight / 2;
+    DrawText(TextFormat("%-6s %7s %7s %9s %6s %8s", "eq", "sample", "p95", "evals", "draws", "tris"), x, y, 10, YELLOW);
+    y += lineHeight;
+    for (int i = 0; i < rows; i++) {
+        const Equation* eq = &equations[i];
+        ProfileStats sample, shade, curves;
+        bool sampled = Profiler_Stats(&profiler, PROFILE_SAMPLE, eq->id, &sample);
+        bool shaded = Profiler_Stats(&profiler, PROFILE_SHADE, eq->id, &shade);
+        bool drawn = Profiler_Stats(&profiler, PROFILE_CURVES, eq->id, &curves);
+        if (!sampled && !drawn) continue;
+        float draws = (shaded ? shade.counters[PROFILE_DRAW_CALLS] : 0) + (drawn ? curves.counters[PROFILE_DRAW_CALLS] : 0);
+        float tris = (shaded ? shade.counters[PROFILE_TRIANGLES] : 0) + (drawn ? curves.counters[PROFILE_TRIANGLES] : 0);
+        const char* label = (i == PROFILE_MAX_ITEMS - 1 && count > PROFILE_MAX_ITEMS) ? TextFormat("%d+", i + 1) : TextFormat("%d", i + 1);
+        DrawText(TextFormat("%-6s %7.2f %7.2f %9.0f %6.0f %8.0f", label, sampled ? sample.p50 : 0.0f, sampled ? sample.p95 : 0.0f,
+                            shaded ? shade.counters[PROFILE_SAMPLES] : 0.0f, draws, tris), x, y, 10, eq->color);
+        y += lineHeight;
+    }
+}
+
+// graph_calc [file] starts with the equations in file, one per line, instead of the last
+// session's. .csv and .bin files are point clouds instead, see PointCloud_Load
+int main(int argc, char** argv) {
     int screenWidth = 800;
     int screenHeight = 600;
 
@@ -95,71 +367,116 @@ int main(void) {
     Font font = LoadFontEx("C:\\Windows\\Fonts\\arial.ttf", 32, 0, 250);
     if (font.texture.id == 0) font = GetFontDefault();
 
-    Equation equations[MAX_EQUATIONS];
-    Color colors[MAX_EQUATIONS] = { RED, BLUE, GREEN, PURPLE, ORANGE };
-
-    for (int i = 0; i < MAX_EQUATIONS; i++) {
-        equations[i].input = (InputField){ 
-            .rect = { 10, 10 + i * 50, 300, 40 }, 
-            .focused = (i == 0), 
-            .letterCount = 0 
-        };
-        equations[i].color = colors[i];
-        equations[i].visible = true;
-        equations[i].parsedExpr[0] = '\0';
-        equations[i].input.text[0] = '\0';
-        equations[i].lastInput[0] = '\0';
-        equations[i].ast = NULL;
+    // the render thread takes part in every batch, so a 1 core machine gets no pool at all
+    ThreadPool* pool = Pool_Create(0);
+    PoolTask* tasks = NULL;
+    int taskCapacity = 0;
+    Profiler_Init(&profiler, Pool_WorkerCount(pool));
+    // roots, extrema and intersections, found on a thread of their own and drawn as they come
+    Solver* solver = Solver_Create();
+    static SolvePoint solved[SOLVER_MAX_POINTS];
+    int solvedCount = 0;
+
+    // dropped with ctrl + click, and loaded from files given or dropped on the window
+    PointCloud dropped, loaded;
+    PointCloud_Init(&dropped);
+    PointCloud_Init(&loaded);
+    PointScratch pointScratch = { 0 };
+    const char* equationFile = "history.txt";
+    for (int i = 1; i < argc; i++) {
+        if (!IsPointFile(argv[i])) equationFile = argv[i];
+        else if (PointCloud_Load(&loaded, argv[i], pool) < 0) TraceLog(LOG_WARNING, "can't read points from %s", argv[i]);
     }
-    
-    // Initial equation
+    PointCloud_Build(&loaded);
+    FramePoints(&graph, &loaded, screenWidth, screenHeight);
+
+    EquationList list = { 0 };
     // Load from history if available, otherwise default
-    LoadEquations(equations, MAX_EQUATIONS, "history.txt");
-    if (equations[0].input.letterCount == 0) {
-        strcpy(equations[0].input.text, "x^2");
-        equations[0].input.letterCount = strlen(equations[0].input.text);
-    }
+    LoadEquations(&list, equationFile);
+    if (list.count == 0) AddEquation(&list, "x^2");
+    AddEquation(&list, "");
     
     int activeEqIndex = 0;
+    int solverFocus = 0; // the active equation the solver was last given
+    // F6 fits one degree more every press
+    int fitDegree = 1;
+    char fitStatus[128] = "";
 
     Keyboard kb;
     InitKeyboard(&kb, screenWidth, screenHeight);
 
     SetTargetFPS(60);
 
-    // Dropped Points
-    #define MAX_POINTS 100
-    Vector2 droppedPoints[MAX_POINTS];
-    int droppedPointCount = 0;
+    // grid, shading, curves and points, drawn again only when dirty
+    RenderTexture2D scene = LoadRenderTexture(screenWidth, screenHeight);
+    int dirty = DIRTY_INPUT | DIRTY_VIEW;
+
+    // the timeline over the equations, t drives animated equations
+    float t = 0.0f;
+    float sceneT = 0.0f; // what the scene layer was drawn for
+    bool playing = false;
+    Button playButton = { .rect = { 10, 10, 70, 30 }, .color = WHITE, .hoverColor = LIGHTGRAY, .textColor = BLACK };
+    Rectangle timeSlider = { 100, playButton.rect.y + 10, 200, 10 };
+    // the sidebar, drags that start here don't pan and the wheel scrolls it instead of zooming
+    Rectangle panel = { 0, 0, SIDEBAR_WIDTH, (float)screenHeight };
+    SolverInput* solverInputs = NULL;
+    int solverInputCapacity = 0;
 
     while (!WindowShouldClose()) {
+        double frameStart = Profiler_Now(&profiler);
         if (IsWindowResized()) {
             screenWidth = GetScreenWidth();
             screenHeight = GetScreenHeight();
             ResizeKeyboard(&kb, screenWidth, screenHeight);
+            panel.height = (float)screenHeight;
+            UnloadRenderTexture(scene);
+            scene = LoadRenderTexture(screenWidth, screenHeight);
+            dirty |= DIRTY_VIEW;
+        }
+
+        // the list under the timeline, down to the hint at the bottom. only rows in view are
+        // laid out, handled and drawn, however many equations there are
+        float listHeight = screenHeight - LIST_TOP - 30.0f;
+        float wheel = GetMouseWheelMove();
+        if (wheel != 0 && CheckCollisionPointRec(GetMousePosition(), panel)) {
+            list.scroll -= wheel * ROW_HEIGHT;
+            wheel = 0;
         }
+        ClampScroll(&list, listHeight);
+        LayoutRows(&list, listHeight);
+        int firstRow, lastRow;
+        VisibleRows(&list, listHeight, &firstRow, &lastRow);
 
         // Handle Mouse Clicks to switch focus
-        if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
+        if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT) && GetMousePosition().y >= LIST_TOP && GetMousePosition().y < LIST_TOP + listHeight) {
             Vector2 mouse = GetMousePosition();
-            for (int i = 0; i < MAX_EQUATIONS; i++) {
-                if (CheckCollisionPointRec(mouse, equations[i].input.rect)) {
+            for (int i = firstRow; i < lastRow; i++) {
+                Equation* eq = &list.items[i];
+                if (CheckCollisionPointRec(mouse, eq->input.rect)) {
+                    list.items[activeEqIndex].input.focused = false;
                     activeEqIndex = i;
                 }
+                if (CheckCollisionPointRec(mouse, SwatchRect(eq))) {
+                    eq->visible = !eq->visible;
+                    dirty |= DIRTY_VISIBLE;
+                }
             }
         }
 
         // Update Focus
-        for (int i = 0; i < MAX_EQUATIONS; i++) {
-            equations[i].input.focused = (i == activeEqIndex);
+        list.items[activeEqIndex].input.focused = true;
+        if (activeEqIndex != solverFocus) {
+            solverFocus = activeEqIndex;
+            dirty |= DIRTY_FOCUS;
         }
 
         // Update Active Input
-        InputField* currentInput = &equations[activeEqIndex].input;
-        UpdateInputField(currentInput);
+        InputField* currentInput = &list.items[activeEqIndex].input;
+        bool edited = UpdateInputField(currentInput);
         
         const char *kbKey = UpdateKeyboard(&kb);
         if (kbKey != NULL) {
+            edited = true;
             if (strcmp(kbKey, "C") == 0) {
                 currentInput->text[0] = '\0';
                 currentInput->letterCount = 0;
@@ -179,147 +496,326 @@ int main(void) {
             }
         }
 
+        if (edited) {
+            list.items[activeEqIndex].dirty = true;
+            dirty |= DIRTY_INPUT;
+            // typing into the empty row at the end makes another one
+            if (activeEqIndex == list.count - 1 && currentInput->letterCount > 0) AddEquation(&list, "");
+        }
+
         if (IsKeyPressed(KEY_K)) kb.visible = !kb.visible;
+        if (IsKeyPressed(KEY_F2)) Profiler_SetEnabled(&profiler, !profiler.enabled);
+        if (IsKeyPressed(KEY_F3) && !Profiler_WriteTrace(&profiler, "trace.json")) {
+            TraceLog(LOG_WARNING, "no trace.json, F2 starts the profiler");
+        }
+        // fits of the loaded points, or the dropped ones when nothing is loaded
+        if (IsKeyPressed(KEY_F5) || IsKeyPressed(KEY_F6) || IsKeyPressed(KEY_F7)) {
+            const PointCloud* data = loaded.count > 0 ? &loaded : &dropped;
+            if (IsKeyPressed(KEY_F5)) FitEquation(&list, activeEqIndex, data, FIT_POLYNOMIAL, 1, pool, fitStatus, sizeof(fitStatus));
+            if (IsKeyPressed(KEY_F6)) {
+                fitDegree = fitDegree % FIT_MAX_DEGREE + 1;
+                if (fitDegree == 1) fitDegree = 2;
+                FitEquation(&list, activeEqIndex, data, FIT_POLYNOMIAL, fitDegree, pool, fitStatus, sizeof(fitStatus));
+            }
+            if (IsKeyPressed(KEY_F7)) FitEquation(&list, activeEqIndex, data, FIT_EXPONENTIAL, 1, pool, fitStatus, sizeof(fitStatus));
+            dirty |= DIRTY_INPUT;
+        }
         
         // handle Tab to cycle equations
         if (IsKeyPressed(KEY_TAB)) {
-            activeEqIndex = (activeEqIndex + 1) % MAX_EQUATIONS;
+            list.items[activeEqIndex].input.focused = false;
+            activeEqIndex = (activeEqIndex + 1) % list.count;
+            list.items[activeEqIndex].input.focused = true;
+            // scrolled into view
+            float rowTop = activeEqIndex * ROW_HEIGHT;
+            if (rowTop < list.scroll) list.scroll = rowTop;
+            if (rowTop + ROW_HEIGHT > list.scroll + listHeight) list.scroll = rowTop + ROW_HEIGHT - listHeight;
+        }
+
+        // point files dropped on the window join the loaded ones, framed when they're the first
+        if (IsFileDropped()) {
+            FilePathList files = LoadDroppedFiles();
+            bool first = loaded.count == 0;
+            for (unsigned int i = 0; i < files.count; i++) {
+                if (!IsPointFile(files.paths[i]) || PointCloud_Load(&loaded, files.paths[i], pool) < 0) {
+                    TraceLog(LOG_WARNING, "can't read points from %s", files.paths[i]);
+                }
+            }
+            UnloadDroppedFiles(files);
+            if (!loaded.indexed) {
+                PointCloud_Build(&loaded);
+                if (first) FramePoints(&graph, &loaded, screenWidth, screenHeight);
+                dirty |= DIRTY_POINTS | DIRTY_VIEW;
+            }
         }
 
         // Zoom & Pan
         // Handle Point Dropping: Ctrl + Left Click
         if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT) && IsKeyDown(KEY_LEFT_CONTROL)) {
-             if (droppedPointCount < MAX_POINTS && !CheckCollisionPointRec(GetMousePosition(), (Rectangle){0,0,320, 50*MAX_EQUATIONS})) {
+             if (!CheckCollisionPointRec(GetMousePosition(), panel)) {
                  Vector2 mousePos = GetMousePosition();
-                 Vector2 worldPos = Graph_ToCartesian(&graph, mousePos, screenWidth, screenHeight);
-                 droppedPoints[droppedPointCount++] = worldPos;
+                 double x, y;
+                 Graph_ToView(&graph, mousePos, screenWidth, screenHeight, &x, &y);
+                 PointCloud_Add(&dropped, GraphState_WorldX(&graph, x).hi, GraphState_WorldY(&graph, y).hi);
+                 PointCloud_Build(&dropped);
+                 dirty |= DIRTY_POINTS;
              }
         }
-        else if (IsMouseButtonDown(MOUSE_BUTTON_RIGHT) || (IsMouseButtonDown(MOUSE_BUTTON_LEFT) && !CheckCollisionPointRec(GetMousePosition(), (Rectangle){0,0,320, 50*MAX_EQUATIONS}))) {
+        else if (IsMouseButtonDown(MOUSE_BUTTON_RIGHT) || (IsMouseButtonDown(MOUSE_BUTTON_LEFT) && !CheckCollisionPointRec(GetMousePosition(), panel))) {
              bool clickedInput = false;
-             for(int i=0; i<MAX_EQUATIONS; i++) {
-                 if (CheckCollisionPointRec(GetMousePosition(), equations[i].input.rect)) clickedInput = true;
+             for (int i = firstRow; i < lastRow; i++) {
+                 if (CheckCollisionPointRec(GetMousePosition(), list.items[i].input.rect)) clickedInput = true;
              }
              
-             if (!clickedInput || IsMouseButtonDown(MOUSE_BUTTON_RIGHT)) {
-                Vector2 delta = GetMouseDelta();
+             Vector2 delta = GetMouseDelta();
+             if ((!clickedInput || IsMouseButtonDown(MOUSE_BUTTON_RIGHT)) && (delta.x != 0 || delta.y != 0)) {
                 graph.centerX -= delta.x / graph.scale;
                 graph.centerY += delta.y / graph.scale; 
+                dirty |= DIRTY_VIEW;
              }
         }
 
-        float wheel = GetMouseWheelMove();
         if (wheel != 0) {
             Vector2 mousePos = GetMousePosition();
-            Vector2 mouseWorldBefore = Graph_ToCartesian(&graph, mousePos, screenWidth, screenHeight);
+            double beforeX, beforeY;
+            Graph_ToView(&graph, mousePos, screenWidth, screenHeight, &beforeX, &beforeY);
             
             float scaleFactor = 1.1f;
             if (wheel > 0) graph.scale *= scaleFactor;
             else graph.scale /= scaleFactor;
             
             // adjust center so that mouseWorld remains under mousePos
-            Vector2 mouseWorldAfter = Graph_ToCartesian(&graph, mousePos, screenWidth, screenHeight);
-            graph.centerX += (mouseWorldBefore.x - mouseWorldAfter.x);
-            graph.centerY += (mouseWorldBefore.y - mouseWorldAfter.y);
+            double afterX, afterY;
+            Graph_ToView(&graph, mousePos, screenWidth, screenHeight, &afterX, &afterY);
+            graph.centerX += (beforeX - afterX);
+            graph.centerY += (beforeY - afterY);
+            dirty |= DIRTY_VIEW;
+        }
+        // deep enough in and the view measures from an origin of its own, see GraphState_Recenter
+        if (GraphState_Recenter(&graph)) dirty |= DIRTY_VIEW;
+
+        if (CheckButton(&playButton)) playing = !playing;
+        if (playing) {
+            // the first frame after a wait for events would jump by the whole wait
+            float dt = GetFrameTime();
+            t += dt < 0.1f ? dt : 0.1f;
+            if (t > TIMELINE_END) t -= TIMELINE_END;
+        }
+        if (t != sceneT && ReadsT(list.items, list.count)) dirty |= DIRTY_TIME;
+
+        // only what's dirty gets parsed, sampled and drawn, into the scene layer
+        if (dirty) {
+            for (int eqIdx = 0; eqIdx < list.count; eqIdx++) {
+                Equation* eq = &list.items[eqIdx];
+                if (!eq->dirty) continue;
+                double start = Profiler_Now(&profiler);
+                Figure_SetText(&eq->figure, eq->input.text);
+                eq->dirty = false;
+                Profiler_Record(&profiler, PROFILE_PARSE, eq->id, 0, start);
+            }
+            sceneT = t;
+
+            BeginTextureMode(scene);
+            ClearBackground(RAYWHITE);
+
+            double start = Profiler_Now(&profiler);
+            Graph_DrawGrid(&graph, screenWidth, screenHeight);
+            Profiler_Record(&profiler, PROFILE_GRID, -1, 0, start);
+
+            // equations that don't read t keep their curves while it plays, see SampleCache_Begin
+            EvalContext ctx;
+            ctx.y = 0;
+            ctx.t = t;
+
+            // plan every update first and run them as one batch, so the threads share all the work
+            start = Profiler_Now(&profiler);
+            int taskCount = 0;
+            for (int eqIdx = 0; eqIdx < list.count; eqIdx++) {
+                Equation* eq = &list.items[eqIdx];
+                Figure_SetOrigin(&eq->figure, graph.originX, graph.originY);
+                // the ones that can't reach the view aren't sampled at all
+                eq->onScreen = eq->input.letterCount > 0 && eq->visible &&
+                    Figure_MayShow(&eq->figure, &ctx, graph.scale, graph.centerX, graph.centerY, screenWidth, screenHeight);
+                if (!eq->onScreen) continue;
+
+                int n = Figure_Begin(&eq->figure, &ctx, graph.scale, graph.centerX, graph.centerY, screenWidth, screenHeight);
+                QueueTasks(&tasks, &taskCount, &taskCapacity, SampleTask, eq, n);
+            }
+            Pool_Run(pool, tasks, taskCount);
+            Profiler_Record(&profiler, PROFILE_SAMPLE, -1, 0, start);
+
+            // shade every inequality before any curve goes on top
+            start = Profiler_Now(&profiler);
+            for (int eqIdx = 0; eqIdx < list.count; eqIdx++) {
+                Equation* eq = &list.items[eqIdx];
+                if (!eq->onScreen || Figure_IsEmpty(&eq->figure)) continue;
+
+                double eqStart = Profiler_Now(&profiler);
+                Figure_End(&eq->figure);
+                int batches = DrawTriangles(eq->figure.shading.xy, eq->figure.shading.count, Fade(eq->color, 0.3f));
+                Profiler_Record(&profiler, PROFILE_SHADE, eq->id, 0, eqStart);
+                const Figure* fig = &eq->figure;
+                int evaluated = fig->implicit ? fig->implicitPlot.evaluated : fig->samples.evaluated;
+                if (fig->param != PARAM_NONE) evaluated = fig->paramCurve.evaluated;
+                Profiler_Count(&profiler, PROFILE_SHADE, PROFILE_SAMPLES, eq->id, evaluated);
+                Profiler_Count(&profiler, PROFILE_SHADE, PROFILE_DRAW_CALLS, eq->id, batches);
+                Profiler_Count(&profiler, PROFILE_SHADE, PROFILE_TRIANGLES, eq->id, fig->shading.count / 3);
+            }
+            Profiler_Record(&profiler, PROFILE_SHADE, -1, 0, start);
+
+            // one triangle batch per curve, clipped to the view and broken at jumps and poles
+            start = Profiler_Now(&profiler);
+            for (int eqIdx = 0; eqIdx < list.count; eqIdx++) {
+                Equation* eq = &list.items[eqIdx];
+                if (!eq->onScreen || Figure_IsEmpty(&eq->figure)) continue;
+                double eqStart = Profiler_Now(&profiler);
+                int batches = DrawTriangles(eq->figure.stroke.xy, eq->figure.stroke.count, eq->color);
+                Profiler_Record(&profiler, PROFILE_CURVES, eq->id, 0, eqStart);
+                Profiler_Count(&profiler, PROFILE_CURVES, PROFILE_DRAW_CALLS, eq->id, batches);
+                Profiler_Count(&profiler, PROFILE_CURVES, PROFILE_TRIANGLES, eq->id, eq->figure.stroke.count / 3);
+            }
+            Profiler_Record(&profiler, PROFILE_CURVES, -1, 0, start);
+
+            // whatever the solver was doing is out of date now
+            if ((dirty & ~DIRTY_POINTS) && ReserveSolverInputs(&solverInputs, &solverInputCapacity, list.capacity)) {
+                for (int eqIdx = 0; eqIdx < list.count; eqIdx++) {
+                    const Equation* eq = &list.items[eqIdx];
+                    // the solver works in plain doubles, which can't tell the points of a deep view apart
+                    bool solve = eq->onScreen && !Figure_IsEmpty(&eq->figure) && Figure_IsFunction(&eq->figure) &&
+                                 !GraphState_IsDeep(&graph);
+                    solverInputs[eqIdx] = (SolverInput){ eq->input.text, solve ? &eq->figure.samples.curve : NULL, eqIdx == activeEqIndex };
+                }
+                double left, top, right, bottom;
+                Graph_ToView(&graph, (Vector2){ 0, 0 }, screenWidth, screenHeight, &left, &top);
+                Graph_ToView(&graph, (Vector2){ (float)screenWidth, (float)screenHeight }, screenWidth, screenHeight, &right, &bottom);
+                SolverView view = { left, right, bottom, top };
+                Solver_Submit(solver, solverInputs, list.count, &view, &ctx);
+            }
+
+            // Draw Points
+            DrawPoints(&loaded, &pointScratch, &graph, screenWidth, screenHeight, DARKGRAY, BLACK);
+            DrawPoints(&dropped, &pointScratch, &graph, screenWidth, screenHeight, BLUE, DARKBLUE);
+            EndTextureMode();
+            dirty = 0;
         }
 
         // draw
         BeginDrawing();
-        ClearBackground(RAYWHITE);
-
-        Graph_DrawGrid(&graph, screenWidth, screenHeight);
-        
-        // Plot Functions
-        EvalContext ctx;
-        ctx.y = 0; 
-        ctx.t = 0; // Default time to 0
-
-
-        for (int eqIdx = 0; eqIdx < MAX_EQUATIONS; eqIdx++) {
-            Equation* eq = &equations[eqIdx];
-            if (eq->input.letterCount == 0) continue;
-
-            ParseEquation(eq);
-            
-            // Optimization: If expr is empty or ast is null, skip
-            if (!eq->ast) continue;
+        // copied without blending, the layer's alpha is whatever the shading left in it.
+        // render textures are stored bottom up
+        rlDrawRenderBatchActive();
+        rlDisableColorBlend();
+        DrawTextureRec(scene.texture, (Rectangle){ 0, 0, (float)scene.texture.width, (float)-scene.texture.height }, (Vector2){ 0, 0 }, WHITE);
+        rlDrawRenderBatchActive();
+        rlEnableColorBlend();
 
-            Color plotColor = eq->color;
-            Color shadeColor = Fade(plotColor, 0.3f);
+        double uiStart = Profiler_Now(&profiler);
 
-            Vector2 prevPoint = { 0, 0 };
-            bool first = true;
-            
-            for (int i = 0; i < screenWidth; i++) {
-                // High precision conversion for infinite zoom
-                double worldX = ((double)i - screenWidth / 2.0) / graph.scale + graph.centerX;
-                
-                ctx.x = worldX;
-                double val = AST_Evaluate(eq->ast, &ctx);
-                
-                // Convert value back to screen coordinates manually for precision intermediate
-                // screenY = height/2 - (val - centerY) * scale
-                double screenY = (double)screenHeight / 2.0 - (val - graph.centerY) * graph.scale;
-                
-                Vector2 screenPoint = { (float)i, (float)screenY };
-                
-                if (!isnan(val) && !isinf(val)) {
-                    // Shading
-                    if (eq->rel == REL_LT || eq->rel == REL_LE) {
-                        // y < val => Screen Y > screenY
-                        DrawLine(i, (int)screenY, i, screenHeight, shadeColor);
-                    } else if (eq->rel == REL_GT || eq->rel == REL_GE) {
-                        // y > val => Screen Y < screenY
-                        DrawLine(i, 0, i, (int)screenY, shadeColor);
-                    }
-
-                    // Line Drawing
-                    if (!first) {
-                         // Check for large jumps (asymptotes)
-                        if (fabs(screenPoint.y - prevPoint.y) < screenHeight) {
-                             DrawLineEx(prevPoint, screenPoint, 2.0f, plotColor);
-                        }
-                    }
+        // Hover Coordinates
+        Vector2 mousePos = GetMousePosition();
+        if (mousePos.x > SIDEBAR_WIDTH) { // If not over sidebar (roughly)
+            double viewX, viewY;
+            Graph_ToView(&graph, mousePos, screenWidth, screenHeight, &viewX, &viewY);
+            DrawText(TextFormat("(%.2f, %.2f)", GraphState_WorldX(&graph, viewX).hi, GraphState_WorldY(&graph, viewY).hi),
+                     mousePos.x + 15, mousePos.y + 15, 20, DARKGRAY);
+
+            // shift shows the tangent of the active curve at the mouse's x, slope from dual numbers
+            const Equation* eq = &list.items[activeEqIndex];
+            if (IsKeyDown(KEY_LEFT_SHIFT) && eq->visible && !Figure_IsEmpty(&eq->figure) && Figure_IsFunction(&eq->figure)) {
+                // the figure's expression already measures from the view's origin, both ways
+                EvalContext ctx = { viewX, 0.0, sceneT };
+                double slope;
+                double y = Expr_EvaluateDual(&eq->figure.expr, &ctx, &slope);
+                if (isfinite(y) && isfinite(slope)) {
+                    // across the whole screen, x from the left edge to the right
+                    double halfWidth = screenWidth / graph.scale;
+                    Vector2 from = Graph_ToScreen(&graph, viewX - halfWidth, y - slope * halfWidth, screenWidth, screenHeight);
+                    Vector2 to = Graph_ToScreen(&graph, viewX + halfWidth, y + slope * halfWidth, screenWidth, screenHeight);
+                    Vector2 at = Graph_ToScreen(&graph, viewX, y, screenWidth, screenHeight);
+                    DrawLineEx(from, to, 1.0f, Fade(eq->color, 0.7f));
+                    DrawCircleV(at, 4, eq->color);
+                    DrawText(TextFormat("slope %.4g", slope), at.x + 8, at.y + 8, 10, DARKGRAY);
                 }
-                
-                prevPoint = screenPoint;
-                first = false;
             }
         }
 
-        // Draw Dropped Points
-        for (int i = 0; i < droppedPointCount; i++) {
-            Vector2 screenPos = Graph_ToScreen(&graph, droppedPoints[i], screenWidth, screenHeight);
-            DrawCircleV(screenPos, 5, BLUE);
-            DrawCircleLines(screenPos.x, screenPos.y, 5, DARKBLUE);
-            DrawText(TextFormat("(%.2f, %.2f)", droppedPoints[i].x, droppedPoints[i].y), screenPos.x + 8, screenPos.y - 10, 10, DARKBLUE);
-        }
-
-        // Hover Coordinates
-        Vector2 mousePos = GetMousePosition();
-        if (mousePos.x > 320) { // If not over sidebar (roughly)
-            Vector2 worldPos = Graph_ToCartesian(&graph, mousePos, screenWidth, screenHeight);
-            DrawText(TextFormat("(%.2f, %.2f)", worldPos.x, worldPos.y), mousePos.x + 15, mousePos.y + 15, 20, DARKGRAY);
+        // what the solver has found so far, named when the mouse is close
+        Solver_Fetch(solver, solved, SOLVER_MAX_POINTS, &solvedCount);
+        for (int i = 0; i < solvedCount; i++) {
+            const SolvePoint* pt = &solved[i];
+            Vector2 at = Graph_ToScreen(&graph, pt->x, pt->y, screenWidth, screenHeight);
+            Color color = (pt->kind == SOLVE_INTERSECTION) ? DARKGRAY : list.items[pt->a].color;
+            DrawCircleLines(at.x, at.y, 4, color);
+            if (CheckCollisionPointCircle(mousePos, at, 8)) {
+                DrawCircleV(at, 4, color);
+                DrawText(TextFormat("%s (%.4g, %.4g)", Solver_KindName(pt->kind), pt->x, pt->y), at.x + 8, at.y - 18, 10, DARKGRAY);
+            }
         }
 
         // UI
         // Draw sidebar background
-        DrawRectangle(0, 0, 320, screenHeight, Fade(LIGHTGRAY, 0.5f)); // Extend sidebar background to full height
+        DrawRectangleRec(panel, Fade(LIGHTGRAY, 0.5f));
         
-        for (int i = 0; i < MAX_EQUATIONS; i++) {
-             DrawInputField(&equations[i].input, font);
-             // Draw color indicator
-             DrawRectangle(equations[i].input.rect.x + equations[i].input.rect.width + 5, equations[i].input.rect.y, 10, 40, equations[i].color);
+        // rows half scrolled out are cut at the edges of the list
+        BeginScissorMode(0, LIST_TOP, SIDEBAR_WIDTH, (int)listHeight);
+        for (int i = firstRow; i < lastRow; i++) {
+             Equation* eq = &list.items[i];
+             DrawInputField(&eq->input, font);
+             // color indicator, hollow while the equation is hidden
+             Rectangle swatch = SwatchRect(eq);
+             if (eq->visible) DrawRectangleRec(swatch, eq->color);
+             else DrawRectangleLinesEx(swatch, 2, eq->color);
+             // in the gap under the field, the equation itself draws nothing
+             const char* error = Figure_Error(&eq->figure);
+             if (error) DrawTextEx(font, error, (Vector2){ eq->input.rect.x + 4, eq->input.rect.y + eq->input.rect.height }, 10, 1, RED);
+        }
+        EndScissorMode();
+        // where the view is in the whole list, once it doesn't fit
+        float contentHeight = (float)list.count * ROW_HEIGHT;
+        if (contentHeight > listHeight) {
+            float barHeight = listHeight * listHeight / contentHeight;
+            float barTop = LIST_TOP + (listHeight - barHeight) * list.scroll / (contentHeight - listHeight);
+            DrawRectangleRec((Rectangle){ SIDEBAR_WIDTH - 6, barTop, 4, barHeight }, Fade(DARKGRAY, 0.5f));
         }
 
+        playButton.text = playing ? "Pause" : "Play";
+        DrawButton(&playButton, font);
+        DrawSlider(timeSlider, TextFormat("t = %.2f", t), &t, 0.0f, TIMELINE_END, font);
+
         DrawKeyboard(&kb, font);
         
         DrawTextEx(font, "Press 'K' to toggle keyboard", (Vector2){ 10, (float)screenHeight - 20 }, 10, 2, DARKGRAY);
-
+        if (fitStatus[0]) DrawTextEx(font, fitStatus, (Vector2){ SIDEBAR_WIDTH + 10, (float)screenHeight - 20 }, 10, 2, DARKGRAY);
+        Profiler_Record(&profiler, PROFILE_UI, -1, 0, uiStart);
+
+        if (profiler.enabled) DrawProfiler(list.items, list.count, screenWidth);
+        Profiler_Record(&profiler, PROFILE_FRAME, -1, 0, frameStart);
+        Profiler_EndFrame(&profiler);
+
+        // sleep in EndDrawing until there's input, unless t is moving or the solver still has
+        // points to come. a drag of the slider above changed t after the scene was drawn, so
+        // that takes one more frame
+        if (playing || (t != sceneT && ReadsT(list.items, list.count)) || Solver_IsBusy(solver)) DisableEventWaiting();
+        else EnableEventWaiting();
         EndDrawing();
     }
 
-    SaveEquations(equations, MAX_EQUATIONS, "history.txt");
+    SaveEquations(&list, "history.txt");
+    UnloadRenderTexture(scene);
+
+    for (int i = 0; i < list.count; i++) {
+        Figure_Free(&list.items[i].figure);
+    }
+    free(list.items);
+    PointCloud_Free(&dropped);
+    PointCloud_Free(&loaded);
+    PointMarks_Free(&pointScratch.marks);
+    free(pointScratch.bins);
+    free(solverInputs);
+    free(tasks);
+    Solver_Destroy(solver);
+    Profiler_Free(&profiler);
+    Pool_Destroy(pool);
 
     UnloadFont(font);
     CloseWindow();
@@ -0,0 +1,281 @@
+#include "optimizer.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+
+typedef struct {
+    AST* ast;
+    NodeIndex count;   // nodes written so far, always <= the node being read
+    NodeIndex* table;  // open addressing hash of written nodes
+    uint32_t tableMask;
+} OptimizerState;
+
+static uint64_t DoubleBits(double v) {
+    uint64_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    return bits;
+}
+
+uint64_t AST_HashNode(const ASTNode* n) {
+    uint64_t h = (uint64_t)n->type * 0x9E3779B97F4A7C15ULL;
+    h ^= ((uint64_t)n->op << 8) | ((uint64_t)n->func << 16);
+    switch (n->type) {
+        case NODE_NUMBER: h ^= DoubleBits(n->data.number); break;
+        case NODE_VARIABLE: h ^= n->data.var; break;
+        default: h ^= ((uint64_t)n->data.binary.left << 32) | n->data.binary.right; break;
+    }
+    h ^= h >> 29;
+    h *= 0xBF58476D1CE4E5B9ULL;
+    h ^= h >> 32;
+    return h;
+}
+
+bool AST_SameNode(const ASTNode* a, const ASTNode* b) {
+    if (a->type != b->type || a->op != b->op || a->func != b->func) return false;
+    switch (a->type) {
+        case NODE_NUMBER: return DoubleBits(a->data.number) == DoubleBits(b->data.number); // keeps -0 and NaN payloads apart
+        case NODE_VARIABLE: return a->data.var == b->data.var;
+        case NODE_BINARY_OP: return a->data.binary.left == b->data.binary.left && a->data.binary.right == b->data.binary.right;
+        case NODE_UNARY_OP: return a->data.unary.operand == b->data.unary.operand;
+        case NODE_FUNCTION: return a->data.function.arg == b->data.function.arg;
+    }
+    return false;
+}
+
+// returns an existing identical node or appends this one
+static NodeIndex Intern(OptimizerState* s, const ASTNode* node) {
+    uint32_t slot = (uint32_t)AST_HashNode(node) & s->tableMask;
+    while (s->table[slot] != NODE_NONE) {
+        if (AST_SameNode(&s->ast->nodes[s->table[slot]], node)) return s->table[slot];
+        slot = (slot + 1) & s->tableMask;
+    }
+    NodeIndex index = s->count++;
+    s->ast->nodes[index] = *node;
+    s->table[slot] = index;
+    return index;
+}
+
+static NodeIndex InternNumber(OptimizerState* s, double value) {
+    ASTNode n;
+    memset(&n, 0, sizeof(n));
+    n.type = NODE_NUMBER;
+    n.data.number = value;
+    return Intern(s, &n);
+}
+
+static NodeIndex InternBinary(OptimizerState* s, uint8_t op, NodeIndex left, NodeIndex right) {
+    ASTNode n;
+    memset(&n, 0, sizeof(n));
+    n.type = NODE_BINARY_OP;
+    n.op = op;
+    n.data.binary.left = left;
+    n.data.binary.right = right;
+    return Intern(s, &n);
+}
+
+// missing operands evaluate to 0, so they count as the constant 0 here
+static bool IsConstant(OptimizerState* s, NodeIndex n, double* value) {
+    if (n == NODE_NONE) {
+        *value = 0.0;
+        return true;
+    }
+    const ASTNode* node = &s->ast->nodes[n];
+    if (node->type == NODE_NUMBER) {
+        *value = node->data.number;
+        return true;
+    }
+    if (node->type == NODE_VARIABLE && node->data.var >= VAR_COUNT) {
+        *value = 0.0; // unknown variable
+        return true;
+    }
+    return false;
+}
+
+static bool IsConstantValue(OptimizerState* s, NodeIndex n, double v) {
+    double c;
+    return IsConstant(s, n, &c) && c == v;
+}
+
+// exact bit pattern check, so x*1 doesn't also match x*1.0000000000000002
+static bool IsExactly(OptimizerState* s, NodeIndex n, double v) {
+    double c;
+    return IsConstant(s, n, &c) && DoubleBits(c) == DoubleBits(v);
+}
+
+static NodeIndex OptimizeBinary(OptimizerState* s, const ASTNode* node, NodeIndex l, NodeIndex r) {
+    double a, b;
+    bool constL = IsConstant(s, l, &a);
+    bool constR = IsConstant(s, r, &b);
+
+    if (constL && constR) {
+        // fold with exactly the operations AST_Evaluate uses
+        switch (node->op) {
+            case TOKEN_PLUS: return InternNumber(s, a + b);
+            case TOKEN_MINUS: return InternNumber(s, a - b);
+            case TOKEN_MULTIPLY: return InternNumber(s, a * b);
+            case TOKEN_DIVIDE: return InternNumber(s, (b != 0) ? a / b : NAN);
+            case TOKEN_POWER: return InternNumber(s, pow(a, b));
+            default: return InternNumber(s, 0.0);
+        }
+    }
+
+    switch (node->op) {
+        case TOKEN_PLUS:
+            // x + (-0) is x, x + (+0) is not for x = -0
+            if (IsExactly(s, r, -0.0)) return l;
+            if (IsExactly(s, l, -0.0)) return r;
+            break;
+        case TOKEN_MINUS:
+            if (IsExactly(s, r, 0.0)) return l; // x - (+0) is x, x - (-0) is not for x = -0
+            break;
+        case TOKEN_MULTIPLY:
+            if (IsExactly(s, r, 1.0)) return l;
+            if (IsExactly(s, l, 1.0)) return r;
+            break;
+        case TOKEN_DIVIDE:
+            if (IsExactly(s, r, 1.0)) return l;
+            break;
+        case TOKEN_POWER:
+            if (IsExactly(s, r, 1.0)) return l;
+            if (IsConstantValue(s, r, 0.0)) return InternNumber(s, 1.0); // pow(x, 0) is 1 even for NaN
+            if (IsExactly(s, r, 2.0)) return InternBinary(s, TOKEN_MULTIPLY, l, l);
+            break;
+        default:
+            break;
+    }
+    return InternBinary(s, node->op, l, r);
+}
+
+static NodeIndex OptimizeUnary(OptimizerState* s, NodeIndex o) {
+    double a;
+    if (IsConstant(s, o, &a)) return InternNumber(s, -a);
+
+    const ASTNode* operand = &s->ast->nodes[o]; // not NODE_NONE, that counts as constant
+    if (operand->type == NODE_UNARY_OP) return operand->data.unary.operand; // -(-x)
+
+    ASTNode n;
+    memset(&n, 0, sizeof(n));
+    n.type = NODE_UNARY_OP;
+    n.data.unary.operand = o;
+    return Intern(s, &n);
+}
+
+static NodeIndex OptimizeFunction(OptimizerState* s, const ASTNode* node, NodeIndex o) {
+    double a;
+    if (IsConstant(s, o, &a)) {
+        switch (node->func) {
+            case FUNC_SIN: return InternNumber(s, sin(a));
+            case FUNC_COS: return InternNumber(s, cos(a));
+            case FUNC_TAN: return InternNumber(s, tan(a));
+            case FUNC_SQRT: return InternNumber(s, sqrt(a));
+            case FUNC_LOG: return InternNumber(s, log(a));
+            case FUNC_EXP: return InternNumber(s, exp(a));
+            case FUNC_ABS: return InternNumber(s, fabs(a));
+            default: return InternNumber(s, 0.0);
+        }
+    }
+
+    ASTNode n;
+    memset(&n, 0, sizeof(n));
+    n.type = NODE_FUNCTION;
+    n.func = node->func;
+    n.data.function.arg = o;
+    return Intern(s, &n);
+}
+
+static void Mark(NodeIndex* reachable, NodeIndex n) {
+    if (n != NODE_NONE) reachable[n] = 1;
+}
+
+static NodeIndex Remap(const NodeIndex* remap, NodeIndex n) {
+    return (n == NODE_NONE) ? NODE_NONE : remap[n];
+}
+
+// drops nodes the rewrites left unreachable, keeping children-first order
+static void Compact(AST* ast, NodeIndex count, NodeIndex* remap) {
+    memset(remap, 0, count * sizeof(NodeIndex));
+    remap[ast->root] = 1;
+    for (NodeIndex i = ast->root + 1; i-- > 0;) {
+        if (!remap[i]) continue;
+        const ASTNode* node = &ast->nodes[i];
+        if (node->type == NODE_BINARY_OP) {
+            Mark(remap, node->data.binary.left);
+            Mark(remap, node->data.binary.right);
+        } else if (node->type == NODE_UNARY_OP) {
+            Mark(remap, node->data.unary.operand);
+        } else if (node->type == NODE_FUNCTION) {
+            Mark(remap, node->data.function.arg);
+        }
+    }
+
+    NodeIndex w = 0;
+    for (NodeIndex i = 0; i < count; i++) {
+        if (!remap[i]) continue;
+        ASTNode node = ast->nodes[i];
+        if (node.type == NODE_BINARY_OP) {
+            node.data.binary.left = Remap(remap, node.data.binary.left);
+            node.data.binary.right = Remap(remap, node.data.binary.right);
+        } else if (node.type == NODE_UNARY_OP) {
+            node.data.unary.operand = Remap(remap, node.data.unary.operand);
+        } else if (node.type == NODE_FUNCTION) {
+            node.data.function.arg = Remap(remap, node.data.function.arg);
+        }
+        ast->nodes[w] = node;
+        remap[i] = w++;
+    }
+    ast->root = remap[ast->root];
+    ast->nodeCount = w;
+}
+
+void AST_Optimize(AST* ast) {
+    if (!ast || ast->root == NODE_NONE) return;
+
+    uint32_t n = ast->nodeCount;
+    uint32_t tableSize = 16;
+    while (tableSize < 2 * n) tableSize *= 2;
+
+    NodeIndex* scratch = (NodeIndex*)malloc((n + tableSize) * sizeof(NodeIndex));
+    if (!scratch) return; // the unoptimized tree is still valid
+    NodeIndex* remap = scratch;
+    NodeIndex* table = scratch + n;
+    memset(table, 0xFF, tableSize * sizeof(NodeIndex)); // NODE_NONE
+
+    OptimizerState s;
+    s.ast = ast;
+    s.count = 0;
+    s.table = table;
+    s.tableMask = tableSize - 1;
+
+    // children come first, so by the time a node is read its operands are already rewritten.
+    // each input node writes at most one output node, so writes never overtake reads.
+    for (NodeIndex i = 0; i < n; i++) {
+        ASTNode node = ast->nodes[i];
+        switch (node.type) {
+            case NODE_NUMBER:
+            case NODE_VARIABLE:
+                remap[i] = Intern(&s, &node);
+                break;
+            case NODE_BINARY_OP: {
+                NodeIndex l = node.data.binary.left;
+                NodeIndex r = node.data.binary.right;
+                remap[i] = OptimizeBinary(&s, &node, Remap(remap, l), Remap(remap, r));
+                break;
+            }
+            case NODE_UNARY_OP: {
+                NodeIndex o = node.data.unary.operand;
+                remap[i] = OptimizeUnary(&s, Remap(remap, o));
+                break;
+            }
+            case NODE_FUNCTION: {
+                NodeIndex o = node.data.function.arg;
+                remap[i] = OptimizeFunction(&s, &node, Remap(remap, o));
+                break;
+            }
+        }
+    }
+    ast->root = remap[ast->root];
+
+    Compact(ast, s.count, remap);
+    free(scratch);
+}
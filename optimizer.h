@@ -0,0 +1,20 @@
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include "parser.h"
+#include <stdbool.h>
+
+// rewrites a parsed AST in place: folds constant subtrees, applies identities
+// (x*1, x+(-0), x-0, x/1, x^1, x^0, x^2 -> x*x, -(-x)) and merges identical
+// subtrees so the arena becomes a DAG that the compiler evaluates once per node.
+// which samples come out NaN never changes, division by zero included. values
+// are bit identical except x^2, where x*x is correctly rounded and libm pow can be
+// one ulp off. x+0 stays, since -0 + 0 is +0.
+void AST_Optimize(AST* ast);
+
+// node identity for hash consing, shared with the parser's d/dx table. children
+// compare by index and numbers by bit pattern, so -0 and nan payloads stay apart
+uint64_t AST_HashNode(const ASTNode* n);
+bool AST_SameNode(const ASTNode* a, const ASTNode* b);
+
+#endif
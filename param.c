@@ -0,0 +1,197 @@
+#include "param.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PARAM_TOLERANCE_PX 0.25 // how far the midpoint may be off the chord
+#define PARAM_MAX_DEPTH 24      // halvings of a seed step
+#define PARAM_JUMP_PX 2.0       // a step this long that still bends at the finest halving is a jump
+#define PARAM_MARGIN_PX 4.0     // a step reaching this close to the view still gets halved
+#define PARAM_CHUNK_POINTS 65536 // points a chunk may make, the rest of it stays coarse
+
+void ParamCurve_Init(ParamCurve* c) {
+    memset(c, 0, sizeof(*c));
+}
+
+static bool Reserve(SampleList* list, int count) {
+    if (count <= list->capacity) return true;
+    int capacity = list->capacity ? list->capacity : 256;
+    while (capacity < count) capacity *= 2;
+    SamplePoint* data = (SamplePoint*)realloc(list->data, capacity * sizeof(SamplePoint));
+    if (!data) return false;
+    list->data = data;
+    list->capacity = capacity;
+    return true;
+}
+
+// a point of the curve in world space, y is nan wherever the curve isn't defined
+typedef struct {
+    double x, y;
+} ParamPoint;
+
+typedef struct {
+    const ParamCurve* c;
+    ParamChunk* chunk;
+    EvalContext ctx;
+} Tracer;
+
+static ParamPoint Evaluate(Tracer* tr, double t) {
+    const ParamCurve* c = tr->c;
+    tr->ctx.t = t;
+    tr->chunk->evaluated++;
+    ParamPoint p;
+    if (c->form == PARAM_POLAR) {
+        double r = Expr_Evaluate(c->x, &tr->ctx);
+        p.x = r * cos(t);
+        p.y = r * sin(t);
+    } else {
+        p.x = Expr_Evaluate(c->x, &tr->ctx);
+        p.y = Expr_Evaluate(c->y, &tr->ctx);
+    }
+    if (!isfinite(p.x) || !isfinite(p.y)) {
+        p.x = p.y = NAN;
+    } else if (!DDouble_IsZero(c->originX) || !DDouble_IsZero(c->originY)) {
+        p.x = DDouble_Sub((DDouble){ p.x, 0.0 }, c->originX).hi;
+        p.y = DDouble_Sub((DDouble){ p.y, 0.0 }, c->originY).hi;
+    }
+    return p;
+}
+
+static bool Emit(Tracer* tr, ParamPoint p, SampleJoin join) {
+    SampleList* list = &tr->chunk->work;
+    if (!Reserve(list, list->count + 1)) return false;
+    list->data[list->count++] = (SamplePoint){ p.x, p.y, (uint8_t)join, 0 };
+    return true;
+}
+
+// distance in pixels from m to the segment a-b, all three already on screen
+static double SegmentDistance(double mx, double my, double ax, double ay, double bx, double by) {
+    double dx = bx - ax, dy = by - ay;
+    double ex = mx - ax, ey = my - ay;
+    double len2 = dx * dx + dy * dy;
+    double t = len2 > 0 ? (ex * dx + ey * dy) / len2 : 0.0;
+    if (t < 0) t = 0;
+    if (t > 1) t = 1;
+    return hypot(ex - t * dx, ey - t * dy);
+}
+
+// whether a step with these three points can be left as it is because all of it lies off
+// one side of the view. a step reaches about as far past its points as it is long
+static bool OffView(const double* sx, const double* sy, double halfWidth, double halfHeight) {
+    double reach = fmax(hypot(sx[1] - sx[0], sy[1] - sy[0]), hypot(sx[2] - sx[1], sy[2] - sy[1])) + PARAM_MARGIN_PX;
+    double w = halfWidth + reach, h = halfHeight + reach;
+    return (sx[0] < -w && sx[1] < -w && sx[2] < -w) || (sx[0] > w && sx[1] > w && sx[2] > w) ||
+           (sy[0] < -h && sy[1] < -h && sy[2] < -h) || (sy[0] > h && sy[1] > h && sy[2] > h);
+}
+
+// adds the points after p0 up to and including p1
+static bool Refine(Tracer* tr, double t0, ParamPoint p0, double t1, ParamPoint p1, int depth) {
+    const ParamCurve* c = tr->c;
+    double tm = 0.5 * (t0 + t1);
+    ParamPoint pm = Evaluate(tr, tm);
+    bool f0 = !isnan(p0.y), f1 = !isnan(p1.y), fm = !isnan(pm.y);
+
+    bool split;
+    double length = 0.0;
+    if (f0 && f1 && fm) {
+        double sx[3] = { (p0.x - c->centerX) * c->scale, (pm.x - c->centerX) * c->scale, (p1.x - c->centerX) * c->scale };
+        double sy[3] = { (p0.y - c->centerY) * c->scale, (pm.y - c->centerY) * c->scale, (p1.y - c->centerY) * c->scale };
+        length = hypot(sx[2] - sx[0], sy[2] - sy[0]);
+        split = !OffView(sx, sy, c->width / 2.0, c->height / 2.0) &&
+                SegmentDistance(sx[1], sy[1], sx[0], sy[0], sx[2], sy[2]) > PARAM_TOLERANCE_PX;
+    } else {
+        // an edge of the domain somewhere in here, worth narrowing down
+        split = f0 || f1 || fm;
+    }
+
+    if (split && depth < PARAM_MAX_DEPTH && tr->chunk->work.count < PARAM_CHUNK_POINTS && tm != t0 && tm != t1) {
+        return Refine(tr, t0, p0, tm, pm, depth + 1) && Refine(tr, tm, pm, t1, p1, depth + 1);
+    }
+    // still bending after all the halvings and long on screen, so the curve jumps here
+    bool jump = split && length > PARAM_JUMP_PX;
+    return Emit(tr, p1, (f0 && f1 && fm && !jump) ? JOIN_CONTINUOUS : JOIN_DISCONTINUOUS);
+}
+
+static double SeedAt(const ParamCurve* c, int k) {
+    if (k == PARAM_SEEDS) return c->to;
+    return c->from + (c->to - c->from) * k / PARAM_SEEDS;
+}
+
+int ParamCurve_Begin(ParamCurve* c, ParamForm form, const Expr* x, const Expr* y, double from, double to,
+                     double scale, double centerX, double centerY, int width, int height) {
+    c->pending = false;
+    c->evaluated = 0;
+    unsigned versionY = (form == PARAM_POLAR) ? 0 : y->version;
+    if (c->valid && c->form == form && c->versionX == x->version && c->versionY == versionY &&
+        c->from == from && c->to == to && c->scale == scale && c->centerX == centerX &&
+        c->centerY == centerY && c->width == width && c->height == height) {
+        return 0;
+    }
+    c->form = form;
+    c->versionX = x->version;
+    c->versionY = versionY;
+    c->from = from;
+    c->to = to;
+    c->scale = scale;
+    c->centerX = centerX;
+    c->centerY = centerY;
+    c->width = width;
+    c->height = height;
+    c->x = x;
+    c->y = y;
+    c->pending = true;
+    return PARAM_CHUNKS;
+}
+
+void ParamCurve_SetOrigin(ParamCurve* c, DDouble x, DDouble y) {
+    if (x.hi == c->originX.hi && x.lo == c->originX.lo && y.hi == c->originY.hi && y.lo == c->originY.lo) return;
+    c->originX = x;
+    c->originY = y;
+    c->valid = false;
+}
+
+void ParamCurve_RunChunk(ParamCurve* c, int index) {
+    ParamChunk* chunk = &c->chunks[index];
+    chunk->work.count = 0;
+    chunk->evaluated = 0;
+    Tracer tr = { c, chunk, { 0, 0, 0 } };
+
+    // neighbouring chunks share their boundary seed, End drops the second copy
+    int first = index * (PARAM_SEEDS / PARAM_CHUNKS);
+    int last = first + PARAM_SEEDS / PARAM_CHUNKS;
+    double t0 = SeedAt(c, first);
+    ParamPoint p0 = Evaluate(&tr, t0);
+    if (!Emit(&tr, p0, JOIN_DISCONTINUOUS)) return;
+    for (int k = first + 1; k <= last; k++) {
+        double t1 = SeedAt(c, k);
+        ParamPoint p1 = Evaluate(&tr, t1);
+        if (!Refine(&tr, t0, p0, t1, p1, 0)) return;
+        t0 = t1;
+        p0 = p1;
+    }
+}
+
+void ParamCurve_End(ParamCurve* c) {
+    if (!c->pending) return;
+    c->pending = false;
+    int total = 0;
+    for (int i = 0; i < PARAM_CHUNKS; i++) total += c->chunks[i].work.count;
+    c->curve.count = 0;
+    c->valid = false;
+    c->generation++;
+    if (!Reserve(&c->curve, total)) return;
+    for (int i = 0; i < PARAM_CHUNKS; i++) {
+        const SampleList* work = &c->chunks[i].work;
+        int skip = (i > 0 && work->count > 0) ? 1 : 0;
+        memcpy(c->curve.data + c->curve.count, work->data + skip, (work->count - skip) * sizeof(SamplePoint));
+        c->curve.count += work->count - skip;
+        c->evaluated += c->chunks[i].evaluated;
+    }
+    c->valid = true;
+}
+
+void ParamCurve_Free(ParamCurve* c) {
+    free(c->curve.data);
+    for (int i = 0; i < PARAM_CHUNKS; i++) free(c->chunks[i].work.data);
+    ParamCurve_Init(c);
+}
@@ -0,0 +1,63 @@
+#ifndef PARAM_H
+#define PARAM_H
+
+#include "expr.h"
+#include "samples.h"
+#include <stdbool.h>
+
+#define PARAM_SEEDS 256 // even steps of the parameter over the range, everything starts from these
+#define PARAM_CHUNKS 8  // tasks an update is split into, PARAM_SEEDS / PARAM_CHUNKS seeds each
+
+typedef enum {
+    PARAM_NONE,
+    PARAM_CARTESIAN, // (x(t), y(t))
+    PARAM_POLAR      // r = f(t), t the angle
+} ParamForm;
+
+// one stretch of seeds sampled on its own, so an update can be spread over threads
+typedef struct {
+    SampleList work;
+    int evaluated;
+} ParamChunk;
+
+// a curve traced by a parameter instead of swept along x, kept between frames. the range
+// is cut into even seeds and every step is halved until its midpoint lands within a
+// fraction of a pixel of the chord on screen. how far the midpoint bows out grows with
+// the curvature and the square of the step's length, so tight turns and long arcs get
+// points and straight stretches get none, at any zoom. steps entirely off one side of
+// the view aren't halved at all
+typedef struct {
+    SampleList curve; // world space, in the order of the parameter, breaks marked by join
+    unsigned generation; // bumped whenever the curve changes
+    bool valid;
+    int evaluated;       // evaluations done by the last update
+    // what the samples were taken for
+    ParamForm form;
+    unsigned versionX, versionY;
+    double from, to;
+    double scale, centerX, centerY;
+    int width, height;
+    DDouble originX, originY; // subtracted from every point, see ParamCurve_SetOrigin
+    // the update between Begin and End
+    bool pending;
+    const Expr* x;
+    const Expr* y;
+    ParamChunk chunks[PARAM_CHUNKS];
+} ParamCurve;
+
+void ParamCurve_Init(ParamCurve* c);
+// plans the update for a view and returns how many chunks it takes, 0 when the curve is
+// already up to date. t runs from from to to. for PARAM_POLAR x is r and y is unused.
+// the expressions have to stay put until End
+int ParamCurve_Begin(ParamCurve* c, ParamForm form, const Expr* x, const Expr* y, double from, double to,
+                     double scale, double centerX, double centerY, int width, int height);
+// points come out relative to (x, y), for a view that measures from there. the trace
+// itself stays in doubles, its parameter is one. starts over when the origin moves
+void ParamCurve_SetOrigin(ParamCurve* c, DDouble x, DDouble y);
+// samples one chunk, different chunks can run on different threads at the same time
+void ParamCurve_RunChunk(ParamCurve* c, int chunk);
+// stitches the chunks into the curve
+void ParamCurve_End(ParamCurve* c);
+void ParamCurve_Free(ParamCurve* c);
+
+#endif
@@ -1,5 +1,7 @@
 #include "parser.h"
+#include "optimizer.h"
 #include <stdio.h>
+#include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
@@ -9,22 +11,123 @@ typedef struct {
     const char* input;
     int pos;
     Token current;
+    AST* ast;
+    bool overflow; // out of nodes, the parse is redone in a bigger arena
+    bool failed;
+    // open addressing hash of every node, from the first d/dx on. derivatives repeat
+    // the same subexpressions over and over, nested ones exponentially so, and sharing
+    // them as they're built keeps a nest growing polynomially
+    NodeIndex* table;
+    uint32_t tableMask;
+    uint32_t tableCount;
 } ParserState;
 
 static void GetNextToken(ParserState* p);
-static ASTNode* ParseExpression(ParserState* p);
-
-// helper to create nodes
-static ASTNode* CreateNode(NodeType type) {
-    ASTNode* node = (ASTNode*)malloc(sizeof(ASTNode));
-    if (node) {
-        node->type = type;
-        // zero out memory to be safe
-        memset(&node->data, 0, sizeof(node->data));
+static NodeIndex ParseExpression(ParserState* p);
+
+// the slot holding a node like this one, or the empty slot it would go in
+static uint32_t FindSlot(const ParserState* p, const ASTNode* node) {
+    uint32_t slot = (uint32_t)AST_HashNode(node) & p->tableMask;
+    while (p->table[slot] != NODE_NONE && !AST_SameNode(&p->ast->nodes[p->table[slot]], node)) {
+        slot = (slot + 1) & p->tableMask;
+    }
+    return slot;
+}
+
+// at most half full, without a table nothing is shared and nothing breaks
+static bool GrowTable(ParserState* p) {
+    if (p->tableCount * 2 < p->tableMask + 1) return true;
+    uint32_t capacity = (p->tableMask + 1) * 2;
+    NodeIndex* old = p->table;
+    uint32_t oldCapacity = p->tableMask + 1;
+    p->table = (NodeIndex*)malloc(capacity * sizeof(NodeIndex));
+    if (!p->table) {
+        free(old);
+        p->tableMask = p->tableCount = 0;
+        return false;
+    }
+    memset(p->table, 0xFF, capacity * sizeof(NodeIndex));
+    p->tableMask = capacity - 1;
+    for (uint32_t i = 0; i < oldCapacity; i++) {
+        if (old[i] != NODE_NONE) p->table[FindSlot(p, &p->ast->nodes[old[i]])] = old[i];
+    }
+    free(old);
+    return true;
+}
+
+// appends a node, children always precede parents. once there's a table, an identical
+// node already in the arena is returned instead
+static NodeIndex AddNode(ParserState* p, const ASTNode* node) {
+    AST* ast = p->ast;
+    uint32_t slot = 0;
+    if (p->table) {
+        slot = FindSlot(p, node);
+        if (p->table[slot] != NODE_NONE) return p->table[slot];
     }
+    if (ast->nodeCount >= ast->nodeCapacity) {
+        // only derivatives outgrow the size taken from the input
+        p->overflow = true;
+        return NODE_NONE;
+    }
+    NodeIndex index = ast->nodeCount++;
+    ast->nodes[index] = *node;
+    if (p->table) {
+        p->table[slot] = index;
+        p->tableCount++;
+        GrowTable(p);
+    }
+    return index;
+}
+
+static void StartSharing(ParserState* p) {
+    if (p->table) return;
+    uint32_t capacity = 1024;
+    while (capacity < p->ast->nodeCount * 2 + 2) capacity *= 2;
+    p->table = (NodeIndex*)malloc(capacity * sizeof(NodeIndex));
+    if (!p->table) return;
+    memset(p->table, 0xFF, capacity * sizeof(NodeIndex));
+    p->tableMask = capacity - 1;
+    p->tableCount = 0;
+    for (NodeIndex i = 0; i < p->ast->nodeCount && p->table; i++) {
+        uint32_t slot = FindSlot(p, &p->ast->nodes[i]);
+        if (p->table[slot] != NODE_NONE) continue; // the first of a pair already stands for both
+        p->table[slot] = i;
+        p->tableCount++;
+        GrowTable(p);
+    }
+}
+
+static ASTNode NewNode(NodeType type) {
+    ASTNode node;
+    // zero out memory, the hash reads the whole of data
+    memset(&node, 0, sizeof(node));
+    node.type = type;
     return node;
 }
 
+static NodeIndex CreateBinary(ParserState* p, TokenType op, NodeIndex left, NodeIndex right) {
+    ASTNode node = NewNode(NODE_BINARY_OP);
+    node.op = (uint8_t)op;
+    node.data.binary.left = left;
+    node.data.binary.right = right;
+    return AddNode(p, &node);
+}
+
+static NodeIndex CreateUnary(ParserState* p, NodeIndex operand) {
+    ASTNode node = NewNode(NODE_UNARY_OP);
+    node.data.unary.operand = operand;
+    return AddNode(p, &node);
+}
+
+static uint32_t InternName(AST* ast, const char* name) {
+    for (uint32_t i = 0; i < ast->nameCount; i++) {
+        if (strcmp(ast->names[i], name) == 0) return i;
+    }
+    if (ast->nameCount >= ast->nameCapacity) return VAR_COUNT; // unreachable, treated as unknown
+    strcpy(ast->names[ast->nameCount], name);
+    return ast->nameCount++;
+}
+
 static void GetNextToken(ParserState* p) {
     while (p->input[p->pos] && isspace(p->input[p->pos])) {
         p->pos++;
@@ -45,6 +148,13 @@ static void GetNextToken(ParserState* p) {
         return;
     }
 
+    if (strncmp(p->input + p->pos, "d/dx", 4) == 0 && !isalnum(p->input[p->pos + 4])) {
+        p->current.type = TOKEN_FUNCTION;
+        p->current.func = FUNC_DERIV;
+        p->pos += 4;
+        return;
+    }
+
     if (isalpha(c)) {
         int start = p->pos;
         while (isalnum(p->input[p->pos])) p->pos++; // allow alphanumeric variables
@@ -76,6 +186,9 @@ static void GetNextToken(ParserState* p) {
         } else if (strcmp(buf, "abs") == 0) {
             p->current.type = TOKEN_FUNCTION;
             p->current.func = FUNC_ABS;
+        } else if (strcmp(buf, "pi") == 0) {
+            p->current.type = TOKEN_NUMBER;
+            p->current.value = 3.14159265358979323846;
         } else {
             p->current.type = TOKEN_VARIABLE;
             strcpy(p->current.varName, buf);
@@ -96,52 +209,180 @@ static void GetNextToken(ParserState* p) {
     p->pos++;
 }
 
-static ASTNode* ParseFactor(ParserState* p) {
+static NodeIndex CreateNumber(ParserState* p, double value) {
+    ASTNode node = NewNode(NODE_NUMBER);
+    node.data.number = value;
+    return AddNode(p, &node);
+}
+
+static NodeIndex CreateVariable(ParserState* p, uint32_t var) {
+    ASTNode node = NewNode(NODE_VARIABLE);
+    node.data.var = var;
+    return AddNode(p, &node);
+}
+
+static NodeIndex CreateFunction(ParserState* p, FuncType func, NodeIndex arg) {
+    ASTNode node = NewNode(NODE_FUNCTION);
+    node.func = (uint8_t)func;
+    node.data.function.arg = arg;
+    return AddNode(p, &node);
+}
+
+// tangents are built with NODE_NONE standing for an exact zero, so whatever doesn't
+// depend on x costs nothing. the rules match the dual evaluators in here and compiler.c
+static NodeIndex TangentNeg(ParserState* p, NodeIndex a) {
+    if (a == NODE_NONE) return NODE_NONE;
+    return CreateUnary(p, a);
+}
+
+static NodeIndex TangentAdd(ParserState* p, NodeIndex a, NodeIndex b) {
+    if (a == NODE_NONE) return b;
+    if (b == NODE_NONE) return a;
+    return CreateBinary(p, TOKEN_PLUS, a, b);
+}
+
+static NodeIndex TangentSub(ParserState* p, NodeIndex a, NodeIndex b) {
+    if (b == NODE_NONE) return a;
+    if (a == NODE_NONE) return TangentNeg(p, b);
+    return CreateBinary(p, TOKEN_MINUS, a, b);
+}
+
+static NodeIndex TangentMul(ParserState* p, NodeIndex a, NodeIndex b) {
+    if (a == NODE_NONE || b == NODE_NONE) return NODE_NONE;
+    return CreateBinary(p, TOKEN_MULTIPLY, a, b);
+}
+
+static NodeIndex TangentDiv(ParserState* p, NodeIndex a, NodeIndex b) {
+    if (a == NODE_NONE) return NODE_NONE;
+    return CreateBinary(p, TOKEN_DIVIDE, a, b);
+}
+
+#define TANGENT_UNSET 0xFFFFFFFEu
+
+// the derivative of node n with respect to x as new nodes that reuse the ones of n,
+// memo makes shared subtrees (nested d/dx) derive once
+static NodeIndex Derive(ParserState* p, NodeIndex* memo, NodeIndex n) {
+    if (n == NODE_NONE) return NODE_NONE;
+    if (memo[n] != TANGENT_UNSET) return memo[n];
+    ASTNode node = p->ast->nodes[n];
+    NodeIndex d = NODE_NONE;
+
+    switch (node.type) {
+        case NODE_NUMBER:
+            break;
+        case NODE_VARIABLE:
+            if (node.data.var == VAR_X) d = CreateNumber(p, 1.0);
+            break;
+        case NODE_BINARY_OP: {
+            NodeIndex u = node.data.binary.left;
+            NodeIndex v = node.data.binary.right;
+            NodeIndex du = Derive(p, memo, u);
+            NodeIndex dv = Derive(p, memo, v);
+            switch (node.op) {
+                case TOKEN_PLUS: d = TangentAdd(p, du, dv); break;
+                case TOKEN_MINUS: d = TangentSub(p, du, dv); break;
+                case TOKEN_MULTIPLY: d = TangentAdd(p, TangentMul(p, du, v), TangentMul(p, u, dv)); break;
+                case TOKEN_DIVIDE: // (du - u/v*dv) / v, reusing u/v
+                    d = TangentDiv(p, TangentSub(p, du, TangentMul(p, n, dv)), v);
+                    break;
+                case TOKEN_POWER:
+                    if (dv == NODE_NONE) {
+                        // constant exponent, v*u^(v-1)*du keeps negative bases working
+                        NodeIndex power = CreateBinary(p, TOKEN_POWER, u, CreateBinary(p, TOKEN_MINUS, v, CreateNumber(p, 1.0)));
+                        d = TangentMul(p, TangentMul(p, v, power), du);
+                    } else {
+                        // u^v * (dv*log(u) + v*du/u)
+                        NodeIndex inner = TangentAdd(p, TangentMul(p, dv, CreateFunction(p, FUNC_LOG, u)),
+                                                     TangentDiv(p, TangentMul(p, v, du), u));
+                        d = TangentMul(p, n, inner);
+                    }
+                    break;
+                default: break;
+            }
+            break;
+        }
+        case NODE_UNARY_OP:
+            d = TangentNeg(p, Derive(p, memo, node.data.unary.operand));
+            break;
+        case NODE_FUNCTION: {
+            NodeIndex u = node.data.function.arg;
+            NodeIndex du = Derive(p, memo, u);
+            if (du == NODE_NONE) break;
+            switch (node.func) {
+                case FUNC_SIN: d = TangentMul(p, CreateFunction(p, FUNC_COS, u), du); break;
+                case FUNC_COS: d = TangentNeg(p, TangentMul(p, CreateFunction(p, FUNC_SIN, u), du)); break;
+                case FUNC_TAN: // (1 + tan^2) du
+                    d = TangentMul(p, CreateBinary(p, TOKEN_PLUS, CreateNumber(p, 1.0), CreateBinary(p, TOKEN_MULTIPLY, n, n)), du);
+                    break;
+                case FUNC_SQRT: d = TangentDiv(p, du, CreateBinary(p, TOKEN_MULTIPLY, CreateNumber(p, 2.0), n)); break;
+                case FUNC_LOG: d = TangentDiv(p, du, u); break;
+                case FUNC_EXP: d = TangentMul(p, n, du); break;
+                case FUNC_ABS: d = TangentMul(p, du, CreateBinary(p, TOKEN_DIVIDE, u, n)); break; // NaN at 0
+                default: break;
+            }
+            break;
+        }
+    }
+    memo[n] = d;
+    return d;
+}
+
+// d/dx of an already parsed subtree, the subtree itself stays behind unreachable
+static NodeIndex CreateDerivative(ParserState* p, NodeIndex arg) {
+    uint32_t count = p->ast->nodeCount;
+    NodeIndex* memo = (NodeIndex*)malloc((count + 1) * sizeof(NodeIndex));
+    if (!memo) {
+        p->failed = true;
+        return NODE_NONE;
+    }
+    for (uint32_t i = 0; i < count; i++) memo[i] = TANGENT_UNSET;
+    StartSharing(p);
+    NodeIndex d = Derive(p, memo, arg);
+    free(memo);
+    return (d == NODE_NONE) ? CreateNumber(p, 0.0) : d;
+}
+
+static NodeIndex ParseFactor(ParserState* p) {
     Token t = p->current;
     if (t.type == TOKEN_NUMBER) {
         GetNextToken(p);
-        ASTNode* node = CreateNode(NODE_NUMBER);
-        node->data.number = t.value;
-        return node;
+        return CreateNumber(p, t.value);
     } else if (t.type == TOKEN_VARIABLE) {
-        ASTNode* node = CreateNode(NODE_VARIABLE);
-        strcpy(node->data.varName, t.varName);
+        NodeIndex node = CreateVariable(p, InternName(p->ast, t.varName));
         GetNextToken(p);
         return node;
     } else if (t.type == TOKEN_LPAREN) {
         GetNextToken(p);
-        ASTNode* node = ParseExpression(p);
+        NodeIndex node = ParseExpression(p);
         if (p->current.type == TOKEN_RPAREN) {
             GetNextToken(p);
         }
         return node;
     } else if (t.type == TOKEN_MINUS) {
         GetNextToken(p);
-        ASTNode* node = CreateNode(NODE_UNARY_OP);
-        node->data.unary.operand = ParseFactor(p); // recursive step should be Factor or higher precedence? -x^2 is -(x^2) usually.
+        NodeIndex operand = ParseFactor(p); // recursive step should be Factor or higher precedence? -x^2 is -(x^2) usually.
         // actually -x^2 is usually -(x^2), so unary minus has lower precedence than power.
         // But here im calling ParseFactor. If ParsePower handles power, then -x^2 would be parsed as (-x)^2 if I call ParseFactor?
         // wait, standard precedence: power > unary > mul/div > add/sub.
         // so unary should call power? 
         // Let's implement power first.
-        return node;
+        return CreateUnary(p, operand);
     } else if (t.type == TOKEN_FUNCTION) {
         FuncType f = t.func;
         GetNextToken(p);
-        ASTNode* node = CreateNode(NODE_FUNCTION);
-        node->data.function.func = f;
-        node->data.function.arg = ParseFactor(p); // sin(x) vs sin x. 
+        NodeIndex arg = ParseFactor(p); // sin(x) vs sin x. 
         // if i want sin(x+1), ParseFactor handles parenthesized expression.
-        return node;
+        if (f == FUNC_DERIV) return CreateDerivative(p, arg);
+        return CreateFunction(p, f, arg);
     }
-    return NULL; // handle error
+    return NODE_NONE; // handle error
 }
 
-static ASTNode* ParsePower(ParserState* p) {
-    ASTNode* left = ParseFactor(p);
+static NodeIndex ParsePower(ParserState* p) {
+    NodeIndex left = ParseFactor(p);
     while (p->current.type == TOKEN_POWER) {
         GetNextToken(p);
-        ASTNode* right = ParseFactor(p); // right associative? a^b^c -> a^(b^c). If we just call ParseFactor here, it's correct for right associativity if we recurse ParsePower?
+        NodeIndex right = ParseFactor(p); // right associative? a^b^c -> a^(b^c). If we just call ParseFactor here, it's correct for right associativity if we recurse ParsePower?
         // Actually to do right associative: a^b^c = a^(b^c).
         // my implementation: left = a. see ^. right = ParseFactor(b). 
         // if b is followed by ^c, ParseFactor will just return b.
@@ -163,17 +404,13 @@ static ASTNode* ParsePower(ParserState* p) {
         // let's fix it properly later if needed stick to simple loop left associative for simplicity....
         
         
-        ASTNode* node = CreateNode(NODE_BINARY_OP);
-        node->data.binary.left = left;
-        node->data.binary.right = right;
-        node->data.binary.op = TOKEN_POWER;
-        left = node;
+        left = CreateBinary(p, TOKEN_POWER, left, right);
     }
     return left;
 }
 
-static ASTNode* ParseTerm(ParserState* p) {
-    ASTNode* left = ParsePower(p);
+static NodeIndex ParseTerm(ParserState* p) {
+    NodeIndex left = ParsePower(p);
     while (p->current.type == TOKEN_MULTIPLY || p->current.type == TOKEN_DIVIDE ||
            p->current.type == TOKEN_VARIABLE || p->current.type == TOKEN_LPAREN || 
            p->current.type == TOKEN_FUNCTION || (p->current.type == TOKEN_NUMBER)) { // Implicit multiplication
@@ -181,98 +418,291 @@ static ASTNode* ParseTerm(ParserState* p) {
         TokenType type = p->current.type;
         if (type == TOKEN_MULTIPLY || type == TOKEN_DIVIDE) {
             GetNextToken(p);
-            ASTNode* right = ParsePower(p);
-            ASTNode* node = CreateNode(NODE_BINARY_OP);
-            node->data.binary.left = left;
-            node->data.binary.right = right;
-            node->data.binary.op = type;
-            left = node;
+            NodeIndex right = ParsePower(p);
+            left = CreateBinary(p, type, left, right);
         } else {
              // implicit multiplication
-             ASTNode* right = ParsePower(p);
-             ASTNode* node = CreateNode(NODE_BINARY_OP);
-             node->data.binary.left = left;
-             node->data.binary.right = right;
-             node->data.binary.op = TOKEN_MULTIPLY;
-             left = node;
+             NodeIndex right = ParsePower(p);
+             left = CreateBinary(p, TOKEN_MULTIPLY, left, right);
         }
     }
     return left;
 }
 
-static ASTNode* ParseExpression(ParserState* p) {
-    ASTNode* left = ParseTerm(p);
+static NodeIndex ParseExpression(ParserState* p) {
+    NodeIndex left = ParseTerm(p);
     while (p->current.type == TOKEN_PLUS || p->current.type == TOKEN_MINUS) {
         TokenType type = p->current.type;
         GetNextToken(p);
-        ASTNode* right = ParseTerm(p);
-        ASTNode* node = CreateNode(NODE_BINARY_OP);
-        node->data.binary.left = left;
-        node->data.binary.right = right;
-        node->data.binary.op = type;
-        left = node;
+        NodeIndex right = ParseTerm(p);
+        left = CreateBinary(p, type, left, right);
     }
     return left;
 }
 
-ASTNode* Parser_Parse(const char* input) {
-    ParserState p;
-    p.input = input;
-    p.pos = 0;
-    GetNextToken(&p);
-    return ParseExpression(&p);
+// every token adds at most one node plus one implicit multiplication,
+// and every token is at least one character long. derivatives add more, scale covers them
+static size_t ArenaSize(size_t len, uint32_t scale, uint32_t* nodeCap, uint32_t* nameCap) {
+    *nodeCap = (uint32_t)(2 * len + 1) * scale;
+    *nameCap = (uint32_t)(VAR_COUNT + (len + 1) / 2);
+    return sizeof(AST) + *nodeCap * sizeof(ASTNode) + *nameCap * AST_NAME_LEN;
 }
 
-double AST_Evaluate(ASTNode* node, EvalContext* ctx) {
-    if (!node) return 0.0;
+// past this a d/dx nest is given up on, the expression reads as empty and says why
+#define PARSER_MAX_NODES (1u << 20)
+
+AST* Parser_Reparse(AST* ast, const char* input) {
+    size_t len = strlen(input);
+    for (uint32_t scale = 1;; scale *= 2) {
+        uint32_t nodeCap, nameCap;
+        size_t size = ArenaSize(len, scale, &nodeCap, &nameCap);
+
+        if (!ast || ast->size < size) {
+            // grow in powers of two so typing a line doesn't realloc per keystroke
+            size_t cap = 1024;
+            while (cap < size) cap *= 2;
+            AST* grown = (AST*)realloc(ast, cap);
+            if (!grown) {
+                free(ast);
+                return NULL;
+            }
+            ast = grown;
+            ast->size = cap;
+        }
+
+        ast->nodes = (ASTNode*)(ast + 1);
+        ast->names = (char (*)[AST_NAME_LEN])(ast->nodes + nodeCap);
+        ast->nodeCapacity = nodeCap;
+        ast->nameCapacity = nameCap;
+        ast->nodeCount = 0;
+        ast->nameCount = VAR_COUNT;
+        strcpy(ast->names[VAR_X], "x");
+        strcpy(ast->names[VAR_Y], "y");
+        strcpy(ast->names[VAR_T], "t");
+
+        ParserState p;
+        p.input = input;
+        p.pos = 0;
+        p.ast = ast;
+        p.overflow = false;
+        p.failed = false;
+        p.table = NULL;
+        p.tableMask = p.tableCount = 0;
+        ast->error = NULL;
+        GetNextToken(&p);
+        ast->root = ParseExpression(&p);
+        free(p.table);
+        if (p.failed) ast->root = NODE_NONE;
+        if (!p.overflow) return ast;
+        if (nodeCap >= PARSER_MAX_NODES) {
+            ast->root = NODE_NONE;
+            ast->error = "too big to differentiate";
+            return ast;
+        }
+    }
+}
+
+AST* Parser_Parse(const char* input) {
+    return Parser_Reparse(NULL, input);
+}
+
+static double ApplyBinary(uint8_t op, double left, double right) {
+    switch (op) {
+        case TOKEN_PLUS: return left + right;
+        case TOKEN_MINUS: return left - right;
+        case TOKEN_MULTIPLY: return left * right;
+        case TOKEN_DIVIDE: return (right != 0) ? left / right : NAN;
+        case TOKEN_POWER: return pow(left, right);
+        default: return 0.0;
+    }
+}
+
+static double ApplyFunction(uint8_t func, double arg) {
+    switch (func) {
+        case FUNC_SIN: return sin(arg);
+        case FUNC_COS: return cos(arg);
+        case FUNC_TAN: return tan(arg);
+        case FUNC_SQRT: return sqrt(arg);
+        case FUNC_LOG: return log(arg);
+        case FUNC_EXP: return exp(arg);
+        case FUNC_ABS: return fabs(arg);
+        default: return 0.0;
+    }
+}
+
+static double VariableValue(uint32_t var, const EvalContext* ctx) {
+    if (var == VAR_X) return ctx->x;
+    if (var == VAR_Y) return ctx->y;
+    if (var == VAR_T) return ctx->t;
+    return 0.0; // unknown variable
+}
+
+double AST_EvaluateNode(const AST* ast, NodeIndex index, EvalContext* ctx) {
+    if (index == NODE_NONE) return 0.0;
+    const ASTNode* node = &ast->nodes[index];
     
     switch (node->type) {
         case NODE_NUMBER: return node->data.number;
-        case NODE_VARIABLE:
-            if (strcmp(node->data.varName, "x") == 0) return ctx->x;
-            if (strcmp(node->data.varName, "y") == 0) return ctx->y;
-            if (strcmp(node->data.varName, "t") == 0) return ctx->t;
-            return 0.0; // unknown variable
+        case NODE_VARIABLE: return VariableValue(node->data.var, ctx);
         case NODE_BINARY_OP: {
-            double left = AST_Evaluate(node->data.binary.left, ctx);
-            double right = AST_Evaluate(node->data.binary.right, ctx);
-            switch (node->data.binary.op) {
-                case TOKEN_PLUS: return left + right;
-                case TOKEN_MINUS: return left - right;
-                case TOKEN_MULTIPLY: return left * right;
-                case TOKEN_DIVIDE: return (right != 0) ? left / right : NAN;
-                case TOKEN_POWER: return pow(left, right);
-                default: return 0.0;
-            }
+            double left = AST_EvaluateNode(ast, node->data.binary.left, ctx);
+            double right = AST_EvaluateNode(ast, node->data.binary.right, ctx);
+            return ApplyBinary(node->op, left, right);
         }
         case NODE_UNARY_OP:
-            return -AST_Evaluate(node->data.unary.operand, ctx);
+            return -AST_EvaluateNode(ast, node->data.unary.operand, ctx);
+        case NODE_FUNCTION:
+            return ApplyFunction(node->func, AST_EvaluateNode(ast, node->data.function.arg, ctx));
+    }
+    return 0.0;
+}
+
+double AST_Evaluate(const AST* ast, EvalContext* ctx) {
+    if (!ast) return 0.0;
+    return AST_EvaluateNode(ast, ast->root, ctx);
+}
+
+static double Value(const double* values, NodeIndex n) {
+    return n == NODE_NONE ? 0.0 : values[n];
+}
+
+double AST_EvaluateNodes(const AST* ast, EvalContext* ctx, double* values) {
+    if (!ast || ast->root == NODE_NONE) return 0.0;
+    // children come first, so one pass up to the root sees every operand already done
+    for (NodeIndex i = 0; i <= ast->root; i++) {
+        const ASTNode* node = &ast->nodes[i];
+        double v = 0.0;
+        switch (node->type) {
+            case NODE_NUMBER: v = node->data.number; break;
+            case NODE_VARIABLE: v = VariableValue(node->data.var, ctx); break;
+            case NODE_BINARY_OP:
+                v = ApplyBinary(node->op, Value(values, node->data.binary.left), Value(values, node->data.binary.right));
+                break;
+            case NODE_UNARY_OP: v = -Value(values, node->data.unary.operand); break;
+            case NODE_FUNCTION: v = ApplyFunction(node->func, Value(values, node->data.function.arg)); break;
+        }
+        values[i] = v;
+    }
+    return values[ast->root];
+}
+
+// f(u op v) and its derivative from u, v and theirs
+static double DualBinary(uint8_t op, double u, double du, double v, double dv, double* derivative) {
+    switch (op) {
+        case TOKEN_PLUS:
+            *derivative = du + dv;
+            return u + v;
+        case TOKEN_MINUS:
+            *derivative = du - dv;
+            return u - v;
+        case TOKEN_MULTIPLY:
+            *derivative = du * v + u * dv;
+            return u * v;
+        case TOKEN_DIVIDE: {
+            double f = (v != 0) ? u / v : NAN;
+            *derivative = (du - f * dv) / v;
+            return f;
+        }
+        case TOKEN_POWER: {
+            double f = pow(u, v);
+            if (dv == 0.0) *derivative = (du == 0.0) ? 0.0 : v * pow(u, v - 1.0) * du;
+            else *derivative = f * (dv * log(u) + v * du / u);
+            return f;
+        }
+        default:
+            *derivative = 0.0;
+            return 0.0;
+    }
+}
+
+static double DualFunction(uint8_t func, double u, double du, double* derivative) {
+    double f;
+    switch (func) {
+        case FUNC_SIN: f = sin(u); *derivative = cos(u) * du; break;
+        case FUNC_COS: f = cos(u); *derivative = -sin(u) * du; break;
+        case FUNC_TAN: f = tan(u); *derivative = (1.0 + f * f) * du; break;
+        case FUNC_SQRT: f = sqrt(u); *derivative = du / (2.0 * f); break;
+        case FUNC_LOG: f = log(u); *derivative = du / u; break;
+        case FUNC_EXP: f = exp(u); *derivative = f * du; break;
+        case FUNC_ABS: f = fabs(u); *derivative = du * (u / f); break;
+        default:
+            *derivative = 0.0;
+            return 0.0;
+    }
+    if (du == 0.0) *derivative = 0.0; // constant argument, whatever f is there
+    return f;
+}
+
+// the same rules Derive builds as nodes
+double AST_EvaluateNodeDual(const AST* ast, NodeIndex index, EvalContext* ctx, double* derivative) {
+    *derivative = 0.0;
+    if (index == NODE_NONE) return 0.0;
+    const ASTNode* node = &ast->nodes[index];
+
+    switch (node->type) {
+        case NODE_NUMBER: return node->data.number;
+        case NODE_VARIABLE:
+            if (node->data.var == VAR_X) *derivative = 1.0;
+            return VariableValue(node->data.var, ctx);
+        case NODE_BINARY_OP: {
+            double du, dv;
+            double u = AST_EvaluateNodeDual(ast, node->data.binary.left, ctx, &du);
+            double v = AST_EvaluateNodeDual(ast, node->data.binary.right, ctx, &dv);
+            return DualBinary(node->op, u, du, v, dv, derivative);
+        }
+        case NODE_UNARY_OP: {
+            double du;
+            double u = AST_EvaluateNodeDual(ast, node->data.unary.operand, ctx, &du);
+            *derivative = -du;
+            return -u;
+        }
         case NODE_FUNCTION: {
-            double arg = AST_Evaluate(node->data.function.arg, ctx);
-            switch (node->data.function.func) {
-                case FUNC_SIN: return sin(arg);
-                case FUNC_COS: return cos(arg);
-                case FUNC_TAN: return tan(arg);
-                case FUNC_SQRT: return sqrt(arg);
-                case FUNC_LOG: return log(arg);
-                case FUNC_EXP: return exp(arg);
-                case FUNC_ABS: return fabs(arg);
-                default: return 0.0;
-            }
+            double du;
+            double u = AST_EvaluateNodeDual(ast, node->data.function.arg, ctx, &du);
+            return DualFunction(node->func, u, du, derivative);
         }
     }
     return 0.0;
 }
 
-void AST_Free(ASTNode* node) {
-    if (!node) return;
-    if (node->type == NODE_BINARY_OP) {
-        AST_Free(node->data.binary.left);
-        AST_Free(node->data.binary.right);
-    } else if (node->type == NODE_UNARY_OP) {
-        AST_Free(node->data.unary.operand);
-    } else if (node->type == NODE_FUNCTION) {
-        AST_Free(node->data.function.arg);
+double AST_EvaluateDual(const AST* ast, EvalContext* ctx, double* derivative) {
+    *derivative = 0.0;
+    if (!ast) return 0.0;
+    return AST_EvaluateNodeDual(ast, ast->root, ctx, derivative);
+}
+
+double AST_EvaluateNodesDual(const AST* ast, EvalContext* ctx, double* values, double* tangents, double* derivative) {
+    *derivative = 0.0;
+    if (!ast || ast->root == NODE_NONE) return 0.0;
+    for (NodeIndex i = 0; i <= ast->root; i++) {
+        const ASTNode* node = &ast->nodes[i];
+        double v = 0.0, d = 0.0;
+        switch (node->type) {
+            case NODE_NUMBER: v = node->data.number; break;
+            case NODE_VARIABLE:
+                v = VariableValue(node->data.var, ctx);
+                if (node->data.var == VAR_X) d = 1.0;
+                break;
+            case NODE_BINARY_OP: {
+                NodeIndex l = node->data.binary.left, r = node->data.binary.right;
+                v = DualBinary(node->op, Value(values, l), Value(tangents, l), Value(values, r), Value(tangents, r), &d);
+                break;
+            }
+            case NODE_UNARY_OP:
+                v = -Value(values, node->data.unary.operand);
+                d = -Value(tangents, node->data.unary.operand);
+                break;
+            case NODE_FUNCTION:
+                v = DualFunction(node->func, Value(values, node->data.function.arg), Value(tangents, node->data.function.arg), &d);
+                break;
+        }
+        values[i] = v;
+        tangents[i] = d;
     }
-    free(node);
+    *derivative = tangents[ast->root];
+    return values[ast->root];
+}
+
+void AST_Free(AST* ast) {
+    free(ast); // the whole tree is one block
 }
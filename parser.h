@@ -1,6 +1,9 @@
 #ifndef PARSER_H
 #define PARSER_H
 
+#include <stdint.h>
+#include <stddef.h>
+
 typedef enum {
     TOKEN_NUMBER,
     TOKEN_VARIABLE, 
@@ -24,7 +27,8 @@ typedef enum {
     FUNC_LOG,
     FUNC_EXP,
     FUNC_ABS,
-    FUNC_NONE
+    FUNC_NONE,
+    FUNC_DERIV // d/dx, only ever a token: the parser expands it into the derivative's nodes
 } FuncType;
 
 typedef struct {
@@ -42,27 +46,53 @@ typedef enum {
     NODE_FUNCTION
 } NodeType;
 
-typedef struct ASTNode ASTNode;
+// nodes live in one array per parse and refer to each other by index
+typedef uint32_t NodeIndex;
+#define NODE_NONE 0xFFFFFFFFu // missing operand, evaluates to 0
+
+// interned variable ids, x/y/t are always present in this order
+typedef enum {
+    VAR_X,
+    VAR_Y,
+    VAR_T,
+    VAR_COUNT
+} VarSlot;
+
+#define AST_NAME_LEN 32
 
-struct ASTNode {
+typedef struct {
     NodeType type;
+    uint8_t op;   // TokenType of a NODE_BINARY_OP
+    uint8_t func; // FuncType of a NODE_FUNCTION
     union {
         double number;
-        char varName[32];
+        uint32_t var; // index into AST.names
         struct {
-            struct ASTNode* left;
-            struct ASTNode* right;
-            TokenType op;
+            NodeIndex left;
+            NodeIndex right;
         } binary;
         struct {
-            struct ASTNode* operand;
+            NodeIndex operand;
         } unary; // MINUS
         struct {
-            struct ASTNode* arg;
-            FuncType func;
+            NodeIndex arg;
         } function;
     } data;
-};
+} ASTNode;
+
+// single block arena: header, nodes and the name table.
+// children always come before their parent, so the root is the last node.
+typedef struct {
+    ASTNode* nodes;
+    char (*names)[AST_NAME_LEN];
+    uint32_t nodeCount;
+    uint32_t nodeCapacity;
+    uint32_t nameCount;
+    uint32_t nameCapacity;
+    NodeIndex root;
+    const char* error; // why the parse gave up and left it empty, NULL when it didn't
+    size_t size;
+} AST;
 
 // context includes x, y, t, and other variables 
 typedef struct {
@@ -71,8 +101,19 @@ typedef struct {
      double t;
 } EvalContext;
 
-ASTNode* Parser_Parse(const char* input);
-double AST_Evaluate(ASTNode* node, EvalContext* ctx);
-void AST_Free(ASTNode* node);
+AST* Parser_Parse(const char* input);
+// parses into an existing arena, only reallocating when it is too small
+AST* Parser_Reparse(AST* ast, const char* input);
+double AST_Evaluate(const AST* ast, EvalContext* ctx);
+double AST_EvaluateNode(const AST* ast, NodeIndex node, EvalContext* ctx);
+// value and derivative with respect to x in one walk, forward mode with dual numbers.
+// y and t are held fixed, so for an implicit relation it's the partial derivative
+double AST_EvaluateDual(const AST* ast, EvalContext* ctx, double* derivative);
+double AST_EvaluateNodeDual(const AST* ast, NodeIndex node, EvalContext* ctx, double* derivative);
+// the same values visiting every node exactly once, where the walks above would redo a
+// node shared by many parents each time. values (and tangents) hold a double per node
+double AST_EvaluateNodes(const AST* ast, EvalContext* ctx, double* values);
+double AST_EvaluateNodesDual(const AST* ast, EvalContext* ctx, double* values, double* tangents, double* derivative);
+void AST_Free(AST* ast);
 
 #endif
@@ -0,0 +1,220 @@
+#include "path.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+void CurvePath_Init(CurvePath* path) {
+    memset(path, 0, sizeof(*path));
+}
+
+static bool Grow(void** data, int* capacity, int count, size_t itemSize) {
+    if (count <= *capacity) return true;
+    int newCapacity = *capacity ? *capacity : 1024;
+    while (newCapacity < count) newCapacity *= 2;
+    void* p = realloc(*data, (size_t)newCapacity * itemSize);
+    if (!p) return false;
+    *data = p;
+    *capacity = newCapacity;
+    return true;
+}
+
+// a run that never got a second point is no run
+static void EndRun(CurvePath* path) {
+    if (path->runCount > 0 && path->count - path->runs[path->runCount - 1] < 2) {
+        path->count = path->runs[--path->runCount];
+    }
+}
+
+static bool StartRun(CurvePath* path) {
+    EndRun(path);
+    if (!Grow((void**)&path->runs, &path->runCapacity, path->runCount + 1, sizeof(int))) return false;
+    path->runs[path->runCount++] = path->count;
+    return true;
+}
+
+static bool Add(CurvePath* path, double x, double y) {
+    if (path->count > path->runs[path->runCount - 1]) {
+        // repeated points have no direction, and the stroke needs one
+        double dx = x - path->xy[2 * path->count - 2];
+        double dy = y - path->xy[2 * path->count - 1];
+        if (dx * dx + dy * dy < 1e-12) return true;
+    }
+    if (!Grow((void**)&path->xy, &path->capacity, path->count + 1, 2 * sizeof(double))) return false;
+    path->xy[2 * path->count] = x;
+    path->xy[2 * path->count + 1] = y;
+    path->count++;
+    return true;
+}
+
+// liang-barsky, shrinks t0..t1 to the part of the segment inside the box
+static bool Clip(double x0, double y0, double x1, double y1, double lo, double hiX, double hiY, double* t0, double* t1) {
+    double p[4] = { -(x1 - x0), x1 - x0, -(y1 - y0), y1 - y0 };
+    double q[4] = { x0 - lo, hiX - x0, y0 - lo, hiY - y0 };
+    *t0 = 0.0;
+    *t1 = 1.0;
+    for (int k = 0; k < 4; k++) {
+        if (p[k] == 0.0) {
+            if (q[k] < 0.0) return false;
+            continue;
+        }
+        double t = q[k] / p[k];
+        if (p[k] < 0.0) {
+            if (t > *t1) return false;
+            if (t > *t0) *t0 = t;
+        } else {
+            if (t < *t0) return false;
+            if (t < *t1) *t1 = t;
+        }
+    }
+    return true;
+}
+
+// squared distance from p to the segment a-b
+static double Distance2(const double* p, const double* a, const double* b) {
+    double dx = b[0] - a[0], dy = b[1] - a[1];
+    double len2 = dx * dx + dy * dy;
+    double t = len2 > 0 ? ((p[0] - a[0]) * dx + (p[1] - a[1]) * dy) / len2 : 0.0;
+    if (t < 0) t = 0;
+    if (t > 1) t = 1;
+    double ex = a[0] + dx * t - p[0], ey = a[1] + dy * t - p[1];
+    return ex * ex + ey * ey;
+}
+
+// ramer-douglas-peucker over first..last, with a stack instead of recursion
+static void Simplify(CurvePath* path, int first, int last) {
+    double tol2 = path->tolerance * path->tolerance;
+    unsigned char* keep = path->keep;
+    const double* xy = path->xy;
+    keep[first] = 1;
+    keep[last] = 1;
+    int top = 0;
+    path->stack[top++] = first;
+    path->stack[top++] = last;
+    while (top > 0) {
+        int b = path->stack[--top];
+        int a = path->stack[--top];
+        double worst = tol2;
+        int split = -1;
+        for (int i = a + 1; i < b; i++) {
+            double d = Distance2(xy + 2 * i, xy + 2 * a, xy + 2 * b);
+            if (d > worst) {
+                worst = d;
+                split = i;
+            }
+        }
+        if (split < 0) continue;
+        keep[split] = 1;
+        path->stack[top++] = a;
+        path->stack[top++] = split;
+        path->stack[top++] = split;
+        path->stack[top++] = b;
+    }
+}
+
+bool CurvePath_FromCurve(CurvePath* path, const SampleCache* cache, double tolerance, double margin,
+                         double scale, double centerX, double centerY, int width, int height) {
+    return CurvePath_FromSamples(path, cache, cache->generation, cache->valid ? &cache->curve : NULL, tolerance, margin,
+                                 scale, centerX, centerY, width, height);
+}
+
+bool CurvePath_FromSamples(CurvePath* path, const void* source, unsigned generation, const SampleList* curve,
+                           double tolerance, double margin, double scale, double centerX, double centerY,
+                           int width, int height) {
+    if (path->valid && curve && path->source == source && path->sourceGeneration == generation &&
+        path->tolerance == tolerance && path->margin == margin && path->scale == scale &&
+        path->centerX == centerX && path->centerY == centerY && path->width == width && path->height == height) {
+        return false;
+    }
+    path->source = source;
+    path->sourceGeneration = generation;
+    path->tolerance = tolerance;
+    path->margin = margin;
+    path->scale = scale;
+    path->centerX = centerX;
+    path->centerY = centerY;
+    path->width = width;
+    path->height = height;
+    path->generation++;
+    path->count = 0;
+    path->runCount = 0;
+    path->input = 0;
+    path->clipped = 0;
+    path->simplified = 0;
+    path->valid = false;
+    if (!curve) {
+        path->valid = true;
+        return true;
+    }
+
+    double lo = -margin, hiX = width + margin, hiY = height + margin;
+    double halfWidth = width / 2.0;
+    double halfHeight = height / 2.0;
+    bool open = false; // whether the last run can take the next segment
+    for (int i = 1; i < curve->count; i++) {
+        const SamplePoint* a = &curve->data[i - 1];
+        const SamplePoint* b = &curve->data[i];
+        if (b->join != JOIN_CONTINUOUS || !isfinite(a->y) || !isfinite(b->y)) {
+            open = false;
+            continue;
+        }
+        double x0 = (a->x - centerX) * scale + halfWidth;
+        double y0 = halfHeight - (a->y - centerY) * scale;
+        double x1 = (b->x - centerX) * scale + halfWidth;
+        double y1 = halfHeight - (b->y - centerY) * scale;
+        double t0, t1;
+        if (!Clip(x0, y0, x1, y1, lo, hiX, hiY, &t0, &t1)) {
+            open = false;
+            continue;
+        }
+        if (t0 > 0.0 || !open) {
+            if (!StartRun(path) || !Add(path, x0 + (x1 - x0) * t0, y0 + (y1 - y0) * t0)) return true;
+        }
+        if (!Add(path, x0 + (x1 - x0) * t1, y0 + (y1 - y0) * t1)) return true;
+        open = t1 == 1.0;
+    }
+    EndRun(path);
+    path->input = curve->count;
+    path->clipped = curve->count - path->count;
+    if (path->count == 0) {
+        // nothing in view, and maybe no scratch yet to simplify with
+        path->valid = true;
+        return true;
+    }
+
+    if (!Grow((void**)&path->keep, &path->scratchCapacity, path->count, sizeof(unsigned char))) return true;
+    // every pending pair ends at a different kept point, so there are never more pairs than points
+    int* stack = (int*)realloc(path->stack, (size_t)(2 * path->scratchCapacity + 4) * sizeof(int));
+    if (!stack) return true;
+    path->stack = stack;
+    memset(path->keep, 0, path->count);
+    for (int r = 0; r < path->runCount; r++) {
+        int end = r + 1 < path->runCount ? path->runs[r + 1] : path->count;
+        Simplify(path, path->runs[r], end - 1);
+    }
+
+    // squeeze out what was dropped, runs keep at least their two ends
+    int kept = 0;
+    for (int r = 0; r < path->runCount; r++) {
+        int end = r + 1 < path->runCount ? path->runs[r + 1] : path->count;
+        int start = path->runs[r];
+        path->runs[r] = kept;
+        for (int i = start; i < end; i++) {
+            if (!path->keep[i]) continue;
+            path->xy[2 * kept] = path->xy[2 * i];
+            path->xy[2 * kept + 1] = path->xy[2 * i + 1];
+            kept++;
+        }
+    }
+    path->simplified = path->count - kept;
+    path->count = kept;
+    path->valid = true;
+    return true;
+}
+
+void CurvePath_Free(CurvePath* path) {
+    free(path->xy);
+    free(path->runs);
+    free(path->keep);
+    free(path->stack);
+    CurvePath_Init(path);
+}
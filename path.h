@@ -0,0 +1,48 @@
+#ifndef PATH_H
+#define PATH_H
+
+#include "samples.h"
+#include <stdbool.h>
+
+// the visible part of a sampled curve in screen space, between sampling and drawing.
+// segments are clipped to the view and every run is simplified so no dropped point is
+// further than the tolerance from the line, so straight stretches cost two vertices
+// however many samples they took
+typedef struct {
+    double* xy;   // x, y per point
+    int count;
+    int capacity;
+    int* runs;    // first point of each run, the last run ends at count
+    int runCount;
+    int runCapacity;
+    unsigned generation; // bumped on every rebuild
+    // stats of the last rebuild
+    int input;      // samples that went in
+    int clipped;    // dropped because they were off screen
+    int simplified; // dropped because they were within the tolerance
+    // scratch
+    unsigned char* keep;
+    int* stack;
+    int scratchCapacity;
+    // what it was built from
+    const void* source;
+    unsigned sourceGeneration;
+    double tolerance, margin;
+    double scale, centerX, centerY;
+    int width, height;
+    bool valid;
+} CurvePath;
+
+void CurvePath_Init(CurvePath* path);
+// clips to the view grown by margin pixels on every side, breaks at gaps and joins that
+// aren't continuous, then simplifies to tolerance pixels. returns true when it was rebuilt
+bool CurvePath_FromCurve(CurvePath* path, const SampleCache* cache, double tolerance, double margin,
+                         double scale, double centerX, double centerY, int width, int height);
+// the same for any polyline in world space, such as a parametric curve. source and
+// generation say when it changed, NULL for a curve that isn't there
+bool CurvePath_FromSamples(CurvePath* path, const void* source, unsigned generation, const SampleList* curve,
+                           double tolerance, double margin, double scale, double centerX, double centerY,
+                           int width, int height);
+void CurvePath_Free(CurvePath* path);
+
+#endif
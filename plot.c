@@ -0,0 +1,141 @@
+// renders equations to png or ppm without a window
+//   plot [options] equation...
+//   plot [options] -b jobs.txt     one picture per line: "out.png; equation; equation..."
+// build: make plot
+#include "headless.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define PLOT_MAX_EQUATIONS 64
+#define PLOT_MAX_LINE 4096
+
+static void Usage(const char* name) {
+    fprintf(stderr,
+            "usage: %s [options] equation...\n"
+            "  -o FILE     output, .png or .ppm (plot.png)\n"
+            "  -s WxH      size in pixels (1920x1080)\n"
+            "  -c X,Y      center of the view (0,0)\n"
+            "  -z SCALE    pixels per unit (40 at 1080 rows, grows with the height)\n"
+            "  -t T        value of t (0)\n"
+            "  -j N        threads, 0 for one per core (0)\n"
+            "  -b FILE     batch, one picture per line: out.png; equation; equation...\n",
+            name);
+}
+
+static char* Trim(char* s) {
+    while (*s == ' ' || *s == '\t') s++;
+    char* end = s + strlen(s);
+    while (end > s && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r' || end[-1] == '\n')) end--;
+    *end = '\0';
+    return s;
+}
+
+static bool RenderOne(HeadlessRenderer* r, HeadlessJob* job, const char* path) {
+    if (!Headless_Render(r, job)) {
+        fprintf(stderr, "%s: out of memory\n", path);
+        return false;
+    }
+    if (!Canvas_Write(&r->canvas, path)) {
+        fprintf(stderr, "%s: can't write\n", path);
+        return false;
+    }
+    return true;
+}
+
+// "x,y" with every digit kept, a center deep in a zoom needs more than a double holds
+static bool ParseCenter(const char* text, GraphState* graph) {
+    char* end;
+    graph->originX = DDouble_Parse(text, &end);
+    if (end == text || *end != ',') return false;
+    text = end + 1;
+    graph->originY = DDouble_Parse(text, &end);
+    return end != text && *end == '\0';
+}
+
+int main(int argc, char** argv) {
+    const char* output = "plot.png";
+    const char* batch = NULL;
+    const char* equations[PLOT_MAX_EQUATIONS];
+    int equationCount = 0;
+    HeadlessJob job;
+    memset(&job, 0, sizeof(job));
+    job.width = 1920;
+    job.height = 1080;
+    double scale = 0.0;
+    int threads = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        // a leading minus followed by a digit or a dot is a negative equation, not an option
+        bool option = a[0] == '-' && a[1] != '\0' && !(a[1] >= '0' && a[1] <= '9') && a[1] != '.';
+        if (!option) {
+            if (equationCount < PLOT_MAX_EQUATIONS) equations[equationCount++] = a;
+            continue;
+        }
+        bool ok = value != NULL;
+        if (ok && strcmp(a, "-o") == 0) output = value;
+        else if (ok && strcmp(a, "-s") == 0) ok = sscanf(value, "%dx%d", &job.width, &job.height) == 2;
+        else if (ok && strcmp(a, "-c") == 0) ok = ParseCenter(value, &job.graph);
+        else if (ok && strcmp(a, "-z") == 0) scale = atof(value);
+        else if (ok && strcmp(a, "-t") == 0) job.t = atof(value);
+        else if (ok && strcmp(a, "-j") == 0) threads = atoi(value);
+        else if (ok && strcmp(a, "-b") == 0) batch = value;
+        else ok = false;
+        if (!ok) {
+            Usage(argv[0]);
+            return 2;
+        }
+        i++;
+    }
+    if (job.width <= 0 || job.height <= 0 || (!batch && equationCount == 0)) {
+        Usage(argv[0]);
+        return 2;
+    }
+    // the app's 40 pixels per unit, kept in proportion so a bigger picture shows the same area
+    job.graph.scale = scale > 0 ? scale : 40.0 * job.height / 1080.0;
+    GraphState_Recenter(&job.graph);
+
+    ThreadPool* pool = Pool_Create(threads);
+    HeadlessRenderer r;
+    Headless_Init(&r, pool);
+    struct timespec start, end;
+    timespec_get(&start, TIME_UTC);
+    int done = 0, failed = 0;
+
+    if (!batch) {
+        job.equations = equations;
+        job.equationCount = equationCount;
+        if (RenderOne(&r, &job, output)) done++;
+        else failed++;
+    } else {
+        FILE* file = strcmp(batch, "-") == 0 ? stdin : fopen(batch, "r");
+        if (!file) {
+            fprintf(stderr, "%s: can't open\n", batch);
+            failed++;
+        }
+        static char line[PLOT_MAX_LINE];
+        while (file && fgets(line, sizeof(line), file)) {
+            char* fields[PLOT_MAX_EQUATIONS + 1];
+            int n = 0;
+            for (char* f = strtok(line, ";"); f && n <= PLOT_MAX_EQUATIONS; f = strtok(NULL, ";")) {
+                fields[n++] = Trim(f);
+            }
+            if (n == 0 || fields[0][0] == '\0' || fields[0][0] == '#') continue;
+            job.equations = (const char* const*)(fields + 1);
+            job.equationCount = n - 1;
+            if (RenderOne(&r, &job, fields[0])) done++;
+            else failed++;
+        }
+        if (file && file != stdin) fclose(file);
+    }
+
+    timespec_get(&end, TIME_UTC);
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+    fprintf(stderr, "%d plots at %dx%d in %.3f s on %d threads\n", done, job.width, job.height, seconds, Pool_WorkerCount(pool));
+    Headless_Free(&r);
+    Pool_Destroy(pool);
+    return failed ? 1 : 0;
+}
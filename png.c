@@ -0,0 +1,183 @@
+#include "png.h"
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    uint8_t* data;
+    size_t count;
+    size_t capacity;
+    uint32_t bits;  // pending bits, lsb first
+    int bitCount;
+    bool ok;
+} BitWriter;
+
+static void PutByte(BitWriter* w, uint8_t b) {
+    if (w->count == w->capacity) {
+        size_t capacity = w->capacity ? w->capacity * 2 : 65536;
+        uint8_t* data = (uint8_t*)realloc(w->data, capacity);
+        if (!data) {
+            w->ok = false;
+            return;
+        }
+        w->data = data;
+        w->capacity = capacity;
+    }
+    w->data[w->count++] = b;
+}
+
+static void PutBits(BitWriter* w, uint32_t value, int count) {
+    w->bits |= value << w->bitCount;
+    w->bitCount += count;
+    while (w->bitCount >= 8) {
+        PutByte(w, (uint8_t)w->bits);
+        w->bits >>= 8;
+        w->bitCount -= 8;
+    }
+}
+
+// huffman codes go out most significant bit first
+static void PutCode(BitWriter* w, uint32_t code, int length) {
+    uint32_t reversed = 0;
+    for (int i = 0; i < length; i++) {
+        reversed = (reversed << 1) | ((code >> i) & 1);
+    }
+    PutBits(w, reversed, length);
+}
+
+// the fixed huffman table of deflate
+static void PutSymbol(BitWriter* w, int symbol) {
+    if (symbol < 144) PutCode(w, 0x30 + symbol, 8);
+    else if (symbol < 256) PutCode(w, 0x190 + symbol - 144, 9);
+    else if (symbol < 280) PutCode(w, symbol - 256, 7);
+    else PutCode(w, 0xC0 + symbol - 280, 8);
+}
+
+static const int lengthBase[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const int lengthExtra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+
+// a copy of the byte before, length times
+static void PutRepeat(BitWriter* w, int length) {
+    int code = 28;
+    while (lengthBase[code] > length) code--;
+    PutSymbol(w, 257 + code);
+    if (lengthExtra[code]) PutBits(w, (uint32_t)(length - lengthBase[code]), lengthExtra[code]);
+    PutCode(w, 0, 5); // distance 1
+}
+
+static void Deflate(BitWriter* w, const uint8_t* data, int n) {
+    int i = 0;
+    while (i < n) {
+        PutSymbol(w, data[i]);
+        int run = 0;
+        while (i + 1 + run < n && data[i + 1 + run] == data[i]) run++;
+        i++;
+        while (run >= 3) {
+            int length = run > 258 ? 258 : run;
+            // never leave a tail of 1 or 2 that would need literals when one more repeat fits
+            if (run - length > 0 && run - length < 3) length = run - 3;
+            PutRepeat(w, length);
+            run -= length;
+            i += length;
+        }
+    }
+}
+
+static uint32_t crcTable[256];
+
+static void InitCrc(void) {
+    if (crcTable[1]) return;
+    for (uint32_t n = 0; n < 256; n++) {
+        uint32_t c = n;
+        for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        crcTable[n] = c;
+    }
+}
+
+static uint32_t Crc(uint32_t crc, const uint8_t* data, size_t n) {
+    crc = ~crc;
+    for (size_t i = 0; i < n; i++) crc = crcTable[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+static void Put32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+static bool WriteChunk(FILE* file, const char* type, const uint8_t* data, size_t n) {
+    uint8_t header[8];
+    uint8_t footer[4];
+    Put32(header, (uint32_t)n);
+    memcpy(header + 4, type, 4);
+    uint32_t crc = Crc(Crc(0, header + 4, 4), data, n);
+    Put32(footer, crc);
+    return fwrite(header, 1, 8, file) == 8 && (n == 0 || fwrite(data, 1, n, file) == n) && fwrite(footer, 1, 4, file) == 4;
+}
+
+// filters one row with sub or up, whichever leaves smaller bytes
+static void FilterRow(const uint8_t* row, const uint8_t* above, int stride, uint8_t* out) {
+    long subCost = 0, upCost = 0;
+    for (int i = 0; i < stride; i++) {
+        int8_t sub = (int8_t)(row[i] - (i >= 3 ? row[i - 3] : 0));
+        int8_t up = (int8_t)(row[i] - (above ? above[i] : 0));
+        subCost += sub < 0 ? -sub : sub;
+        upCost += up < 0 ? -up : up;
+    }
+    bool useUp = above && upCost < subCost;
+    out[0] = useUp ? 2 : 1;
+    for (int i = 0; i < stride; i++) {
+        out[1 + i] = useUp ? (uint8_t)(row[i] - above[i]) : (uint8_t)(row[i] - (i >= 3 ? row[i - 3] : 0));
+    }
+}
+
+bool Png_Write(FILE* file, const uint8_t* rgb, int width, int height) {
+    InitCrc();
+    int stride = 3 * width;
+    uint8_t* filtered = (uint8_t*)malloc((size_t)stride + 1);
+    if (!filtered) return false;
+
+    BitWriter w = { 0 };
+    w.ok = true;
+    PutByte(&w, 0x78); // zlib, deflate with a 32k window
+    PutByte(&w, 0x01);
+    PutBits(&w, 1, 1); // the only block, fixed huffman
+    PutBits(&w, 1, 2);
+    uint32_t a = 1, b = 0;
+    for (int y = 0; y < height && w.ok; y++) {
+        const uint8_t* row = rgb + (size_t)y * stride;
+        FilterRow(row, y > 0 ? row - stride : NULL, stride, filtered);
+        for (int i = 0; i <= stride; i++) {
+            a = (a + filtered[i]) % 65521;
+            b = (b + a) % 65521;
+        }
+        Deflate(&w, filtered, stride + 1);
+    }
+    PutSymbol(&w, 256);
+    if (w.bitCount) PutBits(&w, 0, 8 - w.bitCount);
+    uint8_t adler[4];
+    Put32(adler, (b << 16) | a);
+    for (int i = 0; i < 4; i++) PutByte(&w, adler[i]);
+    free(filtered);
+
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    uint8_t ihdr[13];
+    Put32(ihdr, (uint32_t)width);
+    Put32(ihdr + 4, (uint32_t)height);
+    ihdr[8] = 8;  // bits per channel
+    ihdr[9] = 2;  // rgb
+    ihdr[10] = 0;
+    ihdr[11] = 0;
+    ihdr[12] = 0;
+    bool ok = w.ok && fwrite(signature, 1, 8, file) == 8 && WriteChunk(file, "IHDR", ihdr, sizeof(ihdr)) &&
+              WriteChunk(file, "IDAT", w.data, w.count) && WriteChunk(file, "IEND", NULL, 0);
+    free(w.data);
+    return ok;
+}
@@ -0,0 +1,13 @@
+#ifndef PNG_H
+#define PNG_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// 8 bit rgb, rows top to bottom with no padding. compressed with a small built in deflate
+// that only looks for repeats of the byte before, which is most of a plot once rows are
+// filtered, so there's no zlib dependency
+bool Png_Write(FILE* file, const uint8_t* rgb, int width, int height);
+
+#endif
@@ -0,0 +1,599 @@
+#define _DEFAULT_SOURCE // mmap under strict -std modes
+#include "points.h"
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+typedef struct {
+    const uint8_t* data;
+    size_t size;
+    HANDLE file;
+    HANDLE mapping;
+} MappedFile;
+
+static bool MapFile(MappedFile* m, const char* filename) {
+    memset(m, 0, sizeof(*m));
+    m->file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (m->file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(m->file, &size)) {
+        CloseHandle(m->file);
+        return false;
+    }
+    m->size = (size_t)size.QuadPart;
+    if (m->size == 0) return true; // nothing to map, and an empty mapping is an error
+    m->mapping = CreateFileMappingA(m->file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (m->mapping) m->data = (const uint8_t*)MapViewOfFile(m->mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!m->data) {
+        if (m->mapping) CloseHandle(m->mapping);
+        CloseHandle(m->file);
+        return false;
+    }
+    return true;
+}
+
+static void UnmapFile(MappedFile* m) {
+    if (m->data) UnmapViewOfFile(m->data);
+    if (m->mapping) CloseHandle(m->mapping);
+    CloseHandle(m->file);
+}
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+typedef struct {
+    const uint8_t* data;
+    size_t size;
+} MappedFile;
+
+static bool MapFile(MappedFile* m, const char* filename) {
+    memset(m, 0, sizeof(*m));
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        return false;
+    }
+    m->size = (size_t)info.st_size;
+    if (m->size > 0) {
+        void* p = mmap(NULL, m->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            close(fd);
+            return false;
+        }
+        madvise(p, m->size, MADV_SEQUENTIAL);
+        m->data = (const uint8_t*)p;
+    }
+    // the mapping keeps the file
+    close(fd);
+    return true;
+}
+
+static void UnmapFile(MappedFile* m) {
+    if (m->data) munmap((void*)m->data, m->size);
+}
+#endif
+
+#define POINTS_CELLS (1u << POINTS_DEPTH) // a side, at the bottom level
+#define POINTS_CHUNK_BYTES (1 << 20)      // of text per parsing task, at least
+
+static bool Grow(void** data, int* capacity, int count, size_t itemSize) {
+    if (count <= *capacity) return true;
+    int newCapacity = *capacity ? *capacity : 256;
+    while (newCapacity < count) newCapacity = (newCapacity > INT_MAX / 2) ? INT_MAX : newCapacity * 2;
+    void* p = realloc(*data, (size_t)newCapacity * itemSize);
+    if (!p) return false;
+    *data = p;
+    *capacity = newCapacity;
+    return true;
+}
+
+static bool Reserve(PointCloud* pc, int count) {
+    if (count <= pc->capacity) return true;
+    int capacity = pc->capacity;
+    if (!Grow((void**)&pc->xs, &capacity, count, sizeof(double))) return false;
+    capacity = pc->capacity;
+    if (!Grow((void**)&pc->ys, &capacity, count, sizeof(double))) return false;
+    pc->capacity = capacity;
+    return true;
+}
+
+static void FreeLevels(PointCloud* pc) {
+    for (int d = 0; d <= POINTS_INDEX_DEPTH; d++) {
+        PointLevel* level = &pc->levels[d];
+        free(level->keys);
+        free(level->first);
+        free(level->children);
+        free(level->meanX);
+        free(level->meanY);
+        memset(level, 0, sizeof(*level));
+    }
+}
+
+void PointCloud_Init(PointCloud* pc) {
+    memset(pc, 0, sizeof(*pc));
+    pc->size = 1.0;
+    pc->indexed = true;
+}
+
+bool PointCloud_Add(PointCloud* pc, double x, double y) {
+    if (!isfinite(x) || !isfinite(y)) return false;
+    if (pc->count == INT_MAX || !Reserve(pc, pc->count + 1)) return false;
+    pc->xs[pc->count] = x;
+    pc->ys[pc->count] = y;
+    pc->count++;
+    pc->indexed = false;
+    return true;
+}
+
+// byte by byte, so the files are the same on any host
+static double GetDouble(const uint8_t* p) {
+    uint64_t bits = 0;
+    for (int i = 0; i < 8; i++) bits |= (uint64_t)p[i] << (8 * i);
+    double v;
+    memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+static void LoadBinary(PointCloud* pc, const uint8_t* data, size_t size) {
+    size_t pairs = size / (2 * sizeof(double));
+    if (pairs > (size_t)(INT_MAX - pc->count)) pairs = (size_t)(INT_MAX - pc->count);
+    if (!Reserve(pc, pc->count + (int)pairs)) return;
+    for (size_t i = 0; i < pairs; i++) {
+        double x = GetDouble(data + i * 2 * sizeof(double));
+        double y = GetDouble(data + i * 2 * sizeof(double) + sizeof(double));
+        if (!isfinite(x) || !isfinite(y)) continue;
+        pc->xs[pc->count] = x;
+        pc->ys[pc->count] = y;
+        pc->count++;
+    }
+}
+
+static bool IsSeparator(char c) {
+    return c == ' ' || c == '\t' || c == ',' || c == ';' || c == '\r';
+}
+
+static const char* SkipSeparators(const char* p, const char* end) {
+    while (p < end && IsSeparator(*p)) p++;
+    return p;
+}
+
+// a number that ends at a separator or the end of the line, NULL when there's none. up to
+// 19 digits and powers of ten up to 22 both are exact in a double, so one multiply or divide
+// rounds right and only the rest goes through strtod
+static const char* ParseNumber(const char* p, const char* end, double* v) {
+    static const double powers[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    const char* start = p;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) negative = (*p++ == '-');
+    uint64_t mantissa = 0;
+    int digits = 0, exponent = 0;
+    bool any = false, exact = true;
+    for (bool fraction = false; p < end; p++) {
+        if (*p == '.' && !fraction) {
+            fraction = true;
+            continue;
+        }
+        if (*p < '0' || *p > '9') break;
+        any = true;
+        if (digits < 19) {
+            mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+            if (mantissa) digits++;
+            if (fraction) exponent--;
+        } else {
+            if (*p != '0') exact = false;
+            if (!fraction) exponent++;
+        }
+    }
+    if (!any) return NULL;
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char* e = p + 1;
+        bool negativeExp = false;
+        if (e < end && (*e == '-' || *e == '+')) negativeExp = (*e++ == '-');
+        if (e < end && *e >= '0' && *e <= '9') {
+            int value = 0;
+            for (; e < end && *e >= '0' && *e <= '9'; e++) {
+                if (value < 100000) value = value * 10 + (*e - '0');
+            }
+            exponent += negativeExp ? -value : value;
+            p = e;
+        }
+    }
+    if (p < end && !IsSeparator(*p) && *p != '\n') return NULL;
+
+    if (exact && mantissa <= (1ull << 53) && exponent >= -22 && exponent <= 22) {
+        double m = (double)mantissa;
+        *v = (exponent < 0) ? m / powers[-exponent] : m * powers[exponent];
+        if (negative) *v = -*v;
+        return p;
+    }
+    char buffer[128];
+    size_t length = (size_t)(p - start);
+    if (length >= sizeof(buffer)) return NULL;
+    memcpy(buffer, start, length);
+    buffer[length] = '\0';
+    *v = strtod(buffer, NULL);
+    return p;
+}
+
+// one piece of a text file, cut at line ends, and the points parsed from it
+typedef struct {
+    const char* from;
+    const char* to;
+    double* xs;
+    double* ys;
+    int count;
+    int capacity;
+} TextChunk;
+
+static void ParseChunk(void* user, int index, int worker) {
+    TextChunk* chunk = &((TextChunk*)user)[index];
+    (void)worker;
+    for (const char* p = chunk->from; p < chunk->to; ) {
+        const char* lineEnd = (const char*)memchr(p, '\n', (size_t)(chunk->to - p));
+        if (!lineEnd) lineEnd = chunk->to;
+        double x, y;
+        const char* q = ParseNumber(SkipSeparators(p, lineEnd), lineEnd, &x);
+        if (q) q = ParseNumber(SkipSeparators(q, lineEnd), lineEnd, &y);
+        p = lineEnd + 1;
+        if (!q || !isfinite(x) || !isfinite(y) || chunk->count == INT_MAX) continue;
+        if (chunk->count == chunk->capacity) {
+            int capacity = chunk->capacity;
+            if (!Grow((void**)&chunk->xs, &capacity, chunk->count + 1, sizeof(double))) break;
+            capacity = chunk->capacity;
+            if (!Grow((void**)&chunk->ys, &capacity, chunk->count + 1, sizeof(double))) break;
+            chunk->capacity = capacity;
+        }
+        chunk->xs[chunk->count] = x;
+        chunk->ys[chunk->count] = y;
+        chunk->count++;
+    }
+}
+
+static void LoadText(PointCloud* pc, const char* text, size_t size, ThreadPool* pool) {
+    size_t pieces = size / POINTS_CHUNK_BYTES + 1;
+    size_t most = (size_t)Pool_WorkerCount(pool) * 4;
+    if (pieces > most) pieces = most;
+    TextChunk* chunks = (TextChunk*)calloc(pieces, sizeof(TextChunk));
+    PoolTask* tasks = (PoolTask*)malloc(pieces * sizeof(PoolTask));
+    if (!chunks || !tasks) {
+        free(chunks);
+        free(tasks);
+        return;
+    }
+    const char* end = text + size;
+    const char* from = text;
+    for (size_t i = 0; i < pieces; i++) {
+        const char* to = (i + 1 == pieces) ? end : text + size / pieces * (i + 1);
+        if (to < from) to = from;
+        const char* lineEnd = (const char*)memchr(to, '\n', (size_t)(end - to));
+        to = lineEnd ? lineEnd + 1 : end;
+        chunks[i].from = from;
+        chunks[i].to = to;
+        tasks[i] = (PoolTask){ ParseChunk, chunks, (int)i };
+        from = to;
+    }
+    Pool_Run(pool, tasks, (int)pieces);
+
+    int64_t total = pc->count;
+    for (size_t i = 0; i < pieces; i++) total += chunks[i].count;
+    if (total > INT_MAX) total = INT_MAX;
+    if (Reserve(pc, (int)total)) {
+        for (size_t i = 0; i < pieces; i++) {
+            int n = chunks[i].count;
+            if (n > (int)total - pc->count) n = (int)total - pc->count;
+            if (n <= 0) break;
+            memcpy(pc->xs + pc->count, chunks[i].xs, (size_t)n * sizeof(double));
+            memcpy(pc->ys + pc->count, chunks[i].ys, (size_t)n * sizeof(double));
+            pc->count += n;
+        }
+    }
+    for (size_t i = 0; i < pieces; i++) {
+        free(chunks[i].xs);
+        free(chunks[i].ys);
+    }
+    free(chunks);
+    free(tasks);
+}
+
+static bool EndsWith(const char* text, const char* suffix) {
+    size_t n = strlen(text), m = strlen(suffix);
+    if (n < m) return false;
+    for (size_t i = 0; i < m; i++) {
+        char c = text[n - m + i];
+        if (c >= 'A' && c <= 'Z') c = (char)(c - 'A' + 'a');
+        if (c != suffix[i]) return false;
+    }
+    return true;
+}
+
+int PointCloud_Load(PointCloud* pc, const char* filename, ThreadPool* pool) {
+    MappedFile file;
+    if (!MapFile(&file, filename)) return -1;
+    int before = pc->count;
+    if (file.data) {
+        if (EndsWith(filename, ".bin")) LoadBinary(pc, file.data, file.size);
+        else LoadText(pc, (const char*)file.data, file.size, pool);
+    }
+    UnmapFile(&file);
+    if (pc->count != before) pc->indexed = false;
+    return pc->count - before;
+}
+
+// the bits of a 16 bit number spread out to every other bit, and back
+static uint32_t Spread(uint32_t v) {
+    v &= 0xFFFF;
+    v = (v | (v << 8)) & 0x00FF00FF;
+    v = (v | (v << 4)) & 0x0F0F0F0F;
+    v = (v | (v << 2)) & 0x33333333;
+    v = (v | (v << 1)) & 0x55555555;
+    return v;
+}
+
+static uint32_t Compact(uint32_t v) {
+    v &= 0x55555555;
+    v = (v | (v >> 1)) & 0x33333333;
+    v = (v | (v >> 2)) & 0x0F0F0F0F;
+    v = (v | (v >> 4)) & 0x00FF00FF;
+    v = (v | (v >> 8)) & 0x0000FFFF;
+    return v;
+}
+
+static uint32_t Column(double c) {
+    if (!(c > 0)) return 0;
+    if (c >= POINTS_CELLS - 1) return POINTS_CELLS - 1;
+    return (uint32_t)c;
+}
+
+// the codes and the points in Morton order. each code is sorted with its point's index
+// in the low half, three passes of an 11 bit radix sort keep the buckets in cache. the
+// scratch of the sort takes the points on their way back and then the codes, so millions of points don't fault in any more memory than the two buffers of keys
+static bool SortPoints(PointCloud* pc) {
+    int n = pc->count;
+    uint64_t* keys = (uint64_t*)malloc((size_t)n * sizeof(uint64_t));
+    uint64_t* scratch = (uint64_t*)malloc((size_t)n * sizeof(uint64_t));
+    if (!keys || !scratch) {
+        free(keys);
+        free(scratch);
+        return false;
+    }
+    static int offsets[3][2048];
+    memset(offsets, 0, sizeof(offsets));
+    double scale = POINTS_CELLS / pc->size;
+    for (int i = 0; i < n; i++) {
+        uint32_t code = Spread(Column((pc->xs[i] - pc->minX) * scale)) | (Spread(Column((pc->ys[i] - pc->minY) * scale)) << 1);
+        keys[i] = ((uint64_t)code << 32) | (uint32_t)i;
+        for (int pass = 0; pass < 3; pass++) offsets[pass][(code >> (11 * pass)) & 2047]++;
+    }
+    for (int pass = 0; pass < 3; pass++) {
+        int sum = 0;
+        for (int b = 0; b < 2048; b++) {
+            int c = offsets[pass][b];
+            offsets[pass][b] = sum;
+            sum += c;
+        }
+        for (int i = 0; i < n; i++) {
+            uint64_t key = keys[i];
+            scratch[offsets[pass][(key >> (32 + 11 * pass)) & 2047]++] = key;
+        }
+        uint64_t* t = keys;
+        keys = scratch;
+        scratch = t;
+    }
+    double* moved = (double*)scratch;
+    for (int i = 0; i < n; i++) moved[i] = pc->xs[(uint32_t)keys[i]];
+    memcpy(pc->xs, moved, (size_t)n * sizeof(double));
+    for (int i = 0; i < n; i++) moved[i] = pc->ys[(uint32_t)keys[i]];
+    memcpy(pc->ys, moved, (size_t)n * sizeof(double));
+    uint32_t* codes = (uint32_t*)scratch;
+    for (int i = 0; i < n; i++) codes[i] = (uint32_t)(keys[i] >> 32);
+    free(keys);
+    free(pc->codes);
+    pc->codes = (uint32_t*)realloc(codes, (size_t)n * sizeof(uint32_t));
+    if (!pc->codes) pc->codes = codes;
+    return true;
+}
+
+static bool AllocateLevel(PointLevel* level, int count, bool children) {
+    level->count = count;
+    level->keys = (uint32_t*)malloc((size_t)count * sizeof(uint32_t));
+    level->first = (int*)malloc((size_t)(count + 1) * sizeof(int));
+    level->children = children ? (int*)malloc((size_t)(count + 1) * sizeof(int)) : NULL;
+    level->meanX = (double*)malloc((size_t)count * sizeof(double));
+    level->meanY = (double*)malloc((size_t)count * sizeof(double));
+    return level->keys && level->first && (level->children || !children) && level->meanX && level->meanY;
+}
+
+// the last kept level from the points, every other one from the level under it
+static bool BuildLevels(PointCloud* pc) {
+    int shift = 2 * (POINTS_DEPTH - POINTS_INDEX_DEPTH);
+    PointLevel* level = &pc->levels[POINTS_INDEX_DEPTH];
+    int cells = 0;
+    for (int i = 0; i < pc->count; i++) {
+        if (i == 0 || (pc->codes[i] >> shift) != (pc->codes[i - 1] >> shift)) cells++;
+    }
+    if (!AllocateLevel(level, cells, false)) return false;
+    int c = -1;
+    for (int i = 0; i < pc->count; i++) {
+        uint32_t key = pc->codes[i] >> shift;
+        if (c < 0 || key != level->keys[c]) {
+            c++;
+            level->keys[c] = key;
+            level->first[c] = i;
+            level->meanX[c] = 0.0;
+            level->meanY[c] = 0.0;
+        }
+        level->meanX[c] += pc->xs[i];
+        level->meanY[c] += pc->ys[i];
+    }
+    level->first[cells] = pc->count;
+    for (c = 0; c < cells; c++) {
+        double n = level->first[c + 1] - level->first[c];
+        level->meanX[c] /= n;
+        level->meanY[c] /= n;
+    }
+
+    for (int d = POINTS_INDEX_DEPTH - 1; d >= 0; d--) {
+        const PointLevel* below = &pc->levels[d + 1];
+        level = &pc->levels[d];
+        cells = 0;
+        for (int j = 0; j < below->count; j++) {
+            if (j == 0 || (below->keys[j] >> 2) != (below->keys[j - 1] >> 2)) cells++;
+        }
+        if (!AllocateLevel(level, cells, true)) return false;
+        c = -1;
+        for (int j = 0; j < below->count; j++) {
+            uint32_t key = below->keys[j] >> 2;
+            if (c < 0 || key != level->keys[c]) {
+                c++;
+                level->keys[c] = key;
+                level->first[c] = below->first[j];
+                level->children[c] = j;
+                level->meanX[c] = 0.0;
+                level->meanY[c] = 0.0;
+            }
+            double n = below->first[j + 1] - below->first[j];
+            level->meanX[c] += below->meanX[j] * n;
+            level->meanY[c] += below->meanY[j] * n;
+        }
+        level->first[cells] = pc->count;
+        level->children[cells] = below->count;
+        for (c = 0; c < cells; c++) {
+            double n = level->first[c + 1] - level->first[c];
+            level->meanX[c] /= n;
+            level->meanY[c] /= n;
+        }
+    }
+    return true;
+}
+
+void PointCloud_Build(PointCloud* pc) {
+    FreeLevels(pc);
+    pc->indexed = false;
+    if (pc->count == 0) {
+        pc->indexed = true;
+        return;
+    }
+    double minX = pc->xs[0], maxX = pc->xs[0], minY = pc->ys[0], maxY = pc->ys[0];
+    for (int i = 1; i < pc->count; i++) {
+        if (pc->xs[i] < minX) minX = pc->xs[i];
+        if (pc->xs[i] > maxX) maxX = pc->xs[i];
+        if (pc->ys[i] < minY) minY = pc->ys[i];
+        if (pc->ys[i] > maxY) maxY = pc->ys[i];
+    }
+    pc->minX = minX;
+    pc->minY = minY;
+    pc->maxX = maxX;
+    pc->maxY = maxY;
+    pc->size = fmax(maxX - minX, maxY - minY);
+    if (!(pc->size > 0) || !isfinite(pc->size)) pc->size = 1.0;
+
+    if (!SortPoints(pc) || !BuildLevels(pc)) {
+        FreeLevels(pc);
+        return;
+    }
+    pc->indexed = true;
+}
+
+typedef struct {
+    const PointCloud* pc;
+    double xMin, xMax, yMin, yMax;
+    double cellSize;
+    PointMarks* out;
+} Query;
+
+static void Emit(PointMarks* out, double x, double y, int count) {
+    if (!Grow((void**)&out->items, &out->capacity, out->count + 1, sizeof(PointMark))) return;
+    out->items[out->count++] = (PointMark){ x, y, count };
+    out->points += count;
+}
+
+// the first of codes[from, to) at or past code
+static int LowerBound(const uint32_t* codes, int from, int to, uint32_t code) {
+    while (from < to) {
+        int mid = from + (to - from) / 2;
+        if (codes[mid] < code) from = mid + 1;
+        else to = mid;
+    }
+    return from;
+}
+
+// a cell of the quadtree, points [first, end). cell is its index in its level, -1 under the
+// kept levels
+static void Visit(const Query* q, int depth, uint32_t key, int first, int end, int cell) {
+    const PointCloud* pc = q->pc;
+    double side = pc->size / (double)(1u << depth);
+    double x0 = pc->minX + Compact(key) * side;
+    double y0 = pc->minY + Compact(key >> 1) * side;
+    // the last column and row also hold whatever was clamped into them
+    double x1 = (Compact(key) + 1 == (1u << depth)) ? INFINITY : x0 + side;
+    double y1 = (Compact(key >> 1) + 1 == (1u << depth)) ? INFINITY : y0 + side;
+    if (x0 > q->xMax || x1 < q->xMin || y0 > q->yMax || y1 < q->yMin) return;
+
+    // a few points are handed out as they are, as long as they aren't more than the cell
+    // has room for cells of cellSize, which keeps the marks to about one a cellSize
+    int count = end - first;
+    bool small = side <= q->cellSize || depth == POINTS_DEPTH;
+    double room = (side / q->cellSize) * (side / q->cellSize);
+    if (count == 1 || (count <= POINTS_LEAF && count <= room)) {
+        for (int i = first; i < end; i++) {
+            double x = pc->xs[i], y = pc->ys[i];
+            if (x >= q->xMin && x <= q->xMax && y >= q->yMin && y <= q->yMax) Emit(q->out, x, y, 1);
+        }
+        return;
+    }
+    if (small) {
+        if (cell >= 0) Emit(q->out, pc->levels[depth].meanX[cell], pc->levels[depth].meanY[cell], count);
+        else Emit(q->out, x0 + side / 2, y0 + side / 2, count);
+        return;
+    }
+    if (depth < POINTS_INDEX_DEPTH) {
+        const PointLevel* level = &pc->levels[depth];
+        const PointLevel* below = &pc->levels[depth + 1];
+        for (int c = level->children[cell]; c < level->children[cell + 1]; c++) {
+            Visit(q, depth + 1, below->keys[c], below->first[c], below->first[c + 1], c);
+        }
+        return;
+    }
+    // under the kept levels the children are runs of the codes, found by bisection
+    int shift = 2 * (POINTS_DEPTH - depth - 1);
+    int from = first;
+    for (uint32_t child = 0; child < 4; child++) {
+        uint32_t childKey = key * 4 + child;
+        int to = (child == 3) ? end : LowerBound(pc->codes, from, end, (childKey + 1) << shift);
+        if (to > from) Visit(q, depth + 1, childKey, from, to, -1);
+        from = to;
+    }
+}
+
+void PointCloud_Query(const PointCloud* pc, double xMin, double xMax, double yMin, double yMax, double cellSize, PointMarks* out) {
+    out->count = 0;
+    out->points = 0;
+    if (!pc->indexed || pc->count == 0) return;
+    Query q = { pc, xMin, xMax, yMin, yMax, cellSize, out };
+    Visit(&q, 0, 0, 0, pc->count, 0);
+}
+
+void PointCloud_Free(PointCloud* pc) {
+    FreeLevels(pc);
+    free(pc->xs);
+    free(pc->ys);
+    free(pc->codes);
+    PointCloud_Init(pc);
+}
+
+void PointMarks_Free(PointMarks* marks) {
+    free(marks->items);
+    memset(marks, 0, sizeof(*marks));
+}
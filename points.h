@@ -0,0 +1,68 @@
+#ifndef POINTS_H
+#define POINTS_H
+
+#include "pool.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define POINTS_DEPTH 16       // levels of the quadtree under the root, 65536 cells a side at the bottom
+#define POINTS_INDEX_DEPTH 10 // levels whose cells are kept, deeper ones are found in the codes
+#define POINTS_LEAF 32        // a cell with this many points or fewer hands out the points themselves
+
+// the non-empty cells of one level of the quadtree, in Morton order
+typedef struct {
+    uint32_t* keys;  // the cell's code at this level
+    int* first;      // its first point, count + 1 of them so first[i + 1] ends the cell
+    int* children;   // its first cell in the next level, count + 1 as well. NULL at the last level
+    double* meanX;
+    double* meanY;
+    int count;
+} PointLevel;
+
+// what a query hands out: a point, or a cell of points too small to tell apart
+typedef struct {
+    double x, y; // the point, or the mean of the cell's points
+    int count;   // 1 for a point
+} PointMark;
+
+typedef struct {
+    PointMark* items;
+    int count;
+    int capacity;
+    int64_t points; // the counts of all the marks, roughly what's in view
+} PointMarks;
+
+// any number of points, sorted along a Morton curve over a square around them so every
+// cell of the quadtree is one run of them. the first levels keep their cells with a count
+// and a mean each, so a view of millions of points costs about as many cells as it has
+// pixels, not points
+typedef struct {
+    double* xs;
+    double* ys;
+    uint32_t* codes; // POINTS_DEPTH levels, two bits each
+    int count;
+    int capacity;
+    double minX, minY, size; // the square the codes cover
+    double maxX, maxY;       // and the box of the points in it
+    PointLevel levels[POINTS_INDEX_DEPTH + 1];
+    bool indexed; // false after points were added, until the next Build
+} PointCloud;
+
+void PointCloud_Init(PointCloud* pc);
+// nan and inf are dropped
+bool PointCloud_Add(PointCloud* pc, double x, double y);
+// appends the points in a file, pairs of little-endian doubles when it ends in .bin (what
+// calc -b -x writes) and text otherwise, the first two numbers of each line with spaces,
+// tabs, commas or semicolons between. lines without two numbers, like a header, are
+// skipped. the file is mapped instead of read and text is parsed in chunks on the pool,
+// which may be NULL. returns how many points were added, -1 when the file can't be opened
+int PointCloud_Load(PointCloud* pc, const char* filename, ThreadPool* pool);
+// sorts the points and rebuilds the index, needed after Add or Load before a query
+void PointCloud_Build(PointCloud* pc);
+// the points in a box, where the cells they're in are bigger than cellSize, and the
+// cells that aren't. the marks replace what was in out
+void PointCloud_Query(const PointCloud* pc, double xMin, double xMax, double yMin, double yMax, double cellSize, PointMarks* out);
+void PointCloud_Free(PointCloud* pc);
+void PointMarks_Free(PointMarks* marks);
+
+#endif
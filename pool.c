@@ -0,0 +1,254 @@
+#define _DEFAULT_SOURCE // sysconf core count under strict -std modes
+#include "pool.h"
+#include "vecmath.h"
+#include <stdlib.h>
+#include <stdbool.h>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+typedef CRITICAL_SECTION Mutex;
+typedef CONDITION_VARIABLE Cond;
+typedef HANDLE Thread;
+
+static void MutexInit(Mutex* m) { InitializeCriticalSection(m); }
+static void MutexDestroy(Mutex* m) { DeleteCriticalSection(m); }
+static void MutexLock(Mutex* m) { EnterCriticalSection(m); }
+static void MutexUnlock(Mutex* m) { LeaveCriticalSection(m); }
+static void CondInit(Cond* c) { InitializeConditionVariable(c); }
+static void CondDestroy(Cond* c) { (void)c; }
+static void CondWait(Cond* c, Mutex* m) { SleepConditionVariableCS(c, m, INFINITE); }
+static void CondBroadcast(Cond* c) { WakeAllConditionVariable(c); }
+
+int Pool_CoreCount(void) {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+}
+#else
+#include <pthread.h>
+#include <unistd.h>
+
+typedef pthread_mutex_t Mutex;
+typedef pthread_cond_t Cond;
+typedef pthread_t Thread;
+
+static void MutexInit(Mutex* m) { pthread_mutex_init(m, NULL); }
+static void MutexDestroy(Mutex* m) { pthread_mutex_destroy(m); }
+static void MutexLock(Mutex* m) { pthread_mutex_lock(m); }
+static void MutexUnlock(Mutex* m) { pthread_mutex_unlock(m); }
+static void CondInit(Cond* c) { pthread_cond_init(c, NULL); }
+static void CondDestroy(Cond* c) { pthread_cond_destroy(c); }
+static void CondWait(Cond* c, Mutex* m) { pthread_cond_wait(c, m); }
+static void CondBroadcast(Cond* c) { pthread_cond_broadcast(c); }
+
+int Pool_CoreCount(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return (n > 0) ? (int)n : 1;
+}
+#endif
+
+// tasks [head, tail) of the current batch still queued on one worker. the owner takes
+// from the head, thieves from the tail, so they only meet on the last task. the batch is
+// kept next to the indices, a worker waking up late can't mix one batch with another
+typedef struct {
+    Mutex lock;
+    const PoolTask* tasks;
+    int head;
+    int tail;
+} WorkQueue;
+
+struct ThreadPool;
+
+typedef struct {
+    struct ThreadPool* pool;
+    int index;
+} WorkerArgs;
+
+struct ThreadPool {
+    int workerCount;
+    int threadCount;  // workers minus the caller
+    Thread* threads;
+    WorkerArgs* args;
+    WorkQueue* queues;
+    Mutex lock;       // guards everything below
+    Cond wake;        // a new batch or shutdown
+    Cond done;        // the batch finished
+    unsigned generation;
+    int pending;      // tasks of the batch that haven't finished
+    bool shutdown;
+};
+
+static const PoolTask* TakeOwn(WorkQueue* q) {
+    const PoolTask* task = NULL;
+    MutexLock(&q->lock);
+    if (q->head < q->tail) task = &q->tasks[q->head++];
+    MutexUnlock(&q->lock);
+    return task;
+}
+
+static const PoolTask* Steal(ThreadPool* pool, int self) {
+    for (int i = 1; i < pool->workerCount; i++) {
+        WorkQueue* q = &pool->queues[(self + i) % pool->workerCount];
+        const PoolTask* task = NULL;
+        MutexLock(&q->lock);
+        if (q->head < q->tail) task = &q->tasks[--q->tail];
+        MutexUnlock(&q->lock);
+        if (task) return task;
+    }
+    return NULL;
+}
+
+static void RunBatch(ThreadPool* pool, int self) {
+    int finished = 0;
+    for (;;) {
+        const PoolTask* task = TakeOwn(&pool->queues[self]);
+        if (!task) task = Steal(pool, self);
+        if (!task) break;
+        task->fn(task->user, task->index, self);
+        finished++;
+    }
+    if (finished == 0) return;
+    MutexLock(&pool->lock);
+    pool->pending -= finished;
+    if (pool->pending == 0) CondBroadcast(&pool->done);
+    MutexUnlock(&pool->lock);
+}
+
+static void WorkerLoop(WorkerArgs* args) {
+    ThreadPool* pool = args->pool;
+    unsigned seen = 0;
+    for (;;) {
+        MutexLock(&pool->lock);
+        while (!pool->shutdown && pool->generation == seen) CondWait(&pool->wake, &pool->lock);
+        if (pool->shutdown) {
+            MutexUnlock(&pool->lock);
+            return;
+        }
+        seen = pool->generation;
+        MutexUnlock(&pool->lock);
+        RunBatch(pool, args->index);
+    }
+}
+
+#if defined(_WIN32)
+static DWORD WINAPI WorkerMain(LPVOID arg) {
+    WorkerLoop((WorkerArgs*)arg);
+    return 0;
+}
+
+static bool StartThread(Thread* thread, WorkerArgs* args) {
+    *thread = CreateThread(NULL, 0, WorkerMain, args, 0, NULL);
+    return *thread != NULL;
+}
+
+static void JoinThread(Thread thread) {
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+}
+#else
+static void* WorkerMain(void* arg) {
+    WorkerLoop((WorkerArgs*)arg);
+    return NULL;
+}
+
+static bool StartThread(Thread* thread, WorkerArgs* args) {
+    return pthread_create(thread, NULL, WorkerMain, args) == 0;
+}
+
+static void JoinThread(Thread thread) {
+    pthread_join(thread, NULL);
+}
+#endif
+
+ThreadPool* Pool_Create(int threads) {
+    if (threads <= 0) threads = Pool_CoreCount();
+    if (threads <= 1) return NULL;
+
+    VecMath_Get(); // picks the kernels once, before anyone can race on it
+
+    ThreadPool* pool = (ThreadPool*)calloc(1, sizeof(ThreadPool));
+    if (!pool) return NULL;
+    pool->workerCount = threads;
+    pool->threads = (Thread*)calloc(threads - 1, sizeof(Thread));
+    pool->args = (WorkerArgs*)calloc(threads - 1, sizeof(WorkerArgs));
+    pool->queues = (WorkQueue*)calloc(threads, sizeof(WorkQueue));
+    if (!pool->threads || !pool->args || !pool->queues) {
+        free(pool->threads);
+        free(pool->args);
+        free(pool->queues);
+        free(pool);
+        return NULL;
+    }
+    MutexInit(&pool->lock);
+    CondInit(&pool->wake);
+    CondInit(&pool->done);
+    for (int i = 0; i < threads; i++) {
+        MutexInit(&pool->queues[i].lock);
+    }
+
+    // worker 0 is whoever calls Pool_Run
+    for (int i = 1; i < threads; i++) {
+        pool->args[pool->threadCount] = (WorkerArgs){ pool, i };
+        if (!StartThread(&pool->threads[pool->threadCount], &pool->args[pool->threadCount])) break;
+        pool->threadCount++;
+    }
+    pool->workerCount = pool->threadCount + 1;
+    return pool;
+}
+
+int Pool_WorkerCount(const ThreadPool* pool) {
+    return pool ? pool->workerCount : 1;
+}
+
+void Pool_Run(ThreadPool* pool, const PoolTask* tasks, int count) {
+    if (!pool || pool->workerCount == 1 || count <= 1) {
+        for (int i = 0; i < count; i++) {
+            tasks[i].fn(tasks[i].user, tasks[i].index, 0);
+        }
+        return;
+    }
+
+    // contiguous slices, so neighbouring chunks of one equation tend to stay on one core
+    MutexLock(&pool->lock);
+    for (int i = 0; i < pool->workerCount; i++) {
+        WorkQueue* q = &pool->queues[i];
+        MutexLock(&q->lock);
+        q->tasks = tasks;
+        q->head = (int)((long long)count * i / pool->workerCount);
+        q->tail = (int)((long long)count * (i + 1) / pool->workerCount);
+        MutexUnlock(&q->lock);
+    }
+    pool->pending = count;
+    pool->generation++;
+    CondBroadcast(&pool->wake);
+    MutexUnlock(&pool->lock);
+
+    RunBatch(pool, 0);
+
+    MutexLock(&pool->lock);
+    while (pool->pending > 0) CondWait(&pool->done, &pool->lock);
+    MutexUnlock(&pool->lock);
+}
+
+void Pool_Destroy(ThreadPool* pool) {
+    if (!pool) return;
+    MutexLock(&pool->lock);
+    pool->shutdown = true;
+    CondBroadcast(&pool->wake);
+    MutexUnlock(&pool->lock);
+    for (int i = 0; i < pool->threadCount; i++) {
+        JoinThread(pool->threads[i]);
+    }
+    for (int i = 0; i < pool->workerCount; i++) {
+        MutexDestroy(&pool->queues[i].lock);
+    }
+    MutexDestroy(&pool->lock);
+    CondDestroy(&pool->wake);
+    CondDestroy(&pool->done);
+    free(pool->queues);
+    free(pool->args);
+    free(pool->threads);
+    free(pool);
+}
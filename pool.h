@@ -0,0 +1,26 @@
+#ifndef POOL_H
+#define POOL_H
+
+// persistent worker threads. a batch of tasks is dealt out to one queue per worker and a
+// worker that runs dry steals from the others, so one expensive equation doesn't leave
+// cores idle. the calling thread works on the batch too.
+typedef void (*PoolTaskFn)(void* user, int index, int worker);
+
+typedef struct {
+    PoolTaskFn fn;
+    void* user;
+    int index;
+} PoolTask;
+
+typedef struct ThreadPool ThreadPool;
+
+int Pool_CoreCount(void);
+// threads <= 0 uses one per core. NULL is still a valid pool that runs everything on the caller
+ThreadPool* Pool_Create(int threads);
+// workers including the calling thread, worker indices passed to tasks are below this
+int Pool_WorkerCount(const ThreadPool* pool);
+// returns once every task has run. tasks must not call Pool_Run themselves
+void Pool_Run(ThreadPool* pool, const PoolTask* tasks, int count);
+void Pool_Destroy(ThreadPool* pool);
+
+#endif
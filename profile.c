@@ -0,0 +1,156 @@
+#include "profile.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static const char* stageNames[PROFILE_STAGE_COUNT] = {
+    "frame", "parse", "sample", "shade", "curves", "grid", "ui"
+};
+
+static double Clock(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// equations past the last row share it
+static int Slot(int item) {
+    if (item < 0) return 0;
+    return (item < PROFILE_MAX_ITEMS) ? item + 1 : PROFILE_MAX_ITEMS;
+}
+
+void Profiler_Init(Profiler* p, int workers) {
+    memset(p, 0, sizeof(*p));
+    if (workers < 1) workers = 1;
+    p->workerCount = workers;
+    p->origin = Clock();
+}
+
+void Profiler_SetEnabled(Profiler* p, bool enabled) {
+    if (enabled && !p->workers) {
+        // only allocated once someone looks
+        p->workers = (ProfileWorker*)calloc(p->workerCount, sizeof(ProfileWorker));
+        if (!p->workers) return;
+        for (int i = 0; i < p->workerCount; i++) {
+            p->workers[i].events = (ProfileEvent*)malloc(PROFILE_TRACE_EVENTS * sizeof(ProfileEvent));
+            if (!p->workers[i].events) {
+                Profiler_Free(p);
+                return;
+            }
+        }
+    }
+    p->enabled = enabled;
+}
+
+double Profiler_Now(const Profiler* p) {
+    return p->enabled ? Clock() : 0.0;
+}
+
+void Profiler_Record(Profiler* p, ProfileStage stage, int item, int worker, double start) {
+    // a buffer is only ever written by its own thread, there's none to share
+    if (!p->enabled || worker < 0 || worker >= p->workerCount) return;
+    double end = Clock();
+    ProfileWorker* w = &p->workers[worker];
+    int slot = Slot(item);
+    w->time[stage][slot] += end - start;
+    w->ran[stage][slot] = true;
+
+    ProfileEvent* e = &w->events[w->eventNext];
+    e->start = start - p->origin;
+    e->duration = (float)(end - start);
+    e->stage = (uint8_t)stage;
+    e->item = item < 0 ? -1 : item; // the trace names every equation, the rows share the last
+    w->eventNext = (w->eventNext + 1) % PROFILE_TRACE_EVENTS;
+    if (w->eventCount < PROFILE_TRACE_EVENTS) w->eventCount++;
+}
+
+void Profiler_Count(Profiler* p, ProfileStage stage, ProfileCounter counter, int item, double value) {
+    if (!p->enabled) return;
+    p->frameCounters[stage][Slot(item)][counter] += value;
+}
+
+void Profiler_EndFrame(Profiler* p) {
+    if (!p->enabled) return;
+    for (int stage = 0; stage < PROFILE_STAGE_COUNT; stage++) {
+        for (int slot = 0; slot <= PROFILE_MAX_ITEMS; slot++) {
+            double time = 0.0;
+            bool ran = false;
+            for (int i = 0; i < p->workerCount; i++) {
+                ProfileWorker* w = &p->workers[i];
+                time += w->time[stage][slot];
+                ran = ran || w->ran[stage][slot];
+                w->time[stage][slot] = 0.0;
+                w->ran[stage][slot] = false;
+            }
+            double* counters = p->frameCounters[stage][slot];
+            if (ran) {
+                int k = p->historyNext[stage][slot];
+                p->history[stage][slot][k] = (float)(time * 1000.0);
+                p->historyNext[stage][slot] = (k + 1) % PROFILE_HISTORY;
+                if (p->historyCount[stage][slot] < PROFILE_HISTORY) p->historyCount[stage][slot]++;
+                for (int c = 0; c < PROFILE_COUNTER_COUNT; c++) p->counters[stage][slot][c] = (float)counters[c];
+            }
+            memset(counters, 0, PROFILE_COUNTER_COUNT * sizeof(double));
+        }
+    }
+}
+
+static int CompareFloat(const void* a, const void* b) {
+    float x = *(const float*)a, y = *(const float*)b;
+    return (x > y) - (x < y);
+}
+
+bool Profiler_Stats(const Profiler* p, ProfileStage stage, int item, ProfileStats* stats) {
+    int slot = Slot(item);
+    int n = p->historyCount[stage][slot];
+    if (n == 0) return false;
+    float sorted[PROFILE_HISTORY];
+    memcpy(sorted, p->history[stage][slot], n * sizeof(float));
+    qsort(sorted, n, sizeof(float), CompareFloat);
+    stats->p50 = sorted[(n - 1) / 2];
+    stats->p95 = sorted[(n - 1) * 95 / 100];
+    stats->max = sorted[n - 1];
+    stats->frames = n;
+    memcpy(stats->counters, p->counters[stage][slot], sizeof(stats->counters));
+    return true;
+}
+
+const char* Profiler_StageName(ProfileStage stage) {
+    return stageNames[stage];
+}
+
+bool Profiler_WriteTrace(const Profiler* p, const char* path) {
+    if (!p->workers) return false;
+    FILE* file = fopen(path, "w");
+    if (!file) return false;
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+    for (int i = 0; i < p->workerCount; i++) {
+        const ProfileWorker* w = &p->workers[i];
+        fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s %d\"}}",
+                first ? "" : ",\n", i, i == 0 ? "main" : "worker", i);
+        first = false;
+        // oldest first
+        int start = (w->eventNext - w->eventCount + PROFILE_TRACE_EVENTS) % PROFILE_TRACE_EVENTS;
+        for (int k = 0; k < w->eventCount; k++) {
+            const ProfileEvent* e = &w->events[(start + k) % PROFILE_TRACE_EVENTS];
+            fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f",
+                    stageNames[e->stage], e->item < 0 ? "stage" : "equation", i, e->start * 1e6, e->duration * 1e6);
+            if (e->item >= 0) fprintf(file, ",\"args\":{\"equation\":%d}", e->item);
+            fprintf(file, "}");
+        }
+    }
+    fprintf(file, "\n]}\n");
+    bool ok = !ferror(file);
+    return fclose(file) == 0 && ok;
+}
+
+void Profiler_Free(Profiler* p) {
+    if (p->workers) {
+        for (int i = 0; i < p->workerCount; i++) free(p->workers[i].events);
+    }
+    free(p->workers);
+    p->workers = NULL;
+    p->enabled = false;
+}
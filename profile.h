@@ -0,0 +1,85 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define PROFILE_HISTORY 240        // frames the percentiles are taken over
+#define PROFILE_MAX_ITEMS 16       // equations with rows of their own, later ones share the last
+#define PROFILE_TRACE_EVENTS 16384 // per worker, a trace holds the most recent ones
+
+typedef enum {
+    PROFILE_FRAME,
+    PROFILE_PARSE,
+    PROFILE_SAMPLE,
+    PROFILE_SHADE, // stitching, shading, path and stroke, then drawing the shading
+    PROFILE_CURVES,
+    PROFILE_GRID,
+    PROFILE_UI,
+    PROFILE_STAGE_COUNT
+} ProfileStage;
+
+typedef enum {
+    PROFILE_SAMPLES,    // evaluations
+    PROFILE_DRAW_CALLS,
+    PROFILE_TRIANGLES,
+    PROFILE_COUNTER_COUNT
+} ProfileCounter;
+
+typedef struct {
+    double start; // seconds since Profiler_Init
+    float duration;
+    uint8_t stage;
+    int32_t item; // equation, -1 for the stage as a whole
+} ProfileEvent;
+
+// one per pool worker so tasks record without locking
+typedef struct {
+    double time[PROFILE_STAGE_COUNT][PROFILE_MAX_ITEMS + 1]; // this frame, slot 0 is the whole stage
+    bool ran[PROFILE_STAGE_COUNT][PROFILE_MAX_ITEMS + 1];
+    ProfileEvent* events; // ring
+    int eventNext;
+    int eventCount;
+} ProfileWorker;
+
+typedef struct {
+    float p50, p95, max; // milliseconds
+    int frames;          // recent frames the stage ran in
+    float counters[PROFILE_COUNTER_COUNT]; // in the last of them
+} ProfileStats;
+
+// stage timings and counters per frame, per equation and per worker. everything is a
+// no-op while disabled, a zone costs one branch then
+typedef struct {
+    bool enabled;
+    double origin;
+    int workerCount;
+    ProfileWorker* workers;
+    double frameCounters[PROFILE_STAGE_COUNT][PROFILE_MAX_ITEMS + 1][PROFILE_COUNTER_COUNT];
+    // milliseconds per stage and item over the recent frames it ran in, a ring each
+    float history[PROFILE_STAGE_COUNT][PROFILE_MAX_ITEMS + 1][PROFILE_HISTORY];
+    int historyNext[PROFILE_STAGE_COUNT][PROFILE_MAX_ITEMS + 1];
+    int historyCount[PROFILE_STAGE_COUNT][PROFILE_MAX_ITEMS + 1];
+    float counters[PROFILE_STAGE_COUNT][PROFILE_MAX_ITEMS + 1][PROFILE_COUNTER_COUNT];
+} Profiler;
+
+// workers as in Pool_WorkerCount, the worker index tasks get picks the buffer. zones of a
+// worker past that aren't recorded
+void Profiler_Init(Profiler* p, int workers);
+void Profiler_SetEnabled(Profiler* p, bool enabled);
+// start of a zone, 0 while disabled
+double Profiler_Now(const Profiler* p);
+// end of a zone that started at start. item is an equation or -1
+void Profiler_Record(Profiler* p, ProfileStage stage, int item, int worker, double start);
+// adds to a counter of this frame, from the calling thread only, which is worker 0
+void Profiler_Count(Profiler* p, ProfileStage stage, ProfileCounter counter, int item, double value);
+// folds the frame into the history
+void Profiler_EndFrame(Profiler* p);
+// false when the stage hasn't run for that item lately
+bool Profiler_Stats(const Profiler* p, ProfileStage stage, int item, ProfileStats* stats);
+const char* Profiler_StageName(ProfileStage stage);
+// the recent zones as Chrome trace events, for chrome://tracing or Perfetto
+bool Profiler_WriteTrace(const Profiler* p, const char* path);
+void Profiler_Free(Profiler* p);
+
+#endif
@@ -0,0 +1,177 @@
+#include "raster.h"
+#include "png.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+bool Canvas_Resize(Canvas* canvas, int width, int height) {
+    if (width <= 0 || height <= 0) return false;
+    if (canvas->rgb && canvas->width == width && canvas->height == height) return true;
+    uint8_t* rgb = (uint8_t*)realloc(canvas->rgb, (size_t)width * height * 3);
+    if (!rgb) return false;
+    canvas->rgb = rgb;
+    canvas->width = width;
+    canvas->height = height;
+    return true;
+}
+
+void Canvas_Free(Canvas* canvas) {
+    free(canvas->rgb);
+    canvas->rgb = NULL;
+    canvas->width = 0;
+    canvas->height = 0;
+}
+
+// the clip, cut down to the canvas
+static RasterClip Bounds(const Canvas* canvas, RasterClip clip) {
+    if (clip.x0 < 0) clip.x0 = 0;
+    if (clip.y0 < 0) clip.y0 = 0;
+    if (clip.x1 > canvas->width) clip.x1 = canvas->width;
+    if (clip.y1 > canvas->height) clip.y1 = canvas->height;
+    return clip;
+}
+
+static void Blend(uint8_t* p, RasterColor c) {
+    if (c.a == 255) {
+        p[0] = c.r;
+        p[1] = c.g;
+        p[2] = c.b;
+        return;
+    }
+    int a = c.a, k = 255 - c.a;
+    p[0] = (uint8_t)((p[0] * k + c.r * a + 127) / 255);
+    p[1] = (uint8_t)((p[1] * k + c.g * a + 127) / 255);
+    p[2] = (uint8_t)((p[2] * k + c.b * a + 127) / 255);
+}
+
+void Canvas_Clear(Canvas* canvas, RasterClip clip, RasterColor color) {
+    clip = Bounds(canvas, clip);
+    for (int y = clip.y0; y < clip.y1; y++) {
+        uint8_t* p = canvas->rgb + ((size_t)y * canvas->width + clip.x0) * 3;
+        for (int x = clip.x0; x < clip.x1; x++, p += 3) {
+            p[0] = color.r;
+            p[1] = color.g;
+            p[2] = color.b;
+        }
+    }
+}
+
+void Canvas_FillRect(Canvas* canvas, RasterClip clip, int x, int y, int w, int h, RasterColor color) {
+    clip = Bounds(canvas, clip);
+    int x0 = x > clip.x0 ? x : clip.x0;
+    int y0 = y > clip.y0 ? y : clip.y0;
+    int x1 = x + w < clip.x1 ? x + w : clip.x1;
+    int y1 = y + h < clip.y1 ? y + h : clip.y1;
+    for (int py = y0; py < y1; py++) {
+        uint8_t* p = canvas->rgb + ((size_t)py * canvas->width + x0) * 3;
+        for (int px = x0; px < x1; px++, p += 3) Blend(p, color);
+    }
+}
+
+// an edge owns the pixels exactly on it when it runs down, or right along a horizontal. the
+// neighbour across a shared edge sees it reversed, so one of the two draws each pixel
+static bool Owns(double dx, double dy) {
+    return dy > 0 || (dy == 0 && dx > 0);
+}
+
+static bool Inside(double e, bool owns) {
+    return e > 0 || (e == 0 && owns);
+}
+
+void Canvas_FillTriangles(Canvas* canvas, RasterClip clip, const float* xy, int count, RasterColor color) {
+    clip = Bounds(canvas, clip);
+    for (int t = 0; t + 2 < count; t += 3) {
+        double ax = xy[2 * t], ay = xy[2 * t + 1];
+        double bx = xy[2 * t + 2], by = xy[2 * t + 3];
+        double cx = xy[2 * t + 4], cy = xy[2 * t + 5];
+        double area = (bx - ax) * (cy - ay) - (by - ay) * (cx - ax);
+        if (area == 0 || !isfinite(area)) continue;
+        if (area < 0) {
+            double tx = bx, ty = by;
+            bx = cx; by = cy;
+            cx = tx; cy = ty;
+        }
+
+        // pixel centers sit at +0.5
+        double minX = fmin(ax, fmin(bx, cx)), maxX = fmax(ax, fmax(bx, cx));
+        double minY = fmin(ay, fmin(by, cy)), maxY = fmax(ay, fmax(by, cy));
+        int x0 = (int)fmax(ceil(minX - 0.5), clip.x0);
+        int x1 = (int)fmin(floor(maxX - 0.5) + 1, clip.x1);
+        int y0 = (int)fmax(ceil(minY - 0.5), clip.y0);
+        int y1 = (int)fmin(floor(maxY - 0.5) + 1, clip.y1);
+        if (x0 >= x1 || y0 >= y1) continue;
+
+        bool ownsAB = Owns(bx - ax, by - ay);
+        bool ownsBC = Owns(cx - bx, cy - by);
+        bool ownsCA = Owns(ax - cx, ay - cy);
+        for (int py = y0; py < y1; py++) {
+            double y = py + 0.5;
+            uint8_t* row = canvas->rgb + (size_t)py * canvas->width * 3;
+            for (int px = x0; px < x1; px++) {
+                double x = px + 0.5;
+                double eAB = (bx - ax) * (y - ay) - (by - ay) * (x - ax);
+                double eBC = (cx - bx) * (y - by) - (cy - by) * (x - bx);
+                double eCA = (ax - cx) * (y - cy) - (ay - cy) * (x - cx);
+                if (Inside(eAB, ownsAB) && Inside(eBC, ownsBC) && Inside(eCA, ownsCA)) Blend(row + 3 * px, color);
+            }
+        }
+    }
+}
+
+// rows top to bottom, bit 4 is the leftmost column
+static const struct {
+    char c;
+    uint8_t rows[7];
+} glyphs[] = {
+    { '0', { 0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E } },
+    { '1', { 0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E } },
+    { '2', { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F } },
+    { '3', { 0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E } },
+    { '4', { 0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02 } },
+    { '5', { 0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E } },
+    { '6', { 0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E } },
+    { '7', { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 } },
+    { '8', { 0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E } },
+    { '9', { 0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C } },
+    { '.', { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C } },
+    { '-', { 0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00 } },
+    { '+', { 0x00, 0x04, 0x04, 0x1F, 0x04, 0x04, 0x00 } },
+    { 'e', { 0x00, 0x00, 0x0E, 0x11, 0x1F, 0x10, 0x0E } },
+    { ',', { 0x00, 0x00, 0x00, 0x00, 0x0C, 0x04, 0x08 } },
+    { '(', { 0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02 } },
+    { ')', { 0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08 } },
+};
+
+void Canvas_DrawText(Canvas* canvas, RasterClip clip, const char* text, int x, int y, int size, RasterColor color) {
+    // nothing to do for tiles the line misses
+    if (y >= clip.y1 || y + 7 * size <= clip.y0) return;
+    for (; *text; text++, x += 6 * size) {
+        for (size_t g = 0; g < sizeof(glyphs) / sizeof(glyphs[0]); g++) {
+            if (glyphs[g].c != *text) continue;
+            for (int row = 0; row < 7; row++) {
+                for (int col = 0; col < 5; col++) {
+                    if (glyphs[g].rows[row] & (0x10 >> col)) {
+                        Canvas_FillRect(canvas, clip, x + col * size, y + row * size, size, size, color);
+                    }
+                }
+            }
+            break;
+        }
+    }
+}
+
+bool Canvas_Write(const Canvas* canvas, const char* path) {
+    FILE* file = fopen(path, "wb");
+    if (!file) return false;
+    size_t length = strlen(path);
+    bool ok;
+    if (length >= 4 && strcmp(path + length - 4, ".ppm") == 0) {
+        size_t size = (size_t)canvas->width * canvas->height * 3;
+        ok = fprintf(file, "P6\n%d %d\n255\n", canvas->width, canvas->height) > 0 &&
+             fwrite(canvas->rgb, 1, size, file) == size;
+    } else {
+        ok = Png_Write(file, canvas->rgb, canvas->width, canvas->height);
+    }
+    return fclose(file) == 0 && ok;
+}
@@ -0,0 +1,35 @@
+#ifndef RASTER_H
+#define RASTER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct {
+    uint8_t r, g, b, a;
+} RasterColor;
+
+// an 8 bit rgb image drawn on the cpu. every draw takes a clip rectangle, so separate
+// threads can draw separate tiles of one canvas
+typedef struct {
+    uint8_t* rgb;
+    int width;
+    int height;
+} Canvas;
+
+typedef struct {
+    int x0, y0, x1, y1; // x1 and y1 exclusive
+} RasterClip;
+
+bool Canvas_Resize(Canvas* canvas, int width, int height);
+void Canvas_Free(Canvas* canvas);
+void Canvas_Clear(Canvas* canvas, RasterClip clip, RasterColor color);
+void Canvas_FillRect(Canvas* canvas, RasterClip clip, int x, int y, int w, int h, RasterColor color);
+// triangles as x, y per vertex, either winding. pixels are covered when their center is inside,
+// and a pixel on an edge two triangles share is drawn once, so translucent meshes don't seam
+void Canvas_FillTriangles(Canvas* canvas, RasterClip clip, const float* xy, int count, RasterColor color);
+// a built in 5x7 font with what numbers need: digits, ".-+e,()" and space, each dot size pixels
+void Canvas_DrawText(Canvas* canvas, RasterClip clip, const char* text, int x, int y, int size, RasterColor color);
+// png, or binary ppm when the name ends in .ppm
+bool Canvas_Write(const Canvas* canvas, const char* path);
+
+#endif
@@ -0,0 +1,142 @@
+#include "region.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+void RegionLayer_Init(RegionLayer* layer) {
+    memset(layer, 0, sizeof(*layer));
+}
+
+static bool Reserve(RegionLayer* layer, int count) {
+    if (count <= layer->capacity) return true;
+    int newCapacity = layer->capacity ? layer->capacity : 1024;
+    while (newCapacity < count) newCapacity *= 2;
+    float* xy = (float*)realloc(layer->xy, (size_t)newCapacity * 2 * sizeof(float));
+    if (!xy) return false;
+    layer->xy = xy;
+    layer->capacity = newCapacity;
+    return true;
+}
+
+static void Vertex(RegionLayer* layer, double x, double y) {
+    layer->xy[2 * layer->count] = (float)x;
+    layer->xy[2 * layer->count + 1] = (float)y;
+    layer->count++;
+}
+
+// two triangles, x0 < x1 and each top above its bottom on screen
+static void Quad(RegionLayer* layer, double x0, double top0, double bottom0, double x1, double top1, double bottom1) {
+    Vertex(layer, x0, top0);
+    Vertex(layer, x0, bottom0);
+    Vertex(layer, x1, top1);
+    Vertex(layer, x1, top1);
+    Vertex(layer, x0, bottom0);
+    Vertex(layer, x1, bottom1);
+}
+
+static double Clamp(double v, double lo, double hi) {
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+// shades from the segment to the edge, split where it leaves the screen so clamping is exact
+static void Trapezoid(RegionLayer* layer, double x0, double y0, double x1, double y1, double edge, double height) {
+    double cuts[4];
+    int n = 0;
+    cuts[n++] = 0.0;
+    if (y0 != y1) {
+        double a = (0.0 - y0) / (y1 - y0);
+        double b = (height - y0) / (y1 - y0);
+        if (a > b) { double t = a; a = b; b = t; }
+        if (a > 0.0 && a < 1.0) cuts[n++] = a;
+        if (b > 0.0 && b < 1.0) cuts[n++] = b;
+    }
+    cuts[n++] = 1.0;
+
+    for (int i = 0; i + 1 < n; i++) {
+        double xa = x0 + (x1 - x0) * cuts[i];
+        double xb = x0 + (x1 - x0) * cuts[i + 1];
+        double ya = Clamp(y0 + (y1 - y0) * cuts[i], 0.0, height);
+        double yb = Clamp(y0 + (y1 - y0) * cuts[i + 1], 0.0, height);
+        if (xb <= xa || (ya == edge && yb == edge)) continue;
+        if (edge > 0) Quad(layer, xa, ya, edge, xb, yb, edge);
+        else Quad(layer, xa, edge, ya, xb, edge, yb);
+    }
+}
+
+bool RegionLayer_FromCurve(RegionLayer* layer, const SampleCache* cache, int side,
+                           double scale, double centerX, double centerY, int width, int height) {
+    if (layer->valid && cache->valid && layer->source == cache && layer->generation == cache->generation && layer->side == side &&
+        layer->scale == scale && layer->centerX == centerX && layer->centerY == centerY &&
+        layer->width == width && layer->height == height) {
+        return false;
+    }
+    layer->source = cache;
+    layer->generation = cache->generation;
+    layer->side = side;
+    layer->scale = scale;
+    layer->centerX = centerX;
+    layer->centerY = centerY;
+    layer->width = width;
+    layer->height = height;
+    layer->count = 0;
+    layer->valid = true;
+    if (!cache->valid) return true;
+
+    const SampleList* curve = &cache->curve;
+    double halfWidth = width / 2.0;
+    double halfHeight = height / 2.0;
+    double edge = side < 0 ? height : 0.0;
+    for (int i = 1; i < curve->count; i++) {
+        const SamplePoint* p = &curve->data[i - 1];
+        const SamplePoint* q = &curve->data[i];
+        if (q->join != JOIN_CONTINUOUS || !isfinite(p->y) || !isfinite(q->y)) continue;
+
+        double x0 = (p->x - centerX) * scale + halfWidth;
+        double x1 = (q->x - centerX) * scale + halfWidth;
+        if (x1 <= 0.0 || x0 >= width) continue;
+        double y0 = halfHeight - (p->y - centerY) * scale;
+        double y1 = halfHeight - (q->y - centerY) * scale;
+        // clip to the sides first, the samples run past them
+        if (x0 < 0.0) {
+            y0 += (y1 - y0) * (0.0 - x0) / (x1 - x0);
+            x0 = 0.0;
+        }
+        if (x1 > width) {
+            y1 = y0 + (y1 - y0) * (width - x0) / (x1 - x0);
+            x1 = width;
+        }
+
+        // at most three pieces of two triangles each
+        if (!Reserve(layer, layer->count + 18)) {
+            layer->count = 0;
+            layer->valid = false;
+            return true;
+        }
+        Trapezoid(layer, x0, y0, x1, y1, edge, height);
+    }
+    return true;
+}
+
+bool RegionLayer_FromPlot(RegionLayer* layer, const ImplicitPlot* plot) {
+    if (layer->valid && plot->valid && layer->source == plot && layer->generation == plot->generation) return false;
+    layer->source = plot;
+    layer->generation = plot->generation;
+    layer->count = 0;
+    layer->valid = true;
+    if (!plot->valid) return true;
+
+    if (!Reserve(layer, 6 * plot->fillCount)) {
+        layer->valid = false;
+        return true;
+    }
+    for (int i = 0; i < plot->fillCount; i++) {
+        const ImplicitCell* c = &plot->fills[i];
+        Quad(layer, c->x, c->y, c->y + c->size, c->x + c->size, c->y, c->y + c->size);
+    }
+    return true;
+}
+
+void RegionLayer_Free(RegionLayer* layer) {
+    free(layer->xy);
+    RegionLayer_Init(layer);
+}
@@ -0,0 +1,32 @@
+#ifndef REGION_H
+#define REGION_H
+
+#include "samples.h"
+#include "implicit.h"
+#include <stdbool.h>
+
+// the shaded part of an inequality as screen space triangles, ready to go out in one batch.
+// kept between frames and only rebuilt when the samples or the view under them change
+typedef struct {
+    float* xy;    // x, y per vertex, three vertices per triangle, counter-clockwise on screen
+    int count;    // vertices
+    int capacity;
+    // what it was built from
+    const void* source;
+    unsigned generation;
+    int side;
+    double scale, centerX, centerY;
+    int width, height;
+    bool valid;
+} RegionLayer;
+
+void RegionLayer_Init(RegionLayer* layer);
+// the area between the curve and the bottom (side < 0) or top (side > 0) of the screen,
+// for y < f(x) and y > f(x). returns true when the triangles were rebuilt
+bool RegionLayer_FromCurve(RegionLayer* layer, const SampleCache* cache, int side,
+                           double scale, double centerX, double centerY, int width, int height);
+// the fill cells of an implicit plot, which are already in screen space
+bool RegionLayer_FromPlot(RegionLayer* layer, const ImplicitPlot* plot);
+void RegionLayer_Free(RegionLayer* layer);
+
+#endif
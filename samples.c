@@ -0,0 +1,366 @@
+#include "samples.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define SAMPLE_SEED_PX 4.0       // lattice spacing, in pixels
+#define SAMPLE_MIN_PX (1.0 / 64) // intervals aren't halved below this
+#define SAMPLE_TOLERANCE_PX 0.5  // how far the midpoint may be off the chord
+#define SAMPLE_JUMP_PX 2.0       // smaller jumps are never looked at as discontinuities
+// evaluation budget on top of the seeds, per seed interval and at least this much per chunk
+#define SAMPLE_BUDGET_PER_SEED 16
+#define SAMPLE_MIN_BUDGET 256
+#define SAMPLE_CHUNK_SEEDS 32 // 128 pixels of new curve per chunk
+
+void SampleCache_Init(SampleCache* cache) {
+    memset(cache, 0, sizeof(*cache));
+}
+
+static bool Reserve(SampleList* list, int count) {
+    if (count <= list->capacity) return true;
+    int capacity = list->capacity ? list->capacity : 256;
+    while (capacity < count) capacity *= 2;
+    SamplePoint* data = (SamplePoint*)realloc(list->data, capacity * sizeof(SamplePoint));
+    if (!data) return false;
+    list->data = data;
+    list->capacity = capacity;
+    return true;
+}
+
+static bool ReserveScratch(SampleChunk* chunk, int count) {
+    if (count <= chunk->scratchCapacity) return true;
+    int capacity = chunk->scratchCapacity ? chunk->scratchCapacity : 256;
+    while (capacity < count) capacity *= 2;
+    double* xs = (double*)realloc(chunk->xs, capacity * sizeof(double));
+    if (!xs) return false;
+    chunk->xs = xs;
+    double* ys = (double*)realloc(chunk->ys, capacity * sizeof(double));
+    if (!ys) return false;
+    chunk->ys = ys;
+    chunk->scratchCapacity = capacity;
+    return true;
+}
+
+static void Swap(SampleList* a, SampleList* b) {
+    SampleList t = *a;
+    *a = *b;
+    *b = t;
+}
+
+// join across a pair where at least one side isn't finite. infinities come from poles, NaN from the domain
+static uint8_t GapJoin(double a, double b) {
+    if (isfinite(a) && isfinite(b)) return JOIN_CONTINUOUS;
+    return (isinf(a) || isinf(b)) ? JOIN_ASYMPTOTE : JOIN_DISCONTINUOUS;
+}
+
+// distance in pixels from the midpoint to the chord between p and q. measured on screen
+// rather than vertically, so a steep but straight stretch doesn't count as a bend
+static double ChordDistance(const SamplePoint* p, const SamplePoint* q, double mx, double my, double scale) {
+    double dx = (q->x - p->x) * scale, dy = (q->y - p->y) * scale;
+    double ex = (mx - p->x) * scale, ey = (my - p->y) * scale;
+    double t = (ex * dx + ey * dy) / (dx * dx + dy * dy);
+    if (t < 0) t = 0;
+    if (t > 1) t = 1;
+    return hypot(ex - t * dx, ey - t * dy);
+}
+
+// a jump the midpoint doesn't split, which is how steps and poles look before they're narrowed down
+static bool IsJump(double p, double m, double q, double scale) {
+    double jump = fabs(q - p);
+    return jump * scale > SAMPLE_JUMP_PX && fmax(fabs(m - p), fabs(q - m)) > 0.75 * jump;
+}
+
+// one half of an interval that is already as narrow as it gets. a continuous function
+// roughly halves the jump with the interval, a step keeps it, a pole makes it grow.
+static uint8_t Classify(double halfJump, double jump, double scale) {
+    if (halfJump * scale <= SAMPLE_JUMP_PX) return JOIN_CONTINUOUS;
+    if (halfJump > 1.25 * jump) return JOIN_ASYMPTOTE;
+    if (halfJump > 0.75 * jump) return JOIN_DISCONTINUOUS;
+    return JOIN_CONTINUOUS;
+}
+
+// the seeds sit still while t animates, so their x-only part is kept between updates
+static bool EvaluateSeeds(SampleChunk* chunk, const Expr* expr, const EvalContext* ctx, double scale, int seeds) {
+    int columns = Expr_ColumnCount(expr);
+    if (columns == 0) {
+        Expr_EvaluateSpan(expr, chunk->xs, chunk->ys, seeds, ctx);
+        return true;
+    }
+    bool same = chunk->columnsValid && chunk->columnVersion == expr->version && chunk->columnScale == scale &&
+                chunk->columnY == ctx->y && chunk->columnFrom == chunk->from && chunk->columnTo == chunk->to;
+    if (!same) {
+        int need = seeds * columns;
+        if (need > chunk->columnCapacity) {
+            double* p = (double*)realloc(chunk->columns, need * sizeof(double));
+            if (!p) return false;
+            chunk->columns = p;
+            chunk->columnCapacity = need;
+        }
+        Expr_EvaluateColumns(expr, chunk->xs, chunk->columns, seeds, ctx);
+        chunk->columnsValid = true;
+        chunk->columnVersion = expr->version;
+        chunk->columnScale = scale;
+        chunk->columnY = ctx->y;
+        chunk->columnFrom = chunk->from;
+        chunk->columnTo = chunk->to;
+    }
+    Expr_EvaluateSpanColumns(expr, chunk->xs, chunk->columns, chunk->ys, seeds, ctx);
+    return true;
+}
+
+// samples lattice seeds [from, to] into chunk->work. refinement goes breadth first so each
+// level is one batch call, and stops once a level would go over the budget.
+static bool Build(SampleChunk* chunk, const Expr* expr, const EvalContext* ctx, double scale, int64_t from, int64_t to) {
+    SampleList* a = &chunk->work;
+    SampleList* b = &chunk->level;
+    int seeds = (int)(to - from + 1);
+    int budget = seeds * SAMPLE_BUDGET_PER_SEED;
+    if (budget < SAMPLE_MIN_BUDGET) budget = SAMPLE_MIN_BUDGET;
+    double step = SAMPLE_SEED_PX / scale;
+    double minWidth = SAMPLE_MIN_PX / scale;
+
+    if (!Reserve(a, seeds) || !ReserveScratch(chunk, seeds)) return false;
+    for (int i = 0; i < seeds; i++) {
+        chunk->xs[i] = (double)(from + i) * step;
+    }
+    if (!EvaluateSeeds(chunk, expr, ctx, scale, seeds)) return false;
+    chunk->evaluated += seeds;
+    for (int i = 0; i < seeds; i++) {
+        SamplePoint* p = &a->data[i];
+        p->x = chunk->xs[i];
+        p->y = chunk->ys[i];
+        p->join = (i == 0) ? JOIN_DISCONTINUOUS : GapJoin(chunk->ys[i - 1], p->y);
+        p->refine = 0;
+        if (i > 0) a->data[i - 1].refine = isfinite(chunk->ys[i - 1]) || isfinite(p->y);
+    }
+    a->count = seeds;
+
+    for (;;) {
+        int n = 0;
+        for (int i = 0; i + 1 < a->count; i++) {
+            if (a->data[i].refine) n++;
+        }
+        if (n == 0 || n > budget) break;
+        if (!Reserve(b, a->count + n) || !ReserveScratch(chunk, n)) return false;
+
+        n = 0;
+        for (int i = 0; i + 1 < a->count; i++) {
+            if (a->data[i].refine) chunk->xs[n++] = 0.5 * (a->data[i].x + a->data[i + 1].x);
+        }
+        Expr_EvaluateSpan(expr, chunk->xs, chunk->ys, n, ctx);
+        chunk->evaluated += n;
+        budget -= n;
+
+        // merge the midpoints in, deciding for each half whether it needs another level
+        int w = 0;
+        n = 0;
+        for (int i = 0; i < a->count; i++) {
+            SamplePoint* p = &a->data[i];
+            b->data[w++] = *p;
+            if (i + 1 == a->count || !p->refine) continue;
+
+            SamplePoint* q = &a->data[i + 1];
+            SamplePoint m;
+            m.x = chunk->xs[n];
+            m.y = chunk->ys[n];
+            n++;
+            bool leaf = 0.5 * (q->x - p->x) <= minWidth;
+
+            if (isfinite(p->y) && isfinite(q->y) && isfinite(m.y)) {
+                m.join = JOIN_CONTINUOUS;
+                bool smooth = ChordDistance(p, q, m.x, m.y, scale) <= SAMPLE_TOLERANCE_PX && !IsJump(p->y, m.y, q->y, scale);
+                if (smooth) {
+                    b->data[w - 1].refine = 0;
+                    m.refine = 0;
+                } else if (!leaf) {
+                    m.refine = 1;
+                } else {
+                    double jump = fabs(q->y - p->y);
+                    b->data[w - 1].refine = 0;
+                    m.refine = 0;
+                    m.join = Classify(fabs(m.y - p->y), jump, scale);
+                    q->join = Classify(fabs(q->y - m.y), jump, scale);
+                }
+            } else {
+                // a domain edge or a pole, narrow it down until the halves run out
+                m.join = GapJoin(p->y, m.y);
+                q->join = GapJoin(m.y, q->y);
+                b->data[w - 1].refine = !leaf && (isfinite(p->y) || isfinite(m.y));
+                m.refine = !leaf && (isfinite(m.y) || isfinite(q->y));
+            }
+            b->data[w++] = m;
+        }
+        b->count = w;
+        Swap(a, b);
+    }
+    return true;
+}
+
+static int64_t SeedFloor(double x, double step) {
+    return (int64_t)floor(x / step);
+}
+
+static bool Append(SampleList* list, const SamplePoint* points, int count) {
+    if (!Reserve(list, list->count + count)) return false;
+    memcpy(list->data + list->count, points, count * sizeof(SamplePoint));
+    list->count += count;
+    return true;
+}
+
+// index of the first point at or after x
+static int LowerBound(const SampleList* list, double x) {
+    int lo = 0, hi = list->count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (list->data[mid].x < x) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static bool AddChunks(SampleCache* cache, int64_t from, int64_t to) {
+    for (int64_t start = from; start < to; start += SAMPLE_CHUNK_SEEDS) {
+        if (cache->chunkCount == cache->chunkCapacity) {
+            int capacity = cache->chunkCapacity ? 2 * cache->chunkCapacity : 16;
+            SampleChunk* chunks = (SampleChunk*)realloc(cache->chunks, capacity * sizeof(SampleChunk));
+            if (!chunks) return false;
+            memset(chunks + cache->chunkCapacity, 0, (capacity - cache->chunkCapacity) * sizeof(SampleChunk));
+            cache->chunks = chunks;
+            cache->chunkCapacity = capacity;
+        }
+        SampleChunk* chunk = &cache->chunks[cache->chunkCount++];
+        chunk->from = start;
+        chunk->to = (to - start > SAMPLE_CHUNK_SEEDS) ? start + SAMPLE_CHUNK_SEEDS : to;
+    }
+    return true;
+}
+
+int SampleCache_Begin(SampleCache* cache, const Expr* expr, const EvalContext* ctx, double scale, double centerX, int width) {
+    cache->evaluated = 0;
+    cache->pending = false;
+    cache->chunkCount = 0;
+    if (width <= 0) return 0;
+
+    double step = SAMPLE_SEED_PX / scale;
+    double halfWidth = width / 2.0 / scale;
+    int64_t from = SeedFloor(centerX - halfWidth, step);
+    int64_t to = SeedFloor(centerX + halfWidth, step) + 1;
+
+    // a new t redoes every seed, an expression without t never sees it change
+    bool sameTime = !Expr_DependsOn(expr, VAR_T) || cache->t == ctx->t;
+    bool sameGrid = cache->valid && cache->version == expr->version && cache->scale == scale && sameTime;
+    if (sameGrid && from == cache->firstSeed && to == cache->lastSeed) return 0;
+
+    cache->pending = true;
+    cache->expr = expr;
+    cache->ctx = *ctx;
+    cache->nextScale = scale;
+    cache->nextFirst = from;
+    cache->nextLast = to;
+
+    int64_t keepFrom = (from > cache->firstSeed) ? from : cache->firstSeed;
+    int64_t keepTo = (to < cache->lastSeed) ? to : cache->lastSeed;
+    bool ok;
+    if (!sameGrid || keepFrom > keepTo) {
+        cache->keepStart = -1;
+        ok = AddChunks(cache, from, to);
+        cache->frontChunks = cache->chunkCount;
+    } else {
+        // the seeds at either end of the kept range are sampled again by the new pieces
+        cache->keepStart = LowerBound(&cache->curve, (double)keepFrom * step);
+        cache->keepEnd = LowerBound(&cache->curve, (double)keepTo * step) + 1;
+        ok = AddChunks(cache, from, keepFrom);
+        cache->frontChunks = cache->chunkCount;
+        ok = ok && AddChunks(cache, keepTo, to);
+    }
+    if (!ok) {
+        cache->pending = false;
+        cache->valid = false;
+        cache->chunkCount = 0;
+    }
+    return cache->chunkCount;
+}
+
+void SampleCache_RunChunk(SampleCache* cache, int index) {
+    SampleChunk* chunk = &cache->chunks[index];
+    chunk->evaluated = 0;
+    chunk->ok = Build(chunk, cache->expr, &cache->ctx, cache->nextScale, chunk->from, chunk->to);
+}
+
+// neighbouring chunks share their end seeds, every chunk after the first drops its copy
+static bool AppendChunks(SampleCache* cache, SampleList* next, int first, int last, bool skipFirst) {
+    for (int i = first; i < last; i++) {
+        SampleChunk* chunk = &cache->chunks[i];
+        int skip = (i > first || skipFirst) ? 1 : 0;
+        if (!Append(next, chunk->work.data + skip, chunk->work.count - skip)) return false;
+    }
+    return true;
+}
+
+void SampleCache_End(SampleCache* cache) {
+    if (!cache->pending) return;
+    cache->pending = false;
+
+    SampleList* next = &cache->next;
+    next->count = 0;
+    bool ok = true;
+    for (int i = 0; i < cache->chunkCount; i++) {
+        ok = ok && cache->chunks[i].ok;
+        cache->evaluated += cache->chunks[i].evaluated;
+    }
+
+    if (ok && cache->keepStart < 0) {
+        ok = AppendChunks(cache, next, 0, cache->chunkCount, false);
+    } else if (ok) {
+        // the kept copy of the left end seed stays and takes the join from the piece in front of it
+        uint8_t frontJoin = JOIN_DISCONTINUOUS;
+        if (cache->frontChunks > 0) {
+            ok = AppendChunks(cache, next, 0, cache->frontChunks, false);
+            if (ok) frontJoin = next->data[--next->count].join;
+        }
+        int start = next->count;
+        ok = ok && Append(next, cache->curve.data + cache->keepStart, cache->keepEnd - cache->keepStart);
+        if (ok) next->data[start].join = frontJoin;
+        ok = ok && AppendChunks(cache, next, cache->frontChunks, cache->chunkCount, true);
+    }
+
+    if (!ok) {
+        cache->valid = false;
+        return;
+    }
+    Swap(&cache->curve, next);
+    cache->version = cache->expr->version;
+    cache->scale = cache->nextScale;
+    cache->firstSeed = cache->nextFirst;
+    cache->lastSeed = cache->nextLast;
+    cache->t = cache->ctx.t;
+    cache->valid = true;
+    cache->generation++;
+}
+
+void SampleCache_Update(SampleCache* cache, const Expr* expr, const EvalContext* ctx, double scale, double centerX, int width) {
+    int chunks = SampleCache_Begin(cache, expr, ctx, scale, centerX, width);
+    for (int i = 0; i < chunks; i++) {
+        SampleCache_RunChunk(cache, i);
+    }
+    SampleCache_End(cache);
+}
+
+void SampleCache_Invalidate(SampleCache* cache) {
+    cache->valid = false;
+}
+
+void SampleCache_Free(SampleCache* cache) {
+    for (int i = 0; i < cache->chunkCapacity; i++) {
+        SampleChunk* chunk = &cache->chunks[i];
+        free(chunk->work.data);
+        free(chunk->level.data);
+        free(chunk->xs);
+        free(chunk->ys);
+        free(chunk->columns);
+    }
+    free(cache->chunks);
+    free(cache->curve.data);
+    free(cache->next.data);
+    SampleCache_Init(cache);
+}
@@ -0,0 +1,90 @@
+#ifndef SAMPLES_H
+#define SAMPLES_H
+
+#include "expr.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// how a sample connects to the one before it
+typedef enum {
+    JOIN_CONTINUOUS,
+    JOIN_DISCONTINUOUS, // a jump that doesn't shrink when the interval is halved, or a gap in the domain
+    JOIN_ASYMPTOTE      // a jump that grows when the interval is halved
+} SampleJoin;
+
+typedef struct {
+    double x;
+    double y;
+    uint8_t join;   // SampleJoin
+    uint8_t refine; // only used while sampling: the interval to the next point still needs a midpoint
+} SamplePoint;
+
+typedef struct {
+    SamplePoint* data;
+    int count;
+    int capacity;
+} SampleList;
+
+// one stretch of seeds sampled on its own, so an update can be spread over threads
+typedef struct {
+    int64_t from;
+    int64_t to;
+    SampleList work, level;
+    double* xs;
+    double* ys;
+    int scratchCapacity;
+    int evaluated;
+    bool ok;
+    // x-only values at the seeds of an expression that reads t, kept while only t changes
+    double* columns;
+    int columnCapacity;
+    bool columnsValid;
+    unsigned columnVersion;
+    double columnScale, columnY;
+    int64_t columnFrom, columnTo;
+} SampleChunk;
+
+// adaptively sampled curve of one equation, kept between frames. seeds sit on a lattice
+// anchored in world x, every SAMPLE_SEED_PX pixels, and intervals are halved where the
+// midpoint is off the chord by more than half a pixel. because the lattice doesn't move
+// with the view, a horizontal pan keeps everything still in view and only samples what
+// was exposed. samples are in world units, so a vertical pan costs nothing.
+typedef struct {
+    SampleList curve;  // sorted by x, the polyline to draw
+    // what the samples were taken for
+    unsigned version;
+    double scale;
+    int64_t firstSeed; // lattice range covered, seed k sits at x = k * SAMPLE_SEED_PX / scale
+    int64_t lastSeed;
+    double t;          // only part of the key when the expression reads t
+    bool valid;
+    unsigned generation; // bumped whenever the curve changes
+    int evaluated;     // evaluations done by the last update
+    // the update between Begin and End
+    bool pending;
+    const Expr* expr;
+    EvalContext ctx;
+    double nextScale;
+    int64_t nextFirst, nextLast;
+    int keepStart, keepEnd; // part of the curve that stays, keepStart is -1 on a full rebuild
+    int frontChunks;        // chunks in front of the kept part, the rest go after it
+    SampleChunk* chunks;
+    int chunkCount;
+    int chunkCapacity;
+    SampleList next;
+} SampleCache;
+
+void SampleCache_Init(SampleCache* cache);
+// plans the update for a view and returns how many chunks it takes, 0 when the curve is
+// already up to date. the chunks read expr, so it has to stay put until End
+int SampleCache_Begin(SampleCache* cache, const Expr* expr, const EvalContext* ctx, double scale, double centerX, int width);
+// samples one chunk, different chunks can run on different threads at the same time
+void SampleCache_RunChunk(SampleCache* cache, int chunk);
+// stitches the chunks into the curve
+void SampleCache_End(SampleCache* cache);
+// all of the above on the calling thread, an unchanged view costs nothing
+void SampleCache_Update(SampleCache* cache, const Expr* expr, const EvalContext* ctx, double scale, double centerX, int width);
+void SampleCache_Invalidate(SampleCache* cache);
+void SampleCache_Free(SampleCache* cache);
+
+#endif
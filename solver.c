@@ -0,0 +1,572 @@
+#include "solver.h"
+#include "figure.h"
+#include "vecmath.h"
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+typedef CRITICAL_SECTION Mutex;
+typedef CONDITION_VARIABLE Cond;
+typedef HANDLE Thread;
+
+static void MutexInit(Mutex* m) { InitializeCriticalSection(m); }
+static void MutexDestroy(Mutex* m) { DeleteCriticalSection(m); }
+static void MutexLock(Mutex* m) { EnterCriticalSection(m); }
+static void MutexUnlock(Mutex* m) { LeaveCriticalSection(m); }
+static void CondInit(Cond* c) { InitializeConditionVariable(c); }
+static void CondDestroy(Cond* c) { (void)c; }
+static void CondWait(Cond* c, Mutex* m) { SleepConditionVariableCS(c, m, INFINITE); }
+static void CondBroadcast(Cond* c) { WakeAllConditionVariable(c); }
+#else
+#include <pthread.h>
+
+typedef pthread_mutex_t Mutex;
+typedef pthread_cond_t Cond;
+typedef pthread_t Thread;
+
+static void MutexInit(Mutex* m) { pthread_mutex_init(m, NULL); }
+static void MutexDestroy(Mutex* m) { pthread_mutex_destroy(m); }
+static void MutexLock(Mutex* m) { pthread_mutex_lock(m); }
+static void MutexUnlock(Mutex* m) { pthread_mutex_unlock(m); }
+static void CondInit(Cond* c) { pthread_cond_init(c, NULL); }
+static void CondDestroy(Cond* c) { pthread_cond_destroy(c); }
+static void CondWait(Cond* c, Mutex* m) { pthread_cond_wait(c, m); }
+static void CondBroadcast(Cond* c) { pthread_cond_broadcast(c); }
+#endif
+
+// the samples of one equation that fall in the view, plus one on either side
+typedef struct {
+    char* text;
+    int textCapacity;
+    bool solve;
+    bool focus;
+    double* xs;
+    double* ys;
+    uint8_t* joins;
+    int count;
+    int capacity;
+} SolverEquation;
+
+typedef struct {
+    SolverEquation* equations;
+    int count;
+    int capacity;
+    SolverView view;
+    EvalContext ctx;
+    unsigned generation;
+} SolverJob;
+
+struct Solver {
+    Mutex lock; // guards everything up to job
+    Cond wake;
+    Thread thread;
+    bool started;
+    bool shutdown;
+    unsigned generation; // of the latest submission
+    bool pending;        // next hasn't been taken yet
+    bool busy;
+    SolverJob next;
+    SolvePoint* points;  // found for the latest submission
+    int pointCount;
+    int pointCapacity;
+    unsigned published;  // bumped whenever points changes
+    unsigned seen;       // published as of the last Solver_Points
+    // only touched by whoever runs the job
+    SolverJob job;
+    Figure* figures;     // parsed on the solver's side, the app's figures change under it
+    int figureCount;
+    double* scratch;
+    int scratchCapacity;
+};
+
+static bool Grow(void** data, int* capacity, int count, size_t itemSize) {
+    if (count <= *capacity) return true;
+    int cap = *capacity ? *capacity : 64;
+    while (cap < count) cap *= 2;
+    void* grown = realloc(*data, cap * itemSize);
+    if (!grown) return false;
+    *data = grown;
+    *capacity = cap;
+    return true;
+}
+
+static bool ReserveSamples(SolverEquation* eq, int count) {
+    if (count <= eq->capacity) return true;
+    int cap = eq->capacity ? eq->capacity : 256;
+    while (cap < count) cap *= 2;
+    double* xs = (double*)realloc(eq->xs, cap * sizeof(double));
+    if (xs) eq->xs = xs;
+    double* ys = (double*)realloc(eq->ys, cap * sizeof(double));
+    if (ys) eq->ys = ys;
+    uint8_t* joins = (uint8_t*)realloc(eq->joins, cap);
+    if (joins) eq->joins = joins;
+    if (!xs || !ys || !joins) return false;
+    eq->capacity = cap;
+    return true;
+}
+
+static void FreeJob(SolverJob* job) {
+    for (int i = 0; i < job->capacity; i++) {
+        SolverEquation* eq = &job->equations[i];
+        free(eq->text);
+        free(eq->xs);
+        free(eq->ys);
+        free(eq->joins);
+    }
+    free(job->equations);
+}
+
+// true once the job has been replaced, checked between brackets
+static bool Stale(Solver* s) {
+    MutexLock(&s->lock);
+    bool stale = s->shutdown || s->generation != s->job.generation;
+    MutexUnlock(&s->lock);
+    return stale;
+}
+
+// false when the job is stale or has found enough, either way it should stop
+static bool Publish(Solver* s, double x, double y, SolveKind kind, int a, int b) {
+    const SolverView* v = &s->job.view;
+    if (x < v->xMin || x > v->xMax || y < v->yMin || y > v->yMax) return true;
+    MutexLock(&s->lock);
+    bool ok = !s->shutdown && s->generation == s->job.generation && s->pointCount < SOLVER_MAX_POINTS &&
+              Grow((void**)&s->points, &s->pointCapacity, s->pointCount + 1, sizeof(SolvePoint));
+    if (ok) {
+        s->points[s->pointCount++] = (SolvePoint){ x, y, (uint8_t)kind, (int32_t)a, (int32_t)b };
+        s->published++;
+    }
+    MutexUnlock(&s->lock);
+    return ok;
+}
+
+static bool HasRoot(Solver* s, int a, double x) {
+    MutexLock(&s->lock);
+    bool found = false;
+    for (int i = 0; i < s->pointCount && !found; i++) {
+        const SolvePoint* pt = &s->points[i];
+        found = pt->kind == SOLVE_ROOT && pt->a == a && fabs(pt->x - x) <= 1e-9 * (1.0 + fabs(x));
+    }
+    MutexUnlock(&s->lock);
+    return found;
+}
+
+// what a bracket is a sign change of: f, f', or fa - fb
+typedef struct {
+    const Expr* a;
+    const Expr* b;
+    bool slope;
+    EvalContext ctx;
+} Problem;
+
+// the function and its derivative, which is NaN for a slope
+static double Evaluate(const Problem* p, double x, double* derivative) {
+    EvalContext c = p->ctx;
+    c.x = x;
+    double d;
+    double v = Expr_EvaluateDual(p->a, &c, &d);
+    if (p->slope) {
+        *derivative = NAN;
+        return d;
+    }
+    if (p->b) {
+        double db;
+        v -= Expr_EvaluateDual(p->b, &c, &db);
+        d -= db;
+    }
+    *derivative = d;
+    return v;
+}
+
+static double Tolerance(double x) {
+    return 4.0 * DBL_EPSILON * (1.0 + fabs(x));
+}
+
+// Newton from the middle of the bracket, bisecting whenever a step would leave it or
+// isn't shrinking it fast enough
+static double Newton(const Problem* p, double lo, double flo, double hi) {
+    if (flo > 0) {
+        double swap = lo;
+        lo = hi;
+        hi = swap;
+    }
+    // f(lo) < 0 < f(hi) from here on, lo may be the larger one
+    double x = 0.5 * (lo + hi);
+    double step = fabs(hi - lo);
+    for (int i = 0; i < SOLVER_MAX_ITERATIONS; i++) {
+        double d;
+        double f = Evaluate(p, x, &d);
+        if (f == 0.0) return x;
+        if (isnan(f)) return NAN; // a hole in the domain, not a root
+        if (f < 0) lo = x;
+        else hi = x;
+
+        // a Newton step has to land inside and at least halve the step before it
+        double next = x - f / d;
+        bool inside = isfinite(next) && (next - lo) * (next - hi) < 0;
+        if (!inside || fabs(2.0 * (x - next)) > fabs(step)) next = 0.5 * (lo + hi);
+        step = next - x;
+        if (fabs(step) <= Tolerance(x)) return next;
+        x = next;
+    }
+    return x;
+}
+
+// Brent's method, inverse quadratic interpolation and secants kept in the bracket by bisection
+static double Brent(const Problem* p, double a, double fa, double b, double fb) {
+    double c = b, fc = fb;
+    double d = b - a, e = d;
+    for (int i = 0; i < SOLVER_MAX_ITERATIONS; i++) {
+        if ((fb > 0) == (fc > 0)) {
+            c = a;
+            fc = fa;
+            d = e = b - a;
+        }
+        if (fabs(fc) < fabs(fb)) {
+            a = b;
+            b = c;
+            c = a;
+            fa = fb;
+            fb = fc;
+            fc = fa;
+        }
+        double tol = 0.5 * Tolerance(b);
+        double m = 0.5 * (c - b);
+        if (fabs(m) <= tol || fb == 0.0) return b;
+        if (fabs(e) >= tol && fabs(fa) > fabs(fb)) {
+            double s = fb / fa, q, r, num, den;
+            if (a == c) {
+                num = 2.0 * m * s;
+                den = 1.0 - s;
+            } else {
+                q = fa / fc;
+                r = fb / fc;
+                num = s * (2.0 * m * q * (q - r) - (b - a) * (r - 1.0));
+                den = (q - 1.0) * (r - 1.0) * (s - 1.0);
+            }
+            if (num > 0) den = -den;
+            else num = -num;
+            if (2.0 * num < fmin(3.0 * m * den - fabs(tol * den), fabs(e * den))) {
+                e = d;
+                d = num / den;
+            } else {
+                d = m;
+                e = m;
+            }
+        } else {
+            d = m;
+            e = m;
+        }
+        a = b;
+        fa = fb;
+        b += (fabs(d) > tol) ? d : (m > 0 ? tol : -tol);
+        double unused;
+        fb = Evaluate(p, b, &unused);
+        if (isnan(fb)) return NAN;
+    }
+    return b;
+}
+
+// a sign change across a pole or a jump converges onto it, where the function is huge
+// rather than 0
+static bool Accept(const Problem* p, double x, double f0, double f1) {
+    if (!isfinite(x)) return false;
+    double d;
+    double f = Evaluate(p, x, &d);
+    return isfinite(f) && fabs(f) <= 1e-6 * (1.0 + fabs(f0) + fabs(f1));
+}
+
+// the sign changes of values between consecutive xs, refined. joins may be NULL
+static bool SolveBrackets(Solver* s, const Problem* p, const double* xs, const double* values, const uint8_t* joins, int n,
+                          int a, int b, bool extrema) {
+    for (int i = 1; i < n; i++) {
+        double f0 = values[i - 1], f1 = values[i];
+        if (joins && joins[i] != JOIN_CONTINUOUS) continue;
+        // a 0 at a sample counts once, for the interval it ends, and never where the
+        // function is 0 all along
+        if (f0 == 0.0 || !isfinite(f0) || !isfinite(f1)) continue;
+        double x;
+        if (f1 == 0.0) {
+            x = xs[i];
+        } else if ((f0 < 0) != (f1 < 0)) {
+            if (Stale(s)) return false;
+            x = p->slope ? Brent(p, xs[i - 1], f0, xs[i], f1) : Newton(p, xs[i - 1], f0, xs[i]);
+            if (!Accept(p, x, f0, f1)) continue;
+        } else {
+            continue;
+        }
+
+        EvalContext c = p->ctx;
+        c.x = x;
+        double unused;
+        double y = Expr_EvaluateDual(p->a, &c, &unused);
+        if (!extrema) {
+            if (!Publish(s, x, b < 0 ? 0.0 : y, b < 0 ? SOLVE_ROOT : SOLVE_INTERSECTION, a, b)) return false;
+            continue;
+        }
+        if (!Publish(s, x, y, f0 < 0 ? SOLVE_MIN : SOLVE_MAX, a, -1)) return false;
+        // an extremum that touches 0 is a root without a sign change, like x^2, unless a
+        // sample happened to land right on it
+        if (fabs(y) <= 1e-12 * (1.0 + fabs(x)) && !HasRoot(s, a, x) && !Publish(s, x, 0.0, SOLVE_ROOT, a, -1)) return false;
+    }
+    return true;
+}
+
+static bool SolveEquation(Solver* s, int index) {
+    const SolverEquation* eq = &s->job.equations[index];
+    const Expr* expr = &s->figures[index].expr;
+    Problem p = { expr, NULL, false, s->job.ctx };
+    if (!SolveBrackets(s, &p, eq->xs, eq->ys, eq->joins, eq->count, index, -1, false)) return false;
+
+    // the slope at the same xs, one pass for both
+    if (!Grow((void**)&s->scratch, &s->scratchCapacity, 2 * eq->count, sizeof(double))) return true;
+    double* values = s->scratch;
+    double* slopes = s->scratch + eq->count;
+    Expr_EvaluateSpanDual(expr, eq->xs, values, slopes, eq->count, &s->job.ctx);
+    p.slope = true;
+    return SolveBrackets(s, &p, eq->xs, slopes, eq->joins, eq->count, index, -1, true);
+}
+
+// fa - fb at the xs of both curves, so wherever either one bends the difference is
+// sampled as finely
+static bool SolvePair(Solver* s, int a, int b) {
+    const SolverEquation* ea = &s->job.equations[a];
+    const SolverEquation* eb = &s->job.equations[b];
+    int most = ea->count + eb->count;
+    if (!Grow((void**)&s->scratch, &s->scratchCapacity, 4 * most, sizeof(double))) return true;
+    double* xs = s->scratch;
+    double* fa = xs + most;
+    double* fb = fa + most;
+    double* diff = fb + most;
+
+    // both are sorted, merge them
+    int n = 0, i = 0, j = 0;
+    double from = fmax(ea->xs[0], eb->xs[0]);
+    double to = fmin(ea->xs[ea->count - 1], eb->xs[eb->count - 1]);
+    while (i < ea->count || j < eb->count) {
+        double x = (j >= eb->count || (i < ea->count && ea->xs[i] <= eb->xs[j])) ? ea->xs[i++] : eb->xs[j++];
+        if (x < from || x > to || (n > 0 && x == xs[n - 1])) continue;
+        xs[n++] = x;
+    }
+    const Expr* exprA = &s->figures[a].expr;
+    const Expr* exprB = &s->figures[b].expr;
+    Expr_EvaluateSpan(exprA, xs, fa, n, &s->job.ctx);
+    Expr_EvaluateSpan(exprB, xs, fb, n, &s->job.ctx);
+    for (int k = 0; k < n; k++) diff[k] = fa[k] - fb[k];
+
+    Problem p = { exprA, exprB, false, s->job.ctx };
+    return SolveBrackets(s, &p, xs, diff, NULL, n, a, b, false);
+}
+
+static bool ReserveFigures(Solver* s, int count) {
+    if (count <= s->figureCount) return true;
+    Figure* grown = (Figure*)realloc(s->figures, count * sizeof(Figure));
+    if (!grown) return false;
+    s->figures = grown;
+    for (int i = s->figureCount; i < count; i++) Figure_Init(&s->figures[i]);
+    s->figureCount = count;
+    return true;
+}
+
+static void Run(Solver* s) {
+    SolverJob* job = &s->job;
+    if (!ReserveFigures(s, job->count)) return;
+    for (int i = 0; i < job->count; i++) {
+        if (!job->equations[i].solve) continue;
+        Figure_SetText(&s->figures[i], job->equations[i].text);
+        if (!Figure_IsFunction(&s->figures[i]) || Figure_IsEmpty(&s->figures[i])) job->equations[i].solve = false;
+    }
+
+    // each curve first, then the pairs, so the points come in by importance
+    int solved = 0;
+    for (int i = 0; i < job->count; i++) {
+        if (!job->equations[i].solve || job->equations[i].count < 2) {
+            job->equations[i].solve = false;
+            continue;
+        }
+        solved++;
+        if (!SolveEquation(s, i)) return;
+    }
+    bool allPairs = solved <= SOLVER_ALL_PAIRS;
+    for (int a = 0; a < job->count; a++) {
+        if (!job->equations[a].solve || (!allPairs && !job->equations[a].focus)) continue;
+        for (int b = allPairs ? a + 1 : 0; b < job->count; b++) {
+            if (b == a || !job->equations[b].solve) continue;
+            // two focused ones cross once
+            if (!allPairs && job->equations[b].focus && b < a) continue;
+            if (Stale(s) || !SolvePair(s, a, b)) return;
+        }
+    }
+}
+
+// takes the latest submission and solves it, until the solver is destroyed
+static void SolverLoop(Solver* s) {
+    MutexLock(&s->lock);
+    for (;;) {
+        while (!s->shutdown && !s->pending) CondWait(&s->wake, &s->lock);
+        if (s->shutdown) break;
+        SolverJob swap = s->job;
+        s->job = s->next;
+        s->next = swap;
+        s->pending = false;
+        MutexUnlock(&s->lock);
+
+        Run(s);
+
+        MutexLock(&s->lock);
+        if (s->job.generation == s->generation) s->busy = false;
+    }
+    MutexUnlock(&s->lock);
+}
+
+#if defined(_WIN32)
+static DWORD WINAPI SolverMain(LPVOID arg) {
+    SolverLoop((Solver*)arg);
+    return 0;
+}
+
+static bool StartThread(Thread* thread, Solver* s) {
+    *thread = CreateThread(NULL, 0, SolverMain, s, 0, NULL);
+    return *thread != NULL;
+}
+
+static void JoinThread(Thread thread) {
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+}
+#else
+static void* SolverMain(void* arg) {
+    SolverLoop((Solver*)arg);
+    return NULL;
+}
+
+static bool StartThread(Thread* thread, Solver* s) {
+    return pthread_create(thread, NULL, SolverMain, s) == 0;
+}
+
+static void JoinThread(Thread thread) {
+    pthread_join(thread, NULL);
+}
+#endif
+
+Solver* Solver_Create(void) {
+    VecMath_Get(); // picks the kernels before the thread can race on it
+    Solver* s = (Solver*)calloc(1, sizeof(Solver));
+    if (!s) return NULL;
+    MutexInit(&s->lock);
+    CondInit(&s->wake);
+    // without a thread Solver_Submit solves on the spot
+    s->started = StartThread(&s->thread, s);
+    return s;
+}
+
+static bool CopyInput(SolverEquation* eq, const SolverInput* in, const SolverView* view) {
+    size_t length = strlen(in->text);
+    if (!Grow((void**)&eq->text, &eq->textCapacity, (int)length + 1, 1)) return false;
+    memcpy(eq->text, in->text, length + 1);
+    eq->solve = in->curve != NULL;
+    eq->focus = in->focus;
+    eq->count = 0;
+    if (!eq->solve) return true;
+
+    // the view's stretch of the curve and a sample past each end, so brackets at the edges count
+    const SampleList* curve = in->curve;
+    int first = 0, last = curve->count;
+    while (first + 1 < curve->count && curve->data[first + 1].x < view->xMin) first++;
+    while (last - 1 > first && curve->data[last - 2].x > view->xMax) last--;
+    if (!ReserveSamples(eq, last - first)) return false;
+    for (int i = first; i < last; i++) {
+        eq->xs[eq->count] = curve->data[i].x;
+        eq->ys[eq->count] = curve->data[i].y;
+        eq->joins[eq->count] = curve->data[i].join;
+        eq->count++;
+    }
+    return true;
+}
+
+void Solver_Submit(Solver* s, const SolverInput* inputs, int count, const SolverView* view, const EvalContext* ctx) {
+    if (!s) return;
+    MutexLock(&s->lock);
+    SolverJob* next = &s->next;
+    int had = next->capacity;
+    if (Grow((void**)&next->equations, &next->capacity, count, sizeof(SolverEquation))) {
+        memset(next->equations + had, 0, (next->capacity - had) * sizeof(SolverEquation));
+        next->count = count;
+        for (int i = 0; i < count; i++) {
+            if (!CopyInput(&next->equations[i], &inputs[i], view)) next->equations[i].solve = false;
+        }
+    } else {
+        next->count = 0;
+    }
+    next->view = *view;
+    next->ctx = *ctx;
+    next->generation = ++s->generation;
+    s->pending = true;
+    s->busy = true;
+    s->pointCount = 0;
+    s->published++;
+    CondBroadcast(&s->wake);
+    MutexUnlock(&s->lock);
+
+    if (!s->started) {
+        SolverJob swap = s->job;
+        s->job = s->next;
+        s->next = swap;
+        s->pending = false;
+        Run(s);
+        s->busy = false;
+    }
+}
+
+bool Solver_Fetch(Solver* s, SolvePoint* out, int capacity, int* count) {
+    if (!s) return false;
+    MutexLock(&s->lock);
+    bool changed = s->published != s->seen;
+    if (changed) {
+        *count = s->pointCount < capacity ? s->pointCount : capacity;
+        memcpy(out, s->points, *count * sizeof(SolvePoint));
+        s->seen = s->published;
+    }
+    MutexUnlock(&s->lock);
+    return changed;
+}
+
+bool Solver_IsBusy(Solver* s) {
+    if (!s) return false;
+    MutexLock(&s->lock);
+    bool busy = s->busy;
+    MutexUnlock(&s->lock);
+    return busy;
+}
+
+const char* Solver_KindName(SolveKind kind) {
+    switch (kind) {
+        case SOLVE_ROOT: return "root";
+        case SOLVE_MIN: return "min";
+        case SOLVE_MAX: return "max";
+        default: return "intersection";
+    }
+}
+
+void Solver_Destroy(Solver* s) {
+    if (!s) return;
+    MutexLock(&s->lock);
+    s->shutdown = true;
+    CondBroadcast(&s->wake);
+    MutexUnlock(&s->lock);
+    if (s->started) JoinThread(s->thread);
+    MutexDestroy(&s->lock);
+    CondDestroy(&s->wake);
+
+    FreeJob(&s->job);
+    FreeJob(&s->next);
+    for (int i = 0; i < s->figureCount; i++) Figure_Free(&s->figures[i]);
+    free(s->figures);
+    free(s->points);
+    free(s->scratch);
+    free(s);
+}
@@ -0,0 +1,57 @@
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include "samples.h"
+#include <stdbool.h>
+
+#define SOLVER_MAX_POINTS 4096 // per submission, sin(1/x) would find them forever
+#define SOLVER_MAX_ITERATIONS 100
+#define SOLVER_ALL_PAIRS 16 // solved equations up to which every pair is crossed, past it only the focused ones
+
+typedef enum {
+    SOLVE_ROOT,
+    SOLVE_MIN,
+    SOLVE_MAX,
+    SOLVE_INTERSECTION
+} SolveKind;
+
+typedef struct {
+    double x, y;
+    uint8_t kind; // SolveKind
+    int32_t a;    // the equation, the first of the two for an intersection
+    int32_t b;    // the second one, -1 for the rest
+} SolvePoint;
+
+// one equation as the caller sees it. curve is NULL for the ones that aren't solved:
+// hidden, empty or implicit. with more than SOLVER_ALL_PAIRS solved, crossings are only
+// looked for between a focused equation and the rest, the pairs would grow with the square
+typedef struct {
+    const char* text;
+    const SampleList* curve;
+    bool focus;
+} SolverInput;
+
+// the view points are published for
+typedef struct {
+    double xMin, xMax, yMin, yMax;
+} SolverView;
+
+typedef struct Solver Solver;
+
+// finds the roots and extrema of every equation and where pairs of them cross, on a thread
+// of its own. brackets come from the sample buffers the curves were drawn from (sign
+// changes of f, of f' by dual numbers, and of fa - fb at the xs of both), then get refined
+// by Newton kept inside the bracket, or Brent where there's no derivative to use
+Solver* Solver_Create(void);
+// replaces whatever is being solved. the inputs are copied, so the curves can change
+// right after. the points found for the last submission are dropped
+void Solver_Submit(Solver* s, const SolverInput* inputs, int count, const SolverView* view, const EvalContext* ctx);
+// the points found so far for the latest submission, they come in as they are found.
+// copies them and returns true only when they changed since the last call
+bool Solver_Fetch(Solver* s, SolvePoint* out, int capacity, int* count);
+// still working on the latest submission
+bool Solver_IsBusy(Solver* s);
+const char* Solver_KindName(SolveKind kind);
+void Solver_Destroy(Solver* s);
+
+#endif
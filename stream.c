@@ -0,0 +1,355 @@
+#include "stream.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// room for "x\tf(x)\n" at any precision, "%.17g" is at most 24 characters
+#define STREAM_SAMPLE_BYTES 64
+#define STREAM_LINE_STEP 256 // bytes of a line read at a time
+
+static bool Grow(void** data, int* capacity, int count, size_t itemSize) {
+    if (count <= *capacity) return true;
+    int newCapacity = *capacity ? *capacity : 256;
+    while (newCapacity < count) newCapacity *= 2;
+    void* p = realloc(*data, (size_t)newCapacity * itemSize);
+    if (!p) return false;
+    *data = p;
+    *capacity = newCapacity;
+    return true;
+}
+
+static char* CopyText(char* old, const char* text) {
+    size_t length = strlen(text);
+    char* copy = (char*)realloc(old, length + 1);
+    if (copy) memcpy(copy, text, length + 1);
+    return copy;
+}
+
+// byte by byte, so the files are the same on any host
+static void PutDouble(uint8_t* p, double v) {
+    uint64_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    for (int i = 0; i < 8; i++) p[i] = (uint8_t)(bits >> (8 * i));
+}
+
+static double GetDouble(const uint8_t* p) {
+    uint64_t bits = 0;
+    for (int i = 0; i < 8; i++) bits |= (uint64_t)p[i] << (8 * i);
+    double v;
+    memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+void Stream_Init(Stream* s, const StreamOptions* options) {
+    memset(s, 0, sizeof(*s));
+    s->options = *options;
+    if (s->options.digits < 1) s->options.digits = 1;
+    if (s->options.digits > STREAM_MAX_DIGITS) s->options.digits = STREAM_MAX_DIGITS;
+    for (int i = 0; i < STREAM_SLOTS; i++) Expr_Init(&s->slots[i].expr);
+}
+
+void Stream_SetExpression(Stream* s, const char* text) {
+    char* copy = CopyText(s->exprText, text);
+    if (copy) s->exprText = copy;
+}
+
+void Stream_SetVariables(Stream* s, double y, double t) {
+    s->ctx.y = y;
+    s->ctx.t = t;
+}
+
+void Stream_SetRange(Stream* s, double from, double to, int64_t count) {
+    s->rangeFrom = from;
+    s->rangeTo = to;
+    s->rangeCount = count > 0 ? count : 0;
+    s->rangeNext = 0;
+}
+
+static void Error(Stream* s, const char* what) {
+    fprintf(stderr, "line %d: %s\n", s->lineNumber, what);
+    s->errors++;
+}
+
+// the batch evaluates whatever the reader is on now
+static void Sync(Stream* s, StreamBatch* b) {
+    b->ctx = s->ctx;
+    const char* text = s->exprText ? s->exprText : "";
+    if (b->exprText && strcmp(b->exprText, text) == 0) return;
+    char* copy = CopyText(b->exprText, text);
+    if (!copy) return;
+    b->exprText = copy;
+    Expr_Set(&b->expr, text);
+}
+
+// a whole line however long, false at the end of the input. fgets can't say how much it
+// read when the input holds a NUL, so the space is filled with newlines first and the last
+// NUL in it is the one fgets put there
+static bool NextLine(Stream* s) {
+    int length = 0;
+    bool nul = false;
+    for (;;) {
+        if (!Grow((void**)&s->line, &s->lineCapacity, length + STREAM_LINE_STEP, 1)) break;
+        memset(s->line + length, '\n', STREAM_LINE_STEP);
+        if (!fgets(s->line + length, STREAM_LINE_STEP, s->in)) {
+            s->line[length] = '\0';
+            break;
+        }
+        int end = length + STREAM_LINE_STEP - 1;
+        while (s->line[end] != '\0') end--;
+        if ((int)strlen(s->line + length) < end - length) nul = true;
+        length = end;
+        if (length > 0 && s->line[length - 1] == '\n') break;
+    }
+    if (length == 0) return false;
+    s->lineNumber++;
+    s->cursor = s->line;
+    if (nul) {
+        Error(s, "NUL byte in line");
+        s->line[0] = '\0';
+    }
+    return true;
+}
+
+static const char* SkipSpace(const char* p) {
+    while (*p == ' ' || *p == '\t' || *p == ',' || *p == '\r' || *p == '\n') p++;
+    return p;
+}
+
+static bool IsWord(const char* p, const char* word, const char** rest) {
+    size_t n = strlen(word);
+    if (strncmp(p, word, n) != 0) return false;
+    if (p[n] != ' ' && p[n] != '\t' && p[n] != '\r' && p[n] != '\n' && p[n] != '\0') return false;
+    *rest = p + n;
+    return true;
+}
+
+static bool ParseNumber(const char* p, double* v) {
+    char* end;
+    *v = strtod(p, &end);
+    return end != p && *SkipSpace(end) == '\0';
+}
+
+// applies one directive line, false when it has to wait for a new batch
+static bool Directive(Stream* s, StreamBatch* b, const char* p) {
+    const char* rest;
+    double v;
+    if (IsWord(p, "range", &rest)) {
+        double from, to;
+        long long count;
+        if (sscanf(rest, "%lf %lf %lld", &from, &to, &count) == 3 && count >= 0) {
+            Stream_SetRange(s, from, to, count);
+        } else {
+            Error(s, "expected range FROM TO COUNT");
+        }
+        return true;
+    }
+    // the rest change what a batch evaluates, so they start a new one
+    bool expr = IsWord(p, "expr", &rest);
+    bool y = !expr && IsWord(p, "y", &rest);
+    bool t = !expr && !y && IsWord(p, "t", &rest);
+    if (b->count > 0) return false;
+    if (expr) {
+        rest = SkipSpace(rest);
+        size_t length = strlen(rest);
+        while (length > 0 && (rest[length - 1] == '\n' || rest[length - 1] == '\r' || rest[length - 1] == ' ')) length--;
+        char* copy = (char*)realloc(s->exprText, length + 1);
+        if (copy) {
+            memcpy(copy, rest, length);
+            copy[length] = '\0';
+            s->exprText = copy;
+        }
+    } else if (y || t) {
+        if (!ParseNumber(SkipSpace(rest), &v)) Error(s, "expected a number");
+        else if (y) s->ctx.y = v;
+        else s->ctx.t = v;
+    }
+    Sync(s, b);
+    return true;
+}
+
+static bool IsDirective(const char* p) {
+    const char* rest;
+    return IsWord(p, "range", &rest) || IsWord(p, "expr", &rest) || IsWord(p, "y", &rest) || IsWord(p, "t", &rest);
+}
+
+static void FillRange(Stream* s, StreamBatch* b, int capacity) {
+    double step = s->rangeCount > 1 ? (s->rangeTo - s->rangeFrom) / (double)(s->rangeCount - 1) : 0.0;
+    while (b->count < capacity && s->rangeNext < s->rangeCount) {
+        int64_t i = s->rangeNext++;
+        // from the index rather than by adding steps, so a long range doesn't drift
+        b->xs[b->count++] = (i == s->rangeCount - 1 && i > 0) ? s->rangeTo : s->rangeFrom + step * (double)i;
+    }
+}
+
+static void ReadText(Stream* s, StreamBatch* b, int capacity) {
+    while (b->count < capacity) {
+        if (s->rangeNext < s->rangeCount) {
+            FillRange(s, b, capacity);
+            continue;
+        }
+        if (s->cursor) s->cursor = SkipSpace(s->cursor);
+        if (!s->cursor || *s->cursor == '\0' || *s->cursor == '#') {
+            if (!NextLine(s)) {
+                s->inputDone = true;
+                return;
+            }
+            continue;
+        }
+        if (IsDirective(s->cursor)) {
+            if (!Directive(s, b, s->cursor)) return;
+            s->cursor = NULL;
+            continue;
+        }
+        char* end;
+        double x = strtod(s->cursor, &end);
+        if (end == s->cursor) {
+            Error(s, "not a number");
+            s->cursor = NULL;
+            continue;
+        }
+        b->xs[b->count++] = x;
+        s->cursor = end;
+    }
+}
+
+static void ReadBinary(Stream* s, StreamBatch* b, int capacity) {
+    FillRange(s, b, capacity);
+    if (b->count == capacity) return;
+    size_t want = (size_t)(capacity - b->count);
+    uint8_t* raw = (uint8_t*)(b->xs + b->count);
+    size_t got = fread(raw, sizeof(double), want, s->in);
+    // decoded in place, every double lands where its bytes were
+    for (size_t i = 0; i < got; i++) b->xs[b->count + i] = GetDouble(raw + i * sizeof(double));
+    b->count += (int)got;
+    if (got < want) s->inputDone = true;
+}
+
+static void ReadBatch(void* user, int index, int worker) {
+    Stream* s = (Stream*)user;
+    StreamBatch* b = &s->slots[index];
+    (void)worker;
+    int capacity = s->chunksPerBatch * STREAM_CHUNK;
+    b->count = 0;
+    Sync(s, b);
+    if (!s->in) {
+        FillRange(s, b, capacity);
+        if (s->rangeNext >= s->rangeCount) s->inputDone = true;
+    } else if (s->options.input == STREAM_BINARY) {
+        ReadBinary(s, b, capacity);
+    } else {
+        ReadText(s, b, capacity);
+    }
+}
+
+static size_t Format(const Stream* s, const double* xs, const double* ys, int n, uint8_t* bytes) {
+    uint8_t* p = bytes;
+    if (s->options.output == STREAM_BINARY) {
+        for (int i = 0; i < n; i++) {
+            if (s->options.withX) {
+                PutDouble(p, xs[i]);
+                p += 8;
+            }
+            PutDouble(p, ys[i]);
+            p += 8;
+        }
+        return (size_t)(p - bytes);
+    }
+    int digits = s->options.digits;
+    for (int i = 0; i < n; i++) {
+        if (s->options.withX) {
+            p += snprintf((char*)p, 32, "%.*g", digits, xs[i]);
+            *p++ = '\t';
+        }
+        p += snprintf((char*)p, 32, "%.*g", digits, ys[i]);
+        *p++ = '\n';
+    }
+    return (size_t)(p - bytes);
+}
+
+// evaluates and formats one chunk, formatting is the slow part of text output
+static void EvaluateChunk(void* user, int index, int worker) {
+    Stream* s = (Stream*)user;
+    StreamBatch* b = &s->slots[s->evalSlot];
+    (void)worker;
+    int from = index * STREAM_CHUNK;
+    int n = b->count - from < STREAM_CHUNK ? b->count - from : STREAM_CHUNK;
+    if (Expr_IsEmpty(&b->expr)) {
+        for (int i = 0; i < n; i++) b->ys[from + i] = NAN;
+    } else {
+        Expr_EvaluateSpan(&b->expr, b->xs + from, b->ys + from, (size_t)n, &b->ctx);
+    }
+    uint8_t* bytes = b->bytes + (size_t)index * STREAM_CHUNK * STREAM_SAMPLE_BYTES;
+    b->byteCount[index] = Format(s, b->xs + from, b->ys + from, n, bytes);
+}
+
+static void WriteBatch(void* user, int index, int worker) {
+    Stream* s = (Stream*)user;
+    StreamBatch* b = &s->slots[index];
+    (void)worker;
+    int chunks = (b->count + STREAM_CHUNK - 1) / STREAM_CHUNK;
+    for (int c = 0; c < chunks && !s->writeFailed; c++) {
+        const uint8_t* bytes = b->bytes + (size_t)c * STREAM_CHUNK * STREAM_SAMPLE_BYTES;
+        if (fwrite(bytes, 1, b->byteCount[c], s->out) != b->byteCount[c]) s->writeFailed = true;
+    }
+    s->samples += b->count;
+}
+
+static bool AllocateSlots(Stream* s, int chunks) {
+    size_t samples = (size_t)chunks * STREAM_CHUNK;
+    for (int i = 0; i < STREAM_SLOTS; i++) {
+        StreamBatch* b = &s->slots[i];
+        b->xs = (double*)malloc(samples * sizeof(double));
+        b->ys = (double*)malloc(samples * sizeof(double));
+        b->bytes = (uint8_t*)malloc(samples * STREAM_SAMPLE_BYTES);
+        b->byteCount = (size_t*)calloc(chunks, sizeof(size_t));
+        if (!b->xs || !b->ys || !b->bytes || !b->byteCount) return false;
+    }
+    s->chunksPerBatch = chunks;
+    return true;
+}
+
+bool Stream_Run(Stream* s, ThreadPool* pool, FILE* in, FILE* out) {
+    // a couple of chunks per worker, enough to balance without holding much
+    int chunks = 2 * Pool_WorkerCount(pool);
+    if (chunks < 4) chunks = 4;
+    if (s->chunksPerBatch == 0 && !AllocateSlots(s, chunks)) return false;
+    PoolTask* tasks = (PoolTask*)malloc((size_t)(s->chunksPerBatch + 2) * sizeof(PoolTask));
+    if (!tasks) return false;
+
+    s->in = in;
+    s->out = out;
+    s->cursor = NULL;
+    s->inputDone = false;
+    for (int step = 0; !s->writeFailed; step++) {
+        int readSlot = step % STREAM_SLOTS;
+        int evalSlot = (step + 2) % STREAM_SLOTS;  // read last step
+        int writeSlot = (step + 1) % STREAM_SLOTS; // evaluated last step
+        int count = 0;
+        if (!s->inputDone) tasks[count++] = (PoolTask){ ReadBatch, s, readSlot };
+        else s->slots[readSlot].count = 0;
+        if (s->slots[writeSlot].count > 0) tasks[count++] = (PoolTask){ WriteBatch, s, writeSlot };
+        s->evalSlot = evalSlot;
+        int evalChunks = (s->slots[evalSlot].count + STREAM_CHUNK - 1) / STREAM_CHUNK;
+        for (int c = 0; c < evalChunks; c++) tasks[count++] = (PoolTask){ EvaluateChunk, s, c };
+        if (count == 0) break;
+        Pool_Run(pool, tasks, count);
+    }
+    free(tasks);
+    if (fflush(out) != 0 || ferror(out)) s->writeFailed = true;
+    return !s->writeFailed && s->errors == 0;
+}
+
+void Stream_Free(Stream* s) {
+    for (int i = 0; i < STREAM_SLOTS; i++) {
+        StreamBatch* b = &s->slots[i];
+        Expr_Free(&b->expr);
+        free(b->exprText);
+        free(b->xs);
+        free(b->ys);
+        free(b->bytes);
+        free(b->byteCount);
+    }
+    free(s->exprText);
+    free(s->line);
+    memset(s, 0, sizeof(*s));
+}
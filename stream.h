@@ -0,0 +1,83 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include "expr.h"
+#include "pool.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define STREAM_CHUNK 4096   // samples per evaluation task
+#define STREAM_SLOTS 3      // batches in flight: one read, one evaluated, one written
+#define STREAM_MAX_DIGITS 17
+
+typedef enum {
+    STREAM_TEXT,
+    STREAM_BINARY // little-endian doubles
+} StreamFormat;
+
+typedef struct {
+    StreamFormat input;
+    StreamFormat output;
+    bool withX;  // x before every f(x)
+    int digits;  // significant digits of text output, 17 round-trips
+} StreamOptions;
+
+// one batch of samples on its way through. each has its own copy of the expression, so
+// the reader can switch to the next one while the last is still being evaluated
+typedef struct {
+    Expr expr;
+    char* exprText;
+    EvalContext ctx;
+    int count;
+    double* xs;
+    double* ys;
+    uint8_t* bytes;      // formatted output, a fixed stride per chunk
+    size_t* byteCount;   // per chunk
+} StreamBatch;
+
+// evaluates an expression over xs read from a file or generated from ranges and writes
+// the results as they come. text input is lines of numbers and directives:
+//   expr sin(x)*t       evaluate this from here on
+//   y 2 / t 0.5         values of the other variables
+//   range 0 10 1000001  that many evenly spaced xs, both ends included
+//   # comment
+// reading, evaluating and writing overlap: every pool step reads one batch, evaluates
+// the one before in chunks and writes the one before that. memory is the three batches,
+// whatever the length of the input
+typedef struct {
+    StreamOptions options;
+    StreamBatch slots[STREAM_SLOTS];
+    int chunksPerBatch;
+    FILE* in;
+    FILE* out;
+    // reader state, carried from batch to batch
+    char* exprText;
+    EvalContext ctx;
+    double rangeFrom, rangeTo;
+    int64_t rangeCount, rangeNext;
+    char* line;
+    int lineCapacity;
+    const char* cursor; // what's left of line
+    int lineNumber;
+    bool inputDone;
+    // results
+    int64_t samples;
+    int errors;      // input lines that couldn't be read
+    bool writeFailed;
+    // the step in progress
+    int evalSlot;
+} Stream;
+
+void Stream_Init(Stream* s, const StreamOptions* options);
+// what to evaluate until the input says otherwise
+void Stream_SetExpression(Stream* s, const char* text);
+void Stream_SetVariables(Stream* s, double y, double t);
+// xs to evaluate before anything read from the input
+void Stream_SetRange(Stream* s, double from, double to, int64_t count);
+// runs until the input and the range are used up. in may be NULL for a range alone.
+// false when the output couldn't be written or part of the input was skipped
+bool Stream_Run(Stream* s, ThreadPool* pool, FILE* in, FILE* out);
+void Stream_Free(Stream* s);
+
+#endif
@@ -0,0 +1,154 @@
+#include "stroke.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// joins sharper than this many half widths fall back to a bevel
+#define STROKE_MITER_LIMIT 4.0
+
+void StrokeMesh_Init(StrokeMesh* mesh) {
+    memset(mesh, 0, sizeof(*mesh));
+}
+
+static bool Grow(void** data, int* capacity, int count, size_t itemSize) {
+    if (count <= *capacity) return true;
+    int newCapacity = *capacity ? *capacity : 1024;
+    while (newCapacity < count) newCapacity *= 2;
+    void* p = realloc(*data, (size_t)newCapacity * itemSize);
+    if (!p) return false;
+    *data = p;
+    *capacity = newCapacity;
+    return true;
+}
+
+// raylib culls clockwise triangles, so the winding is fixed here instead of at every caller
+static void Triangle(StrokeMesh* mesh, double ax, double ay, double bx, double by, double cx, double cy) {
+    if ((bx - ax) * (cy - ay) - (by - ay) * (cx - ax) > 0) {
+        double tx = bx, ty = by;
+        bx = cx; by = cy;
+        cx = tx; cy = ty;
+    }
+    float* v = mesh->xy + 2 * mesh->count;
+    v[0] = (float)ax; v[1] = (float)ay;
+    v[2] = (float)bx; v[3] = (float)by;
+    v[4] = (float)cx; v[5] = (float)cy;
+    mesh->count += 3;
+}
+
+// one run of at least two points, no two in a row the same
+static bool Tessellate(StrokeMesh* mesh, const double* p, int n) {
+    // a quad per segment and two join triangles per vertex at most
+    if (!Grow((void**)&mesh->xy, &mesh->capacity, mesh->count + 12 * n, 2 * sizeof(float))) return false;
+
+    double hw = mesh->thickness / 2.0;
+    // normal of the first segment
+    double dx = p[2] - p[0], dy = p[3] - p[1];
+    double len = sqrt(dx * dx + dy * dy);
+    double nx = -dy / len, ny = dx / len;
+    double lx = p[0] + nx * hw, ly = p[1] + ny * hw;
+    double rx = p[0] - nx * hw, ry = p[1] - ny * hw;
+    for (int i = 1; i < n; i++) {
+        double x = p[2 * i], y = p[2 * i + 1];
+        double elx = x + nx * hw, ely = y + ny * hw;
+        double erx = x - nx * hw, ery = y - ny * hw;
+        double mx = 0, my = 0;
+        bool miter = false;
+        if (i + 1 < n) {
+            dx = p[2 * i + 2] - x;
+            dy = p[2 * i + 3] - y;
+            len = sqrt(dx * dx + dy * dy);
+            double nnx = -dy / len, nny = dx / len;
+            // the miter points along the sum of the normals, hw / cos(half the turn) long
+            mx = nx + nnx;
+            my = ny + nny;
+            double m = sqrt(mx * mx + my * my);
+            if (m > 1e-9) {
+                mx /= m;
+                my /= m;
+                double c = mx * nnx + my * nny;
+                if (c > 1.0 / STROKE_MITER_LIMIT) {
+                    miter = true;
+                    elx = x + mx * hw / c; ely = y + my * hw / c;
+                    erx = x - mx * hw / c; ery = y - my * hw / c;
+                }
+            }
+            mx = nnx;
+            my = nny;
+        }
+
+        Triangle(mesh, lx, ly, rx, ry, elx, ely);
+        Triangle(mesh, elx, ely, rx, ry, erx, ery);
+        mesh->segments++;
+        if (i + 1 == n) break;
+
+        if (miter) {
+            lx = elx; ly = ely;
+            rx = erx; ry = ery;
+        } else {
+            // bevel, both sides since the inner one is hidden under the quads anyway
+            lx = x + mx * hw; ly = y + my * hw;
+            rx = x - mx * hw; ry = y - my * hw;
+            Triangle(mesh, x, y, elx, ely, lx, ly);
+            Triangle(mesh, x, y, erx, ery, rx, ry);
+        }
+        nx = mx;
+        ny = my;
+    }
+    return true;
+}
+
+static void Reset(StrokeMesh* mesh, const void* source, unsigned generation, float thickness) {
+    mesh->source = source;
+    mesh->generation = generation;
+    mesh->thickness = thickness;
+    mesh->count = 0;
+    mesh->segments = 0;
+    mesh->valid = true;
+}
+
+bool StrokeMesh_FromPath(StrokeMesh* mesh, const CurvePath* path, float thickness) {
+    if (mesh->valid && path->valid && mesh->source == path && mesh->generation == path->generation &&
+        mesh->thickness == thickness) {
+        return false;
+    }
+    Reset(mesh, path, path->generation, thickness);
+    if (!path->valid) return true;
+
+    bool ok = true;
+    for (int r = 0; r < path->runCount && ok; r++) {
+        int end = r + 1 < path->runCount ? path->runs[r + 1] : path->count;
+        ok = Tessellate(mesh, path->xy + 2 * path->runs[r], end - path->runs[r]);
+    }
+    if (!ok) {
+        mesh->count = 0;
+        mesh->valid = false;
+    }
+    return true;
+}
+
+bool StrokeMesh_FromPlot(StrokeMesh* mesh, const ImplicitPlot* plot, float thickness) {
+    if (mesh->valid && plot->valid && mesh->source == plot && mesh->generation == plot->generation &&
+        mesh->thickness == thickness) {
+        return false;
+    }
+    Reset(mesh, plot, plot->generation, thickness);
+    if (!plot->valid) return true;
+
+    bool ok = true;
+    for (int i = 0; i < plot->segmentCount && ok; i++) {
+        const ImplicitSegment* s = &plot->segments[i];
+        double p[4] = { s->x0, s->y0, s->x1, s->y1 };
+        if (s->x0 == s->x1 && s->y0 == s->y1) continue;
+        ok = Tessellate(mesh, p, 2);
+    }
+    if (!ok) {
+        mesh->count = 0;
+        mesh->valid = false;
+    }
+    return true;
+}
+
+void StrokeMesh_Free(StrokeMesh* mesh) {
+    free(mesh->xy);
+    StrokeMesh_Init(mesh);
+}
@@ -0,0 +1,29 @@
+#ifndef STROKE_H
+#define STROKE_H
+
+#include "path.h"
+#include "implicit.h"
+#include <stdbool.h>
+
+// a curve as one list of screen space triangles, thick line with mitered joins, so it goes
+// out in one batch instead of a draw call per segment. kept between frames like RegionLayer
+typedef struct {
+    float* xy;    // x, y per vertex, three vertices per triangle, counter-clockwise on screen
+    int count;    // vertices
+    int capacity;
+    int segments; // segments tessellated by the last build
+    // what it was built from
+    const void* source;
+    unsigned generation;
+    float thickness;
+    bool valid;
+} StrokeMesh;
+
+void StrokeMesh_Init(StrokeMesh* mesh);
+// every run of a clipped and simplified curve. returns true when the triangles were rebuilt
+bool StrokeMesh_FromPath(StrokeMesh* mesh, const CurvePath* path, float thickness);
+// the segments of an implicit plot, which are already in screen space
+bool StrokeMesh_FromPlot(StrokeMesh* mesh, const ImplicitPlot* plot, float thickness);
+void StrokeMesh_Free(StrokeMesh* mesh);
+
+#endif
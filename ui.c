@@ -42,7 +42,8 @@ void DrawInputField(InputField *input, Font font) {
     }
 }
 
-void UpdateInputField(InputField *input) {
+bool UpdateInputField(InputField *input) {
+    bool changed = false;
     if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON)) {
         if (CheckCollisionPointRec(GetMousePosition(), input->rect)) {
             input->focused = true;
@@ -58,6 +59,7 @@ void UpdateInputField(InputField *input) {
                 input->text[input->letterCount] = (char)key;
                 input->text[input->letterCount + 1] = '\0';
                 input->letterCount++;
+                changed = true;
             }
             key = GetCharPressed();
         }
@@ -66,9 +68,11 @@ void UpdateInputField(InputField *input) {
             if (input->letterCount > 0) {
                 input->letterCount--;
                 input->text[input->letterCount] = '\0';
+                changed = true;
             }
         }
     }
+    return changed;
 }
 
 void InitKeyboard(Keyboard *kb, int screenWidth, int screenHeight) {
@@ -31,7 +31,8 @@ void DrawButton(Button *btn, Font font);
 bool CheckButton(Button *btn);
 
 void DrawInputField(InputField *input, Font font);
-void UpdateInputField(InputField *input);
+// true when the text changed
+bool UpdateInputField(InputField *input);
 
 void InitKeyboard(Keyboard *kb, int screenWidth, int screenHeight);
 void ResizeKeyboard(Keyboard *kb, int screenWidth, int screenHeight);
@@ -0,0 +1,376 @@
+#include "vecmath.h"
+#include <math.h>
+#include <stdint.h>
+
+// scalar kernels, used as the fallback and for tails
+
+static void ScalarAdd(double* d, const double* a, const double* b, int n) {
+    for (int i = 0; i < n; i++) d[i] = a[i] + b[i];
+}
+
+static void ScalarSub(double* d, const double* a, const double* b, int n) {
+    for (int i = 0; i < n; i++) d[i] = a[i] - b[i];
+}
+
+static void ScalarMul(double* d, const double* a, const double* b, int n) {
+    for (int i = 0; i < n; i++) d[i] = a[i] * b[i];
+}
+
+static void ScalarDiv(double* d, const double* a, const double* b, int n) {
+    for (int i = 0; i < n; i++) d[i] = (b[i] != 0) ? a[i] / b[i] : NAN;
+}
+
+static void ScalarNeg(double* d, const double* a, int n) {
+    for (int i = 0; i < n; i++) d[i] = -a[i];
+}
+
+static void ScalarSqrt(double* d, const double* a, int n) {
+    for (int i = 0; i < n; i++) d[i] = sqrt(a[i]);
+}
+
+static void ScalarAbs(double* d, const double* a, int n) {
+    for (int i = 0; i < n; i++) d[i] = fabs(a[i]);
+}
+
+static void ScalarSin(double* d, const double* a, int n) {
+    for (int i = 0; i < n; i++) d[i] = sin(a[i]);
+}
+
+static void ScalarCos(double* d, const double* a, int n) {
+    for (int i = 0; i < n; i++) d[i] = cos(a[i]);
+}
+
+static void ScalarExp(double* d, const double* a, int n) {
+    for (int i = 0; i < n; i++) d[i] = exp(a[i]);
+}
+
+static void ScalarLog(double* d, const double* a, int n) {
+    for (int i = 0; i < n; i++) d[i] = log(a[i]);
+}
+
+static const VecKernels scalarKernels = {
+    "scalar",
+    ScalarAdd, ScalarSub, ScalarMul, ScalarDiv,
+    ScalarNeg, ScalarSqrt, ScalarAbs,
+    ScalarSin, ScalarCos, ScalarExp, ScalarLog
+};
+
+const VecKernels* VecMath_GetScalar(void) {
+    return &scalarKernels;
+}
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+
+// sse2 is part of x86-64, so these need no runtime check.
+// transcendentals stay on libm at this width.
+
+static void Sse2Add(double* d, const double* a, const double* b, int n) {
+    int i = 0;
+    for (; i + 2 <= n; i += 2) _mm_storeu_pd(d + i, _mm_add_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+    ScalarAdd(d + i, a + i, b + i, n - i);
+}
+
+static void Sse2Sub(double* d, const double* a, const double* b, int n) {
+    int i = 0;
+    for (; i + 2 <= n; i += 2) _mm_storeu_pd(d + i, _mm_sub_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+    ScalarSub(d + i, a + i, b + i, n - i);
+}
+
+static void Sse2Mul(double* d, const double* a, const double* b, int n) {
+    int i = 0;
+    for (; i + 2 <= n; i += 2) _mm_storeu_pd(d + i, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+    ScalarMul(d + i, a + i, b + i, n - i);
+}
+
+static void Sse2Div(double* d, const double* a, const double* b, int n) {
+    const __m128d zero = _mm_setzero_pd();
+    const __m128d nan = _mm_set1_pd(NAN);
+    int i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128d vb = _mm_loadu_pd(b + i);
+        __m128d q = _mm_div_pd(_mm_loadu_pd(a + i), vb);
+        __m128d isZero = _mm_cmpeq_pd(vb, zero);
+        _mm_storeu_pd(d + i, _mm_or_pd(_mm_and_pd(isZero, nan), _mm_andnot_pd(isZero, q)));
+    }
+    ScalarDiv(d + i, a + i, b + i, n - i);
+}
+
+static void Sse2Neg(double* d, const double* a, int n) {
+    const __m128d sign = _mm_set1_pd(-0.0);
+    int i = 0;
+    for (; i + 2 <= n; i += 2) _mm_storeu_pd(d + i, _mm_xor_pd(_mm_loadu_pd(a + i), sign));
+    ScalarNeg(d + i, a + i, n - i);
+}
+
+static void Sse2Sqrt(double* d, const double* a, int n) {
+    int i = 0;
+    for (; i + 2 <= n; i += 2) _mm_storeu_pd(d + i, _mm_sqrt_pd(_mm_loadu_pd(a + i)));
+    ScalarSqrt(d + i, a + i, n - i);
+}
+
+static void Sse2Abs(double* d, const double* a, int n) {
+    const __m128d sign = _mm_set1_pd(-0.0);
+    int i = 0;
+    for (; i + 2 <= n; i += 2) _mm_storeu_pd(d + i, _mm_andnot_pd(sign, _mm_loadu_pd(a + i)));
+    ScalarAbs(d + i, a + i, n - i);
+}
+
+static const VecKernels sse2Kernels = {
+    "sse2",
+    Sse2Add, Sse2Sub, Sse2Mul, Sse2Div,
+    Sse2Neg, Sse2Sqrt, Sse2Abs,
+    ScalarSin, ScalarCos, ScalarExp, ScalarLog
+};
+
+// avx2 + fma kernels, only called after the cpuid check in VecMath_Get
+
+#define AVX2_FN __attribute__((target("avx2,fma")))
+
+AVX2_FN static void Avx2Add(double* d, const double* a, const double* b, int n) {
+    int i = 0;
+    for (; i + 4 <= n; i += 4) _mm256_storeu_pd(d + i, _mm256_add_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+    ScalarAdd(d + i, a + i, b + i, n - i);
+}
+
+AVX2_FN static void Avx2Sub(double* d, const double* a, const double* b, int n) {
+    int i = 0;
+    for (; i + 4 <= n; i += 4) _mm256_storeu_pd(d + i, _mm256_sub_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+    ScalarSub(d + i, a + i, b + i, n - i);
+}
+
+AVX2_FN static void Avx2Mul(double* d, const double* a, const double* b, int n) {
+    int i = 0;
+    for (; i + 4 <= n; i += 4) _mm256_storeu_pd(d + i, _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+    ScalarMul(d + i, a + i, b + i, n - i);
+}
+
+AVX2_FN static void Avx2Div(double* d, const double* a, const double* b, int n) {
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d nan = _mm256_set1_pd(NAN);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d vb = _mm256_loadu_pd(b + i);
+        __m256d q = _mm256_div_pd(_mm256_loadu_pd(a + i), vb);
+        _mm256_storeu_pd(d + i, _mm256_blendv_pd(q, nan, _mm256_cmp_pd(vb, zero, _CMP_EQ_OQ)));
+    }
+    ScalarDiv(d + i, a + i, b + i, n - i);
+}
+
+AVX2_FN static void Avx2Neg(double* d, const double* a, int n) {
+    const __m256d sign = _mm256_set1_pd(-0.0);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) _mm256_storeu_pd(d + i, _mm256_xor_pd(_mm256_loadu_pd(a + i), sign));
+    ScalarNeg(d + i, a + i, n - i);
+}
+
+AVX2_FN static void Avx2Sqrt(double* d, const double* a, int n) {
+    int i = 0;
+    for (; i + 4 <= n; i += 4) _mm256_storeu_pd(d + i, _mm256_sqrt_pd(_mm256_loadu_pd(a + i)));
+    ScalarSqrt(d + i, a + i, n - i);
+}
+
+AVX2_FN static void Avx2Abs(double* d, const double* a, int n) {
+    const __m256d sign = _mm256_set1_pd(-0.0);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) _mm256_storeu_pd(d + i, _mm256_andnot_pd(sign, _mm256_loadu_pd(a + i)));
+    ScalarAbs(d + i, a + i, n - i);
+}
+
+// exp: x = n*ln2 + r with |r| <= ln2/2, exp(r) by a degree 13 taylor series, then scale by 2^n
+AVX2_FN static inline __m256d Avx2Exp4(__m256d x) {
+    const __m256d magic = _mm256_set1_pd(6755399441055744.0); // 1.5 * 2^52
+    const __m256i magicBits = _mm256_set1_epi64x(0x4338000000000000LL);
+    const __m256i bias = _mm256_set1_epi64x(1023);
+
+    __m256d xc = _mm256_min_pd(_mm256_max_pd(x, _mm256_set1_pd(-746.0)), _mm256_set1_pd(710.0));
+    __m256d n = _mm256_round_pd(_mm256_mul_pd(xc, _mm256_set1_pd(1.4426950408889634)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m256d r = _mm256_fnmadd_pd(n, _mm256_set1_pd(6.93147180369123816490e-01), xc);
+    r = _mm256_fnmadd_pd(n, _mm256_set1_pd(1.90821492927058770002e-10), r);
+
+    __m256d p = _mm256_set1_pd(1.0 / 6227020800.0);
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 479001600.0));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 39916800.0));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 3628800.0));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 362880.0));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 40320.0));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 5040.0));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 720.0));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 120.0));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 24.0));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 6.0));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(0.5));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0));
+
+    // split 2^n in two factors so subnormal results and n = 1024 stay representable
+    __m256d n1 = _mm256_floor_pd(_mm256_mul_pd(n, _mm256_set1_pd(0.5)));
+    __m256d n2 = _mm256_sub_pd(n, n1);
+    __m256i k1 = _mm256_sub_epi64(_mm256_castpd_si256(_mm256_add_pd(n1, magic)), magicBits);
+    __m256i k2 = _mm256_sub_epi64(_mm256_castpd_si256(_mm256_add_pd(n2, magic)), magicBits);
+    __m256d s1 = _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_add_epi64(k1, bias), 52));
+    __m256d s2 = _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_add_epi64(k2, bias), 52));
+    __m256d res = _mm256_mul_pd(_mm256_mul_pd(p, s1), s2);
+
+    res = _mm256_blendv_pd(res, _mm256_set1_pd(INFINITY), _mm256_cmp_pd(x, _mm256_set1_pd(709.782712893384), _CMP_GT_OQ));
+    res = _mm256_blendv_pd(res, _mm256_setzero_pd(), _mm256_cmp_pd(x, _mm256_set1_pd(-745.1332191019412), _CMP_LT_OQ));
+    return _mm256_blendv_pd(res, x, _mm256_cmp_pd(x, x, _CMP_UNORD_Q));
+}
+
+// log: same reduction and polynomial as fdlibm's e_log.c, x = 2^e * m with m in [sqrt(2)/2, sqrt(2))
+AVX2_FN static inline __m256d Avx2Log4(__m256d x) {
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d twoP52 = _mm256_set1_pd(4503599627370496.0);
+
+    // bring subnormals into the normal range first
+    __m256d isSub = _mm256_cmp_pd(x, _mm256_set1_pd(2.2250738585072014e-308), _CMP_LT_OQ);
+    __m256d xs = _mm256_blendv_pd(x, _mm256_mul_pd(x, _mm256_set1_pd(18014398509481984.0)), isSub); // 2^54
+    __m256i bits = _mm256_castpd_si256(xs);
+
+    __m256i expBits = _mm256_or_si256(_mm256_srli_epi64(bits, 52), _mm256_castpd_si256(twoP52));
+    __m256d e = _mm256_sub_pd(_mm256_castsi256_pd(expBits), _mm256_set1_pd(4503599627370496.0 + 1023.0));
+    e = _mm256_sub_pd(e, _mm256_and_pd(isSub, _mm256_set1_pd(54.0)));
+
+    __m256i mantBits = _mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi64x(0x000fffffffffffffLL)),
+                                       _mm256_set1_epi64x(0x3ff0000000000000LL));
+    __m256d m = _mm256_castsi256_pd(mantBits);
+    __m256d big = _mm256_cmp_pd(m, _mm256_set1_pd(1.4142135623730951), _CMP_GT_OQ);
+    m = _mm256_blendv_pd(m, _mm256_mul_pd(m, _mm256_set1_pd(0.5)), big);
+    e = _mm256_add_pd(e, _mm256_and_pd(big, one));
+
+    __m256d f = _mm256_sub_pd(m, one);
+    __m256d s = _mm256_div_pd(f, _mm256_add_pd(_mm256_set1_pd(2.0), f));
+    __m256d z = _mm256_mul_pd(s, s);
+    __m256d w = _mm256_mul_pd(z, z);
+    __m256d t1 = _mm256_fmadd_pd(w, _mm256_set1_pd(1.531383769920937332e-01), _mm256_set1_pd(2.222219843214978396e-01));
+    t1 = _mm256_fmadd_pd(w, t1, _mm256_set1_pd(3.999999999940941908e-01));
+    t1 = _mm256_mul_pd(w, t1);
+    __m256d t2 = _mm256_fmadd_pd(w, _mm256_set1_pd(1.479819860511658591e-01), _mm256_set1_pd(1.818357216161805012e-01));
+    t2 = _mm256_fmadd_pd(w, t2, _mm256_set1_pd(2.857142874366239149e-01));
+    t2 = _mm256_fmadd_pd(w, t2, _mm256_set1_pd(6.666666666666735130e-01));
+    t2 = _mm256_mul_pd(z, t2);
+    __m256d R = _mm256_add_pd(t2, t1);
+    __m256d hfsq = _mm256_mul_pd(_mm256_mul_pd(_mm256_set1_pd(0.5), f), f);
+
+    // e*ln2_hi - ((hfsq - (s*(hfsq+R) + e*ln2_lo)) - f)
+    __m256d inner = _mm256_fmadd_pd(e, _mm256_set1_pd(1.90821492927058770002e-10), _mm256_mul_pd(s, _mm256_add_pd(hfsq, R)));
+    __m256d res = _mm256_sub_pd(_mm256_mul_pd(e, _mm256_set1_pd(6.93147180369123816490e-01)),
+                                _mm256_sub_pd(_mm256_sub_pd(hfsq, inner), f));
+
+    res = _mm256_blendv_pd(res, _mm256_set1_pd(NAN), _mm256_cmp_pd(x, _mm256_setzero_pd(), _CMP_LT_OQ));
+    res = _mm256_blendv_pd(res, _mm256_set1_pd(-INFINITY), _mm256_cmp_pd(x, _mm256_setzero_pd(), _CMP_EQ_OQ));
+    res = _mm256_blendv_pd(res, x, _mm256_cmp_pd(x, _mm256_set1_pd(INFINITY), _CMP_EQ_OQ));
+    return _mm256_blendv_pd(res, x, _mm256_cmp_pd(x, x, _CMP_UNORD_Q));
+}
+
+// sin/cos: cephes style reduction by pi/4 in three parts, good while |x| < 2^30
+#define SINCOS_MAX_ARG 1.073741824e9
+
+AVX2_FN static inline __m256d Avx2SinCos4(__m256d x, int wantCos) {
+    const __m256d signMask = _mm256_set1_pd(-0.0);
+    const __m256d one = _mm256_set1_pd(1.0);
+
+    __m256d ax = _mm256_andnot_pd(signMask, x);
+    __m256d y = _mm256_floor_pd(_mm256_mul_pd(ax, _mm256_set1_pd(1.27323954473516268615))); // 4/pi
+    __m256d odd = _mm256_sub_pd(y, _mm256_mul_pd(_mm256_set1_pd(2.0), _mm256_floor_pd(_mm256_mul_pd(y, _mm256_set1_pd(0.5)))));
+    y = _mm256_add_pd(y, odd);
+    __m256d j = _mm256_sub_pd(y, _mm256_mul_pd(_mm256_set1_pd(8.0), _mm256_floor_pd(_mm256_mul_pd(y, _mm256_set1_pd(0.125)))));
+
+    __m256d z = _mm256_fnmadd_pd(y, _mm256_set1_pd(7.85398125648498535156e-1), ax);
+    z = _mm256_fnmadd_pd(y, _mm256_set1_pd(3.77489470793079817668e-8), z);
+    z = _mm256_fnmadd_pd(y, _mm256_set1_pd(2.69515142907905952645e-15), z);
+    __m256d zz = _mm256_mul_pd(z, z);
+
+    __m256d ps = _mm256_set1_pd(1.58962301576546568060e-10);
+    ps = _mm256_fmadd_pd(ps, zz, _mm256_set1_pd(-2.50507477628578072866e-8));
+    ps = _mm256_fmadd_pd(ps, zz, _mm256_set1_pd(2.75573136213857245213e-6));
+    ps = _mm256_fmadd_pd(ps, zz, _mm256_set1_pd(-1.98412698295895385996e-4));
+    ps = _mm256_fmadd_pd(ps, zz, _mm256_set1_pd(8.33333333332211858878e-3));
+    ps = _mm256_fmadd_pd(ps, zz, _mm256_set1_pd(-1.66666666666666307295e-1));
+    __m256d sinPoly = _mm256_fmadd_pd(_mm256_mul_pd(z, zz), ps, z);
+
+    __m256d pc = _mm256_set1_pd(-1.13585365213876817300e-11);
+    pc = _mm256_fmadd_pd(pc, zz, _mm256_set1_pd(2.08757008419747316778e-9));
+    pc = _mm256_fmadd_pd(pc, zz, _mm256_set1_pd(-2.75573141792967388112e-7));
+    pc = _mm256_fmadd_pd(pc, zz, _mm256_set1_pd(2.48015872888517045348e-5));
+    pc = _mm256_fmadd_pd(pc, zz, _mm256_set1_pd(-1.38888888888730564116e-3));
+    pc = _mm256_fmadd_pd(pc, zz, _mm256_set1_pd(4.16666666666665929218e-2));
+    __m256d cosPoly = _mm256_fmadd_pd(_mm256_mul_pd(zz, zz), pc, _mm256_fnmadd_pd(_mm256_set1_pd(0.5), zz, one));
+
+    // octant bookkeeping, j is one of 0, 2, 4, 6
+    __m256d upper = _mm256_cmp_pd(j, _mm256_set1_pd(3.0), _CMP_GT_OQ);
+    j = _mm256_sub_pd(j, _mm256_and_pd(upper, _mm256_set1_pd(4.0)));
+    __m256d useOther = _mm256_cmp_pd(j, _mm256_set1_pd(2.0), _CMP_EQ_OQ);
+    __m256d sign;
+    __m256d res;
+    if (wantCos) {
+        sign = _mm256_xor_pd(_mm256_and_pd(upper, signMask), _mm256_and_pd(useOther, signMask));
+        res = _mm256_blendv_pd(cosPoly, sinPoly, useOther);
+    } else {
+        sign = _mm256_xor_pd(_mm256_and_pd(x, signMask), _mm256_and_pd(upper, signMask));
+        res = _mm256_blendv_pd(sinPoly, cosPoly, useOther);
+    }
+    return _mm256_xor_pd(res, sign);
+}
+
+AVX2_FN static void Avx2SinCos(double* d, const double* a, int n, int wantCos) {
+    const __m256d signMask = _mm256_set1_pd(-0.0);
+    const __m256d maxArg = _mm256_set1_pd(SINCOS_MAX_ARG);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d x = _mm256_loadu_pd(a + i);
+        if (_mm256_movemask_pd(_mm256_cmp_pd(_mm256_andnot_pd(signMask, x), maxArg, _CMP_GT_OQ))) {
+            // huge arguments need a full range reduction, leave those to libm
+            for (int k = 0; k < 4; k++) d[i + k] = wantCos ? cos(a[i + k]) : sin(a[i + k]);
+            continue;
+        }
+        _mm256_storeu_pd(d + i, Avx2SinCos4(x, wantCos));
+    }
+    if (wantCos) ScalarCos(d + i, a + i, n - i);
+    else ScalarSin(d + i, a + i, n - i);
+}
+
+AVX2_FN static void Avx2Sin(double* d, const double* a, int n) {
+    Avx2SinCos(d, a, n, 0);
+}
+
+AVX2_FN static void Avx2Cos(double* d, const double* a, int n) {
+    Avx2SinCos(d, a, n, 1);
+}
+
+AVX2_FN static void Avx2Exp(double* d, const double* a, int n) {
+    int i = 0;
+    for (; i + 4 <= n; i += 4) _mm256_storeu_pd(d + i, Avx2Exp4(_mm256_loadu_pd(a + i)));
+    ScalarExp(d + i, a + i, n - i);
+}
+
+AVX2_FN static void Avx2Log(double* d, const double* a, int n) {
+    int i = 0;
+    for (; i + 4 <= n; i += 4) _mm256_storeu_pd(d + i, Avx2Log4(_mm256_loadu_pd(a + i)));
+    ScalarLog(d + i, a + i, n - i);
+}
+
+static const VecKernels avx2Kernels = {
+    "avx2",
+    Avx2Add, Avx2Sub, Avx2Mul, Avx2Div,
+    Avx2Neg, Avx2Sqrt, Avx2Abs,
+    Avx2Sin, Avx2Cos, Avx2Exp, Avx2Log
+};
+
+const VecKernels* VecMath_Get(void) {
+    static const VecKernels* selected = NULL;
+    if (!selected) {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) selected = &avx2Kernels;
+        else selected = &sse2Kernels;
+    }
+    return selected;
+}
+
+#else
+
+const VecKernels* VecMath_Get(void) {
+    return &scalarKernels;
+}
+
+#endif
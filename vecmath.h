@@ -0,0 +1,27 @@
+#ifndef VECMATH_H
+#define VECMATH_H
+
+// array kernels used by the batch evaluator, d[i] = op(a[i], b[i]) for i < n
+typedef void (*VecBinaryFn)(double* d, const double* a, const double* b, int n);
+typedef void (*VecUnaryFn)(double* d, const double* a, int n);
+
+typedef struct {
+    const char* name;
+    VecBinaryFn add;
+    VecBinaryFn sub;
+    VecBinaryFn mul;
+    VecBinaryFn div; // NaN where b == 0, same as AST_Evaluate
+    VecUnaryFn neg;
+    VecUnaryFn sqrt;
+    VecUnaryFn abs;
+    VecUnaryFn sin;
+    VecUnaryFn cos;
+    VecUnaryFn exp;
+    VecUnaryFn log;
+} VecKernels;
+
+// picks the best kernel set for this cpu on first call (avx2, sse2 or scalar)
+const VecKernels* VecMath_Get(void);
+const VecKernels* VecMath_GetScalar(void);
+
+#endif